@@ -131,6 +131,12 @@ typedef struct {
     void (*subscriptionInactivityCallback)(UA_Client *client,
                                            UA_UInt32 subscriptionId,
                                            void *subContext);
+
+    /* Decode the notifications of a PublishResponse one at a time and call
+     * the MonitoredItem callbacks during decoding. The notification arrays
+     * are not materialised. The values passed to the callbacks are only valid
+     * during the callback. */
+    UA_Boolean streamNotifications;
 #endif
 } UA_ClientConfig;
 
@@ -209,6 +209,8 @@ typedef struct {
     size_t rejectedSessionCount;
     size_t sessionTimeoutCount;          /* only used by servers */
     size_t sessionAbortCount;            /* only used by servers */
+    size_t accessCacheHitCount;          /* only used by servers */
+    size_t accessCacheMissCount;         /* only used by servers */
 } UA_SessionStatistics;
 
 /**
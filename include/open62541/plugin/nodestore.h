@@ -18,7 +18,6 @@
  * / OPC UA services to interact with the information model. */
 
 #include <open62541/server.h>
-#include "ziptree.h"
 
 _UA_BEGIN_DECLS
 
@@ -66,31 +65,29 @@ struct UA_MonitoredItem;
  * not known or not important. The ``nodeClass`` attribute is used to ensure the
  * correctness of casting from ``UA_Node`` to a specific node type. */
 
-/* Ordered tree structure for fast member check */
-typedef struct UA_ReferenceTarget {
-    ZIP_ENTRY(UA_ReferenceTarget) idTreeFields;
-    ZIP_ENTRY(UA_ReferenceTarget) nameTreeFields;
+typedef struct {
     UA_UInt32 targetIdHash;   /* Hash of the target's NodeId */
     UA_UInt32 targetNameHash; /* Hash of the target's BrowseName */
     UA_ExpandedNodeId targetId;
 } UA_ReferenceTarget;
 
-ZIP_HEAD(UA_ReferenceTargetIdTree, UA_ReferenceTarget);
-typedef struct UA_ReferenceTargetIdTree UA_ReferenceTargetIdTree;
-ZIP_PROTTYPE(UA_ReferenceTargetIdTree, UA_ReferenceTarget, UA_ReferenceTarget)
-
-ZIP_HEAD(UA_ReferenceTargetNameTree, UA_ReferenceTarget);
-typedef struct UA_ReferenceTargetNameTree UA_ReferenceTargetNameTree;
-ZIP_PROTTYPE(UA_ReferenceTargetNameTree, UA_ReferenceTarget, UA_UInt32)
+/* Lists with more targets get an index for the lookup */
+#define UA_REFERENCETARGETS_INDEXTHRESHOLD 16
 
-/* List of reference targets with the same reference type and direction */
+/* List of reference targets with the same reference type and direction. The
+ * targets are stored in a flat array. Short lists are scanned for the lookup
+ * of a target. Longer lists have an index (open addressing with linear
+ * probing) with the position of the targets in the array. The first half of
+ * the index is ordered by the NodeId hash, the second half by the BrowseName
+ * hash. Use the lookup methods below instead of accessing the index
+ * directly. */
 typedef struct {
     UA_NodeId referenceTypeId;
     UA_Boolean isInverse;
     size_t refTargetsSize;
     UA_ReferenceTarget *refTargets;
-    UA_ReferenceTargetIdTree refTargetsIdTree;
-    UA_ReferenceTargetNameTree refTargetsNameTree;
+    size_t refTargetsIndexSize;    /* Slots in each half (power of two) */
+    UA_UInt32 *refTargetsIndex;    /* Position + 1 of the target. 0 is empty. */
 } UA_NodeReferenceKind;
 
 /* Every Node starts with these attributes */
@@ -269,9 +266,6 @@ typedef struct {
 
 typedef struct {
     UA_NodeHead head;
-#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-    struct UA_MonitoredItem *monitoredItemQueue;
-#endif
     UA_Byte eventNotifier;
 } UA_ObjectNode;
 
@@ -473,6 +467,16 @@ typedef union {
 
 typedef void (*UA_NodestoreVisitor)(void *visitorCtx, const UA_Node *node);
 
+/* A range of NodeIds for ordered scans. The range contains all NodeIds of the
+ * namespace. If numericOnly is set, only the numeric NodeIds with an identifier
+ * in [numericMin, numericMax] are contained. */
+typedef struct {
+    UA_UInt16 namespaceIndex;
+    UA_Boolean numericOnly;
+    UA_UInt32 numericMin;
+    UA_UInt32 numericMax;
+} UA_NodeIdRange;
+
 typedef struct {
     /* Nodestore context and lifecycle */
     void *context;
@@ -516,6 +520,38 @@ typedef struct {
     /* Execute a callback for every node in the nodestore. */
     void (*iterate)(void *nsCtx, UA_NodestoreVisitor visitor,
                     void *visitorCtx);
+
+    /* Optional. Gets several nodes in one call so that the nodestore can
+     * overlap the lookups (e.g. by prefetching). For NodeIds that are NULL or
+     * not found, the output node is NULL. Every node that was found has to be
+     * released individually with ``releaseNode``. If not defined, ``getNode``
+     * is used for every NodeId. */
+    void (*getNodes)(void *nsCtx, size_t nodeIdsSize, const UA_NodeId **nodeIds,
+                     const UA_Node **outNodes);
+
+    /* Optional. Called after a node was edited in-situ (a node from ``getNode``
+     * and not an editable copy). The node is still acquired by the caller.
+     * Used for example to persist the changes. */
+    void (*nodeChanged)(void *nsCtx, const UA_Node *node);
+
+    /* Optional. Ordered scan over a range of NodeIds. Returns the next node of
+     * the range after the cursor or NULL when the end of the range is reached.
+     * The returned node has to be released with ``releaseNode``. The cursor is
+     * set to the null-NodeId before the first call and is then replaced with a
+     * copy of the NodeId of the returned node. So nodes can be added and
+     * removed between the calls. Clear the cursor with UA_NodeId_clear after
+     * the scan. Within a namespace, the numeric NodeIds come first and are
+     * ordered by their identifier. The order of the other NodeIds is
+     * unspecified but stable. If not defined, ``iterate`` has to be used and
+     * the NodeIds filtered. */
+    const UA_Node * (*getNextNode)(void *nsCtx, const UA_NodeIdRange *range,
+                                   UA_NodeId *cursor);
+
+    /* Optional. Returns whether the caller holds the only reference to a node
+     * from ``getNode``. Then no other consumer observes an in-situ edit of the
+     * node. The server uses this to edit nodes in-situ with immutable nodes
+     * when it can. If not defined, nodes are always copied for editing. */
+    UA_Boolean (*isNodeExclusive)(void *nsCtx, const UA_Node *node);
 } UA_Nodestore;
 
 /* Attributes must be of a matching type (VariableAttributes, ObjectAttributes,
@@ -535,6 +571,23 @@ UA_Node_copy(const UA_Node *src, UA_Node *dst);
 UA_EXPORT UA_Node *
 UA_Node_copy_alloc(const UA_Node *src);
 
+/* Binary encoding of a node with all attributes and references. Node contexts,
+ * DataSources, value callbacks and method callbacks are not encoded. A
+ * VariableNode with a DataSource is encoded with an empty value. Returns zero
+ * if the node cannot be encoded. */
+UA_EXPORT size_t
+UA_Node_calcSizeBinary(const UA_Node *node);
+
+UA_StatusCode UA_EXPORT
+UA_Node_encodeBinary(const UA_Node *node, UA_Byte **bufPos, const UA_Byte *bufEnd);
+
+/* Decodes a node at the offset of the ByteString. The node is allocated with
+ * the newNode method of the nodestore. The offset is moved past the node. */
+UA_StatusCode UA_EXPORT
+UA_Node_decodeBinary(const UA_ByteString *src, size_t *offset,
+                     const UA_DataTypeArray *customTypes,
+                     const UA_Nodestore *ns, UA_Node **outNode);
+
 /* Add a single reference to the node */
 UA_StatusCode UA_EXPORT
 UA_Node_addReference(UA_Node *node, const UA_AddReferencesItem *item,
@@ -548,6 +601,17 @@ UA_Node_deleteReference(UA_Node *node, const UA_DeleteReferencesItem *item);
 void UA_EXPORT
 UA_Node_deleteReferences(UA_Node *node);
 
+/* Returns the target with the given NodeId or NULL */
+UA_EXPORT const UA_ReferenceTarget *
+UA_NodeReferenceKind_findTarget(const UA_NodeReferenceKind *rk,
+                                const UA_ExpandedNodeId *targetId);
+
+/* Iterate over the targets with the given BrowseName hash. The iterator is set
+ * to zero for the first call. Returns NULL if no more target matches. */
+UA_EXPORT const UA_ReferenceTarget *
+UA_NodeReferenceKind_findTargetByName(const UA_NodeReferenceKind *rk,
+                                      UA_UInt32 targetNameHash, size_t *iter);
+
 /* Remove all malloc'ed members of the node and reset */
 void UA_EXPORT
 UA_Node_clear(UA_Node *node);
@@ -10,6 +10,7 @@
 
 #include <open62541/types.h>
 #include <open62541/types_generated.h>
+#include <open62541/plugin/log.h>
 
 _UA_BEGIN_DECLS
 
@@ -46,6 +47,10 @@ struct UA_CertificateVerification {
 
     /* Delete the certificate verification context */
     void (*clear)(UA_CertificateVerification *cv);
+
+    /* Logger for the plugin. Set by the default server and client
+     * configuration before the plugin is initialized. Can be NULL. */
+    const UA_Logger *logging;
 };
 
 _UA_END_DECLS
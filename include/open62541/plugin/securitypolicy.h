@@ -207,6 +207,11 @@ typedef struct {
     UA_FUNC_ATTR_WARN_UNUSED_RESULT;
 
     UA_SecurityPolicyCryptoModule cryptoModule;
+
+    /* The asymmetric crypto functions, the certificateSigningAlgorithm and the
+     * channel contexts of different channels can be used concurrently.
+     * Required for the asynchronous handshakes in the server worker threads. */
+    UA_Boolean reentrant;
 } UA_SecurityPolicyAsymmetricModule;
 
 typedef struct {
@@ -243,6 +248,12 @@ typedef struct {
     size_t secureChannelNonceLength;
 
     UA_SecurityPolicyCryptoModule cryptoModule;
+
+    /* The symmetric sign/verify and encrypt/decrypt functions can be called
+     * concurrently on the same channel context. That is the case if they keep
+     * no state in the context beyond the keys. Required for the parallel chunk
+     * crypto in the server worker threads. */
+    UA_Boolean reentrant;
 } UA_SecurityPolicySymmetricModule;
 
 typedef struct {
@@ -1287,11 +1287,31 @@ UA_Server_addMethodNode_finish(UA_Server *server, const UA_NodeId nodeId,
 
 #endif
 
+/* Adds several nodes like the AddNodes service (with the admin session). The
+ * results array has the same length as the items and is freed with
+ * UA_Array_delete. The node contexts are initially NULL. The children of the
+ * TypeDefinitions are looked up once and reused for the following instances.
+ * And nodes that are edited repeatedly (e.g. the common parent) are copied
+ * only once. So this is the fastest way to create many nodes. */
+UA_StatusCode UA_EXPORT UA_THREADSAFE
+UA_Server_addNodes(UA_Server *server, size_t nodesToAddSize,
+                   const UA_AddNodesItem *nodesToAdd,
+                   UA_AddNodesResult **results);
+
 /* Deletes a node and optionally all references leading to the node. */
 UA_StatusCode UA_EXPORT UA_THREADSAFE
 UA_Server_deleteNode(UA_Server *server, const UA_NodeId nodeId,
                      UA_Boolean deleteReferences);
 
+/* Deletes several nodes like the DeleteNodes service (with the admin session).
+ * The results array has the same length as the items and is freed with
+ * UA_Array_delete. Nodes that are edited repeatedly during the operation (e.g.
+ * the common parent) are copied only once. */
+UA_StatusCode UA_EXPORT UA_THREADSAFE
+UA_Server_deleteNodes(UA_Server *server, size_t nodesToDeleteSize,
+                      const UA_DeleteNodesItem *nodesToDelete,
+                      UA_StatusCode **results);
+
 /**
  * Reference Management
  * -------------------- */
@@ -1306,6 +1326,31 @@ UA_Server_deleteReference(UA_Server *server, const UA_NodeId sourceNodeId,
                           const UA_ExpandedNodeId targetNodeId,
                           UA_Boolean deleteBidirectional);
 
+/**
+ * Nodeset Snapshots
+ * -----------------
+ * A snapshot contains the nodes of selected namespaces in the binary encoding.
+ * Loading a snapshot is much faster than creating the same nodes with the code
+ * generated by the nodeset compiler (see the ``--snapshot`` option), as the
+ * nodes are inserted without the checks and the instantiation of the AddNodes
+ * service. Node contexts, DataSources and method callbacks are not part of the
+ * snapshot. They have to be set up again after loading.
+ *
+ * Snapshots are specific to the version of the library and to the data types
+ * of the server. Namespace zero can be loaded from a snapshot during the
+ * server initialization. See the ``namespace0Snapshot`` config option. */
+
+/* Encode the nodes of the namespaces into a newly allocated snapshot */
+UA_StatusCode UA_EXPORT UA_THREADSAFE
+UA_Server_saveNodesetSnapshot(UA_Server *server, size_t namespacesSize,
+                              const UA_UInt16 *namespaces, UA_ByteString *snapshot);
+
+/* Insert the nodes from the snapshot. The namespaces of the snapshot are added
+ * to the server as required and the NodeIds are translated. References to
+ * nodes outside of the snapshot are added in both directions. */
+UA_StatusCode UA_EXPORT UA_THREADSAFE
+UA_Server_loadNodesetSnapshot(UA_Server *server, const UA_ByteString *snapshot);
+
 /**
  * .. _events:
  *
@@ -1499,6 +1544,13 @@ UA_StatusCode UA_EXPORT UA_THREADSAFE
 UA_Server_getNamespaceByName(UA_Server *server, const UA_String namespaceUri,
                              size_t* foundIndex);
 
+/* Drop the cached access control decisions of a Session. All Sessions if the
+ * sessionId is NULL. To be called when the access rights have changed outside
+ * of the server (e.g. in a role database). See the ``accessControlCacheSize``
+ * server config option. */
+void UA_EXPORT UA_THREADSAFE
+UA_Server_invalidateAccessControlCache(UA_Server *server, const UA_NodeId *sessionId);
+
 #ifdef UA_ENABLE_HISTORIZING
 UA_Boolean UA_EXPORT UA_THREADSAFE
 UA_Server_AccessControl_allowHistoryUpdateUpdateData(UA_Server *server,
@@ -159,6 +159,14 @@ struct UA_ServerConfig {
     /* Access Control */
     UA_AccessControl accessControl;
 
+    /* Number of decisions of the access control plugin (user rights mask,
+     * user access level, user executable, browse permission) that are cached
+     * per Session. Zero disables the cache. The cache is cleared when a Session
+     * is (re-)activated and when a node is deleted or its context changes. Use
+     * ``UA_Server_invalidateAccessControlCache`` if the decisions change for
+     * other reasons. */
+    size_t accessControlCacheSize;
+
     /**
      * .. note:: See the section for :ref:`access-control
      *    handling<access-control>`. */
@@ -179,6 +187,12 @@ struct UA_ServerConfig {
     /* Nodestore */
     UA_Nodestore nodestore;
 
+    /* Load namespace zero from a snapshot (UA_Server_saveNodesetSnapshot)
+     * instead of creating the nodes one by one. The snapshot has to be taken
+     * from a server with the same build options. The ByteString is not freed
+     * with the config. */
+    const UA_ByteString *namespace0Snapshot;
+
     /* Certificate Verification */
     UA_CertificateVerification certificateVerification;
 
@@ -191,6 +205,37 @@ struct UA_ServerConfig {
     UA_UInt16 maxSecureChannels;
     UA_UInt32 maxSecurityTokenLifetime; /* in ms */
 
+    /* Admission control for the asymmetric handshake. Limits the number of
+     * SecureChannels with a SecurityPolicy other than None that have received
+     * their first OpenSecureChannel request but have not yet activated a
+     * Session. Further OpenSecureChannel requests are rejected with
+     * BadTcpServerTooBusy before any asymmetric crypto operation is performed
+     * for them. Zero means no limit. */
+    UA_UInt16 maxConcurrentHandshakes;
+
+    /* A SecureChannel releases its handshake slot if no Session was activated
+     * within this time after the first OpenSecureChannel request. The timeout
+     * is checked in the regular housekeeping of the server. Zero means that
+     * the slot is held until a Session is activated or the channel closes. */
+    UA_UInt32 handshakeTimeout; /* in ms */
+
+#if UA_MULTITHREADING >= 200
+    /* Sign/encrypt and decrypt/verify the chunks of large messages in parallel
+     * in the worker threads. Requires that the symmetric crypto functions of
+     * all SecurityPolicies are reentrant (see the reentrant flag of the
+     * symmetric module). Otherwise the server refuses to start up. */
+    UA_Boolean parallelChunkCrypto;
+
+    /* Process the handshake of SecureChannels (HEL, OpenSecureChannel,
+     * CreateSession and ActivateSession) in the worker threads. The service
+     * mutex is released during the asymmetric crypto operations, so that the
+     * established sessions are not stalled by many parallel handshakes.
+     * Requires that the asymmetric crypto functions of all SecurityPolicies
+     * are reentrant (see the reentrant flag of the asymmetric module).
+     * Otherwise the server refuses to start up. */
+    UA_Boolean asyncHandshakes;
+#endif
+
     /* Limits for Sessions */
     UA_UInt16 maxSessions;
     UA_Double maxSessionTimeout; /* in ms */
@@ -217,6 +262,15 @@ struct UA_ServerConfig {
     UA_UInt32 maxNotificationsPerPublish;
     UA_Boolean enableRetransmissionQueue;
     UA_UInt32 maxRetransmissionQueueSize; /* 0 -> unlimited size */
+
+    /* Memory budget for the encoded retransmission messages of all sessions.
+     * The oldest messages exceeding the budget are moved to the spill file (if
+     * configured) or dropped. Spilling requires a POSIX architecture. The spill
+     * file is used as a ring buffer of the given size. So Republish can be
+     * served also after long client outages without growing the heap. */
+    size_t maxRetransmissionQueueBytes; /* 0 -> unlimited size */
+    UA_String retransmissionSpillFile;  /* Empty -> no spilling */
+    size_t retransmissionSpillFileSize;
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
     UA_UInt32 maxEventsPerNode; /* 0 -> unlimited size */
 #endif
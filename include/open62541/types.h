@@ -1040,6 +1040,17 @@ void UA_EXPORT UA_clear(void *p, const UA_DataType *type);
  * @param type The datatype description of the variable */
 void UA_EXPORT UA_delete(void *p, const UA_DataType *type);
 
+/* Compares two variables of the same type in place (without allocating
+ * memory). Two variables are equal if their binary encoding is identical.
+ * Decoded ExtensionObjects are compared by their content.
+ *
+ * @param p1 The memory location of the first variable
+ * @param p2 The memory location of the second variable
+ * @param type The datatype description of the variables
+ * @return Whether the variables are equal */
+UA_Boolean UA_EXPORT
+UA_equal(const void *p1, const void *p2, const UA_DataType *type);
+
 /**
  * .. _array-handling:
  *
@@ -0,0 +1,41 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#ifndef UA_LOG_ASYNC_H_
+#define UA_LOG_ASYNC_H_
+
+#include <open62541/plugin/log.h>
+
+#include <stdio.h>
+
+_UA_BEGIN_DECLS
+
+/* Asynchronous logging is available only for Linux/Unices.
+ *
+ * The calling thread formats the message into a slot of a lock-free ring
+ * buffer and returns. A background thread adds the timestamp prefix and writes
+ * the messages to the output stream (same format as UA_Log_Stdout). Messages
+ * are dropped when the ring buffer is full. Messages longer than 512 bytes are
+ * truncated.
+ *
+ * The clear method of the logger writes the pending messages and stops the
+ * background thread. */
+
+#if defined(__linux__) || defined(__unix__)
+
+/* Returns a logger for messages up to the specified level. The bufferSize is
+ * rounded up to the next power of two. If the logger could not be created, the
+ * log method of the returned logger is NULL. */
+UA_EXPORT UA_Logger
+UA_Log_Async_withLevel(FILE *out, UA_LogLevel minlevel, size_t bufferSize);
+
+/* Number of messages that were dropped because the ring buffer was full */
+UA_EXPORT size_t
+UA_Log_Async_getDropCount(const UA_Logger *logger);
+
+#endif
+
+_UA_END_DECLS
+
+#endif /* UA_LOG_ASYNC_H_ */
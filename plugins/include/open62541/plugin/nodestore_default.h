@@ -27,6 +27,38 @@ UA_Nodestore_HashMap(UA_Nodestore *ns);
 UA_EXPORT UA_StatusCode
 UA_Nodestore_ZipTree(UA_Nodestore *ns);
 
+#ifdef UA_ENABLE_IMMUTABLE_NODES
+
+/* The layered Nodestore lets several servers in one process share the nodes
+ * they have in common (e.g. namespace zero and common type definitions). The
+ * shared nodes are copied once from a template Nodestore and are never changed
+ * afterwards. Every server gets its own layered Nodestore with a private
+ * HashMap Nodestore as overlay. New nodes are added to the overlay. A shared
+ * node is copied into the overlay when it is changed for the first time and
+ * hidden from the server when it is removed. Requires immutable nodes, as the
+ * shared nodes must not be edited in-situ.
+ *
+ * The node contexts are not shared. The servers must add their namespaces in
+ * the same order as the template server. The DataSources and method callbacks
+ * of namespace zero are set up by every server when it is started, as the
+ * RootFolder already exists. These changes end up in the overlay. */
+typedef struct UA_SharedNodes UA_SharedNodes;
+
+/* Copy all nodes of the Nodestore. The template Nodestore (or its server) can
+ * be deleted afterwards. */
+UA_EXPORT UA_SharedNodes *
+UA_SharedNodes_new(const UA_Nodestore *ns);
+
+/* Release the reference from UA_SharedNodes_new. The shared nodes are deleted
+ * when the last layered Nodestore using them is cleared. */
+UA_EXPORT void
+UA_SharedNodes_release(UA_SharedNodes *sn);
+
+UA_EXPORT UA_StatusCode
+UA_Nodestore_Layered(UA_Nodestore *ns, UA_SharedNodes *shared);
+
+#endif
+
 _UA_END_DECLS
 
 #endif /* UA_NODESTORE_DEFAULT_H_ */
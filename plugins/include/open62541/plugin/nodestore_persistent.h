@@ -0,0 +1,60 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#ifndef UA_NODESTORE_PERSISTENT_H_
+#define UA_NODESTORE_PERSISTENT_H_
+
+#include <open62541/plugin/nodestore.h>
+
+_UA_BEGIN_DECLS
+
+/* The persistent Nodestore is available only for Linux/Unices.
+ *
+ * The nodes are held in RAM in a HashMap Nodestore. Changed nodes are appended
+ * to a log file (<path>.log) in the binary encoding of UA_Node_encodeBinary.
+ * Every flush of the log is written as one block. A block that was written
+ * only partially (e.g. due to a power loss) is discarded when the log is read.
+ * When the log becomes larger than maxLogSize, all nodes are written into a
+ * new snapshot file (<path>.snapshot) and the log is truncated. Both files
+ * carry the generation of the snapshot. A log that is older than the snapshot
+ * (the truncation was interrupted) is ignored.
+ *
+ * When the Nodestore is created, the snapshot is loaded and the log is
+ * replayed. The server then skips the creation of namespace zero, as the nodes
+ * are already present. Only the DataSources, method callbacks and the values
+ * taken from the server configuration are set up again. Node contexts are not
+ * persisted. The namespaces have to be added to the server in the same order
+ * as before the restart.
+ *
+ * Changes are collected in memory. A background thread writes them to the log
+ * every flushInterval (in milliseconds). So at most the changes of the last
+ * interval are lost. An interval of zero writes every change right away. The
+ * pending changes are also written when the Nodestore is cleared (when the
+ * server is deleted).
+ *
+ * The Nodestore can be used concurrently from several threads. Writing and
+ * syncing the files does not block the access to the nodes. A node that is
+ * held by a consumer (and might be edited in-situ) is written with a later
+ * flush. */
+
+#if defined(__linux__) || defined(__unix__)
+
+UA_EXPORT UA_StatusCode
+UA_Nodestore_Persistent(UA_Nodestore *ns, const char *path,
+                        const UA_DataTypeArray *customTypes,
+                        UA_Double flushInterval, size_t maxLogSize);
+
+/* Write the pending changes to the log right away */
+UA_EXPORT UA_StatusCode
+UA_Nodestore_Persistent_flush(UA_Nodestore *ns);
+
+/* Write all nodes into a new snapshot file and truncate the log */
+UA_EXPORT UA_StatusCode
+UA_Nodestore_Persistent_snapshot(UA_Nodestore *ns);
+
+#endif
+
+_UA_END_DECLS
+
+#endif /* UA_NODESTORE_PERSISTENT_H_ */
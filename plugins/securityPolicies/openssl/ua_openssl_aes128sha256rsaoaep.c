@@ -622,10 +622,15 @@ UA_SecurityPolicy_Aes128Sha256RsaOaep(UA_SecurityPolicy *policy,
 
     asymmetricModule->compareCertificateThumbprint = UA_compareCertificateThumbprint;
     asymmetricModule->makeCertificateThumbprint = UA_makeCertificateThumbprint;
+    /* The RSA functions load the keys into a fresh OpenSSL context for every
+     * call */
+    asymmetricModule->reentrant = true;
 
     /* SymmetricModule */
 
     symmetricModule->secureChannelNonceLength = 32;
+    /* The HMACs and ciphers use a fresh OpenSSL context for every call */
+    symmetricModule->reentrant = true;
     symmetricModule->generateNonce = UA_Sym_Aes128Sha256RsaOaep_generateNonce;
     symmetricModule->generateKey = UA_Sym_Aes128Sha256RsaOaep_generateKey;
 
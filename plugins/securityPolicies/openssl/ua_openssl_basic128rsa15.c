@@ -570,6 +570,9 @@ UA_SecurityPolicy_Basic128Rsa15 (UA_SecurityPolicy * policy,
 
     asymmetricModule->compareCertificateThumbprint = UA_Asy_Basic128Rsa15_compareCertificateThumbprint;
     asymmetricModule->makeCertificateThumbprint = UA_Asy_Basic128Rsa15_makeCertificateThumbprint;
+    /* The RSA functions load the keys into a fresh OpenSSL context for every
+     * call */
+    asymmetricModule->reentrant = true;
 
     /* AsymmetricModule - signature algorithm */
 
@@ -600,6 +603,8 @@ UA_SecurityPolicy_Basic128Rsa15 (UA_SecurityPolicy * policy,
     /* SymmetricModule */
 
     symmetricModule->secureChannelNonceLength = 16;  /* 128 bits*/
+    /* The HMACs and ciphers use a fresh OpenSSL context for every call */
+    symmetricModule->reentrant = true;
     symmetricModule->generateNonce = UA_Sym_Basic128Rsa15_generateNonce;
     symmetricModule->generateKey = UA_Sym_Basic128Rsa15_generateKey; 
 
@@ -573,6 +573,9 @@ UA_SecurityPolicy_Basic256 (UA_SecurityPolicy * policy,
 
     asymmetricModule->compareCertificateThumbprint = UA_Asy_Basic256_compareCertificateThumbprint;
     asymmetricModule->makeCertificateThumbprint = UA_Asy_Basic256_makeCertificateThumbprint;
+    /* The RSA functions load the keys into a fresh OpenSSL context for every
+     * call */
+    asymmetricModule->reentrant = true;
 
     /* AsymmetricModule - signature algorithm */
 
@@ -603,6 +606,8 @@ UA_SecurityPolicy_Basic256 (UA_SecurityPolicy * policy,
     /* SymmetricModule */
 
     symmetricModule->secureChannelNonceLength = 32;
+    /* The HMACs and ciphers use a fresh OpenSSL context for every call */
+    symmetricModule->reentrant = true;
     symmetricModule->generateNonce = UA_Sym_Basic256_generateNonce;
     symmetricModule->generateKey = UA_Sym_Basic256_generateKey; 
 
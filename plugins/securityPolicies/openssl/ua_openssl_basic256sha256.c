@@ -613,10 +613,15 @@ UA_SecurityPolicy_Basic256Sha256(UA_SecurityPolicy * policy,
 
     asymmetricModule->compareCertificateThumbprint = UA_compareCertificateThumbprint;
     asymmetricModule->makeCertificateThumbprint = UA_makeCertificateThumbprint;
+    /* The RSA functions load the keys into a fresh OpenSSL context for every
+     * call */
+    asymmetricModule->reentrant = true;
 
     /* SymmetricModule */
 
     symmetricModule->secureChannelNonceLength = 32;
+    /* The HMACs and ciphers use a fresh OpenSSL context for every call */
+    symmetricModule->reentrant = true;
     symmetricModule->generateNonce = UA_Sym_Basic256Sha256_generateNonce;
     symmetricModule->generateKey = UA_Sym_Basic256Sha256_generateKey;
 
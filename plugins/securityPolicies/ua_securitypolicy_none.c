@@ -159,9 +159,11 @@ UA_SecurityPolicy_None(UA_SecurityPolicy *policy, const UA_ByteString localCerti
     sym_encryptionAlgorithm->getLocalPlainTextBlockSize = length_none;
     sym_encryptionAlgorithm->getRemotePlainTextBlockSize = length_none;
     policy->symmetricModule.secureChannelNonceLength = 0;
+    policy->symmetricModule.reentrant = true;
 
     policy->asymmetricModule.makeCertificateThumbprint = makeThumbprint_none;
     policy->asymmetricModule.compareCertificateThumbprint = compareThumbprint_none;
+    policy->asymmetricModule.reentrant = true;
 
     // This only works for none since symmetric and asymmetric crypto modules do the same i.e. nothing
     policy->asymmetricModule.cryptoModule = policy->symmetricModule.cryptoModule;
@@ -0,0 +1,241 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#include <open62541/plugin/log_async.h>
+#include <open62541/types.h>
+
+#if defined(__linux__) || defined(__unix__)
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define LOGMSGSIZE 512
+
+static const char *asyncLevelNames[6] = {"trace", "debug", "info",
+                                         "warn", "error", "fatal"};
+static const char *asyncCategoryNames[7] = {"network", "channel", "session", "server",
+                                            "client", "userland", "securitypolicy"};
+
+/* Bounded MPSC queue after Dmitry Vyukov. A slot can be written when its
+ * sequence number equals the enqueue position. It can be read when the
+ * sequence number is ahead of the dequeue position by one. */
+typedef struct {
+    size_t sequence;
+    UA_DateTime timestamp;
+    UA_LogLevel level;
+    UA_LogCategory category;
+    char msg[LOGMSGSIZE];
+} LogSlot;
+
+typedef struct {
+    UA_LogLevel minlevel;
+    FILE *out;
+
+    LogSlot *slots;
+    size_t mask;
+    size_t enqueuePos; /* Shared between the producers */
+    size_t dequeuePos; /* Only used by the background thread */
+
+    size_t dropCount;
+    size_t reportedDropCount; /* Only used by the background thread */
+
+    /* The background thread waits on the condition when the queue is empty.
+     * Producers signal only while it is sleeping. So the common path does not
+     * take the mutex. */
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    UA_Boolean sleeping;
+
+    UA_Boolean running;
+    pthread_t thread;
+} AsyncLog;
+
+#ifdef __clang__
+__attribute__((__format__(__printf__, 4 , 0)))
+#endif
+static void
+UA_Log_Async_log(void *context, UA_LogLevel level, UA_LogCategory category,
+                 const char *msg, va_list args) {
+    AsyncLog *al = (AsyncLog*)context;
+    if(al->minlevel > level)
+        return;
+
+    /* Reserve a slot */
+    LogSlot *slot;
+    size_t pos = __atomic_load_n(&al->enqueuePos, __ATOMIC_RELAXED);
+    for(;;) {
+        slot = &al->slots[pos & al->mask];
+        size_t seq = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&al->enqueuePos, &pos, pos + 1, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if(diff < 0) {
+            /* The ring buffer is full */
+            __atomic_add_fetch(&al->dropCount, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&al->enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+
+    /* Fill the slot. The arguments are formatted right away. They might point
+     * to memory that is freed when the call returns. */
+    slot->timestamp = UA_DateTime_now();
+    slot->level = level;
+    slot->category = category;
+    if(vsnprintf(slot->msg, LOGMSGSIZE, msg, args) < 0)
+        slot->msg[0] = 0;
+
+    /* Publish to the background thread */
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_SEQ_CST);
+
+    /* Wake up the background thread. The publication is ordered before the
+     * load of the sleeping flag (both sequentially consistent). The background
+     * thread sets the flag before it checks the queue a last time. So either
+     * it sees the message or we see that it sleeps. */
+    if(__atomic_load_n(&al->sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&al->mutex);
+        pthread_cond_signal(&al->wakeup);
+        pthread_mutex_unlock(&al->mutex);
+    }
+}
+
+static void
+writeMessage(AsyncLog *al, UA_DateTime timestamp, UA_LogLevel level,
+             UA_LogCategory category, const char *msg) {
+    UA_Int64 tOffset = UA_DateTime_localTimeUtcOffset();
+    UA_DateTimeStruct dts = UA_DateTime_toStruct(timestamp + tOffset);
+    fprintf(al->out, "[%04u-%02u-%02u %02u:%02u:%02u.%03u (UTC%+05d)] %s/%s\t%s\n",
+            dts.year, dts.month, dts.day, dts.hour, dts.min, dts.sec, dts.milliSec,
+            (int)(tOffset / UA_DATETIME_SEC / 36), asyncLevelNames[level],
+            asyncCategoryNames[category], msg);
+}
+
+/* Returns the number of written messages */
+static size_t
+drainMessages(AsyncLog *al) {
+    size_t count = 0;
+    for(;;) {
+        LogSlot *slot = &al->slots[al->dequeuePos & al->mask];
+        size_t seq = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if(seq != al->dequeuePos + 1)
+            break;
+        writeMessage(al, slot->timestamp, slot->level, slot->category, slot->msg);
+        /* Release the slot for the next round */
+        __atomic_store_n(&slot->sequence, al->dequeuePos + al->mask + 1, __ATOMIC_RELEASE);
+        al->dequeuePos++;
+        count++;
+    }
+
+    size_t dropped = __atomic_load_n(&al->dropCount, __ATOMIC_RELAXED);
+    if(dropped != al->reportedDropCount) {
+        char buf[64];
+        snprintf(buf, 64, "%lu log messages dropped",
+                 (unsigned long)(dropped - al->reportedDropCount));
+        writeMessage(al, UA_DateTime_now(), UA_LOGLEVEL_WARNING,
+                     UA_LOGCATEGORY_USERLAND, buf);
+        al->reportedDropCount = dropped;
+        count++;
+    }
+
+    if(count > 0)
+        fflush(al->out);
+    return count;
+}
+
+static UA_Boolean
+hasMessages(AsyncLog *al) {
+    LogSlot *slot = &al->slots[al->dequeuePos & al->mask];
+    return (__atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) == al->dequeuePos + 1);
+}
+
+static void *
+asyncLogLoop(void *context) {
+    AsyncLog *al = (AsyncLog*)context;
+    for(;;) {
+        if(drainMessages(al) > 0)
+            continue;
+
+        /* Sleep until a producer signals a new message or the logger stops */
+        pthread_mutex_lock(&al->mutex);
+        __atomic_store_n(&al->sleeping, true, __ATOMIC_SEQ_CST);
+        UA_Boolean running = __atomic_load_n(&al->running, __ATOMIC_ACQUIRE);
+        if(running && !hasMessages(al))
+            pthread_cond_wait(&al->wakeup, &al->mutex);
+        __atomic_store_n(&al->sleeping, false, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&al->mutex);
+        if(!running)
+            break;
+    }
+    drainMessages(al); /* Pick up the messages from before the stop */
+    return NULL;
+}
+
+static void
+UA_Log_Async_clear(void *context) {
+    AsyncLog *al = (AsyncLog*)context;
+    if(!al)
+        return;
+    pthread_mutex_lock(&al->mutex);
+    __atomic_store_n(&al->running, false, __ATOMIC_RELEASE);
+    pthread_cond_signal(&al->wakeup);
+    pthread_mutex_unlock(&al->mutex);
+    pthread_join(al->thread, NULL);
+    pthread_cond_destroy(&al->wakeup);
+    pthread_mutex_destroy(&al->mutex);
+    UA_free(al->slots);
+    UA_free(al);
+}
+
+UA_Logger
+UA_Log_Async_withLevel(FILE *out, UA_LogLevel minlevel, size_t bufferSize) {
+    UA_Logger logger = {NULL, NULL, NULL};
+
+    /* Round up to the next power of two */
+    size_t size = 2;
+    while(size < bufferSize)
+        size <<= 1;
+
+    AsyncLog *al = (AsyncLog*)UA_calloc(1, sizeof(AsyncLog));
+    if(!al)
+        return logger;
+    al->slots = (LogSlot*)UA_malloc(size * sizeof(LogSlot));
+    if(!al->slots) {
+        UA_free(al);
+        return logger;
+    }
+    for(size_t i = 0; i < size; i++)
+        al->slots[i].sequence = i;
+    al->mask = size - 1;
+    al->minlevel = minlevel;
+    al->out = out;
+    al->running = true;
+    pthread_mutex_init(&al->mutex, NULL);
+    pthread_cond_init(&al->wakeup, NULL);
+
+    if(pthread_create(&al->thread, NULL, asyncLogLoop, al) != 0) {
+        pthread_cond_destroy(&al->wakeup);
+        pthread_mutex_destroy(&al->mutex);
+        UA_free(al->slots);
+        UA_free(al);
+        return logger;
+    }
+
+    logger.log = UA_Log_Async_log;
+    logger.context = al;
+    logger.clear = UA_Log_Async_clear;
+    return logger;
+}
+
+size_t
+UA_Log_Async_getDropCount(const UA_Logger *logger) {
+    if(!logger || logger->log != UA_Log_Async_log)
+        return 0;
+    AsyncLog *al = (AsyncLog*)logger->context;
+    return __atomic_load_n(&al->dropCount, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -194,8 +194,7 @@ cleanupNodeMapEntry(UA_NodeMapEntry *entry) {
 }
 
 static UA_NodeMapSlot *
-findOccupiedSlot(const UA_NodeMap *ns, const UA_NodeId *nodeid) {
-    UA_UInt32 h = UA_NodeId_hash(nodeid);
+findOccupiedSlotHash(const UA_NodeMap *ns, const UA_NodeId *nodeid, UA_UInt32 h) {
     UA_UInt32 size = ns->size;
     UA_UInt64 idx = mod(h, size); /* Use 64bit container to avoid overflow */
     UA_UInt32 hash2 = mod2(h, size);
@@ -220,6 +219,11 @@ findOccupiedSlot(const UA_NodeMap *ns, const UA_NodeId *nodeid) {
     return NULL;
 }
 
+static UA_NodeMapSlot *
+findOccupiedSlot(const UA_NodeMap *ns, const UA_NodeId *nodeid) {
+    return findOccupiedSlotHash(ns, nodeid, UA_NodeId_hash(nodeid));
+}
+
 /***********************/
 /* Interface functions */
 /***********************/
@@ -249,6 +253,66 @@ UA_NodeMap_getNode(void *context, const UA_NodeId *nodeid) {
     return &slot->entry->node;
 }
 
+#if defined(__GNUC__) || defined(__clang__)
+# define UA_NODEMAP_PREFETCH(p) __builtin_prefetch(p)
+#else
+# define UA_NODEMAP_PREFETCH(p) (void)(p)
+#endif
+
+#define UA_NODEMAP_BATCHSIZE 32
+
+/* The lookups are done in three rounds over small batches. First, the hashes
+ * are computed and the first probed slot is prefetched. Then the slots are
+ * searched and the found entries are prefetched. Only then is the refCount of
+ * the entries touched. So the cache misses for the different NodeIds
+ * overlap. */
+static void
+UA_NodeMap_getNodes(void *context, size_t nodeIdsSize, const UA_NodeId **nodeIds,
+                    const UA_Node **outNodes) {
+    UA_NodeMap *ns = (UA_NodeMap*)context;
+    UA_UInt32 hashes[UA_NODEMAP_BATCHSIZE];
+    UA_NodeMapEntry *entries[UA_NODEMAP_BATCHSIZE];
+    for(size_t start = 0; start < nodeIdsSize; start += UA_NODEMAP_BATCHSIZE) {
+        size_t n = nodeIdsSize - start;
+        if(n > UA_NODEMAP_BATCHSIZE)
+            n = UA_NODEMAP_BATCHSIZE;
+        const UA_NodeId **ids = &nodeIds[start];
+
+        for(size_t i = 0; i < n; i++) {
+            if(!ids[i])
+                continue;
+            hashes[i] = UA_NodeId_hash(ids[i]);
+            UA_NODEMAP_PREFETCH(&ns->slots[mod(hashes[i], ns->size)]);
+        }
+
+        for(size_t i = 0; i < n; i++) {
+            entries[i] = NULL;
+            if(!ids[i])
+                continue;
+            UA_NodeMapSlot *slot = findOccupiedSlotHash(ns, ids[i], hashes[i]);
+            if(!slot)
+                continue;
+            entries[i] = slot->entry;
+            UA_NODEMAP_PREFETCH(entries[i]);
+        }
+
+        for(size_t i = 0; i < n; i++) {
+            if(!entries[i]) {
+                outNodes[start + i] = NULL;
+                continue;
+            }
+            ++entries[i]->refCount;
+            outNodes[start + i] = &entries[i]->node;
+        }
+    }
+}
+
+static UA_Boolean
+UA_NodeMap_isNodeExclusive(void *context, const UA_Node *node) {
+    UA_NodeMapEntry *entry = container_of(node, UA_NodeMapEntry, node);
+    return (entry->refCount == 1 && !entry->deleted);
+}
+
 static void
 UA_NodeMap_releaseNode(void *context, const UA_Node *node) {
     if (!node)
@@ -452,5 +516,9 @@ UA_Nodestore_HashMap(UA_Nodestore *ns) {
     ns->replaceNode = UA_NodeMap_replaceNode;
     ns->removeNode = UA_NodeMap_removeNode;
     ns->iterate = UA_NodeMap_iterate;
+    ns->getNodes = UA_NodeMap_getNodes;
+    ns->nodeChanged = NULL;
+    ns->getNextNode = NULL; /* Not ordered */
+    ns->isNodeExclusive = UA_NodeMap_isNodeExclusive;
     return UA_STATUSCODE_GOOD;
 }
@@ -0,0 +1,349 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#include <open62541/plugin/nodestore_default.h>
+
+#include "ua_util_internal.h"
+
+#ifdef UA_ENABLE_IMMUTABLE_NODES
+
+/* The layered Nodestore looks up nodes first in the (private) overlay and then
+ * in the shared nodes. Changed shared nodes are copied into the overlay.
+ * Removed shared nodes are hidden by a tombstone. The shared nodes are never
+ * edited after they were created. So they are read from several threads
+ * without synchronization. */
+
+#define SET_MINSIZE 64
+
+/****************/
+/* Shared Nodes */
+/****************/
+
+struct UA_SharedNodes {
+    size_t refCount;
+    const UA_Node **slots; /* Hash table with linear probing */
+    size_t size; /* Power of two */
+    size_t count;
+};
+
+static const UA_Node **
+sharedSlot(const UA_SharedNodes *sn, const UA_NodeId *nodeId) {
+    size_t mask = sn->size - 1;
+    size_t idx = UA_NodeId_hash(nodeId) & mask;
+    while(sn->slots[idx] && !UA_NodeId_equal(&sn->slots[idx]->head.nodeId, nodeId))
+        idx = (idx + 1) & mask;
+    return &sn->slots[idx];
+}
+
+static const UA_Node *
+sharedGet(const UA_SharedNodes *sn, const UA_NodeId *nodeId) {
+    return *sharedSlot(sn, nodeId);
+}
+
+static void
+countVisitor(void *context, const UA_Node *node) {
+    (*(size_t*)context)++;
+}
+
+typedef struct {
+    UA_SharedNodes *sn;
+    UA_StatusCode res;
+} SharedCopyContext;
+
+static void
+copyVisitor(void *context, const UA_Node *node) {
+    SharedCopyContext *ctx = (SharedCopyContext*)context;
+    if(ctx->res != UA_STATUSCODE_GOOD)
+        return;
+    UA_Node *copy = UA_Node_copy_alloc(node);
+    if(!copy) {
+        ctx->res = UA_STATUSCODE_BADOUTOFMEMORY;
+        return;
+    }
+    /* The context belongs to the server of the original node */
+    copy->head.context = NULL;
+    *sharedSlot(ctx->sn, &copy->head.nodeId) = copy;
+    ctx->sn->count++;
+}
+
+static void
+deleteSharedNodes(UA_SharedNodes *sn) {
+    for(size_t i = 0; i < sn->size; i++) {
+        UA_Node *node = (UA_Node*)(uintptr_t)sn->slots[i];
+        if(!node)
+            continue;
+        UA_Node_clear(node);
+        UA_free(node);
+    }
+    UA_free(sn->slots);
+    UA_free(sn);
+}
+
+UA_SharedNodes *
+UA_SharedNodes_new(const UA_Nodestore *ns) {
+    size_t count = 0;
+    ns->iterate(ns->context, countVisitor, &count);
+
+    UA_SharedNodes *sn = (UA_SharedNodes*)UA_calloc(1, sizeof(UA_SharedNodes));
+    if(!sn)
+        return NULL;
+    sn->refCount = 1;
+    sn->size = SET_MINSIZE;
+    while(sn->size < count * 2)
+        sn->size *= 2;
+    sn->slots = (const UA_Node**)UA_calloc(sn->size, sizeof(UA_Node*));
+    if(!sn->slots) {
+        UA_free(sn);
+        return NULL;
+    }
+
+    SharedCopyContext ctx;
+    ctx.sn = sn;
+    ctx.res = UA_STATUSCODE_GOOD;
+    ns->iterate(ns->context, copyVisitor, &ctx);
+    if(ctx.res != UA_STATUSCODE_GOOD) {
+        deleteSharedNodes(sn);
+        return NULL;
+    }
+    return sn;
+}
+
+void
+UA_SharedNodes_release(UA_SharedNodes *sn) {
+    if(sn && UA_atomic_subSize(&sn->refCount, 1) == 0)
+        deleteSharedNodes(sn);
+}
+
+/**********************/
+/* Layered Nodestore */
+/**********************/
+
+typedef struct {
+    UA_SharedNodes *shared;
+    UA_Nodestore overlay;
+
+    UA_NodeIdMap removed; /* Tombstones of the removed shared nodes */
+
+    UA_UInt32 nextId; /* For fresh numeric NodeIds */
+} LayeredNodestore;
+
+static UA_Boolean
+isRemoved(const LayeredNodestore *ln, const UA_NodeId *nodeId) {
+    return (UA_NodeIdMap_find(&ln->removed, nodeId) != NULL);
+}
+
+/* Visible shared node or NULL */
+static const UA_Node *
+getShared(const LayeredNodestore *ln, const UA_NodeId *nodeId) {
+    const UA_Node *node = sharedGet(ln->shared, nodeId);
+    if(node && isRemoved(ln, nodeId))
+        return NULL;
+    return node;
+}
+
+static UA_Boolean
+inOverlay(const LayeredNodestore *ln, const UA_NodeId *nodeId) {
+    const UA_Node *node = ln->overlay.getNode(ln->overlay.context, nodeId);
+    if(!node)
+        return false;
+    ln->overlay.releaseNode(ln->overlay.context, node);
+    return true;
+}
+
+static UA_Node *
+Layered_newNode(void *context, UA_NodeClass nodeClass) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    return ln->overlay.newNode(ln->overlay.context, nodeClass);
+}
+
+static void
+Layered_deleteNode(void *context, UA_Node *node) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    ln->overlay.deleteNode(ln->overlay.context, node);
+}
+
+static const UA_Node *
+Layered_getNode(void *context, const UA_NodeId *nodeId) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    const UA_Node *node = ln->overlay.getNode(ln->overlay.context, nodeId);
+    if(node)
+        return node;
+    return getShared(ln, nodeId);
+}
+
+static void
+Layered_releaseNode(void *context, const UA_Node *node) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    if(!node)
+        return;
+    /* The shared nodes are not reference-counted */
+    if(sharedGet(ln->shared, &node->head.nodeId) == node)
+        return;
+    ln->overlay.releaseNode(ln->overlay.context, node);
+}
+
+/* The shared nodes are visible to all servers and never exclusive */
+static UA_Boolean
+Layered_isNodeExclusive(void *context, const UA_Node *node) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    if(sharedGet(ln->shared, &node->head.nodeId) == node)
+        return false;
+    return ln->overlay.isNodeExclusive(ln->overlay.context, node);
+}
+
+static UA_StatusCode
+Layered_getNodeCopy(void *context, const UA_NodeId *nodeId, UA_Node **outNode) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    UA_StatusCode res = ln->overlay.getNodeCopy(ln->overlay.context, nodeId, outNode);
+    if(res != UA_STATUSCODE_BADNODEIDUNKNOWN)
+        return res;
+
+    /* Copy the shared node into a node of the overlay */
+    const UA_Node *shared = getShared(ln, nodeId);
+    if(!shared)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    UA_Node *node = ln->overlay.newNode(ln->overlay.context, shared->head.nodeClass);
+    if(!node)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    res = UA_Node_copy(shared, node);
+    if(res != UA_STATUSCODE_GOOD) {
+        ln->overlay.deleteNode(ln->overlay.context, node);
+        return res;
+    }
+    *outNode = node;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+Layered_insertNode(void *context, UA_Node *node, UA_NodeId *addedNodeId) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    UA_NodeId *nodeId = &node->head.nodeId;
+
+    /* Assign a fresh numeric NodeId that is not used in either layer */
+    if(nodeId->identifierType == UA_NODEIDTYPE_NUMERIC &&
+       nodeId->identifier.numeric == 0) {
+        UA_UInt32 startId = ln->nextId;
+        do {
+            nodeId->identifier.numeric = ln->nextId++;
+            if(ln->nextId == 0)
+                ln->nextId = 50000;
+            if(!sharedGet(ln->shared, nodeId) && !inOverlay(ln, nodeId))
+                break;
+        } while(ln->nextId != startId);
+    }
+
+    if(getShared(ln, nodeId)) {
+        ln->overlay.deleteNode(ln->overlay.context, node);
+        return UA_STATUSCODE_BADNODEIDEXISTS;
+    }
+
+    /* Added again after it was removed */
+    UA_NodeId removedId;
+    UA_StatusCode res = UA_NodeId_copy(nodeId, &removedId);
+    if(res != UA_STATUSCODE_GOOD) {
+        ln->overlay.deleteNode(ln->overlay.context, node);
+        return res;
+    }
+    res = ln->overlay.insertNode(ln->overlay.context, node, addedNodeId);
+    if(res == UA_STATUSCODE_GOOD)
+        UA_NodeIdMap_remove(&ln->removed, &removedId);
+    UA_NodeId_clear(&removedId);
+    return res;
+}
+
+static UA_StatusCode
+Layered_replaceNode(void *context, UA_Node *node) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    if(inOverlay(ln, &node->head.nodeId))
+        return ln->overlay.replaceNode(ln->overlay.context, node);
+
+    /* The first change of a shared node */
+    if(!getShared(ln, &node->head.nodeId)) {
+        ln->overlay.deleteNode(ln->overlay.context, node);
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    }
+    UA_StatusCode res = ln->overlay.insertNode(ln->overlay.context, node, NULL);
+    if(res == UA_STATUSCODE_BADNODEIDEXISTS)
+        res = UA_STATUSCODE_BADINTERNALERROR; /* Replaced in the meantime */
+    return res;
+}
+
+static UA_StatusCode
+Layered_removeNode(void *context, const UA_NodeId *nodeId) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    UA_StatusCode res = ln->overlay.removeNode(ln->overlay.context, nodeId);
+    if(sharedGet(ln->shared, nodeId)) {
+        if(res != UA_STATUSCODE_GOOD && isRemoved(ln, nodeId))
+            return UA_STATUSCODE_BADNODEIDUNKNOWN;
+        res = UA_NodeIdMap_insert(&ln->removed, nodeId, NULL);
+    }
+    return res;
+}
+
+typedef struct {
+    const LayeredNodestore *ln;
+    UA_NodestoreVisitor visitor;
+    void *visitorContext;
+} LayeredIterateContext;
+
+static void
+Layered_iterate(void *context, UA_NodestoreVisitor visitor, void *visitorContext) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    ln->overlay.iterate(ln->overlay.context, visitor, visitorContext);
+
+    /* The shared nodes that are not hidden by the overlay */
+    for(size_t i = 0; i < ln->shared->size; i++) {
+        const UA_Node *node = ln->shared->slots[i];
+        if(!node || isRemoved(ln, &node->head.nodeId) ||
+           inOverlay(ln, &node->head.nodeId))
+            continue;
+        visitor(visitorContext, node);
+    }
+}
+
+static void
+Layered_clear(void *context) {
+    LayeredNodestore *ln = (LayeredNodestore*)context;
+    if(!ln)
+        return;
+    if(ln->overlay.context)
+        ln->overlay.clear(ln->overlay.context);
+    UA_NodeIdMap_clear(&ln->removed);
+    UA_SharedNodes_release(ln->shared);
+    UA_free(ln);
+}
+
+UA_StatusCode
+UA_Nodestore_Layered(UA_Nodestore *ns, UA_SharedNodes *shared) {
+    LayeredNodestore *ln = (LayeredNodestore*)UA_calloc(1, sizeof(LayeredNodestore));
+    if(!ln)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode res = UA_Nodestore_HashMap(&ln->overlay);
+    if(res != UA_STATUSCODE_GOOD) {
+        UA_free(ln);
+        return res;
+    }
+    UA_atomic_addSize(&shared->refCount, 1);
+    ln->shared = shared;
+    ln->nextId = 50000;
+
+    ns->context = ln;
+    ns->clear = Layered_clear;
+    ns->newNode = Layered_newNode;
+    ns->deleteNode = Layered_deleteNode;
+    ns->getNode = Layered_getNode;
+    ns->releaseNode = Layered_releaseNode;
+    ns->getNodeCopy = Layered_getNodeCopy;
+    ns->insertNode = Layered_insertNode;
+    ns->replaceNode = Layered_replaceNode;
+    ns->removeNode = Layered_removeNode;
+    ns->iterate = Layered_iterate;
+    ns->getNodes = NULL;
+    ns->nodeChanged = NULL;
+    ns->getNextNode = NULL;
+    ns->isNodeExclusive = (ln->overlay.isNodeExclusive) ? Layered_isNodeExclusive : NULL;
+    return UA_STATUSCODE_GOOD;
+}
+
+#endif /* UA_ENABLE_IMMUTABLE_NODES */
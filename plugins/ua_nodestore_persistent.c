@@ -0,0 +1,850 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+#include <open62541/plugin/nodestore_default.h>
+#include <open62541/plugin/nodestore_persistent.h>
+
+#include "ua_types_encoding_binary.h"
+#include "ua_util_internal.h"
+
+#if defined(__linux__) || defined(__unix__)
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* The log and the snapshot file are a sequence of blocks. Every block starts
+ * with its length (UInt32) and contains records. A record starts with its kind
+ * (Byte). Followed by the encoded node (PUT) or the NodeId (REMOVE).
+ *
+ * Both files start with a header that contains the generation (UInt64) of the
+ * snapshot. Every snapshot increases the generation. The log contains the
+ * changes after the snapshot of the same generation. A log with an older
+ * generation was not truncated after the snapshot was written. Its blocks are
+ * contained in the snapshot and are skipped. */
+
+#define HEADER_SIZE 8
+
+#define RECORD_PUT 0
+#define RECORD_REMOVE 1
+
+#define SNAPSHOT_BLOCKSIZE (1 << 20) /* Write the snapshot in blocks of 1MB */
+
+/* The Nodestore is used from the server and from the flush thread. The mutex
+ * protects the inner Nodestore, the dirty set and the block buffer. It is
+ * recursive as the visitor of iterate can call back into the Nodestore. The
+ * fileMutex protects the files and the unwritten blocks. It is taken before
+ * the mutex. So writing and syncing the files does not block the server. */
+typedef struct {
+    UA_Nodestore inner; /* Holds the nodes in RAM */
+    const UA_DataTypeArray *customTypes;
+
+    pthread_mutex_t mutex;
+    size_t lockDepth;
+
+    pthread_mutex_t fileMutex;
+    char *logPath;
+    char *snapshotPath;
+    FILE *log;
+    size_t logSize;
+    size_t maxLogSize;
+    UA_UInt64 generation; /* Of the current snapshot */
+    UA_Boolean snapshotRequired; /* The last snapshot has failed */
+
+    /* Encoded blocks that were not yet written to the log */
+    UA_ByteString unwritten;
+
+    /* The flush thread waits on the condition with the fileMutex */
+    UA_Double flushInterval; /* in ms */
+    UA_Boolean threadStarted;
+    UA_Boolean running;
+    pthread_cond_t flushCondition;
+    pthread_t thread;
+
+    UA_NodeIdMap dirty; /* The NodeIds that changed since the last flush */
+
+    /* Buffer for the current block. The first four bytes are reserved for the
+     * length. */
+    UA_ByteString buf;
+    size_t bufUsed;
+} PersistentNodestore;
+
+/*************/
+/* Dirty Set */
+/*************/
+
+static UA_StatusCode
+markDirty(PersistentNodestore *pn, const UA_NodeId *nodeId) {
+    return UA_NodeIdMap_insert(&pn->dirty, nodeId, NULL);
+}
+
+/*************/
+/* Recording */
+/*************/
+
+static UA_StatusCode
+reserve(PersistentNodestore *pn, size_t size) {
+    if(pn->bufUsed + size <= pn->buf.length)
+        return UA_STATUSCODE_GOOD;
+    size_t newSize = (pn->buf.length > 0) ? pn->buf.length : 4096;
+    while(newSize < pn->bufUsed + size)
+        newSize *= 2;
+    UA_Byte *data = (UA_Byte*)UA_realloc(pn->buf.data, newSize);
+    if(!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    pn->buf.data = data;
+    pn->buf.length = newSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+recordPut(PersistentNodestore *pn, const UA_Node *node) {
+    size_t size = UA_Node_calcSizeBinary(node);
+    if(size == 0)
+        return UA_STATUSCODE_BADENCODINGERROR;
+    UA_StatusCode res = reserve(pn, size + 1);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    UA_Byte *pos = &pn->buf.data[pn->bufUsed];
+    *pos++ = RECORD_PUT;
+    res = UA_Node_encodeBinary(node, &pos, &pn->buf.data[pn->buf.length]);
+    pn->bufUsed = (size_t)(pos - pn->buf.data);
+    return res;
+}
+
+static UA_StatusCode
+recordRemove(PersistentNodestore *pn, const UA_NodeId *nodeId) {
+    size_t size = UA_calcSizeBinary(nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_StatusCode res = reserve(pn, size + 1);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    UA_Byte *pos = &pn->buf.data[pn->bufUsed];
+    const UA_Byte *end = &pn->buf.data[pn->buf.length];
+    *pos++ = RECORD_REMOVE;
+    res = UA_encodeBinary(nodeId, &UA_TYPES[UA_TYPES_NODEID], &pos, &end, NULL, NULL);
+    pn->bufUsed = (size_t)(pos - pn->buf.data);
+    return res;
+}
+
+static void
+resetBlock(PersistentNodestore *pn) {
+    pn->bufUsed = 4; /* The length is filled in when the block is written */
+}
+
+/* Fill in the length of the current block */
+static UA_StatusCode
+finishBlock(PersistentNodestore *pn) {
+    size_t length = pn->bufUsed - 4;
+    if(length > UA_UINT32_MAX)
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    UA_UInt32 length32 = (UA_UInt32)length;
+    UA_Byte *pos = pn->buf.data;
+    const UA_Byte *end = &pn->buf.data[4];
+    return UA_encodeBinary(&length32, &UA_TYPES[UA_TYPES_UINT32],
+                           &pos, &end, NULL, NULL);
+}
+
+/* Write the current block and reset the buffer */
+static UA_StatusCode
+writeBlock(PersistentNodestore *pn, FILE *fp) {
+    if(pn->bufUsed <= 4)
+        return UA_STATUSCODE_GOOD;
+    UA_StatusCode res = finishBlock(pn);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    if(fwrite(pn->buf.data, 1, pn->bufUsed, fp) != pn->bufUsed)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    resetBlock(pn);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+syncFile(FILE *fp) {
+    if(fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+writeHeader(FILE *fp, UA_UInt64 generation) {
+    UA_Byte header[HEADER_SIZE];
+    UA_Byte *pos = header;
+    const UA_Byte *end = &header[HEADER_SIZE];
+    UA_StatusCode res = UA_encodeBinary(&generation, &UA_TYPES[UA_TYPES_UINT64],
+                                        &pos, &end, NULL, NULL);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    if(fwrite(header, 1, HEADER_SIZE, fp) != HEADER_SIZE)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Sync the directory that contains the file. Otherwise a renamed file might
+ * appear under the old name after a crash. */
+static UA_StatusCode
+syncDirectory(const char *path) {
+    const char *slash = strrchr(path, '/');
+    size_t dirLen = (slash) ? (size_t)(slash - path) : 1;
+    if(dirLen == 0)
+        dirLen = 1; /* The root directory */
+    char *dir = (char*)UA_malloc(dirLen + 1);
+    if(!dir)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    if(slash)
+        memcpy(dir, path, dirLen);
+    else
+        dir[0] = '.';
+    dir[dirLen] = '\0';
+    int fd = open(dir, O_RDONLY);
+    UA_free(dir);
+    if(fd < 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    UA_StatusCode res = (fsync(fd) == 0) ?
+        UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+    close(fd);
+    return res;
+}
+
+/* Truncate the log and start it with the header of the current snapshot */
+static UA_StatusCode
+resetLog(PersistentNodestore *pn) {
+    if(pn->log)
+        fclose(pn->log);
+    pn->log = fopen(pn->logPath, "wb");
+    if(!pn->log)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    pn->logSize = 0;
+    UA_StatusCode res = writeHeader(pn->log, pn->generation);
+    if(res == UA_STATUSCODE_GOOD)
+        res = syncFile(pn->log);
+    if(res != UA_STATUSCODE_GOOD) {
+        fclose(pn->log);
+        pn->log = NULL;
+    }
+    return res;
+}
+
+static UA_StatusCode snapshot(PersistentNodestore *pn);
+
+/* The server edits a node in-situ only while it holds a reference. A node that
+ * is held by another consumer is not encoded. The mutex is held. */
+static UA_Boolean
+isNodeHeld(PersistentNodestore *pn, const UA_Node *node) {
+    return (pn->inner.isNodeExclusive &&
+            !pn->inner.isNodeExclusive(pn->inner.context, node));
+}
+
+/* Append the current block to the unwritten blocks */
+static UA_StatusCode
+appendBlock(PersistentNodestore *pn) {
+    UA_StatusCode res = finishBlock(pn);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+
+    /* Move the buffer if no other blocks are unwritten */
+    if(pn->unwritten.length == 0) {
+        UA_ByteString_clear(&pn->unwritten);
+        pn->unwritten.data = pn->buf.data;
+        pn->unwritten.length = pn->bufUsed;
+        UA_ByteString_init(&pn->buf);
+        pn->bufUsed = 0;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    UA_Byte *data = (UA_Byte*)
+        UA_realloc(pn->unwritten.data, pn->unwritten.length + pn->bufUsed);
+    if(!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(&data[pn->unwritten.length], pn->buf.data, pn->bufUsed);
+    pn->unwritten.data = data;
+    pn->unwritten.length += pn->bufUsed;
+    resetBlock(pn);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Encode the current state of the dirty nodes as one block and append it to
+ * the unwritten blocks. Held nodes remain dirty for the next flush. The mutex
+ * and the fileMutex are held. */
+static UA_StatusCode
+collectBlock(PersistentNodestore *pn) {
+    if(pn->dirty.count == 0)
+        return UA_STATUSCODE_GOOD;
+
+    /* Take the dirty set and mark the held nodes again */
+    UA_NodeIdMap dirty = pn->dirty;
+    memset(&pn->dirty, 0, sizeof(UA_NodeIdMap));
+
+    UA_StatusCode res = reserve(pn, 4);
+    resetBlock(pn);
+    for(size_t i = 0; i < dirty.slotsSize && res == UA_STATUSCODE_GOOD; i++) {
+        if(dirty.slots[i].hash == 0)
+            continue;
+        const UA_NodeId *nodeId = &dirty.slots[i].key;
+        const UA_Node *node = pn->inner.getNode(pn->inner.context, nodeId);
+        if(!node) {
+            res = recordRemove(pn, nodeId);
+            continue;
+        }
+        if(isNodeHeld(pn, node))
+            res = markDirty(pn, nodeId);
+        else
+            res = recordPut(pn, node);
+        pn->inner.releaseNode(pn->inner.context, node);
+    }
+    if(res == UA_STATUSCODE_GOOD && pn->bufUsed > 4)
+        res = appendBlock(pn);
+    resetBlock(pn);
+
+    /* Keep all nodes dirty if the block could not be encoded */
+    if(res != UA_STATUSCODE_GOOD) {
+        for(size_t i = 0; i < dirty.slotsSize; i++) {
+            if(dirty.slots[i].hash != 0)
+                markDirty(pn, &dirty.slots[i].key);
+        }
+    }
+    UA_NodeIdMap_clear(&dirty);
+    return res;
+}
+
+/* Write the dirty nodes to the log. Only the encoding is done with the mutex.
+ * The fileMutex is held. */
+static UA_StatusCode
+flushLocked(PersistentNodestore *pn) {
+    pthread_mutex_lock(&pn->mutex);
+    UA_StatusCode res = collectBlock(pn);
+    pthread_mutex_unlock(&pn->mutex);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+
+    /* The blocks are kept for the next attempt if writing fails */
+    if(pn->unwritten.length > 0 && pn->log) {
+        if(fwrite(pn->unwritten.data, 1, pn->unwritten.length, pn->log) !=
+           pn->unwritten.length)
+            return UA_STATUSCODE_BADINTERNALERROR;
+        pn->logSize += pn->unwritten.length;
+        UA_ByteString_clear(&pn->unwritten);
+        res = syncFile(pn->log);
+        if(res != UA_STATUSCODE_GOOD)
+            return res;
+    }
+
+    /* Compact the log. The changes are already written. So a failed snapshot
+     * is only retried with the next flush. */
+    if(pn->snapshotRequired ||
+       (pn->maxLogSize > 0 && pn->logSize > pn->maxLogSize))
+        snapshot(pn);
+    return (pn->log) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+}
+
+static UA_StatusCode
+flush(PersistentNodestore *pn) {
+    pthread_mutex_lock(&pn->fileMutex);
+    UA_StatusCode res = flushLocked(pn);
+    pthread_mutex_unlock(&pn->fileMutex);
+    return res;
+}
+
+/* Flush periodically so that no later change is needed to write the pending
+ * changes */
+static void *
+flushLoop(void *context) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    UA_UInt64 intervalNsec = (UA_UInt64)(pn->flushInterval * 1000.0 * 1000.0);
+    pthread_mutex_lock(&pn->fileMutex);
+    while(pn->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        UA_UInt64 nsec = (UA_UInt64)deadline.tv_nsec + intervalNsec;
+        deadline.tv_sec += (time_t)(nsec / 1000000000);
+        deadline.tv_nsec = (long)(nsec % 1000000000);
+        pthread_cond_timedwait(&pn->flushCondition, &pn->fileMutex, &deadline);
+        if(pn->running)
+            flushLocked(pn);
+    }
+    pthread_mutex_unlock(&pn->fileMutex);
+    return NULL;
+}
+
+typedef struct {
+    PersistentNodestore *pn;
+    FILE *fp;
+    UA_StatusCode res;
+} SnapshotContext;
+
+static void
+snapshotVisitor(void *context, const UA_Node *node) {
+    SnapshotContext *ctx = (SnapshotContext*)context;
+    if(ctx->res != UA_STATUSCODE_GOOD)
+        return;
+    /* The node might be edited. Retry the snapshot with the next flush. */
+    if(isNodeHeld(ctx->pn, node)) {
+        ctx->res = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        return;
+    }
+    ctx->res = recordPut(ctx->pn, node);
+    if(ctx->res == UA_STATUSCODE_GOOD && ctx->pn->bufUsed >= SNAPSHOT_BLOCKSIZE)
+        ctx->res = writeBlock(ctx->pn, ctx->fp);
+}
+
+/* Write all nodes to a temporary file that replaces the snapshot. Then
+ * truncate the log. The pending changes are contained in the snapshot. The
+ * fileMutex is held. The mutex is held only while the nodes are encoded. */
+static UA_StatusCode
+snapshot(PersistentNodestore *pn) {
+    pn->snapshotRequired = true;
+    size_t pathLen = strlen(pn->snapshotPath);
+    char *tmpPath = (char*)UA_malloc(pathLen + 5);
+    if(!tmpPath)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(tmpPath, pn->snapshotPath, pathLen);
+    memcpy(&tmpPath[pathLen], ".tmp", 5);
+
+    SnapshotContext ctx;
+    ctx.pn = pn;
+    ctx.res = UA_STATUSCODE_GOOD;
+    ctx.fp = fopen(tmpPath, "wb");
+    if(!ctx.fp) {
+        UA_free(tmpPath);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    ctx.res = writeHeader(ctx.fp, pn->generation + 1);
+    pthread_mutex_lock(&pn->mutex);
+    if(ctx.res == UA_STATUSCODE_GOOD)
+        ctx.res = reserve(pn, 4);
+    resetBlock(pn);
+    if(ctx.res == UA_STATUSCODE_GOOD)
+        pn->inner.iterate(pn->inner.context, snapshotVisitor, &ctx);
+    if(ctx.res == UA_STATUSCODE_GOOD)
+        ctx.res = writeBlock(pn, ctx.fp);
+    resetBlock(pn);
+    if(ctx.res == UA_STATUSCODE_GOOD) {
+        /* Later changes are written to the truncated log */
+        UA_NodeIdMap_clear(&pn->dirty);
+        UA_ByteString_clear(&pn->unwritten);
+    }
+    pthread_mutex_unlock(&pn->mutex);
+    if(ctx.res == UA_STATUSCODE_GOOD)
+        ctx.res = syncFile(ctx.fp);
+    fclose(ctx.fp);
+    if(ctx.res == UA_STATUSCODE_GOOD && rename(tmpPath, pn->snapshotPath) != 0)
+        ctx.res = UA_STATUSCODE_BADINTERNALERROR;
+    if(ctx.res != UA_STATUSCODE_GOOD) {
+        remove(tmpPath);
+        UA_free(tmpPath);
+        return ctx.res;
+    }
+    UA_free(tmpPath);
+
+    /* The current log is now outdated and skipped during the restore. Truncate
+     * it only after the renamed snapshot is durable. */
+    pn->generation++;
+    UA_StatusCode res = syncDirectory(pn->snapshotPath);
+    if(res == UA_STATUSCODE_GOOD)
+        res = resetLog(pn);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    pn->snapshotRequired = false;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+lockNodestore(PersistentNodestore *pn) {
+    pthread_mutex_lock(&pn->mutex);
+    pn->lockDepth++;
+}
+
+/* Without a flush interval, the changes are written when the outermost call
+ * into the Nodestore returns */
+static void
+unlockNodestore(PersistentNodestore *pn) {
+    pn->lockDepth--;
+    UA_Boolean flushNow = (pn->lockDepth == 0 && !pn->threadStarted &&
+                           pn->dirty.count > 0);
+    pthread_mutex_unlock(&pn->mutex);
+    if(flushNow)
+        flush(pn);
+}
+
+/*************/
+/* Replaying */
+/*************/
+
+static UA_StatusCode
+readFile(const char *path, UA_ByteString *content) {
+    UA_ByteString_init(content);
+    FILE *fp = fopen(path, "rb");
+    if(!fp)
+        return UA_STATUSCODE_GOOD; /* Nothing persisted so far */
+    UA_StatusCode res = UA_STATUSCODE_BADINTERNALERROR;
+    if(fseek(fp, 0, SEEK_END) == 0) {
+        long size = ftell(fp);
+        if(size > 0 && fseek(fp, 0, SEEK_SET) == 0)
+            res = UA_ByteString_allocBuffer(content, (size_t)size);
+        else if(size == 0)
+            res = UA_STATUSCODE_GOOD;
+    }
+    if(res == UA_STATUSCODE_GOOD && content->length > 0 &&
+       fread(content->data, 1, content->length, fp) != content->length) {
+        UA_ByteString_clear(content);
+        res = UA_STATUSCODE_BADINTERNALERROR;
+    }
+    fclose(fp);
+    return res;
+}
+
+static UA_StatusCode
+replayRecord(PersistentNodestore *pn, const UA_ByteString *block, size_t *offset) {
+    UA_Byte kind = block->data[(*offset)++];
+    if(kind == RECORD_REMOVE) {
+        UA_NodeId nodeId;
+        UA_StatusCode res = UA_decodeBinary(block, offset, &nodeId,
+                                            &UA_TYPES[UA_TYPES_NODEID], NULL);
+        if(res != UA_STATUSCODE_GOOD)
+            return res;
+        pn->inner.removeNode(pn->inner.context, &nodeId);
+        UA_NodeId_clear(&nodeId);
+        return UA_STATUSCODE_GOOD;
+    }
+    if(kind != RECORD_PUT)
+        return UA_STATUSCODE_BADDECODINGERROR;
+
+    /* Replace the previous version */
+    UA_Node *node = NULL;
+    UA_StatusCode res = UA_Node_decodeBinary(block, offset, pn->customTypes,
+                                             &pn->inner, &node);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    pn->inner.removeNode(pn->inner.context, &node->head.nodeId);
+    return pn->inner.insertNode(pn->inner.context, node, NULL);
+}
+
+/* Replay the blocks after the header. Sets the number of bytes that were
+ * replayed. A block that was cut short ends the replay. */
+static UA_StatusCode
+replay(PersistentNodestore *pn, const UA_ByteString *content, size_t *replayed) {
+    size_t offset = HEADER_SIZE;
+    while(content->length - offset >= 4) {
+        UA_UInt32 length = 0;
+        size_t pos = offset;
+        UA_StatusCode res = UA_decodeBinary(content, &pos, &length,
+                                            &UA_TYPES[UA_TYPES_UINT32], NULL);
+        if(res != UA_STATUSCODE_GOOD || length > content->length - pos)
+            break;
+
+        UA_ByteString block = {length, &content->data[pos]};
+        size_t blockOffset = 0;
+        while(blockOffset < block.length) {
+            res = replayRecord(pn, &block, &blockOffset);
+            if(res != UA_STATUSCODE_GOOD)
+                return res;
+        }
+        offset = pos + length;
+    }
+    *replayed = offset;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+readHeader(const UA_ByteString *content, UA_UInt64 *generation) {
+    size_t offset = 0;
+    return UA_decodeBinary(content, &offset, generation,
+                           &UA_TYPES[UA_TYPES_UINT64], NULL);
+}
+
+static UA_StatusCode
+restore(PersistentNodestore *pn) {
+    /* Without a snapshot, the log belongs to generation zero */
+    UA_ByteString content;
+    size_t replayed = 0;
+    UA_StatusCode res = readFile(pn->snapshotPath, &content);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    if(content.length > 0) {
+        res = readHeader(&content, &pn->generation);
+        if(res == UA_STATUSCODE_GOOD)
+            res = replay(pn, &content, &replayed);
+        if(res == UA_STATUSCODE_GOOD && replayed != content.length)
+            res = UA_STATUSCODE_BADDECODINGERROR; /* The snapshot is never cut short */
+    }
+    UA_ByteString_clear(&content);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+
+    /* A log with a header that was cut short contains no blocks */
+    res = readFile(pn->logPath, &content);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    UA_UInt64 logGeneration = pn->generation;
+    if(content.length >= HEADER_SIZE)
+        res = readHeader(&content, &logGeneration);
+    if(res == UA_STATUSCODE_GOOD && logGeneration > pn->generation)
+        res = UA_STATUSCODE_BADDECODINGERROR; /* The snapshot is missing */
+    UA_Boolean logBlocks = (content.length > HEADER_SIZE);
+    if(res == UA_STATUSCODE_GOOD && logBlocks &&
+       logGeneration == pn->generation)
+        res = replay(pn, &content, &replayed);
+    UA_ByteString_clear(&content);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+
+    /* Continue with an empty log. Otherwise rewrite the snapshot and truncate
+     * the log. This also drops a partially written last block and an outdated
+     * log. */
+    if(!logBlocks)
+        return resetLog(pn);
+    return snapshot(pn);
+}
+
+/*************/
+/* Nodestore */
+/*************/
+
+static UA_Node *
+Persistent_newNode(void *context, UA_NodeClass nodeClass) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    return pn->inner.newNode(pn->inner.context, nodeClass);
+}
+
+static void
+Persistent_deleteNode(void *context, UA_Node *node) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    pn->inner.deleteNode(pn->inner.context, node);
+}
+
+static const UA_Node *
+Persistent_getNode(void *context, const UA_NodeId *nodeId) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    const UA_Node *node = pn->inner.getNode(pn->inner.context, nodeId);
+    unlockNodestore(pn);
+    return node;
+}
+
+static void
+Persistent_releaseNode(void *context, const UA_Node *node) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    pn->inner.releaseNode(pn->inner.context, node);
+    unlockNodestore(pn);
+}
+
+static void
+Persistent_getNodes(void *context, size_t nodeIdsSize, const UA_NodeId **nodeIds,
+                    const UA_Node **outNodes) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    pn->inner.getNodes(pn->inner.context, nodeIdsSize, nodeIds, outNodes);
+    unlockNodestore(pn);
+}
+
+static UA_Boolean
+Persistent_isNodeExclusive(void *context, const UA_Node *node) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    UA_Boolean exclusive = pn->inner.isNodeExclusive(pn->inner.context, node);
+    unlockNodestore(pn);
+    return exclusive;
+}
+
+static UA_StatusCode
+Persistent_getNodeCopy(void *context, const UA_NodeId *nodeId, UA_Node **outNode) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    UA_StatusCode res = pn->inner.getNodeCopy(pn->inner.context, nodeId, outNode);
+    unlockNodestore(pn);
+    return res;
+}
+
+static UA_StatusCode
+Persistent_insertNode(void *context, UA_Node *node, UA_NodeId *addedNodeId) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    UA_NodeId nodeId;
+    lockNodestore(pn);
+    UA_StatusCode res = pn->inner.insertNode(pn->inner.context, node, &nodeId);
+    if(res == UA_STATUSCODE_GOOD)
+        markDirty(pn, &nodeId);
+    unlockNodestore(pn);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    if(addedNodeId)
+        *addedNodeId = nodeId;
+    else
+        UA_NodeId_clear(&nodeId);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+Persistent_replaceNode(void *context, UA_Node *node) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    /* The node is consumed by the inner Nodestore */
+    UA_NodeId nodeId;
+    UA_StatusCode res = UA_NodeId_copy(&node->head.nodeId, &nodeId);
+    if(res != UA_STATUSCODE_GOOD) {
+        pn->inner.deleteNode(pn->inner.context, node);
+        return res;
+    }
+    lockNodestore(pn);
+    res = pn->inner.replaceNode(pn->inner.context, node);
+    if(res == UA_STATUSCODE_GOOD)
+        markDirty(pn, &nodeId);
+    unlockNodestore(pn);
+    UA_NodeId_clear(&nodeId);
+    return res;
+}
+
+static UA_StatusCode
+Persistent_removeNode(void *context, const UA_NodeId *nodeId) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    UA_StatusCode res = pn->inner.removeNode(pn->inner.context, nodeId);
+    if(res == UA_STATUSCODE_GOOD)
+        markDirty(pn, nodeId);
+    unlockNodestore(pn);
+    return res;
+}
+
+static void
+Persistent_nodeChanged(void *context, const UA_Node *node) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    markDirty(pn, &node->head.nodeId);
+    unlockNodestore(pn);
+}
+
+static void
+Persistent_iterate(void *context, UA_NodestoreVisitor visitor,
+                   void *visitorContext) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    lockNodestore(pn);
+    pn->inner.iterate(pn->inner.context, visitor, visitorContext);
+    unlockNodestore(pn);
+}
+
+static void
+Persistent_clear(void *context) {
+    PersistentNodestore *pn = (PersistentNodestore*)context;
+    if(!pn)
+        return;
+
+    /* Stop the flush thread */
+    if(pn->threadStarted) {
+        pthread_mutex_lock(&pn->fileMutex);
+        pn->running = false;
+        pthread_cond_signal(&pn->flushCondition);
+        pthread_mutex_unlock(&pn->fileMutex);
+        pthread_join(pn->thread, NULL);
+        pn->threadStarted = false;
+    }
+
+    if(pn->log) {
+        flush(pn);
+        fclose(pn->log);
+    }
+    UA_NodeIdMap_clear(&pn->dirty);
+    if(pn->inner.context)
+        pn->inner.clear(pn->inner.context);
+    UA_ByteString_clear(&pn->buf);
+    UA_ByteString_clear(&pn->unwritten);
+    UA_free(pn->logPath);
+    UA_free(pn->snapshotPath);
+    pthread_cond_destroy(&pn->flushCondition);
+    pthread_mutex_destroy(&pn->fileMutex);
+    pthread_mutex_destroy(&pn->mutex);
+    UA_free(pn);
+}
+
+static char *
+concatPath(const char *path, const char *suffix) {
+    size_t pathLen = strlen(path);
+    size_t suffixLen = strlen(suffix);
+    char *p = (char*)UA_malloc(pathLen + suffixLen + 1);
+    if(!p)
+        return NULL;
+    memcpy(p, path, pathLen);
+    memcpy(&p[pathLen], suffix, suffixLen + 1);
+    return p;
+}
+
+UA_StatusCode
+UA_Nodestore_Persistent(UA_Nodestore *ns, const char *path,
+                        const UA_DataTypeArray *customTypes,
+                        UA_Double flushInterval, size_t maxLogSize) {
+    PersistentNodestore *pn = (PersistentNodestore*)
+        UA_calloc(1, sizeof(PersistentNodestore));
+    if(!pn)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    pn->customTypes = customTypes;
+    pn->maxLogSize = maxLogSize;
+    pn->flushInterval = (flushInterval > 0.0) ? flushInterval : 0.0;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&pn->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&pn->fileMutex, NULL);
+    pthread_cond_init(&pn->flushCondition, NULL);
+
+    pn->logPath = concatPath(path, ".log");
+    pn->snapshotPath = concatPath(path, ".snapshot");
+    UA_StatusCode res = UA_Nodestore_HashMap(&pn->inner);
+    if(!pn->logPath || !pn->snapshotPath)
+        res = UA_STATUSCODE_BADOUTOFMEMORY;
+    if(res == UA_STATUSCODE_GOOD) {
+        pthread_mutex_lock(&pn->fileMutex);
+        res = restore(pn);
+        pthread_mutex_unlock(&pn->fileMutex);
+    }
+    if(res == UA_STATUSCODE_GOOD && pn->flushInterval > 0.0) {
+        pn->running = true;
+        if(pthread_create(&pn->thread, NULL, flushLoop, pn) == 0)
+            pn->threadStarted = true;
+        else
+            res = UA_STATUSCODE_BADINTERNALERROR;
+    }
+    if(res != UA_STATUSCODE_GOOD) {
+        Persistent_clear(pn);
+        return res;
+    }
+
+    ns->context = pn;
+    ns->clear = Persistent_clear;
+    ns->newNode = Persistent_newNode;
+    ns->deleteNode = Persistent_deleteNode;
+    ns->getNode = Persistent_getNode;
+    ns->releaseNode = Persistent_releaseNode;
+    ns->getNodeCopy = Persistent_getNodeCopy;
+    ns->insertNode = Persistent_insertNode;
+    ns->replaceNode = Persistent_replaceNode;
+    ns->removeNode = Persistent_removeNode;
+    ns->iterate = Persistent_iterate;
+    ns->getNodes = (pn->inner.getNodes) ? Persistent_getNodes : NULL;
+    ns->nodeChanged = Persistent_nodeChanged;
+    ns->getNextNode = NULL;
+    ns->isNodeExclusive = (pn->inner.isNodeExclusive) ? Persistent_isNodeExclusive : NULL;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Nodestore_Persistent_flush(UA_Nodestore *ns) {
+    if(!ns || ns->clear != Persistent_clear)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    return flush((PersistentNodestore*)ns->context);
+}
+
+UA_StatusCode
+UA_Nodestore_Persistent_snapshot(UA_Nodestore *ns) {
+    if(!ns || ns->clear != Persistent_clear)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    PersistentNodestore *pn = (PersistentNodestore*)ns->context;
+    pthread_mutex_lock(&pn->fileMutex);
+    UA_StatusCode res = snapshot(pn);
+    pthread_mutex_unlock(&pn->fileMutex);
+    return res;
+}
+
+#endif
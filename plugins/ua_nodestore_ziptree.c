@@ -28,12 +28,32 @@ struct NodeEntry {
     UA_NodeId nodeId; /* This is actually a UA_Node that also starts with a NodeId */
 };
 
-/* Absolute ordering for NodeIds */
+/* Absolute ordering for NodeIds. The namespace index is compared first, so
+ * that the nodes of a namespace are adjacent in the tree. Numeric NodeIds come
+ * first within a namespace and are ordered by their identifier. This allows
+ * ordered scans over ranges of NodeIds. The other NodeIds are compared by their
+ * hash first. */
 static enum ZIP_CMP
 cmpNodeId(const void *a, const void *b) {
     const NodeEntry *aa = (const NodeEntry*)a;
     const NodeEntry *bb = (const NodeEntry*)b;
 
+    /* Compare namespace and identifier type */
+    if(aa->nodeId.namespaceIndex != bb->nodeId.namespaceIndex)
+        return (aa->nodeId.namespaceIndex < bb->nodeId.namespaceIndex) ?
+            ZIP_CMP_LESS : ZIP_CMP_MORE;
+    if(aa->nodeId.identifierType != bb->nodeId.identifierType)
+        return (aa->nodeId.identifierType < bb->nodeId.identifierType) ?
+            ZIP_CMP_LESS : ZIP_CMP_MORE;
+
+    /* Compare numeric identifier */
+    if(aa->nodeId.identifierType == UA_NODEIDTYPE_NUMERIC) {
+        if(aa->nodeId.identifier.numeric == bb->nodeId.identifier.numeric)
+            return ZIP_CMP_EQ;
+        return (aa->nodeId.identifier.numeric < bb->nodeId.identifier.numeric) ?
+            ZIP_CMP_LESS : ZIP_CMP_MORE;
+    }
+
     /* Compare hash */
     if(aa->nodeIdHash < bb->nodeIdHash)
         return ZIP_CMP_LESS;
@@ -137,6 +157,12 @@ zipNsGetNode(void *nsCtx, const UA_NodeId *nodeId) {
     return (const UA_Node*)&entry->nodeId;
 }
 
+static UA_Boolean
+zipNsIsNodeExclusive(void *nsCtx, const UA_Node *node) {
+    NodeEntry *entry = container_of(node, NodeEntry, nodeId);
+    return (entry->refCount == 1 && !entry->deleted);
+}
+
 static void
 zipNsReleaseNode(void *nsCtx, const UA_Node *node) {
     if(!node)
@@ -280,6 +306,59 @@ zipNsIterate(void *nsCtx, UA_NodestoreVisitor visitor,
     ZIP_ITER(NodeTree, &ns->root, nodeVisitor, &d);
 }
 
+/* The smallest entry that is larger than the key (or equal if inclusive) */
+static NodeEntry *
+findNextEntry(NodeEntry *root, const NodeEntry *key, UA_Boolean inclusive) {
+    NodeEntry *next = NULL;
+    while(root) {
+        enum ZIP_CMP cmp = cmpNodeId(key, root);
+        if(cmp == ZIP_CMP_LESS || (inclusive && cmp == ZIP_CMP_EQ)) {
+            next = root;
+            root = ZIP_LEFT(root, zipfields);
+        } else {
+            root = ZIP_RIGHT(root, zipfields);
+        }
+    }
+    return next;
+}
+
+static const UA_Node *
+zipNsGetNextNode(void *nsCtx, const UA_NodeIdRange *range, UA_NodeId *cursor) {
+    ZipContext *ns = (ZipContext*)nsCtx;
+
+    /* Continue after the cursor or start at the beginning of the range */
+    NodeEntry after;
+    after.nodeId = *cursor;
+    after.nodeIdHash = UA_NodeId_hash(cursor);
+    NodeEntry start;
+    start.nodeId = UA_NODEID_NUMERIC(range->namespaceIndex,
+                                     range->numericOnly ? range->numericMin : 0);
+    start.nodeIdHash = UA_NodeId_hash(&start.nodeId);
+    NodeEntry *entry;
+    if(cmpNodeId(&after, &start) == ZIP_CMP_LESS)
+        entry = findNextEntry(ZIP_ROOT(&ns->root), &start, true);
+    else
+        entry = findNextEntry(ZIP_ROOT(&ns->root), &after, false);
+
+    /* End of the range reached? */
+    if(!entry || entry->nodeId.namespaceIndex != range->namespaceIndex)
+        return NULL;
+    if(range->numericOnly &&
+       (entry->nodeId.identifierType != UA_NODEIDTYPE_NUMERIC ||
+        entry->nodeId.identifier.numeric > range->numericMax))
+        return NULL;
+
+    /* Move the cursor */
+    UA_NodeId next;
+    if(UA_NodeId_copy(&entry->nodeId, &next) != UA_STATUSCODE_GOOD)
+        return NULL;
+    UA_NodeId_clear(cursor);
+    *cursor = next;
+
+    ++entry->refCount;
+    return (const UA_Node*)&entry->nodeId;
+}
+
 static void
 deleteNodeVisitor(NodeEntry *entry, void *data) {
     deleteEntry(entry);
@@ -319,6 +398,10 @@ UA_Nodestore_ZipTree(UA_Nodestore *ns) {
     ns->replaceNode = zipNsReplaceNode;
     ns->removeNode = zipNsRemoveNode;
     ns->iterate = zipNsIterate;
-    
+    ns->getNodes = NULL; /* Use the fallback with getNode */
+    ns->nodeChanged = NULL;
+    ns->getNextNode = zipNsGetNextNode;
+    ns->isNodeExclusive = zipNsIsNodeExclusive;
+
     return UA_STATUSCODE_GOOD;
 }
@@ -14,6 +14,8 @@
 #include <mbedtls/x509.h>
 #include <mbedtls/x509_crt.h>
 #include <mbedtls/error.h>
+#include <mbedtls/sha1.h>
+#include <mbedtls/version.h>
 #endif
 
 #define REMOTECERTIFICATETRUSTED 1
@@ -21,6 +23,11 @@
 #define DUALPARENT               3
 #define PARENTFOUND              4
 
+/* Cache of verification results, keyed by the certificate thumbprint */
+#define CERTCACHE_SIZE           64
+#define CERTCACHE_TTL            (60 * UA_DATETIME_SEC)
+#define CERTCACHE_THUMBPRINT     20 /* sha1 */
+
 /************/
 /* AllowAll */
 /************/
@@ -95,6 +102,12 @@ UA_Bstrstr(const unsigned char *s1, size_t l1, const unsigned char *s2, size_t l
 
 #ifdef UA_ENABLE_ENCRYPTION_MBEDTLS
 
+typedef struct {
+    UA_DateTime validTill; /* Monotonic. Zero for empty entries. */
+    UA_StatusCode result;
+    UA_Byte thumbprint[CERTCACHE_THUMBPRINT];
+} CertCacheEntry;
+
 typedef struct {
     /* If the folders are defined, we use them to reload the certificates during
      * runtime */
@@ -102,15 +115,71 @@ typedef struct {
     UA_String issuerListFolder;
     UA_String revocationListFolder;
 
+    /* Watches the folders for changes. -1 if not used. Then the folders are
+     * reloaded for every verification. */
+    int inotifyFd;
+
+    const UA_Logger *logger;
+
     mbedtls_x509_crt certificateTrustList;
     mbedtls_x509_crt certificateIssuerList;
     mbedtls_x509_crl certificateRevocationList;
+
+    CertCacheEntry cache[CERTCACHE_SIZE];
 } CertInfo;
 
+static void
+certCache_flush(CertInfo *ci) {
+    for(size_t i = 0; i < CERTCACHE_SIZE; i++)
+        ci->cache[i].validTill = 0;
+}
+
+static CertCacheEntry *
+certCache_lookup(CertInfo *ci, const UA_Byte *thumbprint, UA_DateTime now) {
+    for(size_t i = 0; i < CERTCACHE_SIZE; i++) {
+        CertCacheEntry *e = &ci->cache[i];
+        if(e->validTill > now &&
+           memcmp(e->thumbprint, thumbprint, CERTCACHE_THUMBPRINT) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/* Use an empty or expired entry. Otherwise replace the entry that expires
+ * first. The entry does not outlive the validity of the certificate. validTo
+ * is the (wall clock) end of the validity. Zero if unknown. */
+static void
+certCache_insert(CertInfo *ci, const UA_Byte *thumbprint, UA_StatusCode result,
+                 UA_DateTime now, UA_DateTime validTo) {
+    UA_DateTime ttl = CERTCACHE_TTL;
+    if(validTo != 0) {
+        UA_DateTime remaining = validTo - UA_DateTime_now();
+        if(remaining < ttl)
+            ttl = remaining;
+    }
+    if(ttl <= 0)
+        return;
+
+    CertCacheEntry *e = &ci->cache[0];
+    for(size_t i = 0; i < CERTCACHE_SIZE; i++) {
+        if(ci->cache[i].validTill <= now) {
+            e = &ci->cache[i];
+            break;
+        }
+        if(ci->cache[i].validTill < e->validTill)
+            e = &ci->cache[i];
+    }
+    memcpy(e->thumbprint, thumbprint, CERTCACHE_THUMBPRINT);
+    e->result = result;
+    e->validTill = now + ttl;
+}
+
 #ifdef __linux__ /* Linux only so far */
 
 #include <dirent.h>
 #include <limits.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 static UA_StatusCode
 fileNamesFromFolder(const UA_String *folder, size_t *pathsSize, UA_String **paths) {
@@ -165,7 +234,7 @@ reloadCertificates(CertInfo *ci) {
 
     /* Load the trustlists */
     if(ci->trustListFolder.length > 0) {
-        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "Reloading the trust-list");
+        UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER, "Reloading the trust-list");
         mbedtls_x509_crt_free(&ci->certificateTrustList);
         mbedtls_x509_crt_init(&ci->certificateTrustList);
 
@@ -174,19 +243,19 @@ reloadCertificates(CertInfo *ci) {
         f[ci->trustListFolder.length] = 0;
         err = mbedtls_x509_crt_parse_path(&ci->certificateTrustList, f);
         if(err == 0) {
-            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+            UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER,
                         "Loaded certificate from %s", f);
         } else {
             char errBuff[300];
             mbedtls_strerror(err, errBuff, 300);
-            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+            UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER,
                         "Failed to load certificate from %s", f);
         }
     }
 
     /* Load the revocationlists */
     if(ci->revocationListFolder.length > 0) {
-        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "Reloading the revocation-list");
+        UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER, "Reloading the revocation-list");
         size_t pathsSize = 0;
         UA_String *paths = NULL;
         retval = fileNamesFromFolder(&ci->revocationListFolder, &pathsSize, &paths);
@@ -200,11 +269,11 @@ reloadCertificates(CertInfo *ci) {
             f[paths[i].length] = 0;
             err = mbedtls_x509_crl_parse_file(&ci->certificateRevocationList, f);
             if(err == 0) {
-                UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER,
                             "Loaded certificate from %.*s",
                             (int)paths[i].length, paths[i].data);
             } else {
-                UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER,
                             "Failed to load certificate from %.*s",
                             (int)paths[i].length, paths[i].data);
             }
@@ -216,7 +285,7 @@ reloadCertificates(CertInfo *ci) {
 
     /* Load the issuerlists */
     if(ci->issuerListFolder.length > 0) {
-        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "Reloading the issuer-list");
+        UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER, "Reloading the issuer-list");
         mbedtls_x509_crt_free(&ci->certificateIssuerList);
         mbedtls_x509_crt_init(&ci->certificateIssuerList);
         char f[PATH_MAX];
@@ -224,10 +293,10 @@ reloadCertificates(CertInfo *ci) {
         f[ci->issuerListFolder.length] = 0;
         err = mbedtls_x509_crt_parse_path(&ci->certificateIssuerList, f);
         if(err == 0) {
-            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+            UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER,
                         "Loaded certificate from %s", f);
         } else {
-            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+            UA_LOG_INFO(ci->logger, UA_LOGCATEGORY_SERVER,
                         "Failed to load certificate from %s", f);
         }
     }
@@ -235,6 +304,64 @@ reloadCertificates(CertInfo *ci) {
     return retval;
 }
 
+static void
+watchFolder(CertInfo *ci, const UA_String *folder) {
+    if(ci->inotifyFd < 0 || folder->length == 0)
+        return;
+    char f[PATH_MAX];
+    if(folder->length >= PATH_MAX)
+        return;
+    memcpy(f, folder->data, folder->length);
+    f[folder->length] = 0;
+    if(inotify_add_watch(ci->inotifyFd, f, IN_CREATE | IN_DELETE | IN_MODIFY |
+                         IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO) < 0) {
+        UA_LOG_WARNING(ci->logger, UA_LOGCATEGORY_SERVER,
+                       "Cannot watch the folder %s for changes. "
+                       "Reloading the certificates for every verification.", f);
+        close(ci->inotifyFd);
+        ci->inotifyFd = -1;
+    }
+}
+
+static void
+watchFolders(CertInfo *ci) {
+    ci->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    watchFolder(ci, &ci->trustListFolder);
+    watchFolder(ci, &ci->issuerListFolder);
+    watchFolder(ci, &ci->revocationListFolder);
+}
+
+/* Reload the certificates (and flush the cache) only if the folder content
+ * has changed since the last verification */
+static void
+updateCertificates(CertInfo *ci) {
+    if(ci->trustListFolder.length == 0 &&
+       ci->issuerListFolder.length == 0 &&
+       ci->revocationListFolder.length == 0)
+        return;
+
+    if(ci->inotifyFd >= 0) {
+        char buf[4096];
+        UA_Boolean changed = false;
+        while(read(ci->inotifyFd, buf, sizeof(buf)) > 0)
+            changed = true;
+        if(!changed)
+            return;
+    }
+
+    reloadCertificates(ci);
+    certCache_flush(ci);
+}
+
+#endif
+
+static UA_StatusCode
+verifyCertificateUncached(CertInfo *ci, const UA_ByteString *certificate,
+                          UA_DateTime *validTo);
+
+#ifdef UA_ENABLE_UNIT_TEST_FAILURE_HOOKS
+/* Counts the verifications that were not answered from the cache */
+size_t UA_CertificateVerification_uncachedCount;
 #endif
 
 static UA_StatusCode
@@ -245,16 +372,49 @@ certificateVerification_verify(void *verificationContext,
         return UA_STATUSCODE_BADINTERNALERROR;
 
 #ifdef __linux__ /* Reload certificates if folder paths are specified */
-    reloadCertificates(ci);
+    updateCertificates(ci);
 #endif
 
+    /* Look up the cached result for the certificate */
+    UA_Byte thumbprint[CERTCACHE_THUMBPRINT];
+    mbedtls_sha1(certificate->data, certificate->length, thumbprint);
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    CertCacheEntry *e = certCache_lookup(ci, thumbprint, now);
+    if(e)
+        return e->result;
+
+    UA_DateTime validTo = 0;
+    UA_StatusCode retval = verifyCertificateUncached(ci, certificate, &validTo);
+    certCache_insert(ci, thumbprint, retval, now, validTo);
+#ifdef UA_ENABLE_UNIT_TEST_FAILURE_HOOKS
+    UA_CertificateVerification_uncachedCount++;
+#endif
+    return retval;
+}
+
+static UA_DateTime
+fromX509Time(const mbedtls_x509_time *t) {
+    UA_DateTimeStruct dts;
+    memset(&dts, 0, sizeof(UA_DateTimeStruct));
+    dts.year = (UA_UInt16)t->year;
+    dts.month = (UA_UInt16)t->mon;
+    dts.day = (UA_UInt16)t->day;
+    dts.hour = (UA_UInt16)t->hour;
+    dts.min = (UA_UInt16)t->min;
+    dts.sec = (UA_UInt16)t->sec;
+    return UA_DateTime_fromStruct(dts);
+}
+
+static UA_StatusCode
+verifyCertificateUncached(CertInfo *ci, const UA_ByteString *certificate,
+                          UA_DateTime *validTo) {
     if(ci->trustListFolder.length == 0 &&
        ci->issuerListFolder.length == 0 &&
        ci->revocationListFolder.length == 0 &&
        ci->certificateTrustList.raw.len == 0 &&
        ci->certificateIssuerList.raw.len == 0 &&
        ci->certificateRevocationList.raw.len == 0) {
-        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+        UA_LOG_WARNING(ci->logger, UA_LOGCATEGORY_SERVER,
                        "PKI plugin unconfigured. Accepting the certificate.");
         return UA_STATUSCODE_GOOD;
     }
@@ -290,6 +450,7 @@ certificateVerification_verify(void *verificationContext,
         /*                "Could not parse the remote certificate with error: %s", errBuff); */
         return UA_STATUSCODE_BADSECURITYCHECKSFAILED;
     }
+    *validTo = fromX509Time(&remoteCertificate.valid_to);
 
     /* Verify */
     mbedtls_x509_crt_profile crtProfile = {
@@ -446,7 +607,7 @@ certificateVerification_verify(void *verificationContext,
 #if UA_LOGLEVEL <= 400
         char buff[100];
         int len = mbedtls_x509_crt_verify_info(buff, 100, "", flags);
-        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SECURITYPOLICY,
+        UA_LOG_WARNING(ci->logger, UA_LOGCATEGORY_SECURITYPOLICY,
                        "Verifying the certificate failed with error: %.*s", len-1, buff);
 #endif
         if(flags & (uint32_t)MBEDTLS_X509_BADCERT_NOT_TRUSTED) {
@@ -504,6 +665,10 @@ certificateVerification_clear(UA_CertificateVerification *cv) {
     mbedtls_x509_crt_free(&ci->certificateTrustList);
     mbedtls_x509_crl_free(&ci->certificateRevocationList);
     mbedtls_x509_crt_free(&ci->certificateIssuerList);
+#ifdef __linux__
+    if(ci->inotifyFd >= 0)
+        close(ci->inotifyFd);
+#endif
     UA_String_clear(&ci->trustListFolder);
     UA_String_clear(&ci->issuerListFolder);
     UA_String_clear(&ci->revocationListFolder);
@@ -523,6 +688,8 @@ UA_CertificateVerification_Trustlist(UA_CertificateVerification *cv,
     if(!ci)
         return UA_STATUSCODE_BADOUTOFMEMORY;
     memset(ci, 0, sizeof(CertInfo));
+    ci->inotifyFd = -1;
+    ci->logger = (cv->logging) ? cv->logging : UA_Log_Stdout;
     mbedtls_x509_crt_init(&ci->certificateTrustList);
     mbedtls_x509_crl_init(&ci->certificateRevocationList);
     mbedtls_x509_crt_init(&ci->certificateIssuerList);
@@ -575,16 +742,18 @@ UA_CertificateVerification_CertFolders(UA_CertificateVerification *cv,
     if(!ci)
         return UA_STATUSCODE_BADOUTOFMEMORY;
     memset(ci, 0, sizeof(CertInfo));
+    ci->logger = (cv->logging) ? cv->logging : UA_Log_Stdout;
     mbedtls_x509_crt_init(&ci->certificateTrustList);
     mbedtls_x509_crl_init(&ci->certificateRevocationList);
     mbedtls_x509_crt_init(&ci->certificateIssuerList);
 
-    /* Only set the folder paths. They will be reloaded during runtime.
-     * TODO: Add a more efficient reloading of only the changes */
+    /* Only set the folder paths. They are reloaded during runtime when a
+     * change in the folders is signaled by inotify. */
     ci->trustListFolder = UA_STRING_ALLOC(trustListFolder);
     ci->issuerListFolder = UA_STRING_ALLOC(issuerListFolder);
     ci->revocationListFolder = UA_STRING_ALLOC(revocationListFolder);
 
+    watchFolders(ci);
     reloadCertificates(ci);
 
     cv->context = (void*)ci;
@@ -252,6 +252,14 @@ processAsyncResponse(UA_Client *client, UA_UInt32 requestId, const UA_NodeId *re
     const UA_DataType *responseType = ac->responseType;
     const UA_NodeId expectedNodeId = UA_NODEID_NUMERIC(0, ac->responseType->binaryEncodingId);
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
+
+    /* Process the encoded response directly */
+    if(ac->rawCallback && UA_NodeId_equal(responseTypeId, &expectedNodeId)) {
+        ac->rawCallback(client, ac->userdata, requestId, responseMessage, offset);
+        UA_free(ac);
+        return UA_STATUSCODE_GOOD;
+    }
+
     if(!UA_NodeId_equal(responseTypeId, &expectedNodeId)) {
         UA_init(&response, ac->responseType);
         if(UA_NodeId_equal(responseTypeId, &serviceFaultId)) {
@@ -512,6 +520,18 @@ __UA_Client_AsyncServiceEx(UA_Client *client, const void *request,
                            const UA_DataType *responseType,
                            void *userdata, UA_UInt32 *requestId,
                            UA_UInt32 timeout) {
+    return __UA_Client_AsyncServiceRaw(client, request, requestType, callback, NULL,
+                                       responseType, userdata, requestId, timeout);
+}
+
+UA_StatusCode
+__UA_Client_AsyncServiceRaw(UA_Client *client, const void *request,
+                            const UA_DataType *requestType,
+                            UA_ClientAsyncServiceCallback callback,
+                            UA_ClientAsyncRawCallback rawCallback,
+                            const UA_DataType *responseType,
+                            void *userdata, UA_UInt32 *requestId,
+                            UA_UInt32 timeout) {
     if(client->channel.state != UA_SECURECHANNELSTATE_OPEN) {
         UA_LOG_INFO(&client->config.logger, UA_LOGCATEGORY_CLIENT,
                     "SecureChannel must be connected before sending requests");
@@ -523,6 +543,7 @@ __UA_Client_AsyncServiceEx(UA_Client *client, const void *request,
     if(!ac)
         return UA_STATUSCODE_BADOUTOFMEMORY;
     ac->callback = callback;
+    ac->rawCallback = rawCallback;
     ac->responseType = responseType;
     ac->userdata = userdata;
     ac->timeout = timeout;
@@ -59,6 +59,12 @@ typedef struct UA_Client_Subscription {
     UA_UInt32 sequenceNumber;
     UA_DateTime lastActivity;
     LIST_HEAD(, UA_Client_MonitoredItem) monitoredItems;
+
+    /* Index of the MonitoredItems by their clientHandle (as a numeric NodeId).
+     * MonitoredItems that could not be indexed for lack of memory are found by
+     * searching the list. */
+    UA_NodeIdMap monitoredItemsIndex;
+    size_t monitoredItemsSize;
 } UA_Client_Subscription;
 
 void
@@ -80,10 +86,18 @@ UA_Client_Subscriptions_backgroundPublishInactivityCheck(UA_Client *client);
 /* Client */
 /**********/
 
+/* Processes the encoded response (starting at the offset) instead of the
+ * decoded response. Only used if the response has the expected type. */
+typedef void (*UA_ClientAsyncRawCallback)(UA_Client *client, void *userdata,
+                                          UA_UInt32 requestId,
+                                          const UA_ByteString *message,
+                                          size_t *offset);
+
 typedef struct AsyncServiceCall {
     LIST_ENTRY(AsyncServiceCall) pointers;
     UA_UInt32 requestId;
     UA_ClientAsyncServiceCallback callback;
+    UA_ClientAsyncRawCallback rawCallback; /* Can be NULL */
     const UA_DataType *responseType;
     void *userdata;
     UA_DateTime start;
@@ -98,6 +112,17 @@ UA_Client_AsyncService_cancel(UA_Client *client, AsyncServiceCall *ac,
 void
 UA_Client_AsyncService_removeAll(UA_Client *client, UA_StatusCode statusCode);
 
+/* Same as __UA_Client_AsyncServiceEx. The rawCallback (if set) is used for
+ * responses of the expected type. The callback is used for errors. */
+UA_StatusCode
+__UA_Client_AsyncServiceRaw(UA_Client *client, const void *request,
+                            const UA_DataType *requestType,
+                            UA_ClientAsyncServiceCallback callback,
+                            UA_ClientAsyncRawCallback rawCallback,
+                            const UA_DataType *responseType,
+                            void *userdata, UA_UInt32 *requestId,
+                            UA_UInt32 timeout);
+
 typedef struct CustomCallback {
     LIST_ENTRY(CustomCallback) pointers;
     UA_UInt32 callbackId;
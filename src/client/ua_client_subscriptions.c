@@ -15,6 +15,7 @@
 #include <open62541/client_highlevel_async.h>
 
 #include "ua_client_internal.h"
+#include "ua_types_encoding_binary.h"
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS /* conditional compilation */
 
@@ -44,6 +45,8 @@ __Subscriptions_create_handler(UA_Client *client, void *data, UA_UInt32 requestI
     newSub->publishingInterval = response->revisedPublishingInterval;
     newSub->maxKeepAliveCount = response->revisedMaxKeepAliveCount;
     LIST_INIT(&newSub->monitoredItems);
+    memset(&newSub->monitoredItemsIndex, 0, sizeof(UA_NodeIdMap));
+    newSub->monitoredItemsSize = 0;
     LIST_INSERT_HEAD(&client->subscriptions, newSub, listEntry);
 
 cleanup:
@@ -211,6 +214,7 @@ UA_Client_Subscription_deleteInternal(UA_Client *client, UA_Client_Subscription
 
     /* Remove */
     LIST_REMOVE(sub, listEntry);
+    UA_NodeIdMap_clear(&sub->monitoredItemsIndex);
     UA_free(sub);
 }
 
@@ -392,9 +396,39 @@ UA_Client_Subscriptions_deleteSingle(UA_Client *client, UA_UInt32 subscriptionId
 /* MonitoredItems */
 /******************/
 
+static UA_Client_MonitoredItem *
+findMonitoredItem(UA_Client_Subscription *sub, UA_UInt32 clientHandle) {
+    UA_NodeId key = UA_NODEID_NUMERIC(0, clientHandle);
+    void **found = UA_NodeIdMap_find(&sub->monitoredItemsIndex, &key);
+    if(found)
+        return (UA_Client_MonitoredItem*)*found;
+    if(sub->monitoredItemsIndex.count == sub->monitoredItemsSize)
+        return NULL; /* All MonitoredItems are indexed */
+    UA_Client_MonitoredItem *mon;
+    LIST_FOREACH(mon, &sub->monitoredItems, listEntry) {
+        if(mon->clientHandle == clientHandle)
+            break;
+    }
+    return mon;
+}
+
+static void
+UA_Client_MonitoredItem_add(UA_Client_Subscription *sub, UA_Client_MonitoredItem *mon) {
+    LIST_INSERT_HEAD(&sub->monitoredItems, mon, listEntry);
+    sub->monitoredItemsSize++;
+    /* Without memory for the index, the MonitoredItem is found in the list */
+    UA_NodeId key = UA_NODEID_NUMERIC(0, mon->clientHandle);
+    UA_NodeIdMap_insert(&sub->monitoredItemsIndex, &key, mon);
+}
+
 static void
 UA_Client_MonitoredItem_remove(UA_Client *client, UA_Client_Subscription *sub,
                                UA_Client_MonitoredItem *mon) {
+    UA_NodeId key = UA_NODEID_NUMERIC(0, mon->clientHandle);
+    void **found = UA_NodeIdMap_find(&sub->monitoredItemsIndex, &key);
+    if(found && *found == mon)
+        UA_NodeIdMap_remove(&sub->monitoredItemsIndex, &key);
+    sub->monitoredItemsSize--;
     // NOLINTNEXTLINE
     LIST_REMOVE(mon, listEntry);
     if(mon->deleteCallback)
@@ -475,7 +509,7 @@ __MonitoredItems_create_handler(UA_Client *client, CustomCallback *cc, UA_UInt32
             (UA_Client_DataChangeNotificationCallback)(uintptr_t)handlingCallbacks[i];
         newMon->isEventMonitoredItem =
             (request->itemsToCreate[i].itemToMonitor.attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER);
-        LIST_INSERT_HEAD(&sub->monitoredItems, newMon, listEntry);
+        UA_Client_MonitoredItem_add(sub, newMon);
 
         UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
                     "Subscription %" PRIu32 " | Added a MonitoredItem with handle %" PRIu32,
@@ -965,71 +999,66 @@ UA_Client_Subscriptions_nextSequenceNumber(UA_UInt32 sequenceNumber) {
 }
 
 static void
-processDataChangeNotification(UA_Client *client, UA_Client_Subscription *sub,
-                              UA_DataChangeNotification *dataChangeNotification) {
-    for(size_t j = 0; j < dataChangeNotification->monitoredItemsSize; ++j) {
-        UA_MonitoredItemNotification *min = &dataChangeNotification->monitoredItems[j];
+processMonitoredItemNotification(UA_Client *client, UA_Client_Subscription *sub,
+                                 UA_MonitoredItemNotification *min) {
+    UA_Client_MonitoredItem *mon = findMonitoredItem(sub, min->clientHandle);
+    if(!mon) {
+        UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
+                     "Could not process a notification with clienthandle %" PRIu32
+                     " on subscription %" PRIu32, min->clientHandle, sub->subscriptionId);
+        return;
+    }
 
-        /* Find the MonitoredItem */
-        UA_Client_MonitoredItem *mon;
-        LIST_FOREACH(mon, &sub->monitoredItems, listEntry) {
-            if(mon->clientHandle == min->clientHandle)
-                break;
-        }
+    if(mon->isEventMonitoredItem) {
+        UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
+                     "MonitoredItem is configured for Events. But received a "
+                     "DataChangeNotification.");
+        return;
+    }
 
-        if(!mon) {
-            UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
-                         "Could not process a notification with clienthandle %" PRIu32
-                         " on subscription %" PRIu32, min->clientHandle, sub->subscriptionId);
-            continue;
-        }
+    mon->handler.dataChangeCallback(client, sub->subscriptionId, sub->context,
+                                    mon->monitoredItemId, mon->context,
+                                    &min->value);
+}
 
-        if(mon->isEventMonitoredItem) {
-            UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
-                         "MonitoredItem is configured for Events. But received a "
-                         "DataChangeNotification.");
-            continue;
-        }
+static void
+processEventFieldList(UA_Client *client, UA_Client_Subscription *sub,
+                      UA_EventFieldList *eventFieldList) {
+    UA_Client_MonitoredItem *mon = findMonitoredItem(sub, eventFieldList->clientHandle);
+    if(!mon) {
+        UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
+                     "Could not process a notification with clienthandle %" PRIu32
+                     " on subscription %" PRIu32, eventFieldList->clientHandle,
+                     sub->subscriptionId);
+        return;
+    }
 
-        mon->handler.dataChangeCallback(client, sub->subscriptionId, sub->context,
-                                        mon->monitoredItemId, mon->context,
-                                        &min->value);
+    if(!mon->isEventMonitoredItem) {
+        UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
+                     "MonitoredItem is configured for DataChanges. But received a "
+                     "EventNotification.");
+        return;
     }
+
+    mon->handler.eventCallback(client, sub->subscriptionId, sub->context,
+                               mon->monitoredItemId, mon->context,
+                               eventFieldList->eventFieldsSize,
+                               eventFieldList->eventFields);
+}
+
+static void
+processDataChangeNotification(UA_Client *client, UA_Client_Subscription *sub,
+                              UA_DataChangeNotification *dataChangeNotification) {
+    for(size_t j = 0; j < dataChangeNotification->monitoredItemsSize; ++j)
+        processMonitoredItemNotification(client, sub,
+                                         &dataChangeNotification->monitoredItems[j]);
 }
 
 static void
 processEventNotification(UA_Client *client, UA_Client_Subscription *sub,
                          UA_EventNotificationList *eventNotificationList) {
-    for(size_t j = 0; j < eventNotificationList->eventsSize; ++j) {
-        UA_EventFieldList *eventFieldList = &eventNotificationList->events[j];
-
-        /* Find the MonitoredItem */
-        UA_Client_MonitoredItem *mon;
-        LIST_FOREACH(mon, &sub->monitoredItems, listEntry) {
-            if(mon->clientHandle == eventFieldList->clientHandle)
-                break;
-        }
-
-        if(!mon) {
-            UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
-                         "Could not process a notification with clienthandle %" PRIu32
-                         " on subscription %" PRIu32, eventFieldList->clientHandle,
-                         sub->subscriptionId);
-            continue;
-        }
-
-        if(!mon->isEventMonitoredItem) {
-            UA_LOG_DEBUG(&client->config.logger, UA_LOGCATEGORY_CLIENT,
-                         "MonitoredItem is configured for DataChanges. But received a "
-                         "EventNotification.");
-            continue;
-        }
-
-        mon->handler.eventCallback(client, sub->subscriptionId, sub->context,
-                                   mon->monitoredItemId, mon->context,
-                                   eventFieldList->eventFieldsSize,
-                                   eventFieldList->eventFields);
-    }
+    for(size_t j = 0; j < eventNotificationList->eventsSize; ++j)
+        processEventFieldList(client, sub, &eventNotificationList->events[j]);
 }
 
 static void
@@ -1070,9 +1099,10 @@ processNotificationMessage(UA_Client *client, UA_Client_Subscription *sub,
                    "Unknown notification message type");
 }
 
-static void
-UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequest *request,
-                                               UA_PublishResponse *response) {
+/* Handles the ServiceResult and checks the sequence number. Returns the
+ * Subscription if the notifications shall be processed. */
+static UA_Client_Subscription *
+processPublishResponseHeader(UA_Client *client, UA_PublishResponse *response) {
     UA_NotificationMessage *msg = &response->notificationMessage;
 
     client->currentlyOutStandingPublishRequests--;
@@ -1088,15 +1118,15 @@ UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequ
                          "Too many publishrequest when outStandingPublishRequests = 1");
             UA_Client_Subscriptions_deleteSingle(client, response->subscriptionId);
         }
-        return;
+        return NULL;
     }
 
     if(response->responseHeader.serviceResult == UA_STATUSCODE_BADSHUTDOWN)
-        return;
+        return NULL;
 
     if(!LIST_FIRST(&client->subscriptions)) {
         response->responseHeader.serviceResult = UA_STATUSCODE_BADNOSUBSCRIPTION;
-        return;
+        return NULL;
     }
 
     if(response->responseHeader.serviceResult == UA_STATUSCODE_BADSESSIONCLOSED) {
@@ -1108,14 +1138,14 @@ UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequ
             if (sub != NULL)
               UA_Client_Subscription_deleteInternal(client, sub);
         }
-        return;
+        return NULL;
     }
 
     if(response->responseHeader.serviceResult == UA_STATUSCODE_BADSESSIONIDINVALID) {
         UA_Client_disconnect(client); /* TODO: This should be handled before the process callback */
         UA_LOG_WARNING(&client->config.logger, UA_LOGCATEGORY_CLIENT,
                        "Received BadSessionIdInvalid");
-        return;
+        return NULL;
     }
 
     if(response->responseHeader.serviceResult == UA_STATUSCODE_BADTIMEOUT) {
@@ -1123,14 +1153,14 @@ UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequ
             client->config.inactivityCallback(client);
         UA_LOG_WARNING(&client->config.logger, UA_LOGCATEGORY_CLIENT,
                        "Received Timeout for Publish Response");
-        return;
+        return NULL;
     }
 
     if(response->responseHeader.serviceResult != UA_STATUSCODE_GOOD) {
         UA_LOG_WARNING(&client->config.logger, UA_LOGCATEGORY_CLIENT,
                        "Received Publish Response with code %s",
                        UA_StatusCode_name(response->responseHeader.serviceResult));
-        return;
+        return NULL;
     }
 
     UA_Client_Subscription *sub = findSubscription(client, response->subscriptionId);
@@ -1138,7 +1168,7 @@ UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequ
         response->responseHeader.serviceResult = UA_STATUSCODE_BADINTERNALERROR;
         UA_LOG_WARNING(&client->config.logger, UA_LOGCATEGORY_CLIENT,
                        "Received Publish Response for a non-existant subscription");
-        return;
+        return NULL;
     }
 
     sub->lastActivity = UA_DateTime_nowMonotonic();
@@ -1155,16 +1185,13 @@ UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequ
         /* UA_Client_disconnect(client);
            return; */
     }
-    /* According to f), a keep-alive message contains no notifications and has the sequence number
-     * of the next NotificationMessage that is to be sent => More than one consecutive keep-alive
-     * message or a NotificationMessage following a keep-alive message will share the same sequence
-     * number. */
-    if (msg->notificationDataSize)
-        sub->sequenceNumber = msg->sequenceNumber;
+    return sub;
+}
 
-    /* Process the notification messages */
-    for(size_t k = 0; k < msg->notificationDataSize; ++k)
-        processNotificationMessage(client, sub, &msg->notificationData[k]);
+static void
+processPublishResponseAcks(UA_Client *client, UA_Client_Subscription *sub,
+                           UA_PublishResponse *response) {
+    UA_NotificationMessage *msg = &response->notificationMessage;
 
     /* Add to the list of pending acks */
     for(size_t i = 0; i < response->availableSequenceNumbersSize; i++) {
@@ -1185,6 +1212,28 @@ UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequ
     } 
 }
 
+static void
+UA_Client_Subscriptions_processPublishResponse(UA_Client *client, UA_PublishRequest *request,
+                                               UA_PublishResponse *response) {
+    UA_Client_Subscription *sub = processPublishResponseHeader(client, response);
+    if(!sub)
+        return;
+
+    /* According to f), a keep-alive message contains no notifications and has the sequence number
+     * of the next NotificationMessage that is to be sent => More than one consecutive keep-alive
+     * message or a NotificationMessage following a keep-alive message will share the same sequence
+     * number. */
+    UA_NotificationMessage *msg = &response->notificationMessage;
+    if (msg->notificationDataSize)
+        sub->sequenceNumber = msg->sequenceNumber;
+
+    /* Process the notification messages */
+    for(size_t k = 0; k < msg->notificationDataSize; ++k)
+        processNotificationMessage(client, sub, &msg->notificationData[k]);
+
+    processPublishResponseAcks(client, sub, response);
+}
+
 static void
 processPublishResponseAsync(UA_Client *client, void *userdata, UA_UInt32 requestId,
                             void *response) {
@@ -1201,6 +1250,195 @@ processPublishResponseAsync(UA_Client *client, void *userdata, UA_UInt32 request
     UA_Client_Subscriptions_backgroundPublish(client);
 }
 
+/* Decodes an array length. The null array is returned as an empty array. */
+static UA_StatusCode
+decodeArrayLength(const UA_ByteString *msg, size_t *offset, size_t *length) {
+    UA_Int32 len = 0;
+    UA_StatusCode res = UA_decodeBinary(msg, offset, &len, &UA_TYPES[UA_TYPES_INT32], NULL);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    /* Every element takes up at least one byte */
+    if(len > 0 && (size_t)len > msg->length - *offset)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    *length = (len > 0) ? (size_t)len : 0;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+decodeAvailableSequenceNumbers(const UA_ByteString *msg, size_t *offset,
+                               UA_PublishResponse *response) {
+    size_t size = 0;
+    UA_StatusCode res = decodeArrayLength(msg, offset, &size);
+    if(res != UA_STATUSCODE_GOOD || size == 0)
+        return res;
+    response->availableSequenceNumbers = (UA_UInt32*)
+        UA_Array_new(size, &UA_TYPES[UA_TYPES_UINT32]);
+    if(!response->availableSequenceNumbers)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    response->availableSequenceNumbersSize = size;
+    for(size_t i = 0; i < size && res == UA_STATUSCODE_GOOD; i++)
+        res = UA_decodeBinary(msg, offset, &response->availableSequenceNumbers[i],
+                              &UA_TYPES[UA_TYPES_UINT32], NULL);
+    return res;
+}
+
+/* Decodes the array elements one at a time into the stack and processes them
+ * right away */
+static UA_StatusCode
+streamDataChangeNotification(UA_Client *client, UA_Client_Subscription *sub,
+                             const UA_ByteString *msg, size_t *offset) {
+    const UA_DataTypeArray *customTypes = client->config.customDataTypes;
+    size_t size = 0;
+    UA_StatusCode res = decodeArrayLength(msg, offset, &size);
+    for(size_t i = 0; i < size && res == UA_STATUSCODE_GOOD; i++) {
+        UA_MonitoredItemNotification min;
+        res = UA_decodeBinary(msg, offset, &min,
+                              &UA_TYPES[UA_TYPES_MONITOREDITEMNOTIFICATION], customTypes);
+        if(res != UA_STATUSCODE_GOOD)
+            break;
+        processMonitoredItemNotification(client, sub, &min);
+        UA_MonitoredItemNotification_clear(&min);
+    }
+
+    /* Skip the DiagnosticInfos */
+    if(res == UA_STATUSCODE_GOOD)
+        res = decodeArrayLength(msg, offset, &size);
+    for(size_t i = 0; i < size && res == UA_STATUSCODE_GOOD; i++) {
+        UA_DiagnosticInfo di;
+        res = UA_decodeBinary(msg, offset, &di, &UA_TYPES[UA_TYPES_DIAGNOSTICINFO], NULL);
+        UA_DiagnosticInfo_clear(&di);
+    }
+    return res;
+}
+
+static UA_StatusCode
+streamEventNotificationList(UA_Client *client, UA_Client_Subscription *sub,
+                            const UA_ByteString *msg, size_t *offset) {
+    size_t size = 0;
+    UA_StatusCode res = decodeArrayLength(msg, offset, &size);
+    for(size_t i = 0; i < size && res == UA_STATUSCODE_GOOD; i++) {
+        UA_EventFieldList efl;
+        res = UA_decodeBinary(msg, offset, &efl, &UA_TYPES[UA_TYPES_EVENTFIELDLIST],
+                              client->config.customDataTypes);
+        if(res != UA_STATUSCODE_GOOD)
+            break;
+        processEventFieldList(client, sub, &efl);
+        UA_EventFieldList_clear(&efl);
+    }
+    return res;
+}
+
+/* Streams DataChangeNotifications and EventNotificationLists. Other
+ * notifications are decoded as a whole. */
+static UA_StatusCode
+streamNotificationData(UA_Client *client, UA_Client_Subscription *sub,
+                       const UA_ByteString *msg, size_t *offset) {
+    const UA_NodeId dataChangeId =
+        UA_NODEID_NUMERIC(0, UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION].binaryEncodingId);
+    const UA_NodeId eventListId =
+        UA_NODEID_NUMERIC(0, UA_TYPES[UA_TYPES_EVENTNOTIFICATIONLIST].binaryEncodingId);
+
+    /* Decode the ExtensionObject header */
+    size_t start = *offset;
+    UA_NodeId typeId;
+    UA_Byte encoding = 0;
+    UA_StatusCode res = UA_decodeBinary(msg, offset, &typeId, &UA_TYPES[UA_TYPES_NODEID], NULL);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    res = UA_decodeBinary(msg, offset, &encoding, &UA_TYPES[UA_TYPES_BYTE], NULL);
+    UA_Boolean dataChange = UA_NodeId_equal(&typeId, &dataChangeId);
+    UA_Boolean eventList = UA_NodeId_equal(&typeId, &eventListId);
+    UA_NodeId_clear(&typeId);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+
+    /* Jump over the body length (same as in the ExtensionObject decoding) */
+    if(encoding == UA_EXTENSIONOBJECT_ENCODED_BYTESTRING && (dataChange || eventList)) {
+        if(msg->length - *offset < 4)
+            return UA_STATUSCODE_BADDECODINGERROR;
+        *offset += 4;
+        if(dataChange)
+            return streamDataChangeNotification(client, sub, msg, offset);
+        return streamEventNotificationList(client, sub, msg, offset);
+    }
+
+    *offset = start;
+    UA_ExtensionObject eo;
+    res = UA_decodeBinary(msg, offset, &eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT],
+                          client->config.customDataTypes);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    processNotificationMessage(client, sub, &eo);
+    UA_ExtensionObject_clear(&eo);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Processes the encoded PublishResponse if streamNotifications is enabled.
+ * The members are decoded in order. The trailing results and DiagnosticInfos
+ * are not used and remain undecoded. */
+static void
+processPublishResponseStream(UA_Client *client, void *userdata, UA_UInt32 requestId,
+                             const UA_ByteString *msg, size_t *offset) {
+    UA_PublishRequest *req = (UA_PublishRequest*)userdata;
+    UA_PublishResponse response;
+    UA_PublishResponse_init(&response);
+    UA_NotificationMessage *nm = &response.notificationMessage;
+    size_t notificationsSize = 0;
+
+    /* Decode the members before the notifications */
+    UA_StatusCode res =
+        UA_decodeBinary(msg, offset, &response.responseHeader,
+                        &UA_TYPES[UA_TYPES_RESPONSEHEADER], client->config.customDataTypes);
+    if(res == UA_STATUSCODE_GOOD)
+        res = UA_decodeBinary(msg, offset, &response.subscriptionId,
+                              &UA_TYPES[UA_TYPES_UINT32], NULL);
+    if(res == UA_STATUSCODE_GOOD)
+        res = decodeAvailableSequenceNumbers(msg, offset, &response);
+    if(res == UA_STATUSCODE_GOOD)
+        res = UA_decodeBinary(msg, offset, &response.moreNotifications,
+                              &UA_TYPES[UA_TYPES_BOOLEAN], NULL);
+    if(res == UA_STATUSCODE_GOOD)
+        res = UA_decodeBinary(msg, offset, &nm->sequenceNumber,
+                              &UA_TYPES[UA_TYPES_UINT32], NULL);
+    if(res == UA_STATUSCODE_GOOD)
+        res = UA_decodeBinary(msg, offset, &nm->publishTime,
+                              &UA_TYPES[UA_TYPES_DATETIME], NULL);
+    if(res == UA_STATUSCODE_GOOD)
+        res = decodeArrayLength(msg, offset, &notificationsSize);
+    if(res != UA_STATUSCODE_GOOD) {
+        UA_LOG_INFO(&client->config.logger, UA_LOGCATEGORY_CLIENT,
+                    "Could not decode the response with id %u due to %s",
+                    requestId, UA_StatusCode_name(res));
+        response.responseHeader.serviceResult = res;
+    }
+
+    UA_Client_Subscription *sub = processPublishResponseHeader(client, &response);
+    if(!sub)
+        goto cleanup;
+
+    /* See UA_Client_Subscriptions_processPublishResponse */
+    if(notificationsSize > 0)
+        sub->sequenceNumber = nm->sequenceNumber;
+
+    for(size_t i = 0; i < notificationsSize && res == UA_STATUSCODE_GOOD; i++)
+        res = streamNotificationData(client, sub, msg, offset);
+
+    /* Not acknowledged. The server can send the notifications again. */
+    if(res != UA_STATUSCODE_GOOD) {
+        UA_LOG_WARNING(&client->config.logger, UA_LOGCATEGORY_CLIENT,
+                       "Subscription %" PRIu32 " | Could not decode the notifications "
+                       "due to %s", sub->subscriptionId, UA_StatusCode_name(res));
+        goto cleanup;
+    }
+
+    processPublishResponseAcks(client, sub, &response);
+
+ cleanup:
+    UA_PublishResponse_clear(&response);
+    UA_PublishRequest_delete(req);
+    UA_Client_Subscriptions_backgroundPublish(client);
+}
+
 void
 UA_Client_Subscriptions_clean(UA_Client *client) {
     UA_Client_NotificationsAckNumber *n, *tmp;
@@ -1269,10 +1507,12 @@ UA_Client_Subscriptions_backgroundPublish(UA_Client *client) {
 
         /* Disable the timeout, it is treat in
          * UA_Client_Subscriptions_backgroundPublishInactivityCheck */
-        retval = __UA_Client_AsyncServiceEx(client, request, &UA_TYPES[UA_TYPES_PUBLISHREQUEST],
-                                            processPublishResponseAsync,
-                                            &UA_TYPES[UA_TYPES_PUBLISHRESPONSE],
-                                            (void*)request, &requestId, 0);
+        retval = __UA_Client_AsyncServiceRaw(client, request, &UA_TYPES[UA_TYPES_PUBLISHREQUEST],
+                                             processPublishResponseAsync,
+                                             client->config.streamNotifications ?
+                                             processPublishResponseStream : NULL,
+                                             &UA_TYPES[UA_TYPES_PUBLISHRESPONSE],
+                                             (void*)request, &requestId, 0);
         if(retval != UA_STATUSCODE_GOOD) {
             UA_PublishRequest_delete(request);
             return;
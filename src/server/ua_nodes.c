@@ -13,39 +13,6 @@
 
 #include "ua_server_internal.h"
 #include "ua_types_encoding_binary.h"
-#include "ziptree.h"
-
-/* ZipTree for the lookup of references by their identifier */
-
-static enum ZIP_CMP
-cmpRefTargetId(const void *a, const void *b) {
-    const UA_ReferenceTarget *aa = (const UA_ReferenceTarget*)a;
-    const UA_ReferenceTarget *bb = (const UA_ReferenceTarget*)b;
-    if(aa->targetIdHash < bb->targetIdHash)
-        return ZIP_CMP_LESS;
-    if(aa->targetIdHash > bb->targetIdHash)
-        return ZIP_CMP_MORE;
-    return (enum ZIP_CMP)UA_ExpandedNodeId_order(&aa->targetId, &bb->targetId);
-}
-
-ZIP_IMPL(UA_ReferenceTargetIdTree, UA_ReferenceTarget, idTreeFields,
-         UA_ReferenceTarget, idTreeFields, cmpRefTargetId)
-
-/* ZipTree for the lookup of references by their BrowseName. UA_ReferenceTarget
- * stores only the hash. A full node lookup is in order to do the actual
- * comparison. */
-
-static enum ZIP_CMP
-cmpRefTargetName(const UA_UInt32 *nameHashA, const UA_UInt32 *nameHashB) {
-    if(*nameHashA < *nameHashB)
-        return ZIP_CMP_LESS;
-    if(*nameHashA > *nameHashB)
-        return ZIP_CMP_MORE;
-    return ZIP_CMP_EQ;
-}
-
-ZIP_IMPL(UA_ReferenceTargetNameTree, UA_ReferenceTarget, nameTreeFields,
-         UA_UInt32, targetNameHash, cmpRefTargetName)
 
 /* General node handling methods. There is no UA_Node_new() method here.
  * Creating nodes is part of the Nodestore layer */
@@ -210,7 +177,6 @@ UA_Node_copy(const UA_Node *src, UA_Node *dst) {
             UA_NodeReferenceKind *srefs = &srchead->references[i];
             UA_NodeReferenceKind *drefs = &dsthead->references[i];
             drefs->isInverse = srefs->isInverse;
-            ZIP_INIT(&drefs->refTargetsIdTree);
             retval = UA_NodeId_copy(&srefs->referenceTypeId, &drefs->referenceTypeId);
             if(retval != UA_STATUSCODE_GOOD)
                 break;
@@ -218,47 +184,28 @@ UA_Node_copy(const UA_Node *src, UA_Node *dst) {
                 UA_malloc(srefs->refTargetsSize* sizeof(UA_ReferenceTarget));
             if(!drefs->refTargets) {
                 UA_NodeId_clear(&drefs->referenceTypeId);
+                retval = UA_STATUSCODE_BADOUTOFMEMORY;
                 break;
             }
-            uintptr_t arraydiff = (uintptr_t)drefs->refTargets - (uintptr_t)srefs->refTargets;
             for(size_t j = 0; j < srefs->refTargetsSize; j++) {
                 UA_ReferenceTarget *srefTarget = &srefs->refTargets[j];
                 UA_ReferenceTarget *drefTarget = &drefs->refTargets[j];
                 retval |= UA_ExpandedNodeId_copy(&srefTarget->targetId, &drefTarget->targetId);
                 drefTarget->targetIdHash = srefTarget->targetIdHash;
                 drefTarget->targetNameHash = srefTarget->targetNameHash;
-                ZIP_RANK(drefTarget, idTreeFields) = ZIP_RANK(srefTarget, idTreeFields);
-                /* IdTree Fields */
-                ZIP_RIGHT(drefTarget, idTreeFields) = NULL;
-                if(ZIP_RIGHT(srefTarget, idTreeFields))
-                    ZIP_RIGHT(drefTarget, idTreeFields) = (UA_ReferenceTarget*)
-                        ((uintptr_t)ZIP_RIGHT(srefTarget, idTreeFields) + arraydiff);
-                ZIP_LEFT(drefTarget, idTreeFields) = NULL;
-                if(ZIP_LEFT(srefTarget, idTreeFields))
-                    ZIP_LEFT(drefTarget, idTreeFields) = (UA_ReferenceTarget*)
-                        ((uintptr_t)ZIP_LEFT(srefTarget, idTreeFields) + arraydiff);
-                /* NameTree Fields */
-                ZIP_RIGHT(drefTarget, nameTreeFields) = NULL;
-                if(ZIP_RIGHT(srefTarget, nameTreeFields))
-                    ZIP_RIGHT(drefTarget, nameTreeFields) = (UA_ReferenceTarget*)
-                        ((uintptr_t)ZIP_RIGHT(srefTarget, nameTreeFields) + arraydiff);
-                ZIP_LEFT(drefTarget, nameTreeFields) = NULL;
-                if(ZIP_LEFT(srefTarget, nameTreeFields))
-                    ZIP_LEFT(drefTarget, nameTreeFields) = (UA_ReferenceTarget*)
-                        ((uintptr_t)ZIP_LEFT(srefTarget, nameTreeFields) + arraydiff);
             }
-            /* IdTree Root */
-            ZIP_ROOT(&drefs->refTargetsIdTree) = NULL;
-            if(ZIP_ROOT(&srefs->refTargetsIdTree))
-                ZIP_ROOT(&drefs->refTargetsIdTree) = (UA_ReferenceTarget*)
-                    ((uintptr_t)ZIP_ROOT(&srefs->refTargetsIdTree) + arraydiff);
-            /* NameTree Root */
-            ZIP_ROOT(&drefs->refTargetsNameTree) = NULL;
-            if(ZIP_ROOT(&srefs->refTargetsNameTree))
-                ZIP_ROOT(&drefs->refTargetsNameTree) = (UA_ReferenceTarget*)
-                    ((uintptr_t)ZIP_ROOT(&srefs->refTargetsNameTree) + arraydiff);
-
             drefs->refTargetsSize = srefs->refTargetsSize;
+
+            /* The index holds array positions and can be copied as is */
+            if(srefs->refTargetsIndex) {
+                drefs->refTargetsIndex = (UA_UInt32*)
+                    UA_malloc(srefs->refTargetsIndexSize * 2 * sizeof(UA_UInt32));
+                if(drefs->refTargetsIndex) {
+                    memcpy(drefs->refTargetsIndex, srefs->refTargetsIndex,
+                           srefs->refTargetsIndexSize * 2 * sizeof(UA_UInt32));
+                    drefs->refTargetsIndexSize = srefs->refTargetsIndexSize;
+                }
+            }
             if(retval != UA_STATUSCODE_GOOD)
                 break;
         }
@@ -514,54 +461,159 @@ UA_Node_setAttributes(UA_Node *node, const void *attributes, const UA_DataType *
 /* Manage References */
 /*********************/
 
+/* The index of the reference targets uses open addressing with linear probing.
+ * Deletion shifts the following entries back so that no tombstones are
+ * needed. */
 
-static UA_StatusCode
-resizeReferenceTargets(UA_NodeReferenceKind *refs, size_t newSize) {
+static UA_UInt32 *
+targetIndex(const UA_NodeReferenceKind *rk, UA_Boolean byName) {
+    return &rk->refTargetsIndex[byName ? rk->refTargetsIndexSize : 0];
+}
 
-    UA_ReferenceTarget *targets = (UA_ReferenceTarget*)
-        UA_realloc(refs->refTargets, newSize * sizeof(UA_ReferenceTarget));
-    if(!targets)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
+static size_t
+targetHome(const UA_NodeReferenceKind *rk, UA_Boolean byName, UA_UInt32 pos) {
+    const UA_ReferenceTarget *t = &rk->refTargets[pos - 1];
+    UA_UInt32 hash = byName ? t->targetNameHash : t->targetIdHash;
+    return hash & (rk->refTargetsIndexSize - 1);
+}
+
+static void
+targetIndexInsert(UA_NodeReferenceKind *rk, UA_Boolean byName, UA_UInt32 pos) {
+    UA_UInt32 *index = targetIndex(rk, byName);
+    size_t mask = rk->refTargetsIndexSize - 1;
+    size_t i = targetHome(rk, byName, pos);
+    while(index[i] != 0)
+        i = (i + 1) & mask;
+    index[i] = pos;
+}
+
+/* Returns the slot with the position. The position must be in the index. */
+static size_t
+targetIndexSlot(const UA_NodeReferenceKind *rk, UA_Boolean byName, UA_UInt32 pos) {
+    const UA_UInt32 *index = targetIndex(rk, byName);
+    size_t mask = rk->refTargetsIndexSize - 1;
+    size_t i = targetHome(rk, byName, pos);
+    while(index[i] != pos)
+        i = (i + 1) & mask;
+    return i;
+}
 
-    /* Repair the pointers in the tree for the realloced array */
-    uintptr_t arraydiff = (uintptr_t)targets - (uintptr_t)refs->refTargets;
-    if(arraydiff != 0) {
-        for(size_t i = 0; i < refs->refTargetsSize; i++) {
-            if(targets[i].idTreeFields.zip_left)
-                targets[i].idTreeFields.zip_left = (UA_ReferenceTarget*)
-                    ((uintptr_t)targets[i].idTreeFields.zip_left + arraydiff);
-            if(targets[i].idTreeFields.zip_right)
-                targets[i].idTreeFields.zip_right = (UA_ReferenceTarget*)
-                    ((uintptr_t)targets[i].idTreeFields.zip_right + arraydiff);
-            if(targets[i].nameTreeFields.zip_left)
-                targets[i].nameTreeFields.zip_left = (UA_ReferenceTarget*)
-                    ((uintptr_t)targets[i].nameTreeFields.zip_left + arraydiff);
-            if(targets[i].nameTreeFields.zip_right)
-                targets[i].nameTreeFields.zip_right = (UA_ReferenceTarget*)
-                    ((uintptr_t)targets[i].nameTreeFields.zip_right + arraydiff);
+static void
+targetIndexRemove(UA_NodeReferenceKind *rk, UA_Boolean byName, UA_UInt32 pos) {
+    UA_UInt32 *index = targetIndex(rk, byName);
+    size_t mask = rk->refTargetsIndexSize - 1;
+    size_t i = targetIndexSlot(rk, byName, pos);
+    size_t j = i;
+    while(true) {
+        j = (j + 1) & mask;
+        if(index[j] == 0)
+            break;
+        /* Move the entry into the gap unless its home slot lies cyclically
+         * in (i, j] */
+        size_t k = targetHome(rk, byName, index[j]);
+        if((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+            index[i] = index[j];
+            i = j;
         }
     }
+    index[i] = 0;
+}
 
-    if(refs->refTargetsIdTree.zip_root)
-        refs->refTargetsIdTree.zip_root = (UA_ReferenceTarget*)
-            ((uintptr_t)refs->refTargetsIdTree.zip_root + arraydiff);
-    if(refs->refTargetsNameTree.zip_root)
-        refs->refTargetsNameTree.zip_root = (UA_ReferenceTarget*)
-            ((uintptr_t)refs->refTargetsNameTree.zip_root + arraydiff);
-    refs->refTargets = targets;
-    return UA_STATUSCODE_GOOD;
+/* (Re)build the index for the current number of targets. The index is only an
+ * accelerator. If it cannot be allocated, the targets are scanned. */
+static void
+rebuildTargetIndex(UA_NodeReferenceKind *rk) {
+    UA_free(rk->refTargetsIndex);
+    rk->refTargetsIndex = NULL;
+    rk->refTargetsIndexSize = 0;
+    if(rk->refTargetsSize <= UA_REFERENCETARGETS_INDEXTHRESHOLD)
+        return;
+
+    /* Keep the load factor below one half */
+    size_t indexSize = UA_REFERENCETARGETS_INDEXTHRESHOLD * 2;
+    while(indexSize < rk->refTargetsSize * 2)
+        indexSize <<= 1;
+    rk->refTargetsIndex = (UA_UInt32*)UA_calloc(indexSize * 2, sizeof(UA_UInt32));
+    if(!rk->refTargetsIndex)
+        return;
+    rk->refTargetsIndexSize = indexSize;
+    for(size_t i = 1; i <= rk->refTargetsSize; i++) {
+        targetIndexInsert(rk, false, (UA_UInt32)i);
+        targetIndexInsert(rk, true, (UA_UInt32)i);
+    }
 }
 
+static const UA_ReferenceTarget *
+findTargetHashed(const UA_NodeReferenceKind *rk, const UA_ExpandedNodeId *targetId,
+                 UA_UInt32 targetIdHash) {
+    if(!rk->refTargetsIndex) {
+        for(size_t i = 0; i < rk->refTargetsSize; i++) {
+            const UA_ReferenceTarget *t = &rk->refTargets[i];
+            if(t->targetIdHash == targetIdHash &&
+               UA_ExpandedNodeId_order(&t->targetId, targetId) == UA_ORDER_EQ)
+                return t;
+        }
+        return NULL;
+    }
+
+    const UA_UInt32 *index = targetIndex(rk, false);
+    size_t mask = rk->refTargetsIndexSize - 1;
+    for(size_t i = targetIdHash & mask; index[i] != 0; i = (i + 1) & mask) {
+        const UA_ReferenceTarget *t = &rk->refTargets[index[i] - 1];
+        if(t->targetIdHash == targetIdHash &&
+           UA_ExpandedNodeId_order(&t->targetId, targetId) == UA_ORDER_EQ)
+            return t;
+    }
+    return NULL;
+}
+
+const UA_ReferenceTarget *
+UA_NodeReferenceKind_findTarget(const UA_NodeReferenceKind *rk,
+                                const UA_ExpandedNodeId *targetId) {
+    return findTargetHashed(rk, targetId, UA_ExpandedNodeId_hash(targetId));
+}
+
+const UA_ReferenceTarget *
+UA_NodeReferenceKind_findTargetByName(const UA_NodeReferenceKind *rk,
+                                      UA_UInt32 targetNameHash, size_t *iter) {
+    /* Scan the array. The iterator is the next array position. */
+    if(!rk->refTargetsIndex) {
+        while(*iter < rk->refTargetsSize) {
+            const UA_ReferenceTarget *t = &rk->refTargets[*iter];
+            (*iter)++;
+            if(t->targetNameHash == targetNameHash)
+                return t;
+        }
+        return NULL;
+    }
+
+    /* Probe the index. The iterator is the number of probed slots. */
+    const UA_UInt32 *index = targetIndex(rk, true);
+    size_t mask = rk->refTargetsIndexSize - 1;
+    while(*iter < rk->refTargetsIndexSize) {
+        UA_UInt32 pos = index[(targetNameHash + *iter) & mask];
+        (*iter)++;
+        if(pos == 0)
+            break;
+        const UA_ReferenceTarget *t = &rk->refTargets[pos - 1];
+        if(t->targetNameHash == targetNameHash)
+            return t;
+    }
+    *iter = rk->refTargetsIndexSize;
+    return NULL;
+}
 
 static UA_StatusCode
 addReferenceTarget(UA_NodeReferenceKind *refs, const UA_ExpandedNodeId *target,
                    UA_UInt32 targetIdHash, UA_UInt32 targetNameHash) {
-    UA_StatusCode retval = resizeReferenceTargets(refs, refs->refTargetsSize + 1);
-    if(retval != UA_STATUSCODE_GOOD)
-        return retval;
+    UA_ReferenceTarget *targets = (UA_ReferenceTarget*)
+        UA_realloc(refs->refTargets, (refs->refTargetsSize + 1) * sizeof(UA_ReferenceTarget));
+    if(!targets)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    refs->refTargets = targets;
 
     UA_ReferenceTarget *entry = &refs->refTargets[refs->refTargetsSize];
-    retval = UA_ExpandedNodeId_copy(target, &entry->targetId);
+    UA_StatusCode retval = UA_ExpandedNodeId_copy(target, &entry->targetId);
     if(retval != UA_STATUSCODE_GOOD) {
         if(refs->refTargetsSize== 0) {
             /* We had zero references before (realloc was a malloc) */
@@ -573,13 +625,61 @@ addReferenceTarget(UA_NodeReferenceKind *refs, const UA_ExpandedNodeId *target,
 
     entry->targetIdHash = targetIdHash;
     entry->targetNameHash = targetNameHash;
-    unsigned char rank = ZIP_FFS32(UA_UInt32_random());
-    ZIP_INSERT(UA_ReferenceTargetIdTree, &refs->refTargetsIdTree, entry, rank);
-    ZIP_INSERT(UA_ReferenceTargetNameTree, &refs->refTargetsNameTree, entry, rank);
     refs->refTargetsSize++;
+
+    /* Grow the index when it becomes half full */
+    if(refs->refTargetsSize * 2 > refs->refTargetsIndexSize) {
+        rebuildTargetIndex(refs);
+    } else {
+        targetIndexInsert(refs, false, (UA_UInt32)refs->refTargetsSize);
+        targetIndexInsert(refs, true, (UA_UInt32)refs->refTargetsSize);
+    }
     return UA_STATUSCODE_GOOD;
 }
 
+static void
+removeReferenceTarget(UA_NodeReferenceKind *refs, UA_ReferenceTarget *target) {
+    UA_UInt32 pos = (UA_UInt32)(target - refs->refTargets) + 1;
+    UA_UInt32 last = (UA_UInt32)refs->refTargetsSize;
+    if(refs->refTargetsIndex) {
+        targetIndexRemove(refs, false, pos);
+        targetIndexRemove(refs, true, pos);
+        /* The last entry is moved into the gap */
+        if(pos != last) {
+            targetIndex(refs, false)[targetIndexSlot(refs, false, last)] = pos;
+            targetIndex(refs, true)[targetIndexSlot(refs, true, last)] = pos;
+        }
+    }
+
+    UA_ExpandedNodeId_clear(&target->targetId);
+    if(pos != last)
+        *target = refs->refTargets[last - 1];
+    refs->refTargetsSize--;
+    if(refs->refTargetsSize == 0)
+        return;
+
+    /* Shrink down allocated buffer, ignore failure */
+    UA_ReferenceTarget *targets = (UA_ReferenceTarget*)
+        UA_realloc(refs->refTargets, refs->refTargetsSize * sizeof(UA_ReferenceTarget));
+    if(targets)
+        refs->refTargets = targets;
+
+    /* Shrink the index when it becomes sparse */
+    if(refs->refTargetsIndex &&
+       (refs->refTargetsSize <= UA_REFERENCETARGETS_INDEXTHRESHOLD ||
+        refs->refTargetsSize * 8 < refs->refTargetsIndexSize))
+        rebuildTargetIndex(refs);
+}
+
+static void
+clearReferenceKind(UA_NodeReferenceKind *refs) {
+    for(size_t j = 0; j < refs->refTargetsSize; j++)
+        UA_ExpandedNodeId_clear(&refs->refTargets[j].targetId);
+    UA_free(refs->refTargets);
+    UA_free(refs->refTargetsIndex);
+    UA_NodeId_clear(&refs->referenceTypeId);
+}
+
 static UA_StatusCode
 addReferenceKind(UA_NodeHead *head, const UA_AddReferencesItem *item,
                  UA_UInt32 targetBrowseNameHash) {
@@ -592,8 +692,6 @@ addReferenceKind(UA_NodeHead *head, const UA_AddReferencesItem *item,
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     UA_NodeReferenceKind *newRef = &refs[head->referencesSize];
     memset(newRef, 0, sizeof(UA_NodeReferenceKind));
-    ZIP_INIT(&newRef->refTargetsIdTree);
-    ZIP_INIT(&newRef->refTargetsNameTree);
     newRef->isInverse = !item->isForward;
     retval |= UA_NodeId_copy(&item->referenceTypeId, &newRef->referenceTypeId);
     retval |= addReferenceTarget(newRef, &item->targetNodeId,
@@ -631,16 +729,12 @@ UA_Node_addReference(UA_Node *node, const UA_AddReferencesItem *item,
     if(!existingRefs)
         return addReferenceKind(head, item, targetBrowseNameHash);
 
-    UA_ReferenceTarget tmpTarget;
-    tmpTarget.targetId = item->targetNodeId;
-    tmpTarget.targetIdHash = UA_ExpandedNodeId_hash(&item->targetNodeId);
-    UA_ReferenceTarget *found =
-        ZIP_FIND(UA_ReferenceTargetIdTree, &existingRefs->refTargetsIdTree, &tmpTarget);
-    if(found)
+    UA_UInt32 targetIdHash = UA_ExpandedNodeId_hash(&item->targetNodeId);
+    if(findTargetHashed(existingRefs, &item->targetNodeId, targetIdHash))
         return UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED;
 
     return addReferenceTarget(existingRefs, &item->targetNodeId,
-                              tmpTarget.targetIdHash, targetBrowseNameHash);
+                              targetIdHash, targetBrowseNameHash);
 }
 
 UA_StatusCode
@@ -654,58 +748,44 @@ UA_Node_deleteReference(UA_Node *node, const UA_DeleteReferencesItem *item) {
         if(!UA_NodeId_equal(&item->referenceTypeId, &refs->referenceTypeId))
             continue;
 
-        for(size_t j = refs->refTargetsSize; j > 0; --j) {
-            UA_ReferenceTarget *target = &refs->refTargets[j-1];
-            if(!UA_NodeId_equal(&item->targetNodeId.nodeId, &target->targetId.nodeId))
-                continue;
-
-            /* Ok, delete the reference */
-            ZIP_REMOVE(UA_ReferenceTargetIdTree, &refs->refTargetsIdTree, target);
-            ZIP_REMOVE(UA_ReferenceTargetNameTree, &refs->refTargetsNameTree, target);
-            UA_ExpandedNodeId_clear(&target->targetId);
-            refs->refTargetsSize--;
-
-            if(refs->refTargetsSize > 0) {
-                /* At least one target remains in buffer */ 
-                if(j-1 != refs->refTargetsSize) {
-                    /* Move last entry into the entry from where reference was removed */
-                    ZIP_REMOVE(UA_ReferenceTargetIdTree, &refs->refTargetsIdTree,
-                               &refs->refTargets[refs->refTargetsSize]);
-                    ZIP_REMOVE(UA_ReferenceTargetNameTree, &refs->refTargetsNameTree,
-                               &refs->refTargets[refs->refTargetsSize]);
-                    *target = refs->refTargets[refs->refTargetsSize];
-                    ZIP_INSERT(UA_ReferenceTargetIdTree, &refs->refTargetsIdTree,
-                               target, ZIP_RANK(target, idTreeFields));
-                    ZIP_INSERT(UA_ReferenceTargetNameTree, &refs->refTargetsNameTree,
-                               target, ZIP_RANK(target, nameTreeFields));
-                }
-                /* Shrink down allocated buffer, ignore failure */
-                (void)resizeReferenceTargets(refs, refs->refTargetsSize);
-                return UA_STATUSCODE_GOOD;
-            }
+        /* Look up the target. Only the NodeId part of the ExpandedNodeId has
+         * to match. So scan if the exact lookup fails. */
+        UA_ReferenceTarget *target = (UA_ReferenceTarget*)(uintptr_t)
+            UA_NodeReferenceKind_findTarget(refs, &item->targetNodeId);
+        for(size_t j = refs->refTargetsSize; !target && j > 0; --j) {
+            if(UA_NodeId_equal(&item->targetNodeId.nodeId,
+                               &refs->refTargets[j-1].targetId.nodeId))
+                target = &refs->refTargets[j-1];
+        }
+        if(!target)
+            continue;
 
-            /* No target for the ReferenceType remaining. Remove entry. */
-            UA_free(refs->refTargets);
-            UA_NodeId_clear(&refs->referenceTypeId);
-            head->referencesSize--;
-            if(head->referencesSize > 0) {
-                /* Move last array node into array node from where reference kind was removed */
-                if(i-1 != head->referencesSize)
-                    head->references[i-1] = head->references[head->referencesSize];
-                /* And shrink down allocated buffer for one entry */
-                UA_NodeReferenceKind *newRefs = (UA_NodeReferenceKind*)
-                    UA_realloc(head->references, sizeof(UA_NodeReferenceKind) * head->referencesSize);
-                /* Ignore errors in case memory buffer could not be shrinked down */
-                if(newRefs)
-                    head->references = newRefs;
-                return UA_STATUSCODE_GOOD;
-            }
+        /* Ok, delete the reference */
+        if(refs->refTargetsSize > 1) {
+            removeReferenceTarget(refs, target);
+            return UA_STATUSCODE_GOOD;
+        }
 
-            /* No remaining references of any ReferenceType */
-            UA_free(head->references);
-            head->references = NULL;
+        /* No target for the ReferenceType remaining. Remove entry. */
+        clearReferenceKind(refs);
+        head->referencesSize--;
+        if(head->referencesSize > 0) {
+            /* Move last array node into array node from where reference kind was removed */
+            if(i-1 != head->referencesSize)
+                head->references[i-1] = head->references[head->referencesSize];
+            /* And shrink down allocated buffer for one entry */
+            UA_NodeReferenceKind *newRefs = (UA_NodeReferenceKind*)
+                UA_realloc(head->references, sizeof(UA_NodeReferenceKind) * head->referencesSize);
+            /* Ignore errors in case memory buffer could not be shrinked down */
+            if(newRefs)
+                head->references = newRefs;
             return UA_STATUSCODE_GOOD;
         }
+
+        /* No remaining references of any ReferenceType */
+        UA_free(head->references);
+        head->references = NULL;
+        return UA_STATUSCODE_GOOD;
     }
     return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
 }
@@ -733,10 +813,7 @@ UA_Node_deleteReferencesSubset(UA_Node *node, size_t referencesSkipSize,
             continue;
 
         /* Remove references */
-        for(size_t j = 0; j < refs->refTargetsSize; j++)
-            UA_ExpandedNodeId_clear(&refs->refTargets[j].targetId);
-        UA_free(refs->refTargets);
-        UA_NodeId_clear(&refs->referenceTypeId);
+        clearReferenceKind(refs);
         head->referencesSize--;
 
         /* Move last references-kind entry to this position */
@@ -762,3 +839,315 @@ UA_Node_deleteReferencesSubset(UA_Node *node, size_t referencesSkipSize,
 void UA_Node_deleteReferences(UA_Node *node) {
     UA_Node_deleteReferencesSubset(node, 0, NULL);
 }
+
+/*******************/
+/* Binary Encoding */
+/*******************/
+
+/* The fields are encoded one after the other with the standard binary
+ * encoding. The same walk over the fields computes the encoded size (if pos is
+ * NULL) or encodes. */
+typedef struct {
+    size_t size;
+    UA_Byte **pos;
+    const UA_Byte *end;
+} NodeEncodeCtx;
+
+static UA_StatusCode
+encodeField(NodeEncodeCtx *ctx, const void *p, const UA_DataType *type) {
+    if(ctx->pos)
+        return UA_encodeBinary(p, type, ctx->pos, &ctx->end, NULL, NULL);
+    size_t size = UA_calcSizeBinary(p, type);
+    if(size == 0)
+        return UA_STATUSCODE_BADENCODINGERROR;
+    ctx->size += size;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+encodeReferences(NodeEncodeCtx *ctx, const UA_NodeHead *head) {
+    UA_UInt32 kinds = (UA_UInt32)head->referencesSize;
+    UA_StatusCode res = encodeField(ctx, &kinds, &UA_TYPES[UA_TYPES_UINT32]);
+    for(size_t i = 0; i < head->referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &head->references[i];
+        UA_UInt32 targets = (UA_UInt32)rk->refTargetsSize;
+        res |= encodeField(ctx, &rk->referenceTypeId, &UA_TYPES[UA_TYPES_NODEID]);
+        res |= encodeField(ctx, &rk->isInverse, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        res |= encodeField(ctx, &targets, &UA_TYPES[UA_TYPES_UINT32]);
+        for(size_t j = 0; j < rk->refTargetsSize; j++) {
+            const UA_ReferenceTarget *t = &rk->refTargets[j];
+            res |= encodeField(ctx, &t->targetId, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+            res |= encodeField(ctx, &t->targetNameHash, &UA_TYPES[UA_TYPES_UINT32]);
+        }
+        if(res != UA_STATUSCODE_GOOD)
+            return res;
+    }
+    return res;
+}
+
+/* Common to VariableNode and VariableTypeNode. Values from a DataSource are
+ * not encoded. */
+static UA_StatusCode
+encodeVariableAttributes(NodeEncodeCtx *ctx, const UA_VariableNode *vn) {
+    UA_DataValue empty;
+    UA_DataValue_init(&empty);
+    const UA_DataValue *value = &empty;
+    if(vn->valueSource == UA_VALUESOURCE_DATA)
+        value = &vn->value.data.value;
+    UA_UInt32 dims = (UA_UInt32)vn->arrayDimensionsSize;
+    UA_StatusCode res = encodeField(ctx, &vn->dataType, &UA_TYPES[UA_TYPES_NODEID]);
+    res |= encodeField(ctx, &vn->valueRank, &UA_TYPES[UA_TYPES_INT32]);
+    res |= encodeField(ctx, &dims, &UA_TYPES[UA_TYPES_UINT32]);
+    for(size_t i = 0; i < vn->arrayDimensionsSize; i++)
+        res |= encodeField(ctx, &vn->arrayDimensions[i], &UA_TYPES[UA_TYPES_UINT32]);
+    res |= encodeField(ctx, value, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    return res;
+}
+
+static UA_StatusCode
+encodeNode(NodeEncodeCtx *ctx, const UA_Node *node) {
+    const UA_NodeHead *head = &node->head;
+    UA_StatusCode res = encodeField(ctx, &head->nodeClass, &UA_TYPES[UA_TYPES_NODECLASS]);
+    res |= encodeField(ctx, &head->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    res |= encodeField(ctx, &head->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+    res |= encodeField(ctx, &head->displayName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    res |= encodeField(ctx, &head->description, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    res |= encodeField(ctx, &head->writeMask, &UA_TYPES[UA_TYPES_UINT32]);
+    res |= encodeField(ctx, &head->constructed, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    res |= encodeReferences(ctx, head);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+
+    switch(head->nodeClass) {
+    case UA_NODECLASS_VARIABLE: {
+        const UA_VariableNode *vn = &node->variableNode;
+        res |= encodeVariableAttributes(ctx, vn);
+        res |= encodeField(ctx, &vn->accessLevel, &UA_TYPES[UA_TYPES_BYTE]);
+        res |= encodeField(ctx, &vn->minimumSamplingInterval, &UA_TYPES[UA_TYPES_DOUBLE]);
+        res |= encodeField(ctx, &vn->historizing, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_VARIABLETYPE:
+        res |= encodeVariableAttributes(ctx, (const UA_VariableNode*)node);
+        res |= encodeField(ctx, &node->variableTypeNode.isAbstract,
+                           &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_METHOD:
+        res |= encodeField(ctx, &node->methodNode.executable, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_OBJECT:
+        res |= encodeField(ctx, &node->objectNode.eventNotifier, &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        res |= encodeField(ctx, &node->objectTypeNode.isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_REFERENCETYPE: {
+        const UA_ReferenceTypeNode *rn = &node->referenceTypeNode;
+        res |= encodeField(ctx, &rn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        res |= encodeField(ctx, &rn->symmetric, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        res |= encodeField(ctx, &rn->inverseName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    }
+    case UA_NODECLASS_DATATYPE:
+        res |= encodeField(ctx, &node->dataTypeNode.isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_VIEW:
+        res |= encodeField(ctx, &node->viewNode.eventNotifier, &UA_TYPES[UA_TYPES_BYTE]);
+        res |= encodeField(ctx, &node->viewNode.containsNoLoops, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    default:
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    return res;
+}
+
+size_t
+UA_Node_calcSizeBinary(const UA_Node *node) {
+    NodeEncodeCtx ctx;
+    memset(&ctx, 0, sizeof(NodeEncodeCtx));
+    if(encodeNode(&ctx, node) != UA_STATUSCODE_GOOD)
+        return 0;
+    return ctx.size;
+}
+
+UA_StatusCode
+UA_Node_encodeBinary(const UA_Node *node, UA_Byte **bufPos, const UA_Byte *bufEnd) {
+    NodeEncodeCtx ctx;
+    ctx.size = 0;
+    ctx.pos = bufPos;
+    ctx.end = bufEnd;
+    return encodeNode(&ctx, node);
+}
+
+typedef struct {
+    const UA_ByteString *src;
+    size_t *offset;
+    const UA_DataTypeArray *customTypes;
+    const UA_UInt16 *nsMap;
+    size_t nsMapSize;
+} NodeDecodeCtx;
+
+static UA_StatusCode
+decodeField(NodeDecodeCtx *ctx, void *dst, const UA_DataType *type) {
+    return UA_decodeBinary(ctx->src, ctx->offset, dst, type, ctx->customTypes);
+}
+
+static UA_StatusCode
+mapNamespace(const NodeDecodeCtx *ctx, UA_UInt16 *nsIndex) {
+    if(!ctx->nsMap)
+        return UA_STATUSCODE_GOOD;
+    if(*nsIndex >= ctx->nsMapSize)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    *nsIndex = ctx->nsMap[*nsIndex];
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+decodeReferences(NodeDecodeCtx *ctx, UA_Node *node) {
+    UA_UInt32 kinds = 0;
+    UA_StatusCode res = decodeField(ctx, &kinds, &UA_TYPES[UA_TYPES_UINT32]);
+    for(size_t i = 0; i < kinds && res == UA_STATUSCODE_GOOD; i++) {
+        UA_AddReferencesItem item;
+        UA_AddReferencesItem_init(&item);
+        UA_Boolean isInverse = false;
+        UA_UInt32 targets = 0;
+        res |= decodeField(ctx, &item.referenceTypeId, &UA_TYPES[UA_TYPES_NODEID]);
+        res |= decodeField(ctx, &isInverse, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        res |= decodeField(ctx, &targets, &UA_TYPES[UA_TYPES_UINT32]);
+        res |= mapNamespace(ctx, &item.referenceTypeId.namespaceIndex);
+        item.isForward = !isInverse;
+        for(size_t j = 0; j < targets && res == UA_STATUSCODE_GOOD; j++) {
+            UA_UInt32 nameHash = 0;
+            res |= decodeField(ctx, &item.targetNodeId, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+            res |= decodeField(ctx, &nameHash, &UA_TYPES[UA_TYPES_UINT32]);
+            if(item.targetNodeId.serverIndex == 0)
+                res |= mapNamespace(ctx, &item.targetNodeId.nodeId.namespaceIndex);
+            if(res == UA_STATUSCODE_GOOD)
+                res = UA_Node_addReference(node, &item, nameHash);
+            UA_ExpandedNodeId_clear(&item.targetNodeId);
+        }
+        UA_NodeId_clear(&item.referenceTypeId);
+    }
+    return res;
+}
+
+static UA_StatusCode
+decodeVariableAttributes(NodeDecodeCtx *ctx, UA_VariableNode *vn) {
+    UA_UInt32 dims = 0;
+    UA_StatusCode res = decodeField(ctx, &vn->dataType, &UA_TYPES[UA_TYPES_NODEID]);
+    res |= decodeField(ctx, &vn->valueRank, &UA_TYPES[UA_TYPES_INT32]);
+    res |= decodeField(ctx, &dims, &UA_TYPES[UA_TYPES_UINT32]);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    /* Every dimension takes four bytes */
+    if(dims > (ctx->src->length - *ctx->offset) / 4)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    if(dims > 0) {
+        vn->arrayDimensions = (UA_UInt32*)UA_Array_new(dims, &UA_TYPES[UA_TYPES_UINT32]);
+        if(!vn->arrayDimensions)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        vn->arrayDimensionsSize = dims;
+        for(size_t i = 0; i < dims; i++)
+            res |= decodeField(ctx, &vn->arrayDimensions[i], &UA_TYPES[UA_TYPES_UINT32]);
+    }
+    vn->valueSource = UA_VALUESOURCE_DATA;
+    res |= decodeField(ctx, &vn->value.data.value, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    res |= mapNamespace(ctx, &vn->dataType.namespaceIndex);
+    return res;
+}
+
+static UA_StatusCode
+decodeNode(NodeDecodeCtx *ctx, UA_Node *node) {
+    UA_NodeHead *head = &node->head;
+    UA_StatusCode res = decodeField(ctx, &head->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    res |= decodeField(ctx, &head->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+    res |= decodeField(ctx, &head->displayName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    res |= decodeField(ctx, &head->description, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    res |= decodeField(ctx, &head->writeMask, &UA_TYPES[UA_TYPES_UINT32]);
+    res |= decodeField(ctx, &head->constructed, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    res |= mapNamespace(ctx, &head->nodeId.namespaceIndex);
+    res |= mapNamespace(ctx, &head->browseName.namespaceIndex);
+    if(res == UA_STATUSCODE_GOOD)
+        res = decodeReferences(ctx, node);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+
+    switch(head->nodeClass) {
+    case UA_NODECLASS_VARIABLE: {
+        UA_VariableNode *vn = &node->variableNode;
+        res |= decodeVariableAttributes(ctx, vn);
+        res |= decodeField(ctx, &vn->accessLevel, &UA_TYPES[UA_TYPES_BYTE]);
+        res |= decodeField(ctx, &vn->minimumSamplingInterval, &UA_TYPES[UA_TYPES_DOUBLE]);
+        res |= decodeField(ctx, &vn->historizing, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_VARIABLETYPE:
+        res |= decodeVariableAttributes(ctx, (UA_VariableNode*)node);
+        res |= decodeField(ctx, &node->variableTypeNode.isAbstract,
+                           &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_METHOD:
+        res |= decodeField(ctx, &node->methodNode.executable, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_OBJECT:
+        res |= decodeField(ctx, &node->objectNode.eventNotifier, &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        res |= decodeField(ctx, &node->objectTypeNode.isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_REFERENCETYPE: {
+        UA_ReferenceTypeNode *rn = &node->referenceTypeNode;
+        res |= decodeField(ctx, &rn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        res |= decodeField(ctx, &rn->symmetric, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        res |= decodeField(ctx, &rn->inverseName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    }
+    case UA_NODECLASS_DATATYPE:
+        res |= decodeField(ctx, &node->dataTypeNode.isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_VIEW:
+        res |= decodeField(ctx, &node->viewNode.eventNotifier, &UA_TYPES[UA_TYPES_BYTE]);
+        res |= decodeField(ctx, &node->viewNode.containsNoLoops, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    default:
+        res = UA_STATUSCODE_BADDECODINGERROR;
+        break;
+    }
+    return res;
+}
+
+UA_StatusCode
+UA_Node_decodeBinaryMapped(const UA_ByteString *src, size_t *offset,
+                           const UA_DataTypeArray *customTypes,
+                           const UA_Nodestore *ns, const UA_UInt16 *nsMap,
+                           size_t nsMapSize, UA_Node **outNode) {
+    NodeDecodeCtx ctx;
+    ctx.src = src;
+    ctx.offset = offset;
+    ctx.customTypes = customTypes;
+    ctx.nsMap = nsMap;
+    ctx.nsMapSize = nsMapSize;
+
+    UA_NodeClass nodeClass = UA_NODECLASS_UNSPECIFIED;
+    UA_StatusCode res = decodeField(&ctx, &nodeClass, &UA_TYPES[UA_TYPES_NODECLASS]);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    UA_Node *node = ns->newNode(ns->context, nodeClass);
+    if(!node)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    res = decodeNode(&ctx, node);
+    if(res != UA_STATUSCODE_GOOD) {
+        ns->deleteNode(ns->context, node);
+        return res;
+    }
+    *outNode = node;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Node_decodeBinary(const UA_ByteString *src, size_t *offset,
+                     const UA_DataTypeArray *customTypes,
+                     const UA_Nodestore *ns, UA_Node **outNode) {
+    return UA_Node_decodeBinaryMapped(src, offset, customTypes, ns,
+                                      NULL, 0, outNode);
+}
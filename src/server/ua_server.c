@@ -101,10 +101,8 @@ UA_Server_getConfig(UA_Server *server)
 }
 
 UA_StatusCode
-UA_Server_getNamespaceByName(UA_Server *server, const UA_String namespaceUri,
-                             size_t* foundIndex) {
-    UA_LOCK(server->serviceMutex);
-
+getNamespaceByName(UA_Server *server, const UA_String namespaceUri,
+                   size_t *foundIndex) {
     /* ensure that the uri for ns1 is set up from the app description */
     setupNs1Uri(server);
 
@@ -112,13 +110,20 @@ UA_Server_getNamespaceByName(UA_Server *server, const UA_String namespaceUri,
         if(!UA_String_equal(&server->namespaces[idx], &namespaceUri))
             continue;
         (*foundIndex) = idx;
-        UA_UNLOCK(server->serviceMutex);
         return UA_STATUSCODE_GOOD;
     }
-    UA_UNLOCK(server->serviceMutex);
     return UA_STATUSCODE_BADNOTFOUND;
 }
 
+UA_StatusCode
+UA_Server_getNamespaceByName(UA_Server *server, const UA_String namespaceUri,
+                             size_t* foundIndex) {
+    UA_LOCK(server->serviceMutex);
+    UA_StatusCode res = getNamespaceByName(server, namespaceUri, foundIndex);
+    UA_UNLOCK(server->serviceMutex);
+    return res;
+}
+
 UA_StatusCode
 UA_Server_forEachChildNodeCall(UA_Server *server, UA_NodeId parentNodeId,
                                UA_NodeIteratorCallback callback, void *handle) {
@@ -216,6 +221,25 @@ void UA_Server_delete(UA_Server *server) {
     /* Clean up the work queue */
     UA_WorkQueue_cleanup(&server->workQueue);
 
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* Free the unused notifications */
+    UA_NotificationPool_clear(&server->notificationPool);
+
+    /* Close the retransmission spill file */
+    UA_RetransmissionStore_clear(&server->retransmissionStore);
+
+    /* All MonitoredItems are removed from the index at this point */
+    UA_NodeIdMap_clear(&server->sampleTriggers);
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    UA_NodeIdMap_clear(&server->eventRoutes);
+#endif
+#endif
+
+    /* Delete the index of the type hierarchy */
+    UA_TypeHierarchy_clear(&server->typeHierarchy);
+    UA_BrowsePathCache_delete(server->browsePathCache);
+    UA_InstanceTemplates_clear(&server->instanceTemplates);
+
     /* Delete the timed work */
     UA_Timer_deleteMembers(&server->timer);
 
@@ -262,6 +286,9 @@ UA_Server_init(UA_Server *server) {
      * UA_Server_run_startup() */
     server->startTime = 0;
 
+    /* Unused cache entries have the model version zero */
+    server->modelVersion = 1;
+
     /* Set a seed for non-cyptographic randomness */
 #ifndef UA_ENABLE_DETERMINISTIC_RNG
     UA_random_seed((UA_UInt64)UA_DateTime_now());
@@ -304,6 +331,11 @@ UA_Server_init(UA_Server *server) {
     LIST_INIT(&server->sessions);
     server->sessionCount = 0;
 
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* Initialize the server-wide retransmission queue */
+    UA_RetransmissionStore_init(&server->retransmissionStore);
+#endif
+
 #if UA_MULTITHREADING >= 100
     UA_AsyncManager_init(&server->asyncManager, server);
 #endif
@@ -312,6 +344,9 @@ UA_Server_init(UA_Server *server) {
     UA_Server_addRepeatedCallback(server, (UA_ServerCallback)UA_Server_cleanup, NULL,
                                   10000.0, NULL);
 
+    /* Index the type hierarchy of a nodestore that was filled in advance */
+    UA_TypeHierarchy_build(server);
+
     /* Initialize namespace 0*/
     res = UA_Server_initNS0(server);
     if(res != UA_STATUSCODE_GOOD)
@@ -545,6 +580,37 @@ UA_Server_run_startup(UA_Server *server) {
     if(retVal != UA_STATUSCODE_GOOD)
         return retVal;
 
+#if UA_MULTITHREADING >= 200
+    /* The chunks of a SecureChannel are processed concurrently only if the
+     * SecurityPolicy allows it */
+    if(server->config.parallelChunkCrypto) {
+        for(size_t i = 0; i < server->config.securityPoliciesSize; i++) {
+            UA_SecurityPolicy *sp = &server->config.securityPolicies[i];
+            if(sp->symmetricModule.reentrant)
+                continue;
+            UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                         "The SecurityPolicy %.*s is not reentrant. "
+                         "Cannot enable parallelChunkCrypto.",
+                         (int)sp->policyUri.length, sp->policyUri.data);
+            return UA_STATUSCODE_BADCONFIGURATIONERROR;
+        }
+    }
+
+    /* Dito for the asymmetric crypto of the handshakes */
+    if(server->config.asyncHandshakes) {
+        for(size_t i = 0; i < server->config.securityPoliciesSize; i++) {
+            UA_SecurityPolicy *sp = &server->config.securityPolicies[i];
+            if(sp->asymmetricModule.reentrant)
+                continue;
+            UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                         "The SecurityPolicy %.*s is not reentrant. "
+                         "Cannot enable asyncHandshakes.",
+                         (int)sp->policyUri.length, sp->policyUri.data);
+            return UA_STATUSCODE_BADCONFIGURATIONERROR;
+        }
+    }
+#endif
+
     if(server->state > UA_SERVERLIFECYCLE_FRESH)
         return UA_STATUSCODE_GOOD;
 
@@ -709,8 +775,9 @@ UA_Server_run_shutdown(UA_Server *server) {
         stopMulticastDiscoveryServer(server);
 #endif
 
-    /* Execute all delayed callbacks */
-    UA_WorkQueue_cleanup(&server->workQueue);
+    /* Execute all delayed callbacks. The work queue is cleaned up when the
+     * server is deleted. */
+    UA_WorkQueue_processRemaining(&server->workQueue);
 
     return UA_STATUSCODE_GOOD;
 }
@@ -25,6 +25,11 @@
 #include "ua_server_internal.h"
 #include "ua_services.h"
 
+#ifndef container_of
+#define container_of(ptr, type, member) \
+    (type *)((uintptr_t)ptr - offsetof(type,member))
+#endif
+
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
 // store the authentication token and session ID so we can help fuzzing by setting
 // these values in the next request automatically
@@ -478,6 +483,7 @@ processMSGDecoded(UA_Server *server, UA_SecureChannel *channel, UA_UInt32 reques
                   UA_Service service, const UA_Request *request,
                   const UA_DataType *requestType, UA_Response *response,
                   const UA_DataType *responseType, UA_Boolean sessionRequired) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
     const UA_RequestHeader *requestHeader = &request->requestHeader;
 
     /* If it is an unencrypted (#None) channel, only allow the discovery services */
@@ -497,9 +503,7 @@ processMSGDecoded(UA_Server *server, UA_SecureChannel *channel, UA_UInt32 reques
     if(requestType == &UA_TYPES[UA_TYPES_CREATESESSIONREQUEST] ||
        requestType == &UA_TYPES[UA_TYPES_ACTIVATESESSIONREQUEST] ||
        requestType == &UA_TYPES[UA_TYPES_CLOSESESSIONREQUEST]) {
-        UA_LOCK(server->serviceMutex);
         ((UA_ChannelService)(uintptr_t)service)(server, channel, request, response);
-        UA_UNLOCK(server->serviceMutex);
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
         /* Store the authentication token so we can help fuzzing by setting
          * these values in the next request automatically */
@@ -557,12 +561,9 @@ processMSGDecoded(UA_Server *server, UA_SecureChannel *channel, UA_UInt32 reques
                                "Service %" PRIi16 " refused on a non-activated session",
                                requestType->binaryEncodingId);
 #endif
-        if(session != &anonymousSession) {
-            UA_LOCK(server->serviceMutex);
+        if(session != &anonymousSession)
             UA_Server_removeSessionByToken(server, &session->header.authenticationToken,
                                            UA_DIAGNOSTICEVENT_ABORT);
-            UA_UNLOCK(server->serviceMutex);
-        }
         return sendServiceFault(channel, requestId, requestHeader->requestHandle,
                                 responseType, UA_STATUSCODE_BADSESSIONNOTACTIVATED);
     }
@@ -573,9 +574,7 @@ processMSGDecoded(UA_Server *server, UA_SecureChannel *channel, UA_UInt32 reques
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     /* The publish request is not answered immediately */
     if(requestType == &UA_TYPES[UA_TYPES_PUBLISHREQUEST]) {
-        UA_LOCK(server->serviceMutex);
         Service_Publish(server, session, &request->publishRequest, requestId);
-        UA_UNLOCK(server->serviceMutex);
         return UA_STATUSCODE_GOOD;
     }
 #endif
@@ -584,10 +583,8 @@ processMSGDecoded(UA_Server *server, UA_SecureChannel *channel, UA_UInt32 reques
     /* The call request might not be answered immediately */
     if(requestType == &UA_TYPES[UA_TYPES_CALLREQUEST]) {
         UA_Boolean finished = true;
-        UA_LOCK(server->serviceMutex);
         Service_CallAsync(server, session, requestId, &request->callRequest,
                           &response->callResponse, &finished);
-        UA_UNLOCK(server->serviceMutex);
 
         /* Async method calls remain. Don't send a response now */
         if(!finished)
@@ -599,12 +596,48 @@ processMSGDecoded(UA_Server *server, UA_SecureChannel *channel, UA_UInt32 reques
 #endif
 
     /* Dispatch the synchronous service call and send the response */
-    UA_LOCK(server->serviceMutex);
     service(server, session, request, response);
-    UA_UNLOCK(server->serviceMutex);
     return sendResponse(server, session, channel, requestId, response, responseType);
 }
 
+static UA_StatusCode
+processRequest(UA_Server *server, UA_SecureChannel *channel, UA_UInt32 requestId,
+               UA_Service service, UA_Request *request, const UA_DataType *requestType,
+               const UA_DataType *responseType, UA_Boolean sessionRequired) {
+    UA_StatusCode retval;
+
+    /* Check timestamp in the request header */
+    UA_RequestHeader *requestHeader = &request->requestHeader;
+    if(requestHeader->timestamp == 0) {
+        if(server->config.verifyRequestTimestamp <= UA_RULEHANDLING_WARN) {
+            UA_LOG_WARNING_CHANNEL(&server->config.logger, channel,
+                                   "The server sends no timestamp in the request header. "
+                                   "See the 'verifyRequestTimestamp' setting.");
+            if(server->config.verifyRequestTimestamp <= UA_RULEHANDLING_ABORT) {
+                return sendServiceFault(channel, requestId, requestHeader->requestHandle,
+                                        responseType, UA_STATUSCODE_BADINVALIDTIMESTAMP);
+            }
+        }
+    }
+
+#ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+    /* Set the authenticationToken from the create session request to help
+     * fuzzing cover more lines */
+    UA_NodeId_clear(&requestHeader->authenticationToken);
+    if(!UA_NodeId_isNull(&unsafe_fuzz_authenticationToken))
+        UA_NodeId_copy(&unsafe_fuzz_authenticationToken, &requestHeader->authenticationToken);
+#endif
+
+    /* Prepare the respone and process the request */
+    UA_Response response;
+    UA_init(&response, responseType);
+    response.responseHeader.requestHandle = requestHeader->requestHandle;
+    retval = processMSGDecoded(server, channel, requestId, service, request, requestType,
+                               &response, responseType, sessionRequired);
+    UA_clear(&response, responseType);
+    return retval;
+}
+
 static UA_StatusCode
 processMSG(UA_Server *server, UA_SecureChannel *channel,
            UA_UInt32 requestId, const UA_ByteString *msg) {
@@ -627,7 +660,21 @@ processMSG(UA_Server *server, UA_SecureChannel *channel,
     const UA_DataType *responseType = NULL;
     getServicePointers(requestTypeId.identifier.numeric, &requestType,
                        &responseType, &service, &sessionRequired);
-    if(!requestType) {
+
+    /* Decode the request. This is done without the service mutex. */
+    UA_Request request;
+    UA_StatusCode decodeRes = UA_STATUSCODE_BADSERVICEUNSUPPORTED;
+    if(requestType)
+        decodeRes = UA_decodeBinary(msg, &offset, &request, requestType,
+                                    server->config.customDataTypes);
+
+    /* Process the request with the service mutex. Drop the request if the
+     * channel was closed in the meantime. */
+    UA_LOCK(server->serviceMutex);
+    UA_LOG_TRACE_CHANNEL(&server->config.logger, channel, "Process a MSG");
+    if(channel->state == UA_SECURECHANNELSTATE_CLOSING || !channel->connection) {
+        retval = UA_STATUSCODE_GOOD;
+    } else if(!requestType) {
         if(requestTypeId.identifier.numeric == 787) {
             UA_LOG_INFO_CHANNEL(&server->config.logger, channel,
                                 "Client requested a subscription, " \
@@ -637,57 +684,23 @@ processMSG(UA_Server *server, UA_SecureChannel *channel,
                                 "Unknown request with type identifier %" PRIi32,
                                 requestTypeId.identifier.numeric);
         }
-        return decodeHeaderSendServiceFault(channel, msg, requestPos,
-                                            &UA_TYPES[UA_TYPES_SERVICEFAULT],
-                                            requestId, UA_STATUSCODE_BADSERVICEUNSUPPORTED);
-    }
-    UA_assert(responseType);
-
-    /* Decode the request */
-    UA_Request request;
-    retval = UA_decodeBinary(msg, &offset, &request, requestType, server->config.customDataTypes);
-    if(retval != UA_STATUSCODE_GOOD) {
+        retval = decodeHeaderSendServiceFault(channel, msg, requestPos,
+                                              &UA_TYPES[UA_TYPES_SERVICEFAULT], requestId,
+                                              UA_STATUSCODE_BADSERVICEUNSUPPORTED);
+    } else if(decodeRes != UA_STATUSCODE_GOOD) {
         UA_LOG_DEBUG_CHANNEL(&server->config.logger, channel,
                              "Could not decode the request with StatusCode %s",
-                             UA_StatusCode_name(retval));
-        return decodeHeaderSendServiceFault(channel, msg, requestPos,
-                                            responseType, requestId, retval);
-    }
-
-    /* Check timestamp in the request header */
-    UA_RequestHeader *requestHeader = &request.requestHeader;
-    if(requestHeader->timestamp == 0) {
-        if(server->config.verifyRequestTimestamp <= UA_RULEHANDLING_WARN) {
-            UA_LOG_WARNING_CHANNEL(&server->config.logger, channel,
-                                   "The server sends no timestamp in the request header. "
-                                   "See the 'verifyRequestTimestamp' setting.");
-            if(server->config.verifyRequestTimestamp <= UA_RULEHANDLING_ABORT) {
-                retval = sendServiceFault(channel, requestId, requestHeader->requestHandle,
-                                          responseType, UA_STATUSCODE_BADINVALIDTIMESTAMP);
-                UA_clear(&request, requestType);
-                return retval;
-            }
-        }
+                             UA_StatusCode_name(decodeRes));
+        retval = decodeHeaderSendServiceFault(channel, msg, requestPos,
+                                              responseType, requestId, decodeRes);
+    } else {
+        retval = processRequest(server, channel, requestId, service, &request,
+                                requestType, responseType, sessionRequired);
     }
+    UA_UNLOCK(server->serviceMutex);
 
-#ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
-    /* Set the authenticationToken from the create session request to help
-     * fuzzing cover more lines */
-    UA_NodeId_clear(&requestHeader->authenticationToken);
-    if(!UA_NodeId_isNull(&unsafe_fuzz_authenticationToken))
-        UA_NodeId_copy(&unsafe_fuzz_authenticationToken, &requestHeader->authenticationToken);
-#endif
-
-    /* Prepare the respone and process the request */
-    UA_Response response;
-    UA_init(&response, responseType);
-    response.responseHeader.requestHandle = requestHeader->requestHandle;
-    retval = processMSGDecoded(server, channel, requestId, service, &request, requestType,
-                               &response, responseType, sessionRequired);
-
-    /* Clean up */
-    UA_clear(&request, requestType);
-    UA_clear(&response, responseType);
+    if(decodeRes == UA_STATUSCODE_GOOD)
+        UA_clear(&request, requestType);
     return retval;
 }
 
@@ -698,7 +711,17 @@ processSecureChannelMessage(void *application, UA_SecureChannel *channel,
                             UA_ByteString *message) {
     UA_Server *server = (UA_Server*)application;
 
-    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    /* Takes the service mutex after decoding the request */
+    UA_StatusCode retval;
+    if(messagetype == UA_MESSAGETYPE_MSG) {
+        retval = processMSG(server, channel, requestId, message);
+        if(retval == UA_STATUSCODE_GOOD)
+            return;
+        UA_LOCK(server->serviceMutex);
+        goto error;
+    }
+
+    UA_LOCK(server->serviceMutex);
     switch(messagetype) {
     case UA_MESSAGETYPE_HEL:
         UA_LOG_TRACE_CHANNEL(&server->config.logger, channel, "Process a HEL message");
@@ -708,50 +731,146 @@ processSecureChannelMessage(void *application, UA_SecureChannel *channel,
         UA_LOG_TRACE_CHANNEL(&server->config.logger, channel, "Process an OPN message");
         retval = processOPN(server, channel, requestId, message);
         break;
-    case UA_MESSAGETYPE_MSG:
-        UA_LOG_TRACE_CHANNEL(&server->config.logger, channel, "Process a MSG");
-        retval = processMSG(server, channel, requestId, message);
-        break;
     case UA_MESSAGETYPE_CLO:
         UA_LOG_TRACE_CHANNEL(&server->config.logger, channel, "Process a CLO");
         Service_CloseSecureChannel(server, channel); /* Regular close */
+        retval = UA_STATUSCODE_GOOD;
         break;
     default:
         UA_LOG_TRACE_CHANNEL(&server->config.logger, channel, "Invalid message type");
         retval = UA_STATUSCODE_BADTCPMESSAGETYPEINVALID;
         break;
     }
-    if(retval != UA_STATUSCODE_GOOD) {
-        if(!channel->connection) {
-            UA_LOG_INFO_CHANNEL(&server->config.logger, channel,
-                                "Processing the message failed. Channel already closed "
-                                "with StatusCode %s. ", UA_StatusCode_name(retval));
-            return;
-        }
+    if(retval == UA_STATUSCODE_GOOD) {
+        UA_UNLOCK(server->serviceMutex);
+        return;
+    }
 
+ error:
+    if(!channel->connection) {
         UA_LOG_INFO_CHANNEL(&server->config.logger, channel,
-                            "Processing the message failed with StatusCode %s. "
-                            "Closing the channel.", UA_StatusCode_name(retval));
-        UA_TcpErrorMessage errMsg;
-        UA_TcpErrorMessage_init(&errMsg);
-        errMsg.error = retval;
-        UA_Connection_sendError(channel->connection, &errMsg);
-        switch(retval) {
-        case UA_STATUSCODE_BADSECURITYMODEREJECTED:
-        case UA_STATUSCODE_BADSECURITYCHECKSFAILED:
-        case UA_STATUSCODE_BADSECURECHANNELIDINVALID:
-        case UA_STATUSCODE_BADSECURECHANNELTOKENUNKNOWN:
-        case UA_STATUSCODE_BADSECURITYPOLICYREJECTED:
-        case UA_STATUSCODE_BADCERTIFICATEUSENOTALLOWED:
-            UA_Server_closeSecureChannel(server, channel, UA_DIAGNOSTICEVENT_SECURITYREJECT);
-            break;
-        default:
-            UA_Server_closeSecureChannel(server, channel, UA_DIAGNOSTICEVENT_CLOSE);
-            break;
-        }
+                            "Processing the message failed. Channel already closed "
+                            "with StatusCode %s. ", UA_StatusCode_name(retval));
+        UA_UNLOCK(server->serviceMutex);
+        return;
+    }
+
+    UA_LOG_INFO_CHANNEL(&server->config.logger, channel,
+                        "Processing the message failed with StatusCode %s. "
+                        "Closing the channel.", UA_StatusCode_name(retval));
+    UA_TcpErrorMessage errMsg;
+    UA_TcpErrorMessage_init(&errMsg);
+    errMsg.error = retval;
+    UA_Connection_sendError(channel->connection, &errMsg);
+    switch(retval) {
+    case UA_STATUSCODE_BADSECURITYMODEREJECTED:
+    case UA_STATUSCODE_BADSECURITYCHECKSFAILED:
+    case UA_STATUSCODE_BADSECURECHANNELIDINVALID:
+    case UA_STATUSCODE_BADSECURECHANNELTOKENUNKNOWN:
+    case UA_STATUSCODE_BADSECURITYPOLICYREJECTED:
+    case UA_STATUSCODE_BADCERTIFICATEUSENOTALLOWED:
+        UA_Server_closeSecureChannel(server, channel, UA_DIAGNOSTICEVENT_SECURITYREJECT);
+        break;
+    default:
+        UA_Server_closeSecureChannel(server, channel, UA_DIAGNOSTICEVENT_CLOSE);
+        break;
+    }
+    UA_UNLOCK(server->serviceMutex);
+}
+
+/* Process a received buffer on the channel. Sends an ERR message and closes
+ * the connection if processing fails. Called without the service mutex. The
+ * channel must be pinned (see channel_entry->processing) if the server has
+ * worker threads. */
+static void
+processChannelBuffer(UA_Server *server, UA_SecureChannel *channel,
+                     UA_ByteString *message) {
+    UA_StatusCode retval =
+        UA_SecureChannel_processBuffer(channel, server, processSecureChannelMessage, message);
+    if(retval == UA_STATUSCODE_GOOD)
+        return;
+
+    /* The connection might have been detached in the meantime */
+    UA_LOCK(server->serviceMutex);
+    UA_Connection *connection = channel->connection;
+    if(!connection) {
+        UA_UNLOCK(server->serviceMutex);
+        return;
     }
+    UA_LOG_INFO(&server->config.logger, UA_LOGCATEGORY_NETWORK,
+                "Connection %i | Processing the message failed with error %s",
+                (int)(connection->sockfd), UA_StatusCode_name(retval));
+
+    /* Send an ERR message and close the connection */
+    UA_TcpErrorMessage error;
+    error.error = retval;
+    error.reason = UA_STRING_NULL;
+    UA_Connection_sendError(connection, &error);
+    connection->close(connection);
+    UA_UNLOCK(server->serviceMutex);
 }
 
+#if UA_MULTITHREADING >= 200
+
+/* The channel is in the handshake until the first Session is activated on a
+ * secured channel */
+static UA_Boolean
+inHandshake(const channel_entry *entry) {
+    return (entry->handshake ||
+            entry->channel.state != UA_SECURECHANNELSTATE_OPEN);
+}
+
+/* Append to the messages that wait for the processing worker */
+static UA_StatusCode
+appendPending(channel_entry *entry, const UA_ByteString *message) {
+    /* Limit the pending messages to the maximum message size. The connection
+     * is closed if the client sends faster than the worker processes. */
+    size_t maxSize = entry->channel.config.localMaxMessageSize;
+    if(maxSize != 0 && entry->pending.length + message->length > maxSize)
+        return UA_STATUSCODE_BADTCPMESSAGETOOLARGE;
+
+    UA_Byte *p = (UA_Byte*)
+        UA_realloc(entry->pending.data, entry->pending.length + message->length);
+    if(!p)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(&p[entry->pending.length], message->data, message->length);
+    entry->pending.data = p;
+    entry->pending.length += message->length;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Processes the channel in a worker thread until no more messages are
+ * pending. The messages that arrive in the meantime are appended by the
+ * network thread. */
+static void
+processChannelWorker(UA_Server *server, channel_entry *entry) {
+    UA_LOCK(server->serviceMutex);
+    while(entry->pending.length > 0) {
+        UA_ByteString message = entry->pending;
+        entry->pending = UA_BYTESTRING_NULL;
+        UA_Boolean closed = (entry->channel.state == UA_SECURECHANNELSTATE_CLOSING ||
+                             !entry->channel.connection);
+        UA_UNLOCK(server->serviceMutex);
+        if(!closed)
+            processChannelBuffer(server, &entry->channel, &message);
+        UA_ByteString_clear(&message);
+        UA_LOCK(server->serviceMutex);
+    }
+    UA_Server_endChannelProcessing(server, entry);
+    UA_UNLOCK(server->serviceMutex);
+}
+
+#endif
+
+/* The chunks are parsed, decrypted and decoded without the service mutex. The
+ * mutex is taken for the header checks that change the channel (see
+ * UA_SecureChannel->lock) and for every service. The SecureChannels are also
+ * removed by the housekeeping in the worker threads. So the channel is pinned
+ * while it is processed and freed only afterwards.
+ *
+ * With asyncHandshakes, the channels in the handshake are processed in a
+ * worker thread instead. The mutex is also released for signing and
+ * encrypting the handshake responses. */
 void
 UA_Server_processBinaryMessage(UA_Server *server, UA_Connection *connection,
                                UA_ByteString *message) {
@@ -760,6 +879,7 @@ UA_Server_processBinaryMessage(UA_Server *server, UA_Connection *connection,
 
     UA_TcpErrorMessage error;
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_LOCK(server->serviceMutex);
     UA_SecureChannel *channel = connection->channel;
 
     /* Add a SecureChannel to a new connection */
@@ -778,14 +898,41 @@ UA_Server_processBinaryMessage(UA_Server *server, UA_Connection *connection,
     UA_debug_dumpCompleteChunk(server, channel->connection, message);
 #endif
 
-    retval = UA_SecureChannel_processBuffer(channel, server, processSecureChannelMessage, message);
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_LOG_INFO(&server->config.logger, UA_LOGCATEGORY_NETWORK,
-                    "Connection %i | Processing the message failed with error %s",
-                    (int)(connection->sockfd), UA_StatusCode_name(retval));
-        goto error;
+#if UA_MULTITHREADING >= 200
+    /* Hand over to a worker thread. Keep the order of the messages if a worker
+     * is already processing the channel. */
+    channel_entry *entry = container_of(channel, channel_entry, channel);
+    if(entry->processing ||
+       (server->config.asyncHandshakes && server->workQueue.workersSize > 0 &&
+        inHandshake(entry))) {
+        retval = appendPending(entry, message);
+        if(retval != UA_STATUSCODE_GOOD)
+            goto error;
+        if(entry->processing) {
+            UA_UNLOCK(server->serviceMutex);
+            return;
+        }
+        /* Enqueue without the mutex. The callback is executed immediately
+         * if the memory for the queue entry cannot be allocated. */
+        entry->processing = true;
+        UA_UNLOCK(server->serviceMutex);
+        UA_WorkQueue_enqueue(&server->workQueue,
+                             (UA_ApplicationCallback)processChannelWorker,
+                             server, entry);
+        return;
     }
 
+    /* Process in the network thread */
+    entry->processing = true;
+    UA_UNLOCK(server->serviceMutex);
+    processChannelBuffer(server, channel, message);
+    UA_LOCK(server->serviceMutex);
+    UA_Server_endChannelProcessing(server, entry);
+    UA_UNLOCK(server->serviceMutex);
+#else
+    UA_UNLOCK(server->serviceMutex);
+    processChannelBuffer(server, channel, message);
+#endif
     return;
 
  error:
@@ -794,6 +941,7 @@ UA_Server_processBinaryMessage(UA_Server *server, UA_Connection *connection,
     error.reason = UA_STRING_NULL;
     UA_Connection_sendError(connection, &error);
     connection->close(connection);
+    UA_UNLOCK(server->serviceMutex);
 }
 
 #if UA_MULTITHREADING >= 200
@@ -805,7 +953,9 @@ deleteConnection(UA_Server *server, UA_Connection *connection) {
 
 void
 UA_Server_removeConnection(UA_Server *server, UA_Connection *connection) {
+    UA_LOCK(server->serviceMutex);
     UA_Connection_detachSecureChannel(connection);
+    UA_UNLOCK(server->serviceMutex);
 #if UA_MULTITHREADING >= 200
     UA_DelayedCallback *dc = (UA_DelayedCallback*)UA_malloc(sizeof(UA_DelayedCallback));
     if(!dc)
@@ -67,6 +67,9 @@ UA_ServerConfig_clean(UA_ServerConfig *config) {
     if(config->accessControl.clear)
         config->accessControl.clear(&config->accessControl);
 
+    /* Subscriptions */
+    UA_String_clear(&config->retransmissionSpillFile);
+
     /* Historical data */
 #ifdef UA_ENABLE_HISTORIZING
     if(config->historyDatabase.clear)
@@ -69,6 +69,17 @@ typedef enum {
 typedef struct channel_entry {
     UA_DelayedCallback cleanupCallback;
     TAILQ_ENTRY(channel_entry) pointers;
+    UA_Boolean handshake; /* Counted in handshakesInProgress */
+    UA_DateTime handshakeDeadline; /* Monotonic time when the handshake slot is
+                                    * released */
+#if UA_MULTITHREADING >= 200
+    UA_Boolean processing; /* A thread processes the received messages without
+                            * the service mutex. The channel is freed only
+                            * afterwards. */
+    UA_Boolean asymCryptoUnlocked; /* The service mutex is released for the
+                                    * asymmetric crypto */
+    UA_ByteString pending; /* Received messages for the processing worker */
+#endif
     UA_SecureChannel channel;
 } channel_entry;
 
@@ -78,6 +89,87 @@ typedef struct session_list_entry {
     UA_Session session;
 } session_list_entry;
 
+/* Index of the HasSubtype hierarchy of the type nodes. Every node that is the
+ * source or target of a HasSubtype reference gets an entry. The position of the
+ * entry in the array is a small integer index that never changes. So a set of
+ * types can be represented as a bitset (UA_TypeSet). The hierarchy follows the
+ * inverse HasSubtype references that are stored in the subtype node. */
+
+#define UA_TYPEHIERARCHY_NONE UA_UINT32_MAX
+
+typedef struct {
+    UA_NodeId nodeId;
+    UA_UInt32 supertype;
+    UA_UInt32 firstSubtype;
+    UA_UInt32 nextSibling;  /* Next subtype of the same supertype */
+    UA_Boolean removed;     /* The node was removed from the nodestore */
+} UA_TypeHierarchyEntry;
+
+typedef struct {
+    UA_TypeHierarchyEntry *entries;
+    size_t entriesSize;
+    size_t entriesCapacity;
+    UA_NodeIdMap index;       /* Position of the entry for the NodeId */
+    UA_NodeIdMap subtypeSets; /* Cached UA_TypeSet of the subtypes for the
+                               * type. Dropped when the hierarchy changes. */
+    /* Set if a type has several supertypes or if the index ran out of memory.
+     * Then the hierarchy is always resolved in the nodestore. */
+    UA_Boolean fallback;
+} UA_TypeHierarchy;
+
+typedef struct {
+    size_t wordsSize;
+    UA_UInt64 *words;
+} UA_TypeSet;
+
+/* Cache for the BrowsePaths resolved by the TranslateBrowsePathsToNodeIds
+ * service. The cache is direct-mapped by the hash of the starting node, the
+ * RelativePath and the NodeClass mask. An entry is valid only as long as the
+ * modelVersion of the server is unchanged. */
+
+#define UA_BROWSEPATHCACHE_SIZE 4096
+
+typedef struct {
+    UA_UInt64 modelVersion; /* Zero for unused entries */
+    UA_UInt32 hash;
+    UA_UInt32 nodeClassMask;
+    UA_NodeId startingNode;
+    UA_RelativePath relativePath;
+    UA_BrowsePathResult result;
+} UA_BrowsePathCacheEntry;
+
+/* The children that are copied when a type (or an InstanceDeclaration of a
+ * type) is instantiated. For types, the children of the supertypes and
+ * interfaces are included. All templates are dropped when a node they were
+ * derived from changes. */
+
+typedef struct {
+    UA_ReferenceDescription rd;
+    UA_Boolean mandatory;
+} UA_InstanceTemplateChild;
+
+typedef struct {
+    size_t refCount;    /* Instantiations in progress */
+    UA_Boolean removed; /* Delete when the last instantiation is done */
+    size_t childrenSize;
+    UA_InstanceTemplateChild *children;
+} UA_InstanceTemplate;
+
+typedef struct {
+    UA_NodeIdMap templates; /* UA_InstanceTemplate by the source NodeId */
+    UA_NodeIdMap sources;   /* The NodeIds the templates were derived from */
+} UA_InstanceTemplates;
+
+/* Bulk node management. With immutable nodes, a node is copied on its first
+ * edit within the batch. The copy replaces the node in the nodestore. Later
+ * edits within the batch are in-situ while the nodestore reports that no other
+ * consumer holds a reference to the copy. */
+
+typedef struct {
+    size_t depth;        /* Nested batches end with the outermost batch */
+    UA_NodeIdMap edited; /* The nodes that were replaced by a copy */
+} UA_NodeBatch;
+
 typedef enum {
     UA_SERVERLIFECYCLE_FRESH,
     UA_SERVERLIFECYLE_RUNNING
@@ -96,6 +188,7 @@ struct UA_Server {
     TAILQ_HEAD(, channel_entry) channels;
     UA_UInt32 lastChannelId;
     UA_UInt32 lastTokenId;
+    size_t handshakesInProgress; /* Admission control for secured handshakes */
 
 #if UA_MULTITHREADING >= 100
     UA_AsyncManager asyncManager;
@@ -104,6 +197,8 @@ struct UA_Server {
     /* Session Management */
     LIST_HEAD(session_list, session_list_entry) sessions;
     UA_UInt32 sessionCount;
+    UA_UInt32 accessCacheGeneration; /* Increase to invalidate the cached
+                                      * access control decisions */
     UA_Session adminSession; /* Local access to the services (for startup and
                               * maintenance) uses this Session with all possible
                               * access rights (Session Id: 1) */
@@ -122,6 +217,22 @@ struct UA_Server {
      * the parent and member instantiation */
     UA_Boolean bootstrapNS0;
 
+    /* Index of the type hierarchy */
+    UA_TypeHierarchy typeHierarchy;
+
+    /* Increased whenever nodes or references are added or removed. Invalidates
+     * the caches derived from the information model. */
+    UA_UInt64 modelVersion;
+
+    /* Allocated on first use */
+    UA_BrowsePathCacheEntry *browsePathCache;
+
+    /* Cached children of the types for the instantiation */
+    UA_InstanceTemplates instanceTemplates;
+
+    /* Nodes edited in the ongoing bulk node management */
+    UA_NodeBatch nodeBatch;
+
     /* Discovery */
 #ifdef UA_ENABLE_DISCOVERY
     UA_DiscoveryManager discoveryManager;
@@ -136,9 +247,22 @@ struct UA_Server {
     /* To be cast to UA_LocalMonitoredItem to get the callback and context */
     LIST_HEAD(LocalMonitoredItems, UA_MonitoredItem) localMonitoredItems;
     UA_UInt32 lastLocalMonitoredItemId;
+    UA_NotificationPool notificationPool;
+    UA_RetransmissionStore retransmissionStore;
+    LIST_HEAD(, UA_PublishSlot) publishSlots;
+    UA_NodeIdMap sampleTriggers; /* MonitoredItems that are sampled when the
+                                  * node is written. The value is the first
+                                  * MonitoredItem for the node. */
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    UA_NodeIdMap eventRoutes; /* UA_EventRoute by notifier node */
+#endif
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
     LIST_HEAD(conditionSourcelisthead, UA_ConditionSource) headConditionSource;
+    UA_NodeIdMap conditionSourceIndex; /* By SourceNode */
+    UA_NodeIdMap conditionIndex;       /* By ConditionId */
+    UA_NodeIdMap conditionBranchIndex; /* By BranchId */
+    UA_NodeIdMap conditionEventIndex;  /* By the EventId of the last event */
 #endif//UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
 
 #endif
@@ -177,6 +301,34 @@ UA_StatusCode
 UA_Server_configSecureChannel(void *application, UA_SecureChannel *channel,
                               const UA_AsymmetricAlgorithmSecurityHeader *asymHeader);
 
+/* The first Session was activated on the channel. Releases the handshake slot
+ * taken when the channel was configured with a secured SecurityPolicy. Also
+ * called when the channel is removed or the handshake has timed out. */
+void
+UA_Server_completeHandshake(UA_Server *server, UA_SecureChannel *channel);
+
+#if UA_MULTITHREADING >= 200
+/* Enclose the asymmetric sign/encrypt of the handshake responses. If the
+ * channel is pinned for processing, then the service mutex is released in
+ * between. The end returns
+ * UA_STATUSCODE_BADSECURECHANNELCLOSED if the channel was closed in the
+ * meantime. Everything else that is not owned by the current thread has to be
+ * validated again afterwards. */
+void
+UA_Server_beginAsymCrypto(void *application, UA_SecureChannel *channel);
+
+UA_StatusCode
+UA_Server_endAsymCrypto(void *application, UA_SecureChannel *channel);
+
+/* The processing thread is done with the channel. Frees the channel if
+ * it was removed in the meantime. */
+void
+UA_Server_endChannelProcessing(UA_Server *server, channel_entry *entry);
+#else
+#define UA_Server_beginAsymCrypto(server, channel)
+#define UA_Server_endAsymCrypto(server, channel) UA_STATUSCODE_GOOD
+#endif
+
 UA_StatusCode
 sendServiceFault(UA_SecureChannel *channel, UA_UInt32 requestId, UA_UInt32 requestHandle,
                  const UA_DataType *responseType, UA_StatusCode statusCode);
@@ -224,6 +376,14 @@ UA_Server_getSessionById(UA_Server *server, const UA_NodeId *sessionId);
 void UA_Node_deleteReferencesSubset(UA_Node *node, size_t referencesSkipSize,
                                     UA_NodeId* referencesSkip);
 
+/* Decode a node and translate the namespace indices with the map (from the
+ * encoded index to the index of the server) */
+UA_StatusCode
+UA_Node_decodeBinaryMapped(const UA_ByteString *src, size_t *offset,
+                           const UA_DataTypeArray *customTypes,
+                           const UA_Nodestore *ns, const UA_UInt16 *nsMap,
+                           size_t nsMapSize, UA_Node **outNode);
+
 /* Calls the callback with the node retrieved from the nodestore on top of the
  * stack. Either a copy or the original node for in-situ editing. Depends on
  * multithreading and the nodestore.*/
@@ -234,6 +394,12 @@ UA_StatusCode UA_Server_editNode(UA_Server *server, UA_Session *session,
                                  UA_EditNodeCallback callback,
                                  void *data);
 
+/* Between begin and end, UA_Server_editNode avoids repeated copies of the same
+ * node. The service mutex may be released within the batch (e.g. for the node
+ * constructors). Batches can be nested. */
+void UA_Server_beginNodeBatch(UA_Server *server);
+void UA_Server_endNodeBatch(UA_Server *server);
+
 /*********************/
 /* Utility Functions */
 /*********************/
@@ -244,6 +410,8 @@ extern const UA_NodeId hierarchicalReferences;
 
 void setupNs1Uri(UA_Server *server);
 UA_UInt16 addNamespace(UA_Server *server, const UA_String name);
+UA_StatusCode getNamespaceByName(UA_Server *server, const UA_String namespaceUri,
+                                 size_t *foundIndex);
 
 UA_Boolean
 UA_Node_hasSubTypeOrInstances(const UA_NodeHead *head);
@@ -254,6 +422,39 @@ isNodeInTree(UA_Server *server, const UA_NodeId *leafNode,
              const UA_NodeId *nodeToFind, const UA_NodeId *referenceTypeIds,
              size_t referenceTypeIdsSize);
 
+/* Type Hierarchy Index */
+
+/* Index the HasSubtype references of the nodes already in the nodestore */
+void UA_TypeHierarchy_build(UA_Server *server);
+void UA_TypeHierarchy_clear(UA_TypeHierarchy *th);
+
+/* Track the changes of the one-way references stored in the source node. Only
+ * inverse HasSubtype references are considered. */
+void
+UA_TypeHierarchy_addReference(UA_Server *server, const UA_NodeId *sourceId,
+                              const UA_NodeId *refTypeId, UA_Boolean isForward,
+                              const UA_NodeId *targetId);
+void
+UA_TypeHierarchy_deleteReference(UA_Server *server, const UA_NodeId *sourceId,
+                                 const UA_NodeId *refTypeId, UA_Boolean isForward,
+                                 const UA_NodeId *targetId);
+void
+UA_TypeHierarchy_removeNode(UA_Server *server, const UA_NodeId *nodeId);
+
+/* Computes the set of the type and all its subtypes. The set is cached until
+ * the next change of a HasSubtype reference. The caller gets a copy. Returns
+ * UA_STATUSCODE_BADNOTFOUND if the index cannot be used for the type. Then the
+ * hierarchy has to be browsed in the nodestore. */
+UA_StatusCode
+UA_TypeHierarchy_subtypeSet(UA_Server *server, const UA_NodeId *type,
+                            UA_TypeSet *set);
+
+UA_Boolean
+UA_TypeSet_contains(UA_Server *server, const UA_TypeSet *set,
+                    const UA_NodeId *type);
+
+void UA_TypeSet_clear(UA_TypeSet *set);
+
 /* Returns an array with the hierarchy of nodes. The start nodes can be returned
  * as well. The returned array starts at the leaf and continues "upwards" or
  * "downwards". Duplicate entries are removed. The parameter `walkDownwards`
@@ -369,6 +570,12 @@ readObjectProperty(UA_Server *server, const UA_NodeId objectId,
 UA_BrowsePathResult
 translateBrowsePathToNodeIds(UA_Server *server, const UA_BrowsePath *browsePath);
 
+void
+UA_BrowsePathCache_delete(UA_BrowsePathCacheEntry *cache);
+
+void
+UA_InstanceTemplates_clear(UA_InstanceTemplates *it);
+
 #ifdef UA_ENABLE_SUBSCRIPTIONS
 void
 monitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem);
@@ -524,6 +731,12 @@ UA_StatusCode writeNs0VariableArray(UA_Server *server, UA_UInt32 id, void *v,
 #define UA_NODESTORE_REMOVE(server, nodeId)                             \
     server->config.nodestore.removeNode(server->config.nodestore.context, nodeId)
 
+/* Gets several nodes with the optional getNodes method of the nodestore. Falls
+ * back to getNode for every NodeId. */
+void
+UA_Nodestore_getNodes(UA_Server *server, size_t nodeIdsSize,
+                      const UA_NodeId **nodeIds, const UA_Node **outNodes);
+
 _UA_END_DECLS
 
 #endif /* UA_SERVER_INTERNAL_H_ */
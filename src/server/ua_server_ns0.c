@@ -757,11 +757,28 @@ addModellingRules(UA_Server *server) {
  * example server time. */
 UA_StatusCode
 UA_Server_initNS0(UA_Server *server) {
+    UA_StatusCode retVal = UA_STATUSCODE_GOOD;
+
+    /* The nodes were restored by the nodestore (e.g. from persistent storage)
+     * or are loaded from a snapshot that was taken after the initialization.
+     * Then only the data sources and the values from the configuration are set
+     * up below. */
+    UA_NodeId rootId = UA_NODEID_NUMERIC(0, UA_NS0ID_ROOTFOLDER);
+    const UA_Node *root = UA_NODESTORE_GET(server, &rootId);
+    UA_Boolean prepared = (root != NULL);
+    if(root) {
+        UA_NODESTORE_RELEASE(server, root);
+    } else if(server->config.namespace0Snapshot) {
+        retVal = UA_Server_loadNodesetSnapshot(server, server->config.namespace0Snapshot);
+        prepared = true;
+    }
+    if(prepared)
+        goto bootstrapped;
 
     /* Initialize base nodes which are always required an cannot be created
      * through the NS compiler */
     server->bootstrapNS0 = true;
-    UA_StatusCode retVal = UA_Server_createNS0_base(server);
+    retVal = UA_Server_createNS0_base(server);
     server->bootstrapNS0 = false;
     if(retVal != UA_STATUSCODE_GOOD)
         return retVal;
@@ -774,6 +791,8 @@ UA_Server_initNS0(UA_Server *server) {
     retVal = UA_Server_minimalServerObject(server);
 #endif
 
+ bootstrapped:
+
     if(retVal != UA_STATUSCODE_GOOD) {
         UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
                      "Initialization of Namespace 0 (before bootstrapping) "
@@ -1079,14 +1098,18 @@ UA_Server_initNS0(UA_Server *server) {
      * directly, but need to create a subtype. This is already posted on the OPC Foundation bug tracker under the
      * following link for clarification: https://opcfoundation-onlineapplications.org/mantis/view.php?id=4206 */
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-    UA_ObjectTypeAttributes overflowAttr = UA_ObjectTypeAttributes_default;
-    overflowAttr.description = UA_LOCALIZEDTEXT("en-US", "A simple event for indicating a queue overflow.");
-    overflowAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SimpleOverflowEventType");
-    retVal |= UA_Server_addObjectTypeNode(server, UA_NODEID_NUMERIC(0, UA_NS0ID_SIMPLEOVERFLOWEVENTTYPE),
-                                          UA_NODEID_NUMERIC(0, UA_NS0ID_EVENTQUEUEOVERFLOWEVENTTYPE),
-                                          UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
-                                          UA_QUALIFIEDNAME(0, "SimpleOverflowEventType"),
-                                          overflowAttr, NULL, NULL);
+    if(!prepared) {
+        UA_ObjectTypeAttributes overflowAttr = UA_ObjectTypeAttributes_default;
+        overflowAttr.description = UA_LOCALIZEDTEXT("en-US", "A simple event for indicating a queue overflow.");
+        overflowAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SimpleOverflowEventType");
+        retVal |= UA_Server_addObjectTypeNode(server, UA_NODEID_NUMERIC(0, UA_NS0ID_SIMPLEOVERFLOWEVENTTYPE),
+                                              UA_NODEID_NUMERIC(0, UA_NS0ID_EVENTQUEUEOVERFLOWEVENTTYPE),
+                                              UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                              UA_QUALIFIEDNAME(0, "SimpleOverflowEventType"),
+                                              overflowAttr, NULL, NULL);
+    }
+#else
+    (void)prepared;
 #endif
 
     if(retVal != UA_STATUSCODE_GOOD) {
@@ -0,0 +1,406 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ua_server_internal.h"
+#include "ua_types_encoding_binary.h"
+
+/* Nodeset snapshots contain the nodes of selected namespaces in the binary
+ * encoding. The nodes are inserted into the nodestore without the consistency
+ * checks of the AddNodes service. Everything is encoded with the standard
+ * types of the binary encoding:
+ *
+ * - UInt32 magic and version
+ * - String array of the namespace URIs of the server that took the snapshot
+ * - UInt16 array of the contained namespaces
+ * - UInt32 number of nodes, followed by the nodes
+ *
+ * The nodes store their own side of every reference. When a node is loaded,
+ * the other side is added to the target nodes outside of the snapshot. */
+
+#define UA_SNAPSHOT_MAGIC 0x534E4155 /* "UANS" */
+#define UA_SNAPSHOT_VERSION 1
+
+/************/
+/* Encoding */
+/************/
+
+typedef struct {
+    UA_ByteString buf; /* The allocated buffer */
+    size_t length;     /* The used part of the buffer */
+} SnapshotWriter;
+
+/* Make room for the next size bytes */
+static UA_StatusCode
+reserve(SnapshotWriter *w, size_t size) {
+    if(w->length + size <= w->buf.length)
+        return UA_STATUSCODE_GOOD;
+    size_t newSize = (w->buf.length > 0) ? w->buf.length : 1024;
+    while(newSize < w->length + size)
+        newSize *= 2;
+    UA_Byte *newData = (UA_Byte*)UA_realloc(w->buf.data, newSize);
+    if(!newData)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    w->buf.data = newData;
+    w->buf.length = newSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+writeValue(SnapshotWriter *w, const void *p, const UA_DataType *type) {
+    size_t size = UA_calcSizeBinary(p, type);
+    if(size == 0)
+        return UA_STATUSCODE_BADENCODINGERROR;
+    UA_StatusCode res = reserve(w, size);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    UA_Byte *pos = &w->buf.data[w->length];
+    const UA_Byte *end = &w->buf.data[w->buf.length];
+    res = UA_encodeBinary(p, type, &pos, &end, NULL, NULL);
+    w->length = (size_t)(pos - w->buf.data);
+    return res;
+}
+
+static UA_StatusCode
+writeArray(SnapshotWriter *w, const void *array, size_t size,
+           const UA_DataType *type) {
+    UA_UInt32 size32 = (UA_UInt32)size;
+    UA_StatusCode res = writeValue(w, &size32, &UA_TYPES[UA_TYPES_UINT32]);
+    uintptr_t ptr = (uintptr_t)array;
+    for(size_t i = 0; i < size && res == UA_STATUSCODE_GOOD; i++) {
+        res = writeValue(w, (const void*)ptr, type);
+        ptr += type->memSize;
+    }
+    return res;
+}
+
+static UA_StatusCode
+writeNode(SnapshotWriter *w, const UA_Node *node) {
+    size_t size = UA_Node_calcSizeBinary(node);
+    if(size == 0)
+        return UA_STATUSCODE_BADENCODINGERROR;
+    UA_StatusCode res = reserve(w, size);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    UA_Byte *pos = &w->buf.data[w->length];
+    res = UA_Node_encodeBinary(node, &pos, &w->buf.data[w->buf.length]);
+    w->length = (size_t)(pos - w->buf.data);
+    return res;
+}
+
+typedef struct {
+    SnapshotWriter *w;
+    size_t namespacesSize;
+    const UA_UInt16 *namespaces;
+    UA_UInt32 nodesCount;
+    UA_StatusCode res;
+} SnapshotSaveContext;
+
+static UA_Boolean
+containsNamespace(size_t namespacesSize, const UA_UInt16 *namespaces,
+                  UA_UInt16 nsIndex) {
+    for(size_t i = 0; i < namespacesSize; i++) {
+        if(namespaces[i] == nsIndex)
+            return true;
+    }
+    return false;
+}
+
+static void
+saveNodeVisitor(void *context, const UA_Node *node) {
+    SnapshotSaveContext *ctx = (SnapshotSaveContext*)context;
+    if(ctx->res != UA_STATUSCODE_GOOD ||
+       !containsNamespace(ctx->namespacesSize, ctx->namespaces,
+                          node->head.nodeId.namespaceIndex))
+        return;
+    ctx->res = writeNode(ctx->w, node);
+    ctx->nodesCount++;
+}
+
+static UA_StatusCode
+saveNodesetSnapshot(UA_Server *server, size_t namespacesSize,
+                    const UA_UInt16 *namespaces, UA_ByteString *snapshot) {
+    SnapshotWriter w;
+    memset(&w, 0, sizeof(SnapshotWriter));
+    UA_UInt32 magic = UA_SNAPSHOT_MAGIC;
+    UA_UInt32 version = UA_SNAPSHOT_VERSION;
+    UA_StatusCode res = writeValue(&w, &magic, &UA_TYPES[UA_TYPES_UINT32]);
+    res |= writeValue(&w, &version, &UA_TYPES[UA_TYPES_UINT32]);
+    res |= writeArray(&w, server->namespaces, server->namespacesSize,
+                      &UA_TYPES[UA_TYPES_STRING]);
+    res |= writeArray(&w, namespaces, namespacesSize, &UA_TYPES[UA_TYPES_UINT16]);
+
+    /* Reserve the space for the number of nodes */
+    size_t countPos = w.length;
+    UA_UInt32 count = 0;
+    res |= writeValue(&w, &count, &UA_TYPES[UA_TYPES_UINT32]);
+    if(res != UA_STATUSCODE_GOOD) {
+        UA_ByteString_clear(&w.buf);
+        return res;
+    }
+
+    SnapshotSaveContext ctx;
+    ctx.w = &w;
+    ctx.namespacesSize = namespacesSize;
+    ctx.namespaces = namespaces;
+    ctx.nodesCount = 0;
+    ctx.res = UA_STATUSCODE_GOOD;
+    const UA_Nodestore *store = &server->config.nodestore;
+    if(store->getNextNode) {
+        /* Scan only the nodes of the namespaces */
+        for(size_t i = 0; i < namespacesSize; i++) {
+            if(containsNamespace(i, namespaces, namespaces[i]))
+                continue; /* Duplicate entry */
+            UA_NodeIdRange range;
+            memset(&range, 0, sizeof(UA_NodeIdRange));
+            range.namespaceIndex = namespaces[i];
+            UA_NodeId cursor = UA_NODEID_NULL;
+            const UA_Node *node;
+            while(ctx.res == UA_STATUSCODE_GOOD &&
+                  (node = store->getNextNode(store->context, &range, &cursor))) {
+                saveNodeVisitor(&ctx, node);
+                store->releaseNode(store->context, node);
+            }
+            UA_NodeId_clear(&cursor);
+        }
+    } else {
+        store->iterate(store->context, saveNodeVisitor, &ctx);
+    }
+    if(ctx.res != UA_STATUSCODE_GOOD) {
+        UA_ByteString_clear(&w.buf);
+        return ctx.res;
+    }
+
+    /* Fill in the number of nodes */
+    UA_Byte *pos = &w.buf.data[countPos];
+    const UA_Byte *end = &w.buf.data[w.buf.length];
+    res = UA_encodeBinary(&ctx.nodesCount, &UA_TYPES[UA_TYPES_UINT32],
+                          &pos, &end, NULL, NULL);
+    if(res != UA_STATUSCODE_GOOD) {
+        UA_ByteString_clear(&w.buf);
+        return res;
+    }
+
+    w.buf.length = w.length;
+    *snapshot = w.buf;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_saveNodesetSnapshot(UA_Server *server, size_t namespacesSize,
+                              const UA_UInt16 *namespaces, UA_ByteString *snapshot) {
+    UA_LOCK(server->serviceMutex);
+    UA_StatusCode res = saveNodesetSnapshot(server, namespacesSize,
+                                            namespaces, snapshot);
+    UA_UNLOCK(server->serviceMutex);
+    return res;
+}
+
+/************/
+/* Decoding */
+/************/
+
+typedef struct {
+    const UA_ByteString *src;
+    size_t offset;
+    const UA_DataTypeArray *customTypes;
+    /* From the namespace indices of the snapshot to those of the server */
+    size_t nsMapSize;
+    UA_UInt16 *nsMap;
+    /* Contained namespaces (indices of the server) */
+    size_t containedSize;
+    UA_UInt16 *contained;
+} SnapshotReader;
+
+static UA_StatusCode
+readValue(SnapshotReader *r, void *dst, const UA_DataType *type) {
+    return UA_decodeBinary(r->src, &r->offset, dst, type, r->customTypes);
+}
+
+static UA_StatusCode
+readArray(SnapshotReader *r, void **array, size_t *size, const UA_DataType *type) {
+    UA_UInt32 size32 = 0;
+    UA_StatusCode res = readValue(r, &size32, &UA_TYPES[UA_TYPES_UINT32]);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    /* Every element takes at least one byte */
+    if(size32 > r->src->length - r->offset)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    if(size32 == 0) {
+        *array = NULL;
+        *size = 0;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    void *a = UA_Array_new(size32, type);
+    if(!a)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    uintptr_t ptr = (uintptr_t)a;
+    for(size_t i = 0; i < size32; i++) {
+        res = readValue(r, (void*)ptr, type);
+        if(res != UA_STATUSCODE_GOOD) {
+            UA_Array_delete(a, size32, type);
+            return res;
+        }
+        ptr += type->memSize;
+    }
+    *array = a;
+    *size = size32;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+mapNamespace(const SnapshotReader *r, UA_UInt16 *nsIndex) {
+    if(*nsIndex >= r->nsMapSize)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    *nsIndex = r->nsMap[*nsIndex];
+    return UA_STATUSCODE_GOOD;
+}
+
+struct SnapshotReference {
+    const UA_AddReferencesItem *item;
+    UA_UInt32 browseNameHash;
+};
+
+static UA_StatusCode
+addSnapshotReference(UA_Server *server, UA_Session *session, UA_Node *node,
+                     struct SnapshotReference *ref) {
+    UA_StatusCode res = UA_Node_addReference(node, ref->item, ref->browseNameHash);
+    if(res == UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED)
+        res = UA_STATUSCODE_GOOD;
+    return res;
+}
+
+/* Update the type hierarchy index and add the other side of the references
+ * that lead outside of the snapshot */
+static UA_StatusCode
+linkNode(UA_Server *server, const SnapshotReader *r, const UA_Node *node) {
+    const UA_NodeHead *head = &node->head;
+    struct SnapshotReference ref;
+    ref.browseNameHash = UA_QualifiedName_hash(&head->browseName);
+    for(size_t i = 0; i < head->referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &head->references[i];
+        for(size_t j = 0; j < rk->refTargetsSize; j++) {
+            const UA_ExpandedNodeId *targetId = &rk->refTargets[j].targetId;
+            UA_TypeHierarchy_addReference(server, &head->nodeId, &rk->referenceTypeId,
+                                          !rk->isInverse, &targetId->nodeId);
+            if(targetId->serverIndex != 0 ||
+               containsNamespace(r->containedSize, r->contained,
+                                 targetId->nodeId.namespaceIndex))
+                continue;
+
+            UA_AddReferencesItem item;
+            UA_AddReferencesItem_init(&item);
+            item.sourceNodeId = targetId->nodeId;
+            item.referenceTypeId = rk->referenceTypeId;
+            item.isForward = rk->isInverse;
+            item.targetNodeId.nodeId = head->nodeId;
+            ref.item = &item;
+            UA_StatusCode res =
+                UA_Server_editNode(server, &server->adminSession, &targetId->nodeId,
+                                   (UA_EditNodeCallback)addSnapshotReference, &ref);
+            if(res != UA_STATUSCODE_GOOD)
+                return res;
+            UA_TypeHierarchy_addReference(server, &targetId->nodeId, &rk->referenceTypeId,
+                                          rk->isInverse, &head->nodeId);
+        }
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+loadNodes(UA_Server *server, SnapshotReader *r) {
+    UA_UInt32 count = 0;
+    UA_StatusCode res = readValue(r, &count, &UA_TYPES[UA_TYPES_UINT32]);
+    for(size_t i = 0; i < count && res == UA_STATUSCODE_GOOD; i++) {
+        UA_Node *node = NULL;
+        res = UA_Node_decodeBinaryMapped(r->src, &r->offset, r->customTypes,
+                                         &server->config.nodestore, r->nsMap,
+                                         r->nsMapSize, &node);
+        if(res != UA_STATUSCODE_GOOD)
+            break;
+
+        UA_NodeId nodeId;
+        res = UA_NODESTORE_INSERT(server, node, &nodeId);
+        if(res != UA_STATUSCODE_GOOD)
+            break;
+        server->modelVersion++;
+
+        const UA_Node *inserted = UA_NODESTORE_GET(server, &nodeId);
+        UA_NodeId_clear(&nodeId);
+        if(!inserted) {
+            res = UA_STATUSCODE_BADINTERNALERROR;
+            break;
+        }
+        res = linkNode(server, r, inserted);
+        UA_NODESTORE_RELEASE(server, inserted);
+    }
+    return res;
+}
+
+static UA_StatusCode
+loadNodesetSnapshot(UA_Server *server, const UA_ByteString *snapshot) {
+    SnapshotReader r;
+    memset(&r, 0, sizeof(SnapshotReader));
+    r.src = snapshot;
+    r.customTypes = server->config.customDataTypes;
+
+    /* Check the header */
+    UA_UInt32 magic = 0, version = 0;
+    UA_StatusCode res = readValue(&r, &magic, &UA_TYPES[UA_TYPES_UINT32]);
+    res |= readValue(&r, &version, &UA_TYPES[UA_TYPES_UINT32]);
+    if(res != UA_STATUSCODE_GOOD || magic != UA_SNAPSHOT_MAGIC ||
+       version != UA_SNAPSHOT_VERSION)
+        return UA_STATUSCODE_BADDECODINGERROR;
+
+    /* Map the namespaces. Namespace one is the local namespace of the server
+     * and keeps its index regardless of the URI. */
+    UA_String *namespaces = NULL;
+    size_t namespacesSize = 0;
+    res = readArray(&r, (void**)&namespaces, &namespacesSize,
+                    &UA_TYPES[UA_TYPES_STRING]);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    r.nsMap = (UA_UInt16*)UA_calloc(namespacesSize + 1, sizeof(UA_UInt16));
+    if(!r.nsMap) {
+        UA_Array_delete(namespaces, namespacesSize, &UA_TYPES[UA_TYPES_STRING]);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    r.nsMapSize = namespacesSize;
+    for(size_t i = 0; i < namespacesSize; i++) {
+        if(i < 2) {
+            r.nsMap[i] = (UA_UInt16)i;
+            continue;
+        }
+        r.nsMap[i] = addNamespace(server, namespaces[i]);
+        if(r.nsMap[i] == 0)
+            res = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    UA_Array_delete(namespaces, namespacesSize, &UA_TYPES[UA_TYPES_STRING]);
+
+    /* The contained namespaces */
+    if(res == UA_STATUSCODE_GOOD)
+        res = readArray(&r, (void**)&r.contained, &r.containedSize,
+                        &UA_TYPES[UA_TYPES_UINT16]);
+    for(size_t i = 0; i < r.containedSize && res == UA_STATUSCODE_GOOD; i++)
+        res = mapNamespace(&r, &r.contained[i]);
+
+    if(res == UA_STATUSCODE_GOOD)
+        res = loadNodes(server, &r);
+
+    /* The templates might be derived from nodes that got new references */
+    UA_InstanceTemplates_clear(&server->instanceTemplates);
+
+    UA_free(r.nsMap);
+    UA_free(r.contained);
+    return res;
+}
+
+UA_StatusCode
+UA_Server_loadNodesetSnapshot(UA_Server *server, const UA_ByteString *snapshot) {
+    UA_LOCK(server->serviceMutex);
+    UA_StatusCode res = loadNodesetSnapshot(server, snapshot);
+    UA_UNLOCK(server->serviceMutex);
+    return res;
+}
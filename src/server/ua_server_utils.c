@@ -14,10 +14,308 @@
 
 #define UA_MAX_TREE_RECURSE 50 /* How deep up/down the tree do we recurse at most? */
 
+/************************/
+/* Type Hierarchy Index */
+/************************/
+
+static UA_Boolean
+isHasSubtype(const UA_NodeId *refTypeId) {
+    return (refTypeId->namespaceIndex == 0 &&
+            refTypeId->identifierType == UA_NODEIDTYPE_NUMERIC &&
+            refTypeId->identifier.numeric == UA_NS0ID_HASSUBTYPE);
+}
+
+#define UA_TYPEHIERARCHY_MAXCACHED 64
+
+static UA_UInt32
+TypeHierarchy_find(const UA_TypeHierarchy *th, const UA_NodeId *nodeId) {
+    void **i = UA_NodeIdMap_find(&th->index, nodeId);
+    return (i) ? (UA_UInt32)(uintptr_t)*i : UA_TYPEHIERARCHY_NONE;
+}
+
+/* Returns the index of the entry. A new entry is added if the NodeId is not
+ * yet indexed. Returns UA_TYPEHIERARCHY_NONE if out of memory. */
+static UA_UInt32
+TypeHierarchy_getOrAdd(UA_TypeHierarchy *th, const UA_NodeId *nodeId) {
+    UA_UInt32 i = TypeHierarchy_find(th, nodeId);
+    if(i != UA_TYPEHIERARCHY_NONE)
+        return i;
+
+    /* Grow the entries */
+    if(th->entriesSize == th->entriesCapacity) {
+        size_t capacity = (th->entriesCapacity > 0) ? th->entriesCapacity * 2 : 64;
+        if(capacity >= UA_TYPEHIERARCHY_NONE)
+            return UA_TYPEHIERARCHY_NONE;
+        UA_TypeHierarchyEntry *entries = (UA_TypeHierarchyEntry*)
+            UA_realloc(th->entries, capacity * sizeof(UA_TypeHierarchyEntry));
+        if(!entries)
+            return UA_TYPEHIERARCHY_NONE;
+        th->entries = entries;
+        th->entriesCapacity = capacity;
+    }
+
+    i = (UA_UInt32)th->entriesSize;
+    UA_TypeHierarchyEntry *e = &th->entries[i];
+    if(UA_NodeId_copy(nodeId, &e->nodeId) != UA_STATUSCODE_GOOD)
+        return UA_TYPEHIERARCHY_NONE;
+    if(UA_NodeIdMap_insert(&th->index, nodeId,
+                           (void*)(uintptr_t)i) != UA_STATUSCODE_GOOD) {
+        UA_NodeId_clear(&e->nodeId);
+        return UA_TYPEHIERARCHY_NONE;
+    }
+    e->supertype = UA_TYPEHIERARCHY_NONE;
+    e->firstSubtype = UA_TYPEHIERARCHY_NONE;
+    e->nextSibling = UA_TYPEHIERARCHY_NONE;
+    e->removed = false;
+    th->entriesSize++;
+    return i;
+}
+
+static void
+TypeHierarchy_dropSubtypeSets(UA_TypeHierarchy *th) {
+    if(th->subtypeSets.count == 0)
+        return;
+    for(size_t i = 0; i < th->subtypeSets.slotsSize; i++) {
+        UA_NodeIdMapSlot *slot = &th->subtypeSets.slots[i];
+        if(slot->hash == 0)
+            continue;
+        UA_TypeSet_clear((UA_TypeSet*)slot->value);
+        UA_free(slot->value);
+    }
+    UA_NodeIdMap_clear(&th->subtypeSets);
+}
+
+static void
+TypeHierarchy_link(UA_TypeHierarchy *th, const UA_NodeId *subtypeNodeId,
+                   const UA_NodeId *supertypeNodeId) {
+    if(th->fallback)
+        return;
+    TypeHierarchy_dropSubtypeSets(th);
+    UA_UInt32 sub = TypeHierarchy_getOrAdd(th, subtypeNodeId);
+    UA_UInt32 super = (sub != UA_TYPEHIERARCHY_NONE) ?
+        TypeHierarchy_getOrAdd(th, supertypeNodeId) : UA_TYPEHIERARCHY_NONE;
+    if(sub == UA_TYPEHIERARCHY_NONE || super == UA_TYPEHIERARCHY_NONE) {
+        th->fallback = true;
+        return;
+    }
+
+    /* Both nodes exist when a reference is added */
+    UA_TypeHierarchyEntry *se = &th->entries[sub];
+    se->removed = false;
+    th->entries[super].removed = false;
+    if(se->supertype == super)
+        return;
+
+    /* Multiple supertypes cannot be represented */
+    if(se->supertype != UA_TYPEHIERARCHY_NONE) {
+        th->fallback = true;
+        return;
+    }
+
+    se->supertype = super;
+    se->nextSibling = th->entries[super].firstSubtype;
+    th->entries[super].firstSubtype = sub;
+}
+
+static void
+TypeHierarchy_unlink(UA_TypeHierarchy *th, UA_UInt32 sub) {
+    UA_TypeHierarchyEntry *se = &th->entries[sub];
+    if(se->supertype == UA_TYPEHIERARCHY_NONE)
+        return;
+    TypeHierarchy_dropSubtypeSets(th);
+    UA_UInt32 *i = &th->entries[se->supertype].firstSubtype;
+    while(*i != UA_TYPEHIERARCHY_NONE) {
+        if(*i == sub) {
+            *i = se->nextSibling;
+            break;
+        }
+        i = &th->entries[*i].nextSibling;
+    }
+    se->supertype = UA_TYPEHIERARCHY_NONE;
+    se->nextSibling = UA_TYPEHIERARCHY_NONE;
+}
+
+static void
+buildTypeHierarchyVisitor(void *context, const UA_Node *node) {
+    UA_TypeHierarchy *th = (UA_TypeHierarchy*)context;
+    for(size_t i = 0; i < node->head.referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &node->head.references[i];
+        if(!rk->isInverse || !isHasSubtype(&rk->referenceTypeId))
+            continue;
+        for(size_t j = 0; j < rk->refTargetsSize; j++) {
+            if(rk->refTargets[j].targetId.serverIndex == 0)
+                TypeHierarchy_link(th, &node->head.nodeId,
+                                   &rk->refTargets[j].targetId.nodeId);
+        }
+    }
+}
+
+void
+UA_TypeHierarchy_build(UA_Server *server) {
+    server->config.nodestore.iterate(server->config.nodestore.context,
+                                     buildTypeHierarchyVisitor,
+                                     &server->typeHierarchy);
+}
+
+void
+UA_TypeHierarchy_clear(UA_TypeHierarchy *th) {
+    TypeHierarchy_dropSubtypeSets(th);
+    for(size_t i = 0; i < th->entriesSize; i++)
+        UA_NodeId_clear(&th->entries[i].nodeId);
+    UA_free(th->entries);
+    UA_NodeIdMap_clear(&th->index);
+    memset(th, 0, sizeof(UA_TypeHierarchy));
+}
+
+void
+UA_TypeHierarchy_addReference(UA_Server *server, const UA_NodeId *sourceId,
+                              const UA_NodeId *refTypeId, UA_Boolean isForward,
+                              const UA_NodeId *targetId) {
+    if(!isForward && isHasSubtype(refTypeId))
+        TypeHierarchy_link(&server->typeHierarchy, sourceId, targetId);
+}
+
+void
+UA_TypeHierarchy_deleteReference(UA_Server *server, const UA_NodeId *sourceId,
+                                 const UA_NodeId *refTypeId, UA_Boolean isForward,
+                                 const UA_NodeId *targetId) {
+    UA_TypeHierarchy *th = &server->typeHierarchy;
+    if(isForward || th->fallback || !isHasSubtype(refTypeId))
+        return;
+    UA_UInt32 sub = TypeHierarchy_find(th, sourceId);
+    if(sub == UA_TYPEHIERARCHY_NONE)
+        return;
+    if(th->entries[sub].supertype != TypeHierarchy_find(th, targetId))
+        return;
+    TypeHierarchy_unlink(th, sub);
+}
+
+void
+UA_TypeHierarchy_removeNode(UA_Server *server, const UA_NodeId *nodeId) {
+    UA_TypeHierarchy *th = &server->typeHierarchy;
+    if(th->fallback)
+        return;
+    UA_UInt32 i = TypeHierarchy_find(th, nodeId);
+    if(i == UA_TYPEHIERARCHY_NONE)
+        return;
+    /* The entry keeps its index. The subtypes remain linked as long as they
+     * have a reference to the removed node. */
+    TypeHierarchy_unlink(th, i);
+    TypeHierarchy_dropSubtypeSets(th);
+    th->entries[i].removed = true;
+}
+
+static UA_StatusCode
+copyTypeSet(const UA_TypeSet *src, UA_TypeSet *dst) {
+    dst->words = (UA_UInt64*)UA_malloc(src->wordsSize * sizeof(UA_UInt64));
+    if(!dst->words)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(dst->words, src->words, src->wordsSize * sizeof(UA_UInt64));
+    dst->wordsSize = src->wordsSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+computeSubtypeSet(const UA_TypeHierarchy *th, UA_UInt32 root, UA_TypeSet *set) {
+    size_t wordsSize = (th->entriesSize + 63) / 64;
+    UA_UInt64 *words = (UA_UInt64*)UA_calloc(wordsSize, sizeof(UA_UInt64));
+    UA_UInt32 *stack = (UA_UInt32*)UA_malloc(th->entriesSize * sizeof(UA_UInt32));
+    if(!words || !stack) {
+        UA_free(words);
+        UA_free(stack);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    /* Depth-first search. Every entry is put on the stack at most once. */
+    size_t top = 0;
+    stack[top++] = root;
+    words[root / 64] |= (UA_UInt64)1 << (root % 64);
+    while(top > 0) {
+        UA_UInt32 i = stack[--top];
+        for(UA_UInt32 c = th->entries[i].firstSubtype; c != UA_TYPEHIERARCHY_NONE;
+            c = th->entries[c].nextSibling) {
+            UA_UInt64 bit = (UA_UInt64)1 << (c % 64);
+            if(words[c / 64] & bit)
+                continue;
+            words[c / 64] |= bit;
+            stack[top++] = c;
+        }
+    }
+
+    UA_free(stack);
+    set->words = words;
+    set->wordsSize = wordsSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_TypeHierarchy_subtypeSet(UA_Server *server, const UA_NodeId *type,
+                            UA_TypeSet *set) {
+    UA_TypeHierarchy *th = &server->typeHierarchy;
+    if(th->fallback)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    /* Copy from the cache */
+    void **cached = UA_NodeIdMap_find(&th->subtypeSets, type);
+    if(cached)
+        return copyTypeSet((const UA_TypeSet*)*cached, set);
+
+    UA_UInt32 root = TypeHierarchy_find(th, type);
+    if(root == UA_TYPEHIERARCHY_NONE || th->entries[root].removed)
+        return UA_STATUSCODE_BADNOTFOUND;
+    UA_StatusCode retval = computeSubtypeSet(th, root, set);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* Add to the cache. Without memory the set is just not cached. */
+    if(th->subtypeSets.count >= UA_TYPEHIERARCHY_MAXCACHED)
+        TypeHierarchy_dropSubtypeSets(th);
+    UA_TypeSet *entry = (UA_TypeSet*)UA_malloc(sizeof(UA_TypeSet));
+    if(!entry)
+        return UA_STATUSCODE_GOOD;
+    if(copyTypeSet(set, entry) != UA_STATUSCODE_GOOD) {
+        UA_free(entry);
+        return UA_STATUSCODE_GOOD;
+    }
+    if(UA_NodeIdMap_insert(&th->subtypeSets, type, entry) != UA_STATUSCODE_GOOD) {
+        UA_TypeSet_clear(entry);
+        UA_free(entry);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_Boolean
+UA_TypeSet_contains(UA_Server *server, const UA_TypeSet *set,
+                    const UA_NodeId *type) {
+    UA_UInt32 i = TypeHierarchy_find(&server->typeHierarchy, type);
+    if(i == UA_TYPEHIERARCHY_NONE || i / 64 >= set->wordsSize)
+        return false;
+    return ((set->words[i / 64] >> (i % 64)) & 1) != 0;
+}
+
+void
+UA_TypeSet_clear(UA_TypeSet *set) {
+    UA_free(set->words);
+    set->words = NULL;
+    set->wordsSize = 0;
+}
+
 /********************************/
 /* Information Model Operations */
 /********************************/
 
+void
+UA_Nodestore_getNodes(UA_Server *server, size_t nodeIdsSize,
+                      const UA_NodeId **nodeIds, const UA_Node **outNodes) {
+    UA_Nodestore *ns = &server->config.nodestore;
+    if(ns->getNodes) {
+        ns->getNodes(ns->context, nodeIdsSize, nodeIds, outNodes);
+        return;
+    }
+    for(size_t i = 0; i < nodeIdsSize; i++)
+        outNodes[i] = nodeIds[i] ? ns->getNode(ns->context, nodeIds[i]) : NULL;
+}
+
 /* Keeps track of already visited nodes to detect circular references */
 struct ref_history {
     struct ref_history *parent; /* the previous element */
@@ -96,6 +394,24 @@ isNodeInTreeNoCircular(UA_Server *server, const UA_NodeId *leafNode, const UA_No
 UA_Boolean
 isNodeInTree(UA_Server *server, const UA_NodeId *leafNode, const UA_NodeId *nodeToFind,
              const UA_NodeId *referenceTypeIds, size_t referenceTypeIdsSize) {
+    /* Walk up the type hierarchy index */
+    const UA_TypeHierarchy *th = &server->typeHierarchy;
+    if(referenceTypeIdsSize == 1 && isHasSubtype(referenceTypeIds) && !th->fallback) {
+        if(UA_NodeId_equal(nodeToFind, leafNode))
+            return true;
+        UA_UInt32 target = TypeHierarchy_find(th, nodeToFind);
+        if(target == UA_TYPEHIERARCHY_NONE)
+            return false;
+        UA_UInt32 i = TypeHierarchy_find(th, leafNode);
+        for(size_t depth = 0; i != UA_TYPEHIERARCHY_NONE &&
+                depth < UA_MAX_TREE_RECURSE; depth++) {
+            i = th->entries[i].supertype;
+            if(i == target)
+                return true;
+        }
+        return false;
+    }
+
     struct ref_history visitedRefs = {NULL, leafNode, 0};
     return isNodeInTreeNoCircular(server, leafNode, nodeToFind, &visitedRefs,
                                   referenceTypeIds, referenceTypeIdsSize);
@@ -227,7 +543,35 @@ getParentTypeAndInterfaceHierarchy(UA_Server *server, const UA_NodeId *typeNode,
     return UA_STATUSCODE_GOOD;
 }
 
-/* For mulithreading: make a copy of the node, edit and replace.
+void
+UA_Server_beginNodeBatch(UA_Server *server) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
+    server->nodeBatch.depth++;
+}
+
+void
+UA_Server_endNodeBatch(UA_Server *server) {
+    UA_NodeBatch *batch = &server->nodeBatch;
+    UA_assert(batch->depth > 0);
+    batch->depth--;
+    if(batch->depth > 0)
+        return;
+    UA_NodeIdMap_clear(&batch->edited);
+}
+
+/* Nodes edited in-situ are not replaced. So the nodestore is told explicitly. */
+static void
+notifyNodeChanged(UA_Server *server, const UA_Node *node) {
+    UA_Nodestore *ns = &server->config.nodestore;
+    if(ns->nodeChanged)
+        ns->nodeChanged(ns->context, node);
+}
+
+/* For mulithreading: make a copy of the node, edit and replace. Within a
+ * batch, the copy that replaced the node is edited in-situ as long as no other
+ * consumer holds a reference to it. The service mutex is released during the
+ * batch (e.g. around constructors), so a reader may have gotten the published
+ * copy in the meantime. Then the node is copied again.
  * For singlethreading: edit the original */
 UA_StatusCode
 UA_Server_editNode(UA_Server *server, UA_Session *session,
@@ -239,9 +583,30 @@ UA_Server_editNode(UA_Server *server, UA_Session *session,
     if(!node)
         return UA_STATUSCODE_BADNODEIDUNKNOWN;
     UA_StatusCode retval = callback(server, session, (UA_Node*)(uintptr_t)node, data);
+    if(retval == UA_STATUSCODE_GOOD)
+        notifyNodeChanged(server, node);
     UA_NODESTORE_RELEASE(server, node);
     return retval;
 #else
+    /* The node was already replaced by a copy in this batch. Edit in-situ if
+     * we hold the only reference. */
+    UA_NodeBatch *batch = &server->nodeBatch;
+    UA_Nodestore *ns = &server->config.nodestore;
+    if(batch->depth > 0 && ns->isNodeExclusive &&
+       UA_NodeIdMap_find(&batch->edited, nodeId)) {
+        const UA_Node *node = UA_NODESTORE_GET(server, nodeId);
+        if(node && ns->isNodeExclusive(ns->context, node)) {
+            UA_StatusCode retval =
+                callback(server, session, (UA_Node*)(uintptr_t)node, data);
+            if(retval == UA_STATUSCODE_GOOD)
+                notifyNodeChanged(server, node);
+            UA_NODESTORE_RELEASE(server, node);
+            return retval;
+        }
+        if(node)
+            UA_NODESTORE_RELEASE(server, node);
+    }
+
     UA_StatusCode retval;
     do {
         /* Get an editable copy of the node */
@@ -260,6 +625,10 @@ UA_Server_editNode(UA_Server *server, UA_Session *session,
         /* Replace the node */
         retval = UA_NODESTORE_REPLACE(server, node);
     } while(retval != UA_STATUSCODE_GOOD);
+
+    /* Without memory, the node is copied again on the next edit */
+    if(batch->depth > 0)
+        UA_NodeIdMap_insert(&batch->edited, nodeId, NULL);
     return retval;
 #endif
 }
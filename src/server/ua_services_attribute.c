@@ -34,13 +34,20 @@ static UA_UInt32
 getUserWriteMask(UA_Server *server, const UA_Session *session, const UA_NodeHead *head) {
     if(session == &server->adminSession)
         return 0xFFFFFFFF; /* the local admin user has all rights */
-    UA_UInt32 mask = head->writeMask;
-    UA_UNLOCK(server->serviceMutex);
-    mask &= server->config.accessControl.getUserRightsMask(server, &server->config.accessControl,
-                                                           &session->sessionId, session->sessionHandle,
-                                                           &head->nodeId, head->context);
-    UA_LOCK(server->serviceMutex);
-    return mask;
+    UA_UInt32 mask;
+    if(!UA_Session_getCachedAccess(server, session, UA_ACCESSCACHE_USERRIGHTSMASK,
+                                   &head->nodeId, &mask)) {
+        UA_UInt32 generation = server->accessCacheGeneration;
+        UA_UNLOCK(server->serviceMutex);
+        mask = server->config.accessControl.
+            getUserRightsMask(server, &server->config.accessControl,
+                              &session->sessionId, session->sessionHandle,
+                              &head->nodeId, head->context);
+        UA_LOCK(server->serviceMutex);
+        UA_Session_cacheAccess(session, generation, UA_ACCESSCACHE_USERRIGHTSMASK,
+                               &head->nodeId, mask);
+    }
+    return head->writeMask & mask;
 }
 
 static UA_Byte
@@ -56,14 +63,20 @@ getUserAccessLevel(UA_Server *server, const UA_Session *session,
                    const UA_VariableNode *node) {
     if(session == &server->adminSession)
         return 0xFF; /* the local admin user has all rights */
-    UA_Byte retval = node->accessLevel;
-    UA_UNLOCK(server->serviceMutex);
-    retval &= server->config.accessControl.
-        getUserAccessLevel(server, &server->config.accessControl,
-                           &session->sessionId, session->sessionHandle,
-                           &node->head.nodeId, node->head.context);
-    UA_LOCK(server->serviceMutex);
-    return retval;
+    UA_UInt32 level;
+    if(!UA_Session_getCachedAccess(server, session, UA_ACCESSCACHE_USERACCESSLEVEL,
+                                   &node->head.nodeId, &level)) {
+        UA_UInt32 generation = server->accessCacheGeneration;
+        UA_UNLOCK(server->serviceMutex);
+        level = server->config.accessControl.
+            getUserAccessLevel(server, &server->config.accessControl,
+                               &session->sessionId, session->sessionHandle,
+                               &node->head.nodeId, node->head.context);
+        UA_LOCK(server->serviceMutex);
+        UA_Session_cacheAccess(session, generation, UA_ACCESSCACHE_USERACCESSLEVEL,
+                               &node->head.nodeId, level);
+    }
+    return node->accessLevel & (UA_Byte)level;
 }
 
 static UA_Boolean
@@ -71,14 +84,20 @@ getUserExecutable(UA_Server *server, const UA_Session *session,
                   const UA_MethodNode *node) {
     if(session == &server->adminSession)
         return true; /* the local admin user has all rights */
-    UA_UNLOCK(server->serviceMutex);
-    UA_Boolean userExecutable = node->executable;
-    userExecutable &=
-        server->config.accessControl.getUserExecutable(server, &server->config.accessControl,
-                                                       &session->sessionId, session->sessionHandle,
-                                                       &node->head.nodeId, node->head.context);
-    UA_LOCK(server->serviceMutex);
-    return userExecutable;
+    UA_UInt32 executable;
+    if(!UA_Session_getCachedAccess(server, session, UA_ACCESSCACHE_USEREXECUTABLE,
+                                   &node->head.nodeId, &executable)) {
+        UA_UInt32 generation = server->accessCacheGeneration;
+        UA_UNLOCK(server->serviceMutex);
+        executable = server->config.accessControl.
+            getUserExecutable(server, &server->config.accessControl,
+                              &session->sessionId, session->sessionHandle,
+                              &node->head.nodeId, node->head.context);
+        UA_LOCK(server->serviceMutex);
+        UA_Session_cacheAccess(session, generation, UA_ACCESSCACHE_USEREXECUTABLE,
+                               &node->head.nodeId, executable);
+    }
+    return node->executable && executable;
 }
 
 /****************/
@@ -1477,11 +1496,25 @@ copyAttributeIntoNode(UA_Server *server, UA_Session *session,
     return retval;
 }
 
+/* Edit the node and sample the MonitoredItems that wait for a write */
+static UA_StatusCode
+writeNode(UA_Server *server, UA_Session *session, const UA_WriteValue *wv) {
+    UA_StatusCode retval =
+        UA_Server_editNode(server, session, &wv->nodeId,
+                           (UA_EditNodeCallback)copyAttributeIntoNode,
+                           /* casting away const qualifier because callback uses const anyway */
+                           (UA_WriteValue *)(uintptr_t)wv);
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    if(retval == UA_STATUSCODE_GOOD)
+        UA_MonitoredItem_sampleOnWrite(server, &wv->nodeId);
+#endif
+    return retval;
+}
+
 static void
 Operation_Write(UA_Server *server, UA_Session *session, void *context,
                 UA_WriteValue *wv, UA_StatusCode *result) {
-    *result = UA_Server_editNode(server, session, &wv->nodeId,
-                        (UA_EditNodeCallback)copyAttributeIntoNode, wv);
+    *result = writeNode(server, session, wv);
 }
 
 void
@@ -1509,19 +1542,13 @@ Service_Write(UA_Server *server, UA_Session *session,
 UA_StatusCode
 writeWithSession(UA_Server *server, UA_Session *session,
                            const UA_WriteValue *value) {
-    return UA_Server_editNode(server, session, &value->nodeId,
-                              (UA_EditNodeCallback)copyAttributeIntoNode,
-                              /* casting away const qualifier because callback uses const anyway */
-                              (UA_WriteValue *)(uintptr_t)value);
+    return writeNode(server, session, value);
 }
 
 UA_StatusCode
 writeAttribute(UA_Server *server, const UA_WriteValue *value) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
-    return UA_Server_editNode(server, &server->adminSession, &value->nodeId,
-                              (UA_EditNodeCallback)copyAttributeIntoNode,
-                               /* casting away const qualifier because callback uses const anyway */
-                              (UA_WriteValue *)(uintptr_t)value);
+    return writeNode(server, &server->adminSession, value);
 }
 
 UA_StatusCode
@@ -94,9 +94,20 @@ setMonitoredItemSettings(UA_Server *server, UA_Session *session, UA_MonitoredIte
             return UA_STATUSCODE_BADEVENTFILTERINVALID;
         if(params->filter.content.decoded.type != &UA_TYPES[UA_TYPES_EVENTFILTER])
             return UA_STATUSCODE_BADEVENTFILTERINVALID;
+        /* The routing depends on the where clause. Take the MonitoredItem
+         * out while the filter is replaced. */
+        UA_Boolean routed = (mon->routeGroup != NULL);
+        if(routed)
+            UA_EventRoute_removeMonitoredItem(server, mon);
+        UA_CompiledEventFilter_clear(&mon->compiledEventFilter);
         UA_EventFilter_clear(&mon->filter.eventFilter);
         retval = UA_EventFilter_copy((UA_EventFilter *)params->filter.content.decoded.data,
                                      &mon->filter.eventFilter);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = UA_CompiledEventFilter_init(&mon->compiledEventFilter,
+                                                 &mon->filter.eventFilter);
+        if(routed)
+            retval |= UA_EventRoute_addMonitoredItem(server, mon);
 #endif
     } else {
         /* DataChange MonitoredItem */
@@ -136,14 +147,24 @@ setMonitoredItemSettings(UA_Server *server, UA_Session *session, UA_MonitoredIte
     if(retval != UA_STATUSCODE_GOOD)
         return retval;
 
+    /* Size the notification queue. Local MonitoredItems have no queue. */
+    UA_UInt32 queueSize;
+    UA_BOUNDEDVALUE_SETWBOUNDS(server->config.queueSizeLimits,
+                               params->queueSize, queueSize);
+    if(mon->subscription) {
+        retval = UA_MonitoredItem_reserveQueue(mon, queueSize);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+
     /* <-- The point of no return --> */
 
     /* Unregister the callback */
     UA_MonitoredItem_unregisterSampleCallback(server, mon);
 
     /* Remove the old samples */
-    UA_ByteString_clear(&mon->lastSampledValue);
-    UA_Variant_clear(&mon->lastValue);
+    UA_DataValue_clear(&mon->lastValue);
+    mon->lastValueSet = false;
 
     /* ClientHandle */
     mon->clientHandle = params->clientHandle;
@@ -167,9 +188,12 @@ setMonitoredItemSettings(UA_Server *server, UA_Session *session, UA_MonitoredIte
     if(samplingInterval != samplingInterval) /* Check for nan */
         mon->samplingInterval = server->config.samplingIntervalLimits.min;
 
-    /* QueueSize */
-    UA_BOUNDEDVALUE_SETWBOUNDS(server->config.queueSizeLimits,
-                               params->queueSize, mon->maxQueueSize);
+    /* QueueSize. Reserve the space in the notification pool. */
+    if(mon->subscription)
+        server->notificationPool.reserve -= mon->maxQueueSize;
+    mon->maxQueueSize = queueSize;
+    if(mon->subscription)
+        server->notificationPool.reserve += mon->maxQueueSize;
 
     /* DiscardOldest */
     mon->discardOldest = params->discardOldest;
@@ -185,18 +209,6 @@ setMonitoredItemSettings(UA_Server *server, UA_Session *session, UA_MonitoredIte
 
 static const UA_String binaryEncoding = {sizeof("Default Binary") - 1, (UA_Byte *)"Default Binary"};
 
-#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-static UA_StatusCode
-UA_Server_addMonitoredItemToNodeEditNodeCallback(UA_Server *server, UA_Session *session,
-                                                 UA_Node *node, void *data) {
-    /* data is the MonitoredItem */
-    /* SLIST_INSERT_HEAD */
-    ((UA_MonitoredItem *)data)->next = ((UA_ObjectNode *)node)->monitoredItemQueue;
-    ((UA_ObjectNode *)node)->monitoredItemQueue = (UA_MonitoredItem *)data;
-    return UA_STATUSCODE_GOOD;
-}
-#endif
-
 /* Thread-local variables to pass additional arguments into the operation */
 struct createMonContext {
     UA_Subscription *sub;
@@ -323,9 +335,12 @@ Operation_CreateMonitoredItem(UA_Server *server, UA_Session *session, struct cre
                 UA_MonitoredItem_delete(server, newMon);
                 return;
             }
-            /* Insert the monitored item into the node's queue */
-            UA_Server_editNode(server, NULL, &newMon->monitoredNodeId,
-                               UA_Server_addMonitoredItemToNodeEditNodeCallback, newMon);
+            /* Route the events of the node to the MonitoredItem */
+            result->statusCode = UA_EventRoute_addMonitoredItem(server, newMon);
+            if(result->statusCode != UA_STATUSCODE_GOOD) {
+                UA_MonitoredItem_delete(server, newMon);
+                return;
+            }
         }
 #endif
     } else {
@@ -508,7 +523,6 @@ Operation_SetMonitoringMode(UA_Server *server, UA_Session *session,
         *result = UA_STATUSCODE_BADMONITOREDITEMIDINVALID;
         return;
     }
-    UA_Subscription *sub = mon->subscription;
 
     /* Check if the MonitoringMode is valid or not */
     if(smc->monitoringMode > UA_MONITORINGMODE_REPORTING) {
@@ -520,59 +534,39 @@ Operation_SetMonitoringMode(UA_Server *server, UA_Session *session,
     if(mon->monitoringMode == smc->monitoringMode)
         return;
 
+    /* When reporting is enabled, put all notifications that were already
+     * sampled into the order of the subscription. When reporting is disabled,
+     * remove them from the order. !!! This needs to be the same operation as in
+     * UA_Notification_enqueue !!! */
+    if(smc->monitoringMode == UA_MONITORINGMODE_REPORTING) {
+        *result = UA_MonitoredItem_addToSubscriptionOrder(mon);
+        if(*result != UA_STATUSCODE_GOOD)
+            return;
+    } else {
+        UA_MonitoredItem_removeFromSubscriptionOrder(mon);
+    }
+
     mon->monitoringMode = smc->monitoringMode;
 
-    /* When reporting is enabled, put all notifications that were already
-     * sampled into the global queue of the subscription. When sampling is
-     * enabled, remove all notifications from the global queue. !!! This needs
-     * to be the same operation as in UA_Notification_enqueue !!! */
-    if(mon->monitoringMode == UA_MONITORINGMODE_REPORTING) {
-        UA_Notification *notification;
-        TAILQ_FOREACH(notification, &mon->queue, listEntry) {
-            TAILQ_INSERT_TAIL(&sub->notificationQueue, notification, globalEntry);
-            ++sub->notificationQueueSize;
-#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-            if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
-                ++sub->eventNotifications;
-            } else
-#endif
-            {
-                ++sub->dataChangeNotifications;
-            }
-        }
-        /* Register the sampling callback with an interval */
-        *result = UA_MonitoredItem_registerSampleCallback(server, mon);
-    } else if(mon->monitoringMode == UA_MONITORINGMODE_SAMPLING) {
-        UA_Notification *notification;
-        TAILQ_FOREACH(notification, &mon->queue, listEntry) {
-            TAILQ_REMOVE(&sub->notificationQueue, notification, globalEntry);
-            TAILQ_NEXT(notification, globalEntry) = UA_SUBSCRIPTION_QUEUE_SENTINEL;
-            --sub->notificationQueueSize;
-#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-            if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
-                --sub->eventNotifications;
-            } else
-#endif
-            {
-                --sub->dataChangeNotifications;
-            }
-        }
+    if(mon->monitoringMode == UA_MONITORINGMODE_REPORTING ||
+       mon->monitoringMode == UA_MONITORINGMODE_SAMPLING) {
         /* Register the sampling callback with an interval */
         *result = UA_MonitoredItem_registerSampleCallback(server, mon);
     } else {
         /* UA_MONITORINGMODE_DISABLED */
         UA_MonitoredItem_unregisterSampleCallback(server, mon);
 
-        /* Setting the mode to DISABLED or SAMPLING causes all queued Notifications to be deleted */
-        UA_Notification *notification, *notification_tmp;
-        TAILQ_FOREACH_SAFE(notification, &mon->queue, listEntry, notification_tmp) {
+        /* Setting the mode to DISABLED causes all queued Notifications to be deleted */
+        while(mon->queue.size > 0) {
+            UA_Notification *notification = (UA_Notification*)
+                UA_PointerRing_get(&mon->queue, 0);
             UA_Notification_dequeue(server, notification);
-            UA_Notification_delete(notification);
+            UA_Notification_delete(server, notification);
         }
 
-        /* Initialize lastSampledValue */
-        UA_ByteString_clear(&mon->lastSampledValue);
-        UA_Variant_clear(&mon->lastValue);
+        /* Reset the last sample */
+        UA_DataValue_clear(&mon->lastValue);
+        mon->lastValueSet = false;
     }
 }
 
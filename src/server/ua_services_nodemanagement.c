@@ -62,6 +62,7 @@ static UA_StatusCode
 editNodeContext(UA_Server *server, UA_Session* session,
                 UA_NodeHead *head, void *context) {
     head->context = context;
+    server->accessCacheGeneration++; /* The context is used for access control */
     return UA_STATUSCODE_GOOD;
 }
 
@@ -411,6 +412,172 @@ isMandatoryChild(UA_Server *server, UA_Session *session,
     return false;
 }
 
+/***************************/
+/* Instantiation Templates */
+/***************************/
+
+static void
+InstanceTemplate_delete(UA_InstanceTemplate *t) {
+    for(size_t i = 0; i < t->childrenSize; i++)
+        UA_ReferenceDescription_clear(&t->children[i].rd);
+    UA_free(t->children);
+    UA_free(t);
+}
+
+static void
+InstanceTemplate_release(UA_InstanceTemplate *t) {
+    UA_assert(t->refCount > 0);
+    t->refCount--;
+    if(t->refCount == 0 && t->removed)
+        InstanceTemplate_delete(t);
+}
+
+void
+UA_InstanceTemplates_clear(UA_InstanceTemplates *it) {
+    for(size_t i = 0; i < it->templates.slotsSize; i++) {
+        UA_NodeIdMapSlot *slot = &it->templates.slots[i];
+        if(slot->hash == 0)
+            continue;
+        UA_InstanceTemplate *t = (UA_InstanceTemplate*)slot->value;
+        if(t->refCount > 0)
+            t->removed = true; /* Deleted after the instantiation */
+        else
+            InstanceTemplate_delete(t);
+    }
+    UA_NodeIdMap_clear(&it->templates);
+    UA_NodeIdMap_clear(&it->sources);
+}
+
+/* The templates depend on the forward references of the nodes they were
+ * derived from and on the inverse HasSubtype references (to the supertypes).
+ * The inverse references that the instantiation adds to the type nodes
+ * (HasTypeDefinition) and shared method nodes don't invalidate them. */
+static void
+instanceTemplatesReferenceChanged(UA_Server *server, const UA_NodeId *nodeId,
+                                  const UA_NodeId *referenceTypeId,
+                                  UA_Boolean isForward) {
+    if(!isForward && !UA_NodeId_equal(referenceTypeId, &subtypeId))
+        return;
+    if(UA_NodeIdMap_find(&server->instanceTemplates.sources, nodeId))
+        UA_InstanceTemplates_clear(&server->instanceTemplates);
+}
+
+/* Browse the children of the source node. For types, the children of the
+ * supertypes and interfaces are appended. */
+static UA_StatusCode
+buildInstanceTemplate(UA_Server *server, UA_InstanceTemplate *t,
+                      size_t hierarchySize, const UA_NodeId *hierarchy) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_AGGREGATES);
+    bd.includeSubtypes = true;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.nodeClassMask = UA_NODECLASS_OBJECT | UA_NODECLASS_VARIABLE | UA_NODECLASS_METHOD;
+    bd.resultMask = UA_BROWSERESULTMASK_REFERENCETYPEID | UA_BROWSERESULTMASK_NODECLASS |
+        UA_BROWSERESULTMASK_BROWSENAME | UA_BROWSERESULTMASK_TYPEDEFINITION;
+
+    for(size_t i = 0; i < hierarchySize; i++) {
+        bd.nodeId = hierarchy[i];
+        UA_BrowseResult br;
+        UA_BrowseResult_init(&br);
+        UA_UInt32 maxrefs = 0;
+        Operation_Browse(server, &server->adminSession, &maxrefs, &bd, &br);
+        if(br.statusCode != UA_STATUSCODE_GOOD)
+            return br.statusCode;
+
+        if(br.referencesSize > 0) {
+            UA_InstanceTemplateChild *children = (UA_InstanceTemplateChild*)
+                UA_realloc(t->children, sizeof(UA_InstanceTemplateChild) *
+                           (t->childrenSize + br.referencesSize));
+            if(!children) {
+                UA_BrowseResult_clear(&br);
+                return UA_STATUSCODE_BADOUTOFMEMORY;
+            }
+            t->children = children;
+        }
+
+        /* Move the ReferenceDescriptions into the template */
+        for(size_t j = 0; j < br.referencesSize; j++) {
+            UA_InstanceTemplateChild *c = &t->children[t->childrenSize];
+            c->rd = br.references[j];
+            UA_ReferenceDescription_init(&br.references[j]);
+            c->mandatory = isMandatoryChild(server, &server->adminSession,
+                                            &c->rd.nodeId.nodeId);
+            t->childrenSize++;
+        }
+        UA_BrowseResult_clear(&br);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Returns the template for the type or InstanceDeclaration. The template has
+ * to be released after the instantiation. */
+static UA_StatusCode
+getInstanceTemplate(UA_Server *server, const UA_NodeId *sourceId,
+                    UA_InstanceTemplate **outTemplate) {
+    UA_InstanceTemplates *it = &server->instanceTemplates;
+
+    /* Cached? */
+    void **cached = UA_NodeIdMap_find(&it->templates, sourceId);
+    if(cached) {
+        UA_InstanceTemplate *t = (UA_InstanceTemplate*)*cached;
+        t->refCount++;
+        *outTemplate = t;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    /* Get the type hierarchy for types */
+    const UA_Node *source = UA_NODESTORE_GET(server, sourceId);
+    if(!source)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    UA_Boolean isType = (source->head.nodeClass == UA_NODECLASS_OBJECTTYPE ||
+                         source->head.nodeClass == UA_NODECLASS_VARIABLETYPE);
+    UA_NODESTORE_RELEASE(server, source);
+
+    UA_NodeId *hierarchy = (UA_NodeId*)(uintptr_t)sourceId;
+    size_t hierarchySize = 1;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(isType) {
+        retval = getParentTypeAndInterfaceHierarchy(server, sourceId,
+                                                    &hierarchy, &hierarchySize);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+        UA_assert(hierarchySize < 1000);
+    }
+
+    /* Create the template */
+    UA_InstanceTemplate *t = (UA_InstanceTemplate*)
+        UA_calloc(1, sizeof(UA_InstanceTemplate));
+    if(!t) {
+        retval = UA_STATUSCODE_BADOUTOFMEMORY;
+        goto cleanup;
+    }
+    t->refCount = 1;
+    retval = buildInstanceTemplate(server, t, hierarchySize, hierarchy);
+    if(retval != UA_STATUSCODE_GOOD) {
+        InstanceTemplate_delete(t);
+        goto cleanup;
+    }
+    *outTemplate = t;
+
+    /* Register the nodes the template depends on. If that fails, the template
+     * is used only once and not cached. */
+    UA_StatusCode res = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < hierarchySize; i++)
+        res |= UA_NodeIdMap_insert(&it->sources, &hierarchy[i], NULL);
+    for(size_t i = 0; i < t->childrenSize; i++)
+        res |= UA_NodeIdMap_insert(&it->sources, &t->children[i].rd.nodeId.nodeId, NULL);
+    if(res == UA_STATUSCODE_GOOD)
+        res = UA_NodeIdMap_insert(&it->templates, sourceId, t);
+    if(res != UA_STATUSCODE_GOOD)
+        t->removed = true;
+
+ cleanup:
+    if(isType)
+        UA_Array_delete(hierarchy, hierarchySize, &UA_TYPES[UA_TYPES_NODEID]);
+    return retval;
+}
+
 static UA_StatusCode
 copyAllChildren(UA_Server *server, UA_Session *session,
                 const UA_NodeId *source, const UA_NodeId *destination);
@@ -425,7 +592,9 @@ Operation_addReference(UA_Server *server, UA_Session *session, void *context,
 
 static UA_StatusCode
 copyChild(UA_Server *server, UA_Session *session, const UA_NodeId *destinationNodeId,
-          const UA_ReferenceDescription *rd) {
+          const UA_InstanceTemplateChild *child) {
+    const UA_ReferenceDescription *rd = &child->rd;
+
     /* Is there an existing child with the browsename? */
     UA_NodeId existingChild = UA_NODEID_NULL;
     UA_StatusCode retval = findChildByBrowsename(server, session, destinationNodeId,
@@ -444,7 +613,7 @@ copyChild(UA_Server *server, UA_Session *session, const UA_NodeId *destinationNo
 
     /* Is the child mandatory? If not, ask callback whether child should be instantiated.
      * If not, skip. */
-    if(!isMandatoryChild(server, session, &rd->nodeId.nodeId)) {
+    if(!child->mandatory) {
         if(!server->config.nodeLifecycle.createOptionalChild)
             return UA_STATUSCODE_GOOD;
 
@@ -520,6 +689,7 @@ copyChild(UA_Server *server, UA_Session *session, const UA_NodeId *destinationNo
         retval = UA_NODESTORE_INSERT(server, node, &newNodeId);
         if(retval != UA_STATUSCODE_GOOD)
             return retval;
+        server->modelVersion++;
 
         /* Add the node references */
         retval = AddNode_addRefs(server, session, &newNodeId, destinationNodeId,
@@ -538,61 +708,30 @@ copyChild(UA_Server *server, UA_Session *session, const UA_NodeId *destinationNo
     return retval;
 }
 
-/* Copy any children of Node sourceNodeId to another node destinationNodeId. */
+/* Copy any children of Node sourceNodeId to another node destinationNodeId.
+ * For types, the children of the supertypes are copied as well. */
 static UA_StatusCode
 copyAllChildren(UA_Server *server, UA_Session *session,
                 const UA_NodeId *source, const UA_NodeId *destination) {
-    /* Browse to get all children of the source */
-    UA_BrowseDescription bd;
-    UA_BrowseDescription_init(&bd);
-    bd.nodeId = *source;
-    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_AGGREGATES);
-    bd.includeSubtypes = true;
-    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
-    bd.nodeClassMask = UA_NODECLASS_OBJECT | UA_NODECLASS_VARIABLE | UA_NODECLASS_METHOD;
-    bd.resultMask = UA_BROWSERESULTMASK_REFERENCETYPEID | UA_BROWSERESULTMASK_NODECLASS |
-        UA_BROWSERESULTMASK_BROWSENAME | UA_BROWSERESULTMASK_TYPEDEFINITION;
-
-    UA_BrowseResult br;
-    UA_BrowseResult_init(&br);
-    UA_UInt32 maxrefs = 0;
-    Operation_Browse(server, session, &maxrefs, &bd, &br);
-    if(br.statusCode != UA_STATUSCODE_GOOD)
-        return br.statusCode;
+    UA_InstanceTemplate *t = NULL;
+    UA_StatusCode retval = getInstanceTemplate(server, source, &t);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
 
-    UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    for(size_t i = 0; i < br.referencesSize; ++i) {
-        UA_ReferenceDescription *rd = &br.references[i];
-        retval = copyChild(server, session, destination, rd);
+    for(size_t i = 0; i < t->childrenSize; ++i) {
+        retval = copyChild(server, session, destination, &t->children[i]);
         if(retval != UA_STATUSCODE_GOOD)
-            return retval;
+            break;
     }
 
-    UA_BrowseResult_clear(&br);
+    InstanceTemplate_release(t);
     return retval;
 }
 
 static UA_StatusCode
 addTypeChildren(UA_Server *server, UA_Session *session,
                 const UA_NodeHead *head, const UA_NodeHead *typeHead) {
-    /* Get the hierarchy of the type and all its supertypes */
-    UA_NodeId *hierarchy = NULL;
-    size_t hierarchySize = 0;
-    UA_StatusCode retval = getParentTypeAndInterfaceHierarchy(server, &typeHead->nodeId,
-                                                              &hierarchy, &hierarchySize);
-    if(retval != UA_STATUSCODE_GOOD)
-        return retval;
-    UA_assert(hierarchySize < 1000);
-
-    /* Copy members of the type and supertypes (and instantiate them) */
-    for(size_t i = 0; i < hierarchySize; ++i) {
-        retval = copyAllChildren(server, session, &hierarchy[i], &head->nodeId);
-        if(retval != UA_STATUSCODE_GOOD)
-            break;
-    }
-
-    UA_Array_delete(hierarchy, hierarchySize, &UA_TYPES[UA_TYPES_NODEID]);
-    return retval;
+    return copyAllChildren(server, session, &typeHead->nodeId, &head->nodeId);
 }
 
 static UA_StatusCode
@@ -907,12 +1046,15 @@ AddNode_raw(UA_Server *server, UA_Session *session, void *nodeContext,
 
     /* Add the node to the nodestore */
     retval = UA_NODESTORE_INSERT(server, node, outNewNodeId);
-    if(retval != UA_STATUSCODE_GOOD)
+    if(retval != UA_STATUSCODE_GOOD) {
         UA_LOG_INFO_SESSION(&server->config.logger, session,
                             "AddNodes: Node could not add the new node "
                             "to the nodestore with error code %s",
                             UA_StatusCode_name(retval));
-    return retval;
+        return retval;
+    }
+    server->modelVersion++;
+    return UA_STATUSCODE_GOOD;
 
 create_error:
     UA_LOG_INFO_SESSION(&server->config.logger, session,
@@ -1296,11 +1438,13 @@ Service_AddNodes(UA_Server *server, UA_Session *session,
         return;
     }
 
+    UA_Server_beginNodeBatch(server);
     response->responseHeader.serviceResult =
         UA_Server_processServiceOperations(server, session,
                                            (UA_ServiceOperation)Operation_addNode, NULL,
                                            &request->nodesToAddSize, &UA_TYPES[UA_TYPES_ADDNODESITEM],
                                            &response->resultsSize, &UA_TYPES[UA_TYPES_ADDNODESRESULT]);
+    UA_Server_endNodeBatch(server);
 }
 
 UA_StatusCode
@@ -1352,6 +1496,27 @@ __UA_Server_addNode(UA_Server *server, const UA_NodeClass nodeClass,
     return reval;
 }
 
+UA_StatusCode
+UA_Server_addNodes(UA_Server *server, size_t nodesToAddSize,
+                   const UA_AddNodesItem *nodesToAdd,
+                   UA_AddNodesResult **results) {
+    UA_AddNodesResult *res = (UA_AddNodesResult*)
+        UA_Array_new(nodesToAddSize, &UA_TYPES[UA_TYPES_ADDNODESRESULT]);
+    if(!res)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    UA_LOCK(server->serviceMutex);
+    UA_Server_beginNodeBatch(server);
+    for(size_t i = 0; i < nodesToAddSize; i++)
+        Operation_addNode(server, &server->adminSession, NULL,
+                          &nodesToAdd[i], &res[i]);
+    UA_Server_endNodeBatch(server);
+    UA_UNLOCK(server->serviceMutex);
+
+    *results = res;
+    return UA_STATUSCODE_GOOD;
+}
+
 UA_StatusCode
 UA_Server_addNode_begin(UA_Server *server, const UA_NodeClass nodeClass,
                         const UA_NodeId requestedNewNodeId, const UA_NodeId parentNodeId,
@@ -1559,7 +1724,16 @@ recursiveDeleteNode(UA_Server *server, UA_Session *session, size_t hierarchicalR
     if(removeTargetRefs)
         removeIncomingReferences(server, session, head);
 
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* The next sample reports that the node is gone */
+    UA_MonitoredItem_sampleOnWrite(server, &head->nodeId);
+#endif
+
+    if(UA_NodeIdMap_find(&server->instanceTemplates.sources, &head->nodeId))
+        UA_InstanceTemplates_clear(&server->instanceTemplates);
+    UA_TypeHierarchy_removeNode(server, &head->nodeId);
     UA_NODESTORE_REMOVE(server, &head->nodeId);
+    server->modelVersion++;
 }
 
 static void
@@ -1613,6 +1787,10 @@ deleteNodeOperation(UA_Server *server, UA_Session *session, void *context,
     recursiveDeconstructNode(server, session, hierarchicalRefsSize, hierarchicalRefs, &node->head);
     recursiveDeleteNode(server, session, hierarchicalRefsSize, hierarchicalRefs, &node->head,
                         item->deleteTargetReferences);
+
+    /* Don't reuse cached access control decisions if a node with the same
+     * NodeId is added later on */
+    server->accessCacheGeneration++;
     UA_Array_delete(hierarchicalRefs, hierarchicalRefsSize, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
     
     UA_NODESTORE_RELEASE(server, node);
@@ -1632,12 +1810,35 @@ Service_DeleteNodes(UA_Server *server, UA_Session *session,
         return;
     }
 
+    UA_Server_beginNodeBatch(server);
     response->responseHeader.serviceResult =
         UA_Server_processServiceOperations(server, session,
                                            (UA_ServiceOperation)deleteNodeOperation,
                                            NULL, &request->nodesToDeleteSize,
                                            &UA_TYPES[UA_TYPES_DELETENODESITEM],
                                            &response->resultsSize, &UA_TYPES[UA_TYPES_STATUSCODE]);
+    UA_Server_endNodeBatch(server);
+}
+
+UA_StatusCode
+UA_Server_deleteNodes(UA_Server *server, size_t nodesToDeleteSize,
+                      const UA_DeleteNodesItem *nodesToDelete,
+                      UA_StatusCode **results) {
+    UA_StatusCode *res = (UA_StatusCode*)
+        UA_Array_new(nodesToDeleteSize, &UA_TYPES[UA_TYPES_STATUSCODE]);
+    if(!res)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    UA_LOCK(server->serviceMutex);
+    UA_Server_beginNodeBatch(server);
+    for(size_t i = 0; i < nodesToDeleteSize; i++)
+        deleteNodeOperation(server, &server->adminSession, NULL,
+                            &nodesToDelete[i], &res[i]);
+    UA_Server_endNodeBatch(server);
+    UA_UNLOCK(server->serviceMutex);
+
+    *results = res;
+    return UA_STATUSCODE_GOOD;
 }
 
 UA_StatusCode
@@ -1673,13 +1874,26 @@ struct AddNodeInfo {
 static UA_StatusCode
 addOneWayReference(UA_Server *server, UA_Session *session,
                    UA_Node *node, const struct AddNodeInfo *info) {
-    return UA_Node_addReference(node, info->item, info->browseNameHash);
+    UA_StatusCode res = UA_Node_addReference(node, info->item, info->browseNameHash);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    server->modelVersion++;
+    instanceTemplatesReferenceChanged(server, &node->head.nodeId,
+                                      &info->item->referenceTypeId,
+                                      info->item->isForward);
+    return UA_STATUSCODE_GOOD;
 }
 
 static UA_StatusCode
 deleteOneWayReference(UA_Server *server, UA_Session *session, UA_Node *node,
                       const UA_DeleteReferencesItem *item) {
-    return UA_Node_deleteReference(node, item);
+    UA_StatusCode res = UA_Node_deleteReference(node, item);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    server->modelVersion++;
+    instanceTemplatesReferenceChanged(server, &node->head.nodeId,
+                                      &item->referenceTypeId, item->isForward);
+    return UA_STATUSCODE_GOOD;
 }
 
 static void
@@ -1727,7 +1941,10 @@ Operation_addReference(UA_Server *server, UA_Session *session, void *context,
     *retval = UA_Server_editNode(server, session, &item->sourceNodeId,
                                  (UA_EditNodeCallback)addOneWayReference, &info);
     UA_Boolean firstExisted = false;
-    if(*retval == UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED) {
+    if(*retval == UA_STATUSCODE_GOOD) {
+        UA_TypeHierarchy_addReference(server, &item->sourceNodeId, &item->referenceTypeId,
+                                      item->isForward, &item->targetNodeId.nodeId);
+    } else if(*retval == UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED) {
         *retval = UA_STATUSCODE_GOOD;
         firstExisted = true;
     } else if(*retval != UA_STATUSCODE_GOOD) {
@@ -1751,7 +1968,11 @@ Operation_addReference(UA_Server *server, UA_Session *session, void *context,
 
     /* remove reference if the second direction failed */
     UA_Boolean secondExisted = false;
-    if(*retval == UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED) {
+    if(*retval == UA_STATUSCODE_GOOD) {
+        UA_TypeHierarchy_addReference(server, &secondItem.sourceNodeId,
+                                      &secondItem.referenceTypeId, secondItem.isForward,
+                                      &secondItem.targetNodeId.nodeId);
+    } else if(*retval == UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED) {
         *retval = UA_STATUSCODE_GOOD;
         secondExisted = true;
     } else if(*retval != UA_STATUSCODE_GOOD && !firstExisted) {
@@ -1762,8 +1983,13 @@ Operation_addReference(UA_Server *server, UA_Session *session, void *context,
         deleteItem.targetNodeId = item->targetNodeId;
         deleteItem.deleteBidirectional = false;
         /* ignore returned status code */
-        UA_Server_editNode(server, session, &item->sourceNodeId,
-                           (UA_EditNodeCallback)deleteOneWayReference, &deleteItem);
+        UA_StatusCode res =
+            UA_Server_editNode(server, session, &item->sourceNodeId,
+                               (UA_EditNodeCallback)deleteOneWayReference, &deleteItem);
+        if(res == UA_STATUSCODE_GOOD)
+            UA_TypeHierarchy_deleteReference(server, &item->sourceNodeId,
+                                             &item->referenceTypeId, item->isForward,
+                                             &item->targetNodeId.nodeId);
     }
 
     /* Calculate common duplicate reference not allowed result and set bad result
@@ -1840,6 +2066,8 @@ Operation_deleteReference(UA_Server *server, UA_Session *session, void *context,
                                  (UA_DeleteReferencesItem *)(uintptr_t)item);
     if(*retval != UA_STATUSCODE_GOOD)
         return;
+    UA_TypeHierarchy_deleteReference(server, &item->sourceNodeId, &item->referenceTypeId,
+                                     item->isForward, &item->targetNodeId.nodeId);
 
     if(!item->deleteBidirectional || item->targetNodeId.serverIndex != 0)
         return;
@@ -1853,6 +2081,10 @@ Operation_deleteReference(UA_Server *server, UA_Session *session, void *context,
     *retval = UA_Server_editNode(server, session, &secondItem.sourceNodeId,
                                  (UA_EditNodeCallback)deleteOneWayReference,
                                  &secondItem);
+    if(*retval == UA_STATUSCODE_GOOD)
+        UA_TypeHierarchy_deleteReference(server, &secondItem.sourceNodeId,
+                                         &secondItem.referenceTypeId, secondItem.isForward,
+                                         &secondItem.targetNodeId.nodeId);
 }
 
 void
@@ -1920,6 +2152,11 @@ UA_Server_setVariableNode_valueCallback(UA_Server *server,
                                               (UA_EditNodeCallback)setValueCallback,
                                               /* cast away const because callback uses const anyway */
                                               (UA_ValueCallback *)(uintptr_t) &callback);
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* The value can now change in the onRead callback */
+    if(retval == UA_STATUSCODE_GOOD)
+        UA_MonitoredItem_updateSampleCallbacks(server, &nodeId);
+#endif
     UA_UNLOCK(server->serviceMutex);
     return retval;
 }
@@ -1997,10 +2234,17 @@ UA_StatusCode
 setVariableNode_dataSource(UA_Server *server, const UA_NodeId nodeId,
                                      const UA_DataSource dataSource) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
-    return UA_Server_editNode(server, &server->adminSession, &nodeId,
-                              (UA_EditNodeCallback)setDataSource,
-                              /* casting away const because callback casts it back anyway */
-                              (UA_DataSource *) (uintptr_t)&dataSource);
+    UA_StatusCode retval =
+        UA_Server_editNode(server, &server->adminSession, &nodeId,
+                           (UA_EditNodeCallback)setDataSource,
+                           /* casting away const because callback casts it back anyway */
+                           (UA_DataSource *) (uintptr_t)&dataSource);
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* The value is no longer written into the node */
+    if(retval == UA_STATUSCODE_GOOD)
+        UA_MonitoredItem_updateSampleCallbacks(server, &nodeId);
+#endif
+    return retval;
 }
 
 UA_StatusCode
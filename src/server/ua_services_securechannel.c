@@ -22,6 +22,9 @@ removeSecureChannelCallback(void *_, channel_entry *entry) {
     UA_SecureChannel_close(&entry->channel);
 }
 
+static void
+deleteSecureChannelDelayed(UA_Server *server, channel_entry *entry);
+
 /* Half-closes the channel. Will be completely closed / deleted in a deferred
  * callback. Deferring is necessary so we don't remove lists that are still
  * processed upwards the call stack. */
@@ -42,6 +45,9 @@ removeSecureChannel(UA_Server *server, channel_entry *entry,
     /* Detach the channel */
     TAILQ_REMOVE(&server->channels, entry, pointers);
 
+    /* Release the handshake slot */
+    UA_Server_completeHandshake(server, &entry->channel);
+
     /* Update the statistics */
     UA_SecureChannelStatistics *scs = &server->serverStats.scs;
     UA_atomic_subSize(&scs->currentChannelCount, 1);
@@ -66,6 +72,18 @@ removeSecureChannel(UA_Server *server, channel_entry *entry,
         break;
     }
 
+#if UA_MULTITHREADING >= 200
+    /* A worker thread processes the channel. The channel is freed when the
+     * worker is done. */
+    if(entry->processing)
+        return;
+#endif
+
+    deleteSecureChannelDelayed(server, entry);
+}
+
+static void
+deleteSecureChannelDelayed(UA_Server *server, channel_entry *entry) {
     /* Add a delayed callback to remove the channel when the currently
      * scheduled jobs have completed */
     entry->cleanupCallback.callback = (UA_ApplicationCallback)removeSecureChannelCallback;
@@ -87,13 +105,26 @@ UA_Server_cleanupTimedOutSecureChannels(UA_Server *server,
                                         UA_DateTime nowMonotonic) {
     channel_entry *entry, *temp;
     TAILQ_FOREACH_SAFE(entry, &server->channels, pointers, temp) {
-        /* The channel was closed internally */
-        if(entry->channel.state == UA_SECURECHANNELSTATE_CLOSED ||
+        /* The channel was closed internally. A new channel is also in the
+         * closed state until the OPN is processed. But it has no channelId
+         * yet. */
+        if((entry->channel.state == UA_SECURECHANNELSTATE_CLOSED &&
+            entry->channel.securityToken.channelId != 0) ||
            !entry->channel.connection) {
             removeSecureChannel(server, entry, UA_DIAGNOSTICEVENT_CLOSE);
             continue;
         }
 
+        /* The handshake has timed out. Release the slot so that the channel
+         * does not block further handshakes. */
+        if(entry->handshake && server->config.handshakeTimeout > 0 &&
+           entry->handshakeDeadline < nowMonotonic) {
+            UA_LOG_INFO_CHANNEL(&server->config.logger, &entry->channel,
+                                "No Session was activated before the handshake "
+                                "timeout. Releasing the handshake slot.");
+            UA_Server_completeHandshake(server, &entry->channel);
+        }
+
         /* The channel has timed out */
         UA_DateTime timeout =
             entry->channel.securityToken.createdAt +
@@ -122,6 +153,20 @@ purgeFirstChannelWithoutSession(UA_Server *server) {
     return false;
 }
 
+#if UA_MULTITHREADING >= 100
+static void
+lockServiceMutex(void *application) {
+    UA_Server *server = (UA_Server*)application;
+    UA_LOCK(server->serviceMutex);
+}
+
+static void
+unlockServiceMutex(void *application) {
+    UA_Server *server = (UA_Server*)application;
+    UA_UNLOCK(server->serviceMutex);
+}
+#endif
+
 UA_StatusCode
 UA_Server_createSecureChannel(UA_Server *server, UA_Connection *connection) {
     /* connection already has a channel attached. */
@@ -151,6 +196,22 @@ UA_Server_createSecureChannel(UA_Server *server, UA_Connection *connection) {
     entry->channel.securityToken.revisedLifetime = server->config.maxSecurityTokenLifetime;
     entry->channel.certificateVerification = &server->config.certificateVerification;
     entry->channel.processOPNHeader = UA_Server_configSecureChannel;
+    entry->handshake = false;
+    entry->handshakeDeadline = 0;
+#if UA_MULTITHREADING >= 100
+    entry->channel.lockContext = server;
+    entry->channel.lock = lockServiceMutex;
+    entry->channel.unlock = unlockServiceMutex;
+#endif
+#if UA_MULTITHREADING >= 200
+    entry->processing = false;
+    entry->asymCryptoUnlocked = false;
+    entry->pending = UA_BYTESTRING_NULL;
+    if(server->config.parallelChunkCrypto)
+        entry->channel.cryptoWorkQueue = &server->workQueue;
+    entry->channel.beginAsymCrypto = UA_Server_beginAsymCrypto;
+    entry->channel.endAsymCrypto = UA_Server_endAsymCrypto;
+#endif
 
     TAILQ_INSERT_TAIL(&server->channels, entry, pointers);
     UA_Connection_attachSecureChannel(connection, &entry->channel);
@@ -185,6 +246,25 @@ UA_Server_configSecureChannel(void *application, UA_SecureChannel *channel,
     if(!securityPolicy)
         return UA_STATUSCODE_BADSECURITYPOLICYREJECTED;
 
+    /* Admission control for secured handshakes. This is called for the first
+     * OPN chunk before the certificate is verified and before the asymmetric
+     * decryption. So rejected handshakes don't cost any RSA operations. */
+    channel_entry *entry = container_of(channel, channel_entry, channel);
+    if(!UA_ByteString_equal(&securityPolicy->policyUri, &UA_SECURITY_POLICY_NONE_URI)) {
+        if(server->config.maxConcurrentHandshakes > 0 &&
+           server->handshakesInProgress >= server->config.maxConcurrentHandshakes) {
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SECURECHANNEL,
+                           "Rejecting the OpenSecureChannel request. Too many "
+                           "handshakes in progress.");
+            UA_atomic_addSize(&server->serverStats.scs.rejectedChannelCount, 1);
+            return UA_STATUSCODE_BADTCPSERVERTOOBUSY;
+        }
+        entry->handshake = true;
+        entry->handshakeDeadline = UA_DateTime_nowMonotonic() +
+            (UA_DateTime)server->config.handshakeTimeout * UA_DATETIME_MSEC;
+        server->handshakesInProgress++;
+    }
+
     /* Create the channel context and parse the sender (remote) certificate used for the
      * secureChannel. */
     UA_StatusCode retval =
@@ -197,6 +277,58 @@ UA_Server_configSecureChannel(void *application, UA_SecureChannel *channel,
     return UA_STATUSCODE_GOOD;
 }
 
+void
+UA_Server_completeHandshake(UA_Server *server, UA_SecureChannel *channel) {
+    channel_entry *entry = container_of(channel, channel_entry, channel);
+    if(!entry->handshake)
+        return;
+    entry->handshake = false;
+    server->handshakesInProgress--;
+}
+
+#if UA_MULTITHREADING >= 200
+
+/* Only the processing thread accesses the channel during the handshake. Other
+ * threads can only remove the channel. The channel memory (and the channel
+ * context of the SecurityPolicy) is freed only after the processing has ended.
+ * Once a Session is activated, the publish responses may be sent in parallel.
+ * Then the mutex is kept for the OPN messages to keep the sequence numbers in
+ * order. */
+void
+UA_Server_beginAsymCrypto(void *application, UA_SecureChannel *channel) {
+    UA_Server *server = (UA_Server*)application;
+    channel_entry *entry = container_of(channel, channel_entry, channel);
+    entry->asymCryptoUnlocked = entry->processing &&
+        (entry->handshake || channel->state != UA_SECURECHANNELSTATE_OPEN);
+    if(entry->asymCryptoUnlocked) {
+        UA_UNLOCK(server->serviceMutex);
+    }
+}
+
+UA_StatusCode
+UA_Server_endAsymCrypto(void *application, UA_SecureChannel *channel) {
+    UA_Server *server = (UA_Server*)application;
+    channel_entry *entry = container_of(channel, channel_entry, channel);
+    if(!entry->asymCryptoUnlocked)
+        return UA_STATUSCODE_GOOD;
+    UA_LOCK(server->serviceMutex);
+    entry->asymCryptoUnlocked = false;
+    if(channel->state == UA_SECURECHANNELSTATE_CLOSING)
+        return UA_STATUSCODE_BADSECURECHANNELCLOSED;
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_Server_endChannelProcessing(UA_Server *server, channel_entry *entry) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
+    entry->processing = false;
+    UA_ByteString_clear(&entry->pending);
+    if(entry->channel.state == UA_SECURECHANNELSTATE_CLOSING)
+        deleteSecureChannelDelayed(server, entry);
+}
+
+#endif
+
 static UA_StatusCode
 UA_SecureChannelManager_open(UA_Server *server, UA_SecureChannel *channel,
                              const UA_OpenSecureChannelRequest *request,
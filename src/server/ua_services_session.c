@@ -149,6 +149,19 @@ getSessionByToken(UA_Server *server, const UA_NodeId *token) {
     return NULL;
 }
 
+void
+UA_Server_invalidateAccessControlCache(UA_Server *server, const UA_NodeId *sessionId) {
+    UA_LOCK(server->serviceMutex);
+    if(!sessionId) {
+        server->accessCacheGeneration++;
+    } else {
+        UA_Session *session = UA_Server_getSessionById(server, sessionId);
+        if(session)
+            UA_Session_clearAccessCache(session);
+    }
+    UA_UNLOCK(server->serviceMutex);
+}
+
 UA_Session *
 UA_Server_getSessionById(UA_Server *server, const UA_NodeId *sessionId) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
@@ -203,8 +216,10 @@ signCreateSessionResponse(UA_Server *server, UA_SecureChannel *channel,
     memcpy(dataToSign.data, request->clientCertificate.data, request->clientCertificate.length);
     memcpy(dataToSign.data + request->clientCertificate.length,
            request->clientNonce.data, request->clientNonce.length);
+    UA_Server_beginAsymCrypto(server, channel);
     retval = securityPolicy->certificateSigningAlgorithm.
         sign(securityPolicy, channel->channelContext, &dataToSign, &signatureData->signature);
+    retval |= UA_Server_endAsymCrypto(server, channel);
 
     /* Clean up */
     UA_ByteString_clear(&dataToSign);
@@ -224,8 +239,13 @@ UA_Server_createSession(UA_Server *server, UA_SecureChannel *channel,
     if(!newentry)
         return UA_STATUSCODE_BADOUTOFMEMORY;
 
-    UA_atomic_addUInt32(&server->sessionCount, 1);
     UA_Session_init(&newentry->session);
+    if(UA_Session_initAccessCache(&newentry->session,
+                                  server->config.accessControlCacheSize) != UA_STATUSCODE_GOOD) {
+        UA_free(newentry);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    UA_atomic_addUInt32(&server->sessionCount, 1);
     newentry->session.sessionId = UA_NODEID_GUID(1, UA_Guid_random());
     newentry->session.header.authenticationToken = UA_NODEID_GUID(1, UA_Guid_random());
 
@@ -387,7 +407,7 @@ Service_CreateSession(UA_Server *server, UA_SecureChannel *channel,
 }
 
 static UA_StatusCode
-checkSignature(const UA_Server *server, const UA_SecureChannel *channel,
+checkSignature(UA_Server *server, UA_SecureChannel *channel,
                UA_Session *session, const UA_ActivateSessionRequest *request) {
     if(channel->securityMode != UA_MESSAGESECURITYMODE_SIGN &&
        channel->securityMode != UA_MESSAGESECURITYMODE_SIGNANDENCRYPT)
@@ -412,9 +432,11 @@ checkSignature(const UA_Server *server, const UA_SecureChannel *channel,
     memcpy(dataToVerify.data, localCertificate->data, localCertificate->length);
     memcpy(dataToVerify.data + localCertificate->length,
            session->serverNonce.data, session->serverNonce.length);
+    UA_Server_beginAsymCrypto(server, channel);
     retval = securityPolicy->certificateSigningAlgorithm.
         verify(securityPolicy, channel->channelContext, &dataToVerify,
                &request->clientSignature.signature);
+    retval |= UA_Server_endAsymCrypto(server, channel);
     UA_ByteString_clear(&dataToVerify);
     return retval;
 }
@@ -655,9 +677,19 @@ Service_ActivateSession(UA_Server *server, UA_SecureChannel *channel,
                }
            }
 
-           /* Decrypt */
+           /* Decrypt. The nonce is copied as the session can be modified
+            * while the service mutex is released for the decryption. */
+           UA_ByteString serverNonce;
            response->responseHeader.serviceResult =
-               decryptPassword(securityPolicy, tempChannelContext, &session->serverNonce, userToken);
+               UA_ByteString_copy(&session->serverNonce, &serverNonce);
+           if(response->responseHeader.serviceResult == UA_STATUSCODE_GOOD) {
+               UA_Server_beginAsymCrypto(server, channel);
+               response->responseHeader.serviceResult =
+                   decryptPassword(securityPolicy, tempChannelContext, &serverNonce, userToken);
+               response->responseHeader.serviceResult |=
+                   UA_Server_endAsymCrypto(server, channel);
+               UA_ByteString_clear(&serverNonce);
+           }
 
            /* Remove the temporary channel context */
            if(securityPolicy != channel->securityPolicy)
@@ -673,6 +705,14 @@ Service_ActivateSession(UA_Server *server, UA_SecureChannel *channel,
 #endif
     }
 
+    /* The Session might have been removed while the service mutex was released
+     * for the asymmetric crypto operations. The memory is freed only after the
+     * current worker job. */
+    if(getSessionByToken(server, &request->requestHeader.authenticationToken) != session) {
+        response->responseHeader.serviceResult = UA_STATUSCODE_BADSESSIONIDINVALID;
+        goto rejected;
+    }
+
     /* Callback into userland access control */
     response->responseHeader.serviceResult =
         server->config.accessControl.
@@ -685,6 +725,9 @@ Service_ActivateSession(UA_Server *server, UA_SecureChannel *channel,
         goto rejected;
     }
 
+    /* The user identity may have changed */
+    UA_Session_clearAccessCache(session);
+
     /* Attach the session to the currently used channel if the session isn't
      * attached to a channel or if the session is activated on a different
      * channel than it is attached to. */
@@ -715,6 +758,9 @@ Service_ActivateSession(UA_Server *server, UA_SecureChannel *channel,
         UA_atomic_addSize(&server->serverStats.ss.cumulatedSessionCount, 1);
     }
 
+    /* The handshake of the channel is complete */
+    UA_Server_completeHandshake(server, channel);
+
     UA_LOG_INFO_SESSION(&server->config.logger, session, "ActivateSession: Session activated");
     return;
 
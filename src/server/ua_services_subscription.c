@@ -17,6 +17,7 @@
  */
 
 #include "ua_server_internal.h"
+#include "ua_types_encoding_binary.h"
 #include "ua_services.h"
 #include "ua_subscription.h"
 
@@ -234,7 +235,8 @@ Service_Publish(UA_Server *server, UA_Session *session,
             continue;
         }
         /* Remove the acked transmission from the retransmission queue */
-        response->results[i] = UA_Subscription_removeRetransmissionMessage(sub, ack->sequenceNumber);
+        response->results[i] =
+            UA_Subscription_removeRetransmissionMessage(server, sub, ack->sequenceNumber);
     }
 
     /* Queue the publish response. It will be dequeued in a repeated publish
@@ -348,7 +350,7 @@ Service_Republish(UA_Server *server, UA_Session *session,
     /* Find the notification in the retransmission queue  */
     UA_NotificationMessageEntry *entry;
     TAILQ_FOREACH(entry, &sub->retransmissionQueue, listEntry) {
-        if(entry->message.sequenceNumber == request->retransmitSequenceNumber)
+        if(entry->sequenceNumber == request->retransmitSequenceNumber)
             break;
     }
     if(!entry) {
@@ -356,8 +358,15 @@ Service_Republish(UA_Server *server, UA_Session *session,
         return;
     }
 
+    /* Decode the retransmission message. Republishing is rare. So the
+     * notifications are retained in their encoded form. */
+    UA_ByteString message;
+    UA_RetransmissionStore_getMessage(server, entry, &message);
+    size_t offset = 0;
     response->responseHeader.serviceResult =
-        UA_NotificationMessage_copy(&entry->message, &response->notificationMessage);
+        UA_decodeBinary(&message, &offset, &response->notificationMessage,
+                        &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE],
+                        server->config.customDataTypes);
 }
 
 #endif /* UA_ENABLE_SUBSCRIPTIONS */
@@ -254,6 +254,33 @@ browseRecursive(UA_Server *server,
     return UA_STATUSCODE_GOOD;
 }
 
+/* Append the NodeIds of the types in the set */
+static UA_StatusCode
+appendTypeSet(UA_Server *server, const UA_TypeSet *set,
+              size_t *refTypesSize, UA_NodeId **refTypes) {
+    const UA_TypeHierarchy *th = &server->typeHierarchy;
+    size_t count = 0;
+    for(size_t i = 0; i < th->entriesSize && i / 64 < set->wordsSize; i++) {
+        if((set->words[i / 64] >> (i % 64)) & 1)
+            count++;
+    }
+
+    UA_NodeId *newRt = (UA_NodeId*)
+        UA_realloc(*refTypes, (*refTypesSize + count) * sizeof(UA_NodeId));
+    if(!newRt)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    *refTypes = newRt;
+
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < th->entriesSize && i / 64 < set->wordsSize; i++) {
+        if(!((set->words[i / 64] >> (i % 64)) & 1))
+            continue;
+        retval |= UA_NodeId_copy(&th->entries[i].nodeId, &newRt[*refTypesSize]);
+        (*refTypesSize)++;
+    }
+    return retval;
+}
+
 /* Only if IncludeSubtypes is selected */
 UA_StatusCode
 referenceSubtypes(UA_Server *server, const UA_NodeId *refType,
@@ -262,12 +289,23 @@ referenceSubtypes(UA_Server *server, const UA_NodeId *refType,
     if(UA_NodeId_isNull(refType))
         return UA_STATUSCODE_GOOD;
 
+    /* Take the hierarchy of sub-references from the index */
+    UA_TypeSet set;
+    UA_StatusCode retval = UA_TypeHierarchy_subtypeSet(server, refType, &set);
+    if(retval != UA_STATUSCODE_BADNOTFOUND) {
+        if(retval == UA_STATUSCODE_GOOD) {
+            retval = appendTypeSet(server, &set, refTypesSize, refTypes);
+            UA_TypeSet_clear(&set);
+        }
+        return retval;
+    }
+
     /* Browse recursive for the hierarchy of sub-references */
     UA_ExpandedNodeId *rt = NULL;
     size_t rtSize = 0;
     UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
-    UA_StatusCode retval = browseRecursive(server, 1, refType, 1, &hasSubtype,
-                                           UA_BROWSEDIRECTION_FORWARD, true, &rtSize, &rt);
+    retval = browseRecursive(server, 1, refType, 1, &hasSubtype,
+                             UA_BROWSEDIRECTION_FORWARD, true, &rtSize, &rt);
     if(retval != UA_STATUSCODE_GOOD)
         return retval;
 
@@ -382,6 +420,7 @@ struct ContinuationPoint {
 
     size_t relevantReferencesSize;
     UA_NodeId *relevantReferences;
+    UA_TypeSet relevantSet; /* Used instead of the array if words != NULL */
 
     /* The last point in the node references? */
     size_t referenceKindIndex;
@@ -394,10 +433,20 @@ ContinuationPoint_clear(ContinuationPoint *cp) {
     UA_BrowseDescription_clear(&cp->browseDescription);
     UA_Array_delete(cp->relevantReferences, cp->relevantReferencesSize,
                     &UA_TYPES[UA_TYPES_NODEID]);
+    UA_TypeSet_clear(&cp->relevantSet);
     return cp->next;
 }
 
-/* Target node on top of the stack */
+static UA_Boolean
+cpRelevantReference(UA_Server *server, const ContinuationPoint *cp,
+                    const UA_NodeId *refType) {
+    if(cp->relevantSet.words)
+        return UA_TypeSet_contains(server, &cp->relevantSet, refType);
+    return relevantReference(refType, cp->relevantReferencesSize,
+                             cp->relevantReferences);
+}
+
+/* The target node is NULL if no node attributes are requested */
 static UA_StatusCode UA_FUNC_ATTR_WARN_UNUSED_RESULT
 addReferenceDescription(UA_Server *server, RefResult *rr, const UA_NodeReferenceKind *ref,
                         UA_UInt32 mask, const UA_ExpandedNodeId *nodeId, const UA_Node *curr) {
@@ -418,13 +467,9 @@ addReferenceDescription(UA_Server *server, RefResult *rr, const UA_NodeReference
     if(mask & UA_BROWSERESULTMASK_ISFORWARD)
         descr->isForward = !ref->isInverse;
 
-    /* Remote references (ExpandedNodeId) are not further looked up here */
-    if(!curr) {
-        UA_ReferenceDescription_clear(descr);
-        return retval;
-    }
-    
     /* Fields that require the actual node */
+    if(!curr)
+        goto done;
     if(mask & UA_BROWSERESULTMASK_NODECLASS)
         descr->nodeClass = curr->head.nodeClass;
     if(mask & UA_BROWSERESULTMASK_BROWSENAME)
@@ -442,6 +487,7 @@ addReferenceDescription(UA_Server *server, RefResult *rr, const UA_NodeReference
         }
     }
 
+ done:
     if(retval == UA_STATUSCODE_GOOD)
         rr->size++; /* Increase the counter */
     else
@@ -457,18 +503,47 @@ matchClassMask(const UA_Node *node, UA_UInt32 nodeClassMask) {
     return true;
 }
 
-/* Returns whether the node / continuationpoint is done */
+/* Number of targets that are looked up in one call to the nodestore */
+#define UA_BROWSE_BATCHSIZE 64
+
+/* The target nodes are only looked up if their attributes are part of the
+ * result or if they are filtered by the NodeClass */
+static UA_Boolean
+browseNeedsTargetNode(const UA_BrowseDescription *bd) {
+    if(bd->nodeClassMask != UA_NODECLASS_UNSPECIFIED &&
+       (bd->nodeClassMask & 0xFF) != 0xFF)
+        return true;
+    return (bd->resultMask & (UA_BROWSERESULTMASK_NODECLASS |
+                              UA_BROWSERESULTMASK_BROWSENAME |
+                              UA_BROWSERESULTMASK_DISPLAYNAME |
+                              UA_BROWSERESULTMASK_TYPEDEFINITION)) != 0;
+}
+
+static void
+releaseNodes(UA_Server *server, const UA_Node **nodes, size_t nodesSize) {
+    for(size_t i = 0; i < nodesSize; i++) {
+        if(nodes[i])
+            UA_NODESTORE_RELEASE(server, nodes[i]);
+    }
+}
+
+/* Returns whether the node / continuationpoint is done. The targets are
+ * collected in batches and looked up together in the nodestore. */
 static UA_StatusCode
 browseReferences(UA_Server *server, const UA_NodeHead *head,
                  ContinuationPoint *cp, RefResult *rr, UA_Boolean *done) {
     UA_assert(cp != NULL);
     const UA_BrowseDescription *bd= &cp->browseDescription;
+    UA_Boolean needNode = browseNeedsTargetNode(bd);
 
     size_t referenceKindIndex = cp->referenceKindIndex;
     size_t targetIndex = cp->targetIndex;
 
+    const UA_NodeId *ids[UA_BROWSE_BATCHSIZE];
+    const UA_Node *targets[UA_BROWSE_BATCHSIZE];
+    size_t positions[UA_BROWSE_BATCHSIZE];
+
     /* Loop over the node's references */
-    const UA_Node *target = NULL;
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     for(; referenceKindIndex < head->referencesSize; ++referenceKindIndex) {
         UA_NodeReferenceKind *rk = &head->references[referenceKindIndex];
@@ -480,43 +555,57 @@ browseReferences(UA_Server *server, const UA_NodeHead *head,
             continue;
 
         /* Is the reference part of the hierarchy of references we look for? */
-        if(!relevantReference(&rk->referenceTypeId, cp->relevantReferencesSize,
-                              cp->relevantReferences))
+        if(!cpRelevantReference(server, cp, &rk->referenceTypeId))
             continue;
 
-        /* Loop over the targets */
-        for(; targetIndex < rk->refTargetsSize; ++targetIndex) {
-            target = NULL;
+        /* Loop over the targets in batches */
+        while(targetIndex < rk->refTargetsSize) {
+            /* Collect the batch. Remote references (ExpandedNodeId) are not
+             * looked up. Their NodeId in the batch is NULL. */
+            size_t batchSize = 0;
+            for(; targetIndex < rk->refTargetsSize &&
+                    batchSize < UA_BROWSE_BATCHSIZE; ++targetIndex) {
+                const UA_ExpandedNodeId *targetId = &rk->refTargets[targetIndex].targetId;
+                if(targetId->serverIndex != 0 || targetId->namespaceUri.data != NULL)
+                    ids[batchSize] = NULL;
+                else
+                    ids[batchSize] = &targetId->nodeId;
+                targets[batchSize] = NULL;
+                positions[batchSize] = targetIndex;
+                batchSize++;
+            }
 
-            /* Get the node if it is not a remote reference */
-            if(rk->refTargets[targetIndex].targetId.serverIndex == 0 &&
-               rk->refTargets[targetIndex].targetId.namespaceUri.data == NULL) {
-                target = UA_NODESTORE_GET(server,
-                                          &rk->refTargets[targetIndex].targetId.nodeId);
+            /* Get the target nodes */
+            if(needNode)
+                UA_Nodestore_getNodes(server, batchSize, ids, targets);
 
-                /* Test if the node class matches */
-                if(target && !matchClassMask(target, bd->nodeClassMask)) {
-                    if(target)
-                        UA_NODESTORE_RELEASE(server, target);
+            for(size_t i = 0; i < batchSize; i++) {
+                /* Test if the node class matches. Remote and dangling targets
+                 * (not found in the nodestore) are returned without the
+                 * attributes of the target node. */
+                if(targets[i] && !matchClassMask(targets[i], bd->nodeClassMask)) {
+                    UA_NODESTORE_RELEASE(server, targets[i]);
                     continue;
                 }
-            }
 
-            /* A match! Did we reach maxrefs? */
-            if(rr->size >= cp->maxReferences) {
-                cp->referenceKindIndex = referenceKindIndex;
-                cp->targetIndex = targetIndex;
-                if(target)
-                    UA_NODESTORE_RELEASE(server, target);
-                return UA_STATUSCODE_GOOD;
-            }
+                /* A match! Did we reach maxrefs? */
+                if(rr->size >= cp->maxReferences) {
+                    cp->referenceKindIndex = referenceKindIndex;
+                    cp->targetIndex = positions[i];
+                    releaseNodes(server, &targets[i], batchSize - i);
+                    return UA_STATUSCODE_GOOD;
+                }
 
-            /* Copy the node description. Target is on top of the stack */
-            retval = addReferenceDescription(server, rr, rk, bd->resultMask,
-                                             &rk->refTargets[targetIndex].targetId, target);
-            UA_NODESTORE_RELEASE(server, target);
-            if(retval != UA_STATUSCODE_GOOD)
-                return retval;
+                /* Copy the node description */
+                retval = addReferenceDescription(server, rr, rk, bd->resultMask,
+                                                 &rk->refTargets[positions[i]].targetId,
+                                                 targets[i]);
+                releaseNodes(server, &targets[i], 1);
+                if(retval != UA_STATUSCODE_GOOD) {
+                    releaseNodes(server, &targets[i + 1], batchSize - i - 1);
+                    return retval;
+                }
+            }
         }
 
         targetIndex = 0; /* Start at index 0 for the next reference kind */
@@ -567,13 +656,23 @@ browseWithContinuation(UA_Server *server, UA_Session *session,
         return true;
     }
 
-    if(session != &server->adminSession &&
-       !server->config.accessControl.allowBrowseNode(server, &server->config.accessControl,
-                                                     &session->sessionId, session->sessionHandle,
-                                                     &descr->nodeId, node->head.context)) {
-        result->statusCode = UA_STATUSCODE_BADUSERACCESSDENIED;
-        UA_NODESTORE_RELEASE(server, node);
-        return true;
+    if(session != &server->adminSession) {
+        UA_UInt32 allowed;
+        if(!UA_Session_getCachedAccess(server, session, UA_ACCESSCACHE_BROWSENODE,
+                                       &descr->nodeId, &allowed)) {
+            UA_UInt32 generation = server->accessCacheGeneration;
+            allowed = server->config.accessControl.
+                allowBrowseNode(server, &server->config.accessControl,
+                                &session->sessionId, session->sessionHandle,
+                                &descr->nodeId, node->head.context);
+            UA_Session_cacheAccess(session, generation, UA_ACCESSCACHE_BROWSENODE,
+                                   &descr->nodeId, allowed);
+        }
+        if(!allowed) {
+            result->statusCode = UA_STATUSCODE_BADUSERACCESSDENIED;
+            UA_NODESTORE_RELEASE(server, node);
+            return true;
+        }
     }
 
     RefResult rr;
@@ -635,9 +734,15 @@ Operation_Browse(UA_Server *server, UA_Session *session, const UA_UInt32 *maxref
             cp->relevantReferences = (UA_NodeId*)(uintptr_t)&descr->referenceTypeId;
             cp->relevantReferencesSize = 1;
         } else {
+            /* Prefer a bitset from the type hierarchy index */
             result->statusCode =
-                referenceSubtypes(server, &descr->referenceTypeId,
-                                  &cp->relevantReferencesSize, &cp->relevantReferences);
+                UA_TypeHierarchy_subtypeSet(server, &descr->referenceTypeId,
+                                            &cp->relevantSet);
+            if(result->statusCode == UA_STATUSCODE_BADNOTFOUND)
+                result->statusCode =
+                    referenceSubtypes(server, &descr->referenceTypeId,
+                                      &cp->relevantReferencesSize,
+                                      &cp->relevantReferences);
             if(result->statusCode != UA_STATUSCODE_GOOD)
                 return;
         }
@@ -647,9 +752,11 @@ Operation_Browse(UA_Server *server, UA_Session *session, const UA_UInt32 *maxref
 
     /* Exit early if done or an error occurred */
     if(done || result->statusCode != UA_STATUSCODE_GOOD) {
-        if(descr->includeSubtypes)
+        if(descr->includeSubtypes) {
             UA_Array_delete(cp->relevantReferences, cp->relevantReferencesSize,
                             &UA_TYPES[UA_TYPES_NODEID]);
+            UA_TypeSet_clear(&cp->relevantSet);
+        }
         return;
     }
 
@@ -679,6 +786,7 @@ Operation_Browse(UA_Server *server, UA_Session *session, const UA_UInt32 *maxref
     if(descr->includeSubtypes) {
         cp2->relevantReferences = cp->relevantReferences;
         cp2->relevantReferencesSize = cp->relevantReferencesSize;
+        cp2->relevantSet = cp->relevantSet;
     } else {
         retval = UA_Array_copy(cp->relevantReferences, cp->relevantReferencesSize,
                                (void**)&cp2->relevantReferences, &UA_TYPES[UA_TYPES_NODEID]);
@@ -717,6 +825,10 @@ Operation_Browse(UA_Server *server, UA_Session *session, const UA_UInt32 *maxref
     if(cp2) {
         ContinuationPoint_clear(cp2);
         UA_free(cp2);
+    } else if(descr->includeSubtypes) {
+        UA_Array_delete(cp->relevantReferences, cp->relevantReferencesSize,
+                        &UA_TYPES[UA_TYPES_NODEID]);
+        UA_TypeSet_clear(&cp->relevantSet);
     }
     UA_BrowseResult_clear(result);
     result->statusCode = retval;
@@ -832,19 +944,6 @@ UA_Server_browseNext(UA_Server *server, UA_Boolean releaseContinuationPoint,
 /* TranslateBrowsePath */
 /***********************/
 
-static UA_StatusCode
-addBrowseTarget(RefTree *next, const UA_ReferenceTarget *rt) {
-    UA_assert(rt);
-    UA_StatusCode res = RefTree_add(next, &rt->targetId);
-    UA_ReferenceTarget *left = ZIP_LEFT(rt, nameTreeFields);
-    if(left && left->targetNameHash == rt->targetNameHash)
-        res |= addBrowseTarget(next, left);
-    UA_ReferenceTarget *right = ZIP_RIGHT(rt, nameTreeFields);
-    if(right && right->targetNameHash == rt->targetNameHash)
-        res |= addBrowseTarget(next, right);
-    return res;
-}
-
 static UA_StatusCode
 walkBrowsePathElement(UA_Server *server, UA_Session *session,
                       const UA_RelativePath *path, const size_t pathIndex, UA_UInt32 nodeClassMask,
@@ -930,12 +1029,13 @@ walkBrowsePathElement(UA_Server *server, UA_Session *session,
             }
 
             /* Retrieve by BrowseName hash */
-            UA_ReferenceTarget *rt = ZIP_FIND(UA_ReferenceTargetNameTree,
-                                              &rk->refTargetsNameTree, &browseNameHash);
-            if(!rt)
-                continue;
-
-            res = addBrowseTarget(next, rt);
+            size_t iter = 0;
+            const UA_ReferenceTarget *rt;
+            while((rt = UA_NodeReferenceKind_findTargetByName(rk, browseNameHash, &iter))) {
+                res = RefTree_add(next, &rt->targetId);
+                if(res != UA_STATUSCODE_GOOD)
+                    break;
+            }
             if(res != UA_STATUSCODE_GOOD)
                 break;
         }
@@ -1063,6 +1163,95 @@ Operation_TranslateBrowsePathToNodeIds(UA_Server *server, UA_Session *session,
     }
 }
 
+/**********************/
+/* BrowsePath Caching */
+/**********************/
+
+static void
+BrowsePathCacheEntry_clear(UA_BrowsePathCacheEntry *entry) {
+    UA_NodeId_clear(&entry->startingNode);
+    UA_RelativePath_clear(&entry->relativePath);
+    UA_BrowsePathResult_clear(&entry->result);
+    entry->modelVersion = 0;
+}
+
+void
+UA_BrowsePathCache_delete(UA_BrowsePathCacheEntry *cache) {
+    if(!cache)
+        return;
+    for(size_t i = 0; i < UA_BROWSEPATHCACHE_SIZE; i++)
+        BrowsePathCacheEntry_clear(&cache[i]);
+    UA_free(cache);
+}
+
+static UA_UInt32
+browsePathHash(const UA_BrowsePath *path, UA_UInt32 nodeClassMask) {
+    UA_UInt32 h = UA_NodeId_hash(&path->startingNode);
+    h = UA_ByteString_hash(h, (const UA_Byte*)&nodeClassMask, sizeof(UA_UInt32));
+    for(size_t i = 0; i < path->relativePath.elementsSize; i++) {
+        const UA_RelativePathElement *elem = &path->relativePath.elements[i];
+        UA_UInt32 eh[3];
+        eh[0] = UA_NodeId_hash(&elem->referenceTypeId);
+        eh[1] = UA_QualifiedName_hash(&elem->targetName);
+        eh[2] = (UA_UInt32)elem->isInverse | ((UA_UInt32)elem->includeSubtypes << 1);
+        h = UA_ByteString_hash(h, (const UA_Byte*)eh, sizeof(eh));
+    }
+    return h;
+}
+
+/* Returns the result from the cache or resolves the BrowsePath and stores the
+ * result in the cache. */
+static void
+Operation_TranslateBrowsePathToNodeIdsCached(UA_Server *server, UA_Session *session,
+                                             const UA_UInt32 *nodeClassMask,
+                                             const UA_BrowsePath *path,
+                                             UA_BrowsePathResult *result) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
+
+    /* Allocate the cache on first use */
+    if(!server->browsePathCache) {
+        server->browsePathCache = (UA_BrowsePathCacheEntry*)
+            UA_calloc(UA_BROWSEPATHCACHE_SIZE, sizeof(UA_BrowsePathCacheEntry));
+        if(!server->browsePathCache) {
+            Operation_TranslateBrowsePathToNodeIds(server, session, nodeClassMask,
+                                                   path, result);
+            return;
+        }
+    }
+
+    /* Cache hit? */
+    UA_UInt32 h = browsePathHash(path, *nodeClassMask);
+    UA_BrowsePathCacheEntry *entry = &server->browsePathCache[h % UA_BROWSEPATHCACHE_SIZE];
+    if(entry->modelVersion == server->modelVersion && entry->hash == h &&
+       entry->nodeClassMask == *nodeClassMask &&
+       UA_NodeId_equal(&entry->startingNode, &path->startingNode) &&
+       UA_equal(&entry->relativePath, &path->relativePath,
+                &UA_TYPES[UA_TYPES_RELATIVEPATH])) {
+        UA_StatusCode res = UA_BrowsePathResult_copy(&entry->result, result);
+        if(res != UA_STATUSCODE_GOOD)
+            result->statusCode = res;
+        return;
+    }
+
+    /* Resolve the BrowsePath */
+    Operation_TranslateBrowsePathToNodeIds(server, session, nodeClassMask, path, result);
+    if(result->statusCode == UA_STATUSCODE_BADOUTOFMEMORY)
+        return;
+
+    /* Replace the cache entry */
+    BrowsePathCacheEntry_clear(entry);
+    UA_StatusCode res = UA_NodeId_copy(&path->startingNode, &entry->startingNode);
+    res |= UA_RelativePath_copy(&path->relativePath, &entry->relativePath);
+    res |= UA_BrowsePathResult_copy(result, &entry->result);
+    if(res != UA_STATUSCODE_GOOD) {
+        BrowsePathCacheEntry_clear(entry);
+        return;
+    }
+    entry->hash = h;
+    entry->nodeClassMask = *nodeClassMask;
+    entry->modelVersion = server->modelVersion;
+}
+
 UA_BrowsePathResult
 translateBrowsePathToNodeIds(UA_Server *server,
                                        const UA_BrowsePath *browsePath) {
@@ -1078,8 +1267,12 @@ translateBrowsePathToNodeIds(UA_Server *server,
 UA_BrowsePathResult
 UA_Server_translateBrowsePathToNodeIds(UA_Server *server,
                                        const UA_BrowsePath *browsePath) {
+    UA_BrowsePathResult result;
+    UA_BrowsePathResult_init(&result);
+    UA_UInt32 nodeClassMask = 0; /* All node classes */
     UA_LOCK(server->serviceMutex);
-    UA_BrowsePathResult result = translateBrowsePathToNodeIds(server, browsePath);
+    Operation_TranslateBrowsePathToNodeIdsCached(server, &server->adminSession,
+                                                 &nodeClassMask, browsePath, &result);
     UA_UNLOCK(server->serviceMutex);
     return result;
 }
@@ -1102,7 +1295,7 @@ Service_TranslateBrowsePathsToNodeIds(UA_Server *server, UA_Session *session,
     UA_UInt32 nodeClassMask = 0; /* All node classes */
     response->responseHeader.serviceResult =
         UA_Server_processServiceOperations(server, session,
-                                           (UA_ServiceOperation)Operation_TranslateBrowsePathToNodeIds,
+                                           (UA_ServiceOperation)Operation_TranslateBrowsePathToNodeIdsCached,
                                            &nodeClassMask,
                                            &request->browsePathsSize, &UA_TYPES[UA_TYPES_BROWSEPATH],
                                            &response->resultsSize, &UA_TYPES[UA_TYPES_BROWSEPATHRESULT]);
@@ -38,6 +38,75 @@ void UA_Session_deleteMembersCleanup(UA_Session *session, UA_Server* server) {
     }
     session->continuationPoints = NULL;
     session->availableContinuationPoints = UA_MAXCONTINUATIONPOINTS;
+    UA_Session_clearAccessCache(session);
+    UA_free(session->accessCache);
+    session->accessCache = NULL;
+    session->accessCacheSize = 0;
+}
+
+UA_StatusCode
+UA_Session_initAccessCache(UA_Session *session, size_t cacheSize) {
+    if(cacheSize == 0)
+        return UA_STATUSCODE_GOOD;
+    session->accessCache = (UA_AccessCacheEntry*)
+        UA_calloc(cacheSize, sizeof(UA_AccessCacheEntry));
+    if(!session->accessCache)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    session->accessCacheSize = cacheSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_Session_clearAccessCache(UA_Session *session) {
+    for(size_t i = 0; i < session->accessCacheSize; i++) {
+        UA_AccessCacheEntry *e = &session->accessCache[i];
+        if(e->kind == 0)
+            continue;
+        UA_NodeId_clear(&e->nodeId);
+        e->kind = 0;
+    }
+}
+
+static UA_AccessCacheEntry *
+accessCacheSlot(const UA_Session *session, UA_AccessCacheKind kind,
+                const UA_NodeId *nodeId) {
+    UA_UInt32 h = UA_NodeId_hash(nodeId) + (UA_UInt32)kind * 2654435761u;
+    return &session->accessCache[h % session->accessCacheSize];
+}
+
+UA_Boolean
+UA_Session_getCachedAccess(UA_Server *server, const UA_Session *session,
+                           UA_AccessCacheKind kind, const UA_NodeId *nodeId,
+                           UA_UInt32 *value) {
+    if(!session->accessCache)
+        return false;
+    UA_AccessCacheEntry *e = accessCacheSlot(session, kind, nodeId);
+    if(e->kind != (UA_Byte)kind || e->generation != server->accessCacheGeneration ||
+       !UA_NodeId_equal(&e->nodeId, nodeId)) {
+        UA_atomic_addSize(&server->serverStats.ss.accessCacheMissCount, 1);
+        return false;
+    }
+    *value = e->value;
+    UA_atomic_addSize(&server->serverStats.ss.accessCacheHitCount, 1);
+    return true;
+}
+
+void
+UA_Session_cacheAccess(const UA_Session *session, UA_UInt32 generation,
+                       UA_AccessCacheKind kind, const UA_NodeId *nodeId,
+                       UA_UInt32 value) {
+    if(!session->accessCache)
+        return;
+    UA_AccessCacheEntry *e = accessCacheSlot(session, kind, nodeId);
+    if(e->kind == 0 || !UA_NodeId_equal(&e->nodeId, nodeId)) {
+        UA_NodeId_clear(&e->nodeId);
+        e->kind = 0;
+        if(UA_NodeId_copy(nodeId, &e->nodeId) != UA_STATUSCODE_GOOD)
+            return;
+    }
+    e->kind = (UA_Byte)kind;
+    e->generation = generation;
+    e->value = value;
 }
 
 void
@@ -35,6 +35,23 @@ typedef struct UA_PublishResponseEntry {
 } UA_PublishResponseEntry;
 #endif
 
+/* Cached decision of the access control plugin. The entries are tagged with the
+ * server-wide generation counter. Incrementing the counter invalidates the
+ * caches of all Sessions. */
+typedef enum {
+    UA_ACCESSCACHE_USERRIGHTSMASK = 1,
+    UA_ACCESSCACHE_USERACCESSLEVEL,
+    UA_ACCESSCACHE_USEREXECUTABLE,
+    UA_ACCESSCACHE_BROWSENODE
+} UA_AccessCacheKind;
+
+typedef struct {
+    UA_NodeId nodeId;
+    UA_UInt32 generation;
+    UA_UInt32 value;
+    UA_Byte kind; /* Zero for empty entries */
+} UA_AccessCacheEntry;
+
 typedef struct {
     UA_SessionHeader  header;
     UA_ApplicationDescription clientDescription;
@@ -49,6 +66,8 @@ typedef struct {
     UA_ByteString     serverNonce;
     UA_UInt16 availableContinuationPoints;
     ContinuationPoint *continuationPoints;
+    UA_AccessCacheEntry *accessCache; /* Direct-mapped, NULL if disabled */
+    size_t accessCacheSize;
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     UA_UInt32 lastSubscriptionId;
     UA_UInt32 lastSeenSubscriptionId;
@@ -73,6 +92,34 @@ UA_StatusCode UA_Session_generateNonce(UA_Session *session);
 /* If any activity on a session happens, the timeout is extended */
 void UA_Session_updateLifetime(UA_Session *session);
 
+/**
+ * Access Control Cache
+ * --------------------
+ * The decisions of the access control plugin are cached per Session if
+ * ``accessControlCacheSize`` is set in the server config. */
+
+UA_StatusCode
+UA_Session_initAccessCache(UA_Session *session, size_t cacheSize);
+
+/* Remove all entries. For example when the user identity has changed. */
+void
+UA_Session_clearAccessCache(UA_Session *session);
+
+/* Returns true and sets the value if a valid entry was found */
+UA_Boolean
+UA_Session_getCachedAccess(UA_Server *server, const UA_Session *session,
+                           UA_AccessCacheKind kind, const UA_NodeId *nodeId,
+                           UA_UInt32 *value);
+
+/* The generation is the accessCacheGeneration of the server before the
+ * AccessControl callback was called. The mutex is released during the
+ * callback. If the cache is invalidated in the meantime, then the entry is
+ * stored as already outdated. */
+void
+UA_Session_cacheAccess(const UA_Session *session, UA_UInt32 generation,
+                       UA_AccessCacheKind kind, const UA_NodeId *nodeId,
+                       UA_UInt32 value);
+
 /**
  * Subscription handling
  * --------------------- */
@@ -18,10 +18,17 @@
  */
 
 #include "ua_server_internal.h"
+#include "ua_types_encoding_binary.h"
 #include "ua_subscription.h"
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS /* conditional compilation */
 
+#ifdef UA_ARCHITECTURE_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 UA_Subscription *
 UA_Subscription_new(UA_Session *session, UA_UInt32 subscriptionId) {
     /* Allocate the memory */
@@ -38,16 +45,39 @@ UA_Subscription_new(UA_Session *session, UA_UInt32 subscriptionId) {
      * This can happen by a subscription without a monitored item (see CTT test scripts). */
     newSub->nextSequenceNumber = 1;
     TAILQ_INIT(&newSub->retransmissionQueue);
-    TAILQ_INIT(&newSub->notificationQueue);
     return newSub;
 }
 
+/* Remove the entry from the Subscription and the server-wide store */
+static void
+removeRetransmissionEntry(UA_Server *server, UA_NotificationMessageEntry *entry) {
+    UA_Subscription *sub = entry->sub;
+    UA_RetransmissionStore *store = &server->retransmissionStore;
+    TAILQ_REMOVE(&sub->retransmissionQueue, entry, listEntry);
+    --sub->session->totalRetransmissionQueueSize;
+    --sub->retransmissionQueueSize;
+    if(entry->spilled) {
+        TAILQ_REMOVE(&store->spilled, entry, serverEntry);
+    } else {
+        TAILQ_REMOVE(&store->inMemory, entry, serverEntry);
+        store->inMemoryBytes -= entry->message.length;
+        UA_free(entry->message.data);
+    }
+    UA_free(entry);
+}
+
 void
 UA_Subscription_deleteMembers(UA_Server *server, UA_Subscription *sub) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
 
     Subscription_unregisterPublishCallback(server, sub);
 
+    /* Drop the order of the notifications up front. So the MonitoredItems are
+     * not removed from it one by one. */
+    sub->notificationOrder.size = 0;
+    sub->dataChangeNotifications = 0;
+    sub->eventNotifications = 0;
+
     /* Delete monitored Items */
     UA_MonitoredItem *mon, *tmp_mon;
     LIST_FOREACH_SAFE(mon, &sub->monitoredItems, listEntry, tmp_mon) {
@@ -61,16 +91,12 @@ UA_Subscription_deleteMembers(UA_Server *server, UA_Subscription *sub) {
     UA_assert(server->numMonitoredItems >= sub->monitoredItemsSize);
     server->numMonitoredItems -= sub->monitoredItemsSize;
     sub->monitoredItemsSize = 0;
+    UA_PointerRing_clear(&sub->notificationOrder);
 
     /* Delete Retransmission Queue */
     UA_NotificationMessageEntry *nme, *nme_tmp;
-    TAILQ_FOREACH_SAFE(nme, &sub->retransmissionQueue, listEntry, nme_tmp) {
-        TAILQ_REMOVE(&sub->retransmissionQueue, nme, listEntry);
-        UA_NotificationMessage_clear(&nme->message);
-        UA_free(nme);
-        --sub->session->totalRetransmissionQueueSize;
-        --sub->retransmissionQueueSize;
-    }
+    TAILQ_FOREACH_SAFE(nme, &sub->retransmissionQueue, listEntry, nme_tmp)
+        removeRetransmissionEntry(server, nme);
     UA_assert(sub->retransmissionQueueSize == 0);
 
     UA_LOG_INFO_SESSION(&server->config.logger, sub->session,
@@ -128,29 +154,172 @@ UA_Subscription_addMonitoredItem(UA_Server *server, UA_Subscription *sub, UA_Mon
 }
 
 static void
-removeOldestRetransmissionMessage(UA_Session *session) {
+removeOldestRetransmissionMessage(UA_Server *server, UA_Session *session) {
     UA_NotificationMessageEntry *oldestEntry = NULL;
-    UA_Subscription *oldestSub = NULL;
 
     UA_Subscription *sub;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
-        UA_NotificationMessageEntry *first =
-            TAILQ_LAST(&sub->retransmissionQueue, ListOfNotificationMessages);
+        UA_NotificationMessageEntry *first = TAILQ_FIRST(&sub->retransmissionQueue);
         if(!first)
             continue;
-        if(!oldestEntry || oldestEntry->message.publishTime > first->message.publishTime) {
+        if(!oldestEntry || oldestEntry->publishTime > first->publishTime)
             oldestEntry = first;
-            oldestSub = sub;
-        }
     }
     UA_assert(oldestEntry);
-    UA_assert(oldestSub);
+    removeRetransmissionEntry(server, oldestEntry);
+}
+
+#ifdef UA_ARCHITECTURE_POSIX
+
+/* The spill file is unlinked right after opening. So it does not outlive the
+ * server process. */
+static UA_Boolean
+openSpillFile(UA_Server *server, UA_RetransmissionStore *store) {
+    const UA_String *path = &server->config.retransmissionSpillFile;
+    size_t size = server->config.retransmissionSpillFileSize;
+    if(store->spillFailed || path->length == 0 || size == 0)
+        return false;
+
+    char *filename = (char*)UA_malloc(path->length + 1);
+    if(!filename) {
+        store->spillFailed = true;
+        return false;
+    }
+    memcpy(filename, path->data, path->length);
+    filename[path->length] = 0;
+
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if(fd >= 0)
+        unlink(filename);
+    UA_free(filename);
+    void *map = MAP_FAILED;
+    if(fd >= 0 && ftruncate(fd, (off_t)size) == 0)
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "Could not open the retransmission spill file %.*s",
+                       (int)path->length, (char*)path->data);
+        if(fd >= 0)
+            close(fd);
+        store->spillFailed = true;
+        return false;
+    }
+
+    store->spillFd = fd;
+    store->spillMap = (UA_Byte*)map;
+    store->spillMapSize = size;
+    store->spillTail = 0;
+    return true;
+}
+
+/* Find space for the message in the ring. Returns false if there is not enough
+ * contiguous space without overwriting spilled messages. */
+static UA_Boolean
+allocateSpillSpace(UA_RetransmissionStore *store, size_t length, size_t *offset) {
+    UA_NotificationMessageEntry *first = TAILQ_FIRST(&store->spilled);
+    if(!first) {
+        store->spillTail = 0; /* The ring is empty */
+        if(length > store->spillMapSize)
+            return false;
+        *offset = 0;
+        return true;
+    }
+
+    size_t head = first->spillOffset;
+    if(store->spillTail > head) {
+        /* Free space at the end and (after wrapping around) at the start */
+        if(store->spillMapSize - store->spillTail >= length) {
+            *offset = store->spillTail;
+            return true;
+        }
+        if(head >= length) {
+            *offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    /* Wrapped around. The free space is between the tail and the head. */
+    if(head - store->spillTail >= length) {
+        *offset = store->spillTail;
+        return true;
+    }
+    return false;
+}
+
+static UA_Boolean
+spillRetransmissionEntry(UA_Server *server, UA_NotificationMessageEntry *entry) {
+    UA_RetransmissionStore *store = &server->retransmissionStore;
+    if(!store->spillMap && !openSpillFile(server, store))
+        return false;
+    if(entry->message.length > store->spillMapSize)
+        return false;
+
+    /* Evict the oldest spilled messages until the message fits */
+    size_t offset = 0;
+    while(!allocateSpillSpace(store, entry->message.length, &offset)) {
+        UA_NotificationMessageEntry *oldest = TAILQ_FIRST(&store->spilled);
+        UA_LOG_WARNING_SESSION(&server->config.logger, oldest->sub->session,
+                               "Subscription %" PRIu32 " | Retransmission spill "
+                               "file overflow", oldest->sub->subscriptionId);
+        removeRetransmissionEntry(server, oldest);
+    }
+
+    /* Move the message to the spill file */
+    memcpy(&store->spillMap[offset], entry->message.data, entry->message.length);
+    store->spillTail = offset + entry->message.length;
+    TAILQ_REMOVE(&store->inMemory, entry, serverEntry);
+    store->inMemoryBytes -= entry->message.length;
+    UA_free(entry->message.data);
+    entry->message.data = NULL;
+    entry->spilled = true;
+    entry->spillOffset = offset;
+    TAILQ_INSERT_TAIL(&store->spilled, entry, serverEntry);
+    return true;
+}
+
+#else
+
+static UA_Boolean
+spillRetransmissionEntry(UA_Server *server, UA_NotificationMessageEntry *entry) {
+    (void)server;
+    (void)entry;
+    return false;
+}
 
-    TAILQ_REMOVE(&oldestSub->retransmissionQueue, oldestEntry, listEntry);
-    UA_NotificationMessage_clear(&oldestEntry->message);
-    UA_free(oldestEntry);
-    --session->totalRetransmissionQueueSize;
-    --oldestSub->retransmissionQueueSize;
+#endif
+
+void
+UA_RetransmissionStore_init(UA_RetransmissionStore *store) {
+    memset(store, 0, sizeof(UA_RetransmissionStore));
+    TAILQ_INIT(&store->inMemory);
+    TAILQ_INIT(&store->spilled);
+    store->spillFd = -1;
+}
+
+void
+UA_RetransmissionStore_clear(UA_RetransmissionStore *store) {
+    /* The entries are removed together with the Subscriptions */
+    UA_assert(TAILQ_EMPTY(&store->inMemory));
+    UA_assert(TAILQ_EMPTY(&store->spilled));
+#ifdef UA_ARCHITECTURE_POSIX
+    if(store->spillMap) {
+        munmap(store->spillMap, store->spillMapSize);
+        close(store->spillFd);
+    }
+#endif
+    UA_RetransmissionStore_init(store);
+}
+
+void
+UA_RetransmissionStore_getMessage(UA_Server *server,
+                                  const UA_NotificationMessageEntry *entry,
+                                  UA_ByteString *message) {
+    message->length = entry->message.length;
+    if(entry->spilled)
+        message->data = &server->retransmissionStore.spillMap[entry->spillOffset];
+    else
+        message->data = entry->message.data;
 }
 
 static void
@@ -161,180 +330,297 @@ UA_Subscription_addRetransmissionMessage(UA_Server *server, UA_Subscription *sub
        sub->session->totalRetransmissionQueueSize >= server->config.maxRetransmissionQueueSize) {
         UA_LOG_WARNING_SESSION(&server->config.logger, sub->session, "Subscription %" PRIu32 " | "
                                "Retransmission queue overflow", sub->subscriptionId);
-        removeOldestRetransmissionMessage(sub->session);
+        removeOldestRetransmissionMessage(server, sub->session);
     }
 
     /* Add entry */
+    UA_RetransmissionStore *store = &server->retransmissionStore;
+    entry->sub = sub;
+    entry->spilled = false;
+    entry->spillOffset = 0;
     TAILQ_INSERT_TAIL(&sub->retransmissionQueue, entry, listEntry);
+    TAILQ_INSERT_TAIL(&store->inMemory, entry, serverEntry);
+    store->inMemoryBytes += entry->message.length;
     ++sub->session->totalRetransmissionQueueSize;
     ++sub->retransmissionQueueSize;
 }
 
+/* Spill or drop the oldest messages to stay within the memory budget */
+static void
+enforceRetransmissionBudget(UA_Server *server) {
+    UA_RetransmissionStore *store = &server->retransmissionStore;
+    size_t maxBytes = server->config.maxRetransmissionQueueBytes;
+    while(maxBytes > 0 && store->inMemoryBytes > maxBytes) {
+        UA_NotificationMessageEntry *oldest = TAILQ_FIRST(&store->inMemory);
+        if(spillRetransmissionEntry(server, oldest))
+            continue;
+        UA_LOG_WARNING_SESSION(&server->config.logger, oldest->sub->session,
+                               "Subscription %" PRIu32 " | Retransmission queue "
+                               "exceeds the memory budget", oldest->sub->subscriptionId);
+        removeRetransmissionEntry(server, oldest);
+    }
+}
+
 UA_StatusCode
-UA_Subscription_removeRetransmissionMessage(UA_Subscription *sub, UA_UInt32 sequenceNumber) {
+UA_Subscription_removeRetransmissionMessage(UA_Server *server, UA_Subscription *sub,
+                                            UA_UInt32 sequenceNumber) {
     /* Find the retransmission message */
     UA_NotificationMessageEntry *entry;
     TAILQ_FOREACH(entry, &sub->retransmissionQueue, listEntry) {
-        if(entry->message.sequenceNumber == sequenceNumber)
+        if(entry->sequenceNumber == sequenceNumber)
             break;
     }
     if(!entry)
         return UA_STATUSCODE_BADSEQUENCENUMBERUNKNOWN;
 
     /* Remove the retransmission message */
-    TAILQ_REMOVE(&sub->retransmissionQueue, entry, listEntry);
-    --sub->session->totalRetransmissionQueueSize;
-    --sub->retransmissionQueueSize;
-    UA_NotificationMessage_clear(&entry->message);
-    UA_free(entry);
+    removeRetransmissionEntry(server, entry);
     return UA_STATUSCODE_GOOD;
 }
 
+/* Binary encoding of the ExtensionObject header for a body of known length */
+static size_t
+extensionObjectHeaderSize(const UA_DataType *type) {
+    UA_NodeId typeId = UA_NODEID_NUMERIC(0, type->binaryEncodingId);
+    return UA_calcSizeBinary(&typeId, &UA_TYPES[UA_TYPES_NODEID]) +
+        sizeof(UA_Byte) + sizeof(UA_Int32);
+}
+
 static UA_StatusCode
-prepareNotificationMessage(UA_Server *server, UA_Subscription *sub,
-                           UA_NotificationMessage *message, size_t notifications) {
+encodeExtensionObjectHeader(const UA_DataType *type, size_t bodyLength,
+                            UA_Byte **bufPos, const UA_Byte *bufEnd) {
+    UA_NodeId typeId = UA_NODEID_NUMERIC(0, type->binaryEncodingId);
+    UA_Byte encoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
+    UA_Int32 length = (UA_Int32)bodyLength;
+    UA_StatusCode retval =
+        UA_encodeBinary(&typeId, &UA_TYPES[UA_TYPES_NODEID], bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&encoding, &UA_TYPES[UA_TYPES_BYTE], bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&length, &UA_TYPES[UA_TYPES_INT32], bufPos, &bufEnd, NULL, NULL);
+    return retval;
+}
+
+/* Get the i-th notification in the order of the Subscription. Called for i = 0,
+ * 1, 2, ... after the cursors were reset. */
+static UA_Notification *
+getNotificationInOrder(UA_Subscription *sub, UA_UInt32 i) {
+    UA_MonitoredItem *mon = (UA_MonitoredItem*)
+        UA_PointerRing_get(&sub->notificationOrder, i);
+    return (UA_Notification*)UA_PointerRing_get(&mon->queue, mon->publishCursor++);
+}
+
+static void
+resetPublishCursors(UA_Subscription *sub, UA_UInt32 notifications) {
+    for(UA_UInt32 i = 0; i < notifications; i++) {
+        UA_MonitoredItem *mon = (UA_MonitoredItem*)
+            UA_PointerRing_get(&sub->notificationOrder, i);
+        mon->publishCursor = 0;
+    }
+}
+
+/* Encode the NotificationMessage for the next notifications from the queue. The
+ * notifications are encoded directly from the queue without an intermediate
+ * NotificationMessage structure. The encoded length is computed first, so that
+ * the buffer is allocated only once. The notifications are removed from the
+ * queue only if the encoding succeeds. */
+static UA_StatusCode
+encodeNotificationMessage(UA_Server *server, UA_Subscription *sub,
+                          UA_UInt32 sequenceNumber, UA_DateTime publishTime,
+                          size_t notifications, UA_ByteString *encoded) {
     UA_assert(notifications > 0);
 
-    /* Allocate an ExtensionObject for events and data */
-    message->notificationData = (UA_ExtensionObject*)
-        UA_Array_new(2, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
-    if(!message->notificationData)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
-    message->notificationDataSize = 2;
-
-    /* Pre-allocate DataChangeNotifications */
-    size_t notificationDataIdx = 0;
-    UA_DataChangeNotification *dcn = NULL;
-    if(sub->dataChangeNotifications > 0) {
-        dcn = UA_DataChangeNotification_new();
-        if(!dcn) {
-            UA_NotificationMessage_clear(message);
-            return UA_STATUSCODE_BADOUTOFMEMORY;
-        }
-        message->notificationData->encoding = UA_EXTENSIONOBJECT_DECODED;
-        message->notificationData->content.decoded.data = dcn;
-        message->notificationData->content.decoded.type = &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION];
-
-        size_t dcnSize = sub->dataChangeNotifications;
-        if(dcnSize > notifications)
-            dcnSize = notifications;
-        dcn->monitoredItems = (UA_MonitoredItemNotification*)
-            UA_Array_new(dcnSize, &UA_TYPES[UA_TYPES_MONITOREDITEMNOTIFICATION]);
-        if(!dcn->monitoredItems) {
-            UA_NotificationMessage_clear(message);
-            return UA_STATUSCODE_BADOUTOFMEMORY;
+    /* Compute the encoded size of the notifications */
+    size_t dcnCount = 0, dcnSize = 0;
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    size_t enlCount = 0, enlSize = 0;
+#endif
+    UA_assert(notifications <= sub->notificationOrder.size);
+    UA_Notification *notification;
+    resetPublishCursors(sub, (UA_UInt32)notifications);
+    for(UA_UInt32 i = 0; i < notifications; i++) {
+        notification = getNotificationInOrder(sub, i);
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+        UA_MonitoredItem *mon = notification->mon;
+        if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
+            notification->data.event.fields.clientHandle = mon->clientHandle;
+            enlSize += UA_calcSizeBinary(&notification->data.event.fields,
+                                         &UA_TYPES[UA_TYPES_EVENTFIELDLIST]);
+            enlCount++;
+            continue;
         }
-        dcn->monitoredItemsSize = dcnSize;
-        notificationDataIdx++;
+#endif
+        dcnSize += sizeof(UA_UInt32) + /* ClientHandle */
+            UA_calcSizeBinary(&notification->data.value, &UA_TYPES[UA_TYPES_DATAVALUE]);
+        dcnCount++;
     }
 
+    /* SequenceNumber, PublishTime and the length of the NotificationData */
+    size_t total = sizeof(UA_UInt32) + sizeof(UA_DateTime) + sizeof(UA_Int32);
+    UA_Int32 notificationDataSize = 0;
+    if(dcnCount > 0) {
+        /* MonitoredItems and DiagnosticInfos array length */
+        dcnSize += 2 * sizeof(UA_Int32);
+        total += extensionObjectHeaderSize(&UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION]) + dcnSize;
+        notificationDataSize++;
+    }
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-    UA_EventNotificationList *enl = NULL;
-    UA_StatusChangeNotification *scn = NULL;
-    /* Pre-allocate either StatusChange or EventNotifications. Sending a
-     * (single) StatusChangeNotification has priority. */
-    if(sub->statusChangeNotifications > 0) {
-        scn = UA_StatusChangeNotification_new();
-        if(!scn) {
-            UA_NotificationMessage_clear(message);
-            return UA_STATUSCODE_BADOUTOFMEMORY;
-        }
-        message->notificationData[notificationDataIdx].encoding = UA_EXTENSIONOBJECT_DECODED;
-        message->notificationData[notificationDataIdx].content.decoded.data = scn;
-        message->notificationData[notificationDataIdx].content.decoded.type = &UA_TYPES[UA_TYPES_STATUSCHANGENOTIFICATION];
-        notificationDataIdx++;
-    } else if(sub->eventNotifications > 0) {
-        enl = UA_EventNotificationList_new();
-        if(!enl) {
-            UA_NotificationMessage_clear(message);
-            return UA_STATUSCODE_BADOUTOFMEMORY;
-        }
-        message->notificationData[notificationDataIdx].encoding = UA_EXTENSIONOBJECT_DECODED;
-        message->notificationData[notificationDataIdx].content.decoded.data = enl;
-        message->notificationData[notificationDataIdx].content.decoded.type = &UA_TYPES[UA_TYPES_EVENTNOTIFICATIONLIST];
-
-        size_t enlSize = sub->eventNotifications;
-        if(enlSize > notifications)
-            enlSize = notifications;
-        enl->events = (UA_EventFieldList*) UA_Array_new(enlSize, &UA_TYPES[UA_TYPES_EVENTFIELDLIST]);
-        if(!enl->events) {
-            UA_NotificationMessage_clear(message);
-            return UA_STATUSCODE_BADOUTOFMEMORY;
-        }
-        enl->eventsSize = enlSize;
-        notificationDataIdx++;
+    if(enlCount > 0) {
+        enlSize += sizeof(UA_Int32); /* Events array length */
+        total += extensionObjectHeaderSize(&UA_TYPES[UA_TYPES_EVENTNOTIFICATIONLIST]) + enlSize;
+        notificationDataSize++;
     }
 #endif
+    if(total > UA_INT32_MAX)
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
 
-    UA_assert(notificationDataIdx > 0);
-    message->notificationDataSize = notificationDataIdx;
+    UA_StatusCode retval = UA_ByteString_allocBuffer(encoded, total);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
 
-    /* <-- The point of no return --> */
+    /* Encode the header and set up the positions for the notification
+     * lists */
+    UA_Byte *bufPos = encoded->data;
+    const UA_Byte *bufEnd = &encoded->data[encoded->length];
+    retval |= UA_encodeBinary(&sequenceNumber, &UA_TYPES[UA_TYPES_UINT32],
+                              &bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&publishTime, &UA_TYPES[UA_TYPES_DATETIME],
+                              &bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&notificationDataSize, &UA_TYPES[UA_TYPES_INT32],
+                              &bufPos, &bufEnd, NULL, NULL);
+
+    UA_Byte *dcnPos = NULL;
+    UA_Int32 arrayLength;
+    if(dcnCount > 0) {
+        retval |= encodeExtensionObjectHeader(&UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION],
+                                              dcnSize, &bufPos, bufEnd);
+        arrayLength = (UA_Int32)dcnCount;
+        retval |= UA_encodeBinary(&arrayLength, &UA_TYPES[UA_TYPES_INT32],
+                                  &bufPos, &bufEnd, NULL, NULL);
+        dcnPos = bufPos;
+        bufPos += dcnSize - (2 * sizeof(UA_Int32));
+        arrayLength = -1; /* No DiagnosticInfos */
+        retval |= UA_encodeBinary(&arrayLength, &UA_TYPES[UA_TYPES_INT32],
+                                  &bufPos, &bufEnd, NULL, NULL);
+    }
 
-    size_t totalNotifications = 0; /* How many notifications were moved to the response overall? */
-    size_t dcnPos = 0; /* How many DataChangeNotifications were put into the list? */
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-    size_t enlPos = 0; /* How many EventNotifications were moved into the list */
+    UA_Byte *enlPos = NULL;
+    if(enlCount > 0) {
+        retval |= encodeExtensionObjectHeader(&UA_TYPES[UA_TYPES_EVENTNOTIFICATIONLIST],
+                                              enlSize, &bufPos, bufEnd);
+        arrayLength = (UA_Int32)enlCount;
+        retval |= UA_encodeBinary(&arrayLength, &UA_TYPES[UA_TYPES_INT32],
+                                  &bufPos, &bufEnd, NULL, NULL);
+        enlPos = bufPos;
+    }
 #endif
-    UA_Notification *notification, *notification_tmp;
-    TAILQ_FOREACH_SAFE(notification, &sub->notificationQueue, globalEntry, notification_tmp) {
-        if(totalNotifications >= notifications)
-            break;
 
+    /* Encode the notifications */
+    resetPublishCursors(sub, (UA_UInt32)notifications);
+    for(UA_UInt32 i = 0; i < notifications && retval == UA_STATUSCODE_GOOD; i++) {
+        notification = getNotificationInOrder(sub, i);
         UA_MonitoredItem *mon = notification->mon;
-
-        /* Remove from the queues and decrease the counters */
-        UA_Notification_dequeue(server, notification);
-
-        /* Move the content to the response */
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
         if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
-
-            UA_assert(enl != NULL); /* Have at least one event notification */
-
-            /* Move the content to the response */
-            UA_EventFieldList *efl = &enl->events[enlPos];
-            *efl = notification->data.event.fields;
-            UA_EventFieldList_init(&notification->data.event.fields);
-            efl->clientHandle = mon->clientHandle;
-
-            enlPos++;
-        } else
-#endif
-        {
-            UA_assert(dcn != NULL); /* Have at least one change notification */
-            /* Move the content to the response */
-            UA_MonitoredItemNotification *min = &dcn->monitoredItems[dcnPos];
-            min->clientHandle = mon->clientHandle;
-            min->value = notification->data.value;
-            UA_DataValue_init(&notification->data.value); /* Reset after the value has been moved */
-            dcnPos++;
+            retval = UA_encodeBinary(&notification->data.event.fields,
+                                     &UA_TYPES[UA_TYPES_EVENTFIELDLIST],
+                                     &enlPos, &bufEnd, NULL, NULL);
+            continue;
         }
-
-        UA_Notification_delete(notification);
-        totalNotifications++;
+#endif
+        retval = UA_encodeBinary(&mon->clientHandle, &UA_TYPES[UA_TYPES_UINT32],
+                                 &dcnPos, &bufEnd, NULL, NULL);
+        retval |= UA_encodeBinary(&notification->data.value, &UA_TYPES[UA_TYPES_DATAVALUE],
+                                  &dcnPos, &bufEnd, NULL, NULL);
+    }
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_ByteString_clear(encoded);
+        return retval;
     }
 
-    /* Set sizes */
-    if(dcn) {
-        dcn->monitoredItemsSize = dcnPos;
-        if(dcnPos == 0) {
-            UA_free(dcn->monitoredItems);
-            dcn->monitoredItems = NULL;
-        }
+    /* <-- The point of no return --> */
+
+    /* Remove the encoded notifications from the queues. Each is the oldest of
+     * its MonitoredItem and first in the order. */
+    for(size_t i = 0; i < notifications; i++) {
+        UA_MonitoredItem *mon = (UA_MonitoredItem*)
+            UA_PointerRing_get(&sub->notificationOrder, 0);
+        notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, 0);
+        UA_Notification_dequeue(server, notification);
+        UA_Notification_delete(server, notification);
     }
+    return UA_STATUSCODE_GOOD;
+}
 
-#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-    if(enl) {
-        enl->eventsSize = enlPos;
-        if(enlPos == 0) {
-            UA_free(enl->events);
-            enl->events = NULL;
-        }
+static UA_StatusCode
+encodeArrayWithMessageContext(UA_MessageContext *mc, const void *array,
+                              size_t size, const UA_DataType *type) {
+    /* Same as the array encoding. The empty array (NULL) is encoded as -1. */
+    UA_Int32 length = -1;
+    if(size > 0)
+        length = (UA_Int32)size;
+    else if(array == UA_EMPTY_ARRAY_SENTINEL)
+        length = 0;
+    UA_StatusCode retval = UA_MessageContext_encode(mc, &length, &UA_TYPES[UA_TYPES_INT32]);
+    uintptr_t ptr = (uintptr_t)array;
+    for(size_t i = 0; i < size && retval == UA_STATUSCODE_GOOD; i++) {
+        retval = UA_MessageContext_encode(mc, (const void*)ptr, type);
+        ptr += type->memSize;
     }
-#endif
+    return retval;
+}
 
-    return UA_STATUSCODE_GOOD;
+/* Send the PublishResponse with the NotificationMessage that is already
+ * encoded. If encodedMessage is NULL, the NotificationMessage of the response
+ * is encoded. The members are encoded in the order of the PublishResponse
+ * type. */
+static UA_StatusCode
+sendPublishResponse(UA_SecureChannel *channel, UA_UInt32 requestId,
+                    const UA_PublishResponse *response,
+                    const UA_ByteString *encodedMessage) {
+    UA_MessageContext mc;
+    UA_StatusCode retval = UA_MessageContext_begin(&mc, channel, requestId, UA_MESSAGETYPE_MSG);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_NodeId typeId = UA_NODEID_NUMERIC(0, UA_TYPES[UA_TYPES_PUBLISHRESPONSE].binaryEncodingId);
+    retval = UA_MessageContext_encode(&mc, &typeId, &UA_TYPES[UA_TYPES_NODEID]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = UA_MessageContext_encode(&mc, &response->responseHeader,
+                                      &UA_TYPES[UA_TYPES_RESPONSEHEADER]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = UA_MessageContext_encode(&mc, &response->subscriptionId,
+                                      &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = encodeArrayWithMessageContext(&mc, response->availableSequenceNumbers,
+                                           response->availableSequenceNumbersSize,
+                                           &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = UA_MessageContext_encode(&mc, &response->moreNotifications,
+                                      &UA_TYPES[UA_TYPES_BOOLEAN]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    if(encodedMessage)
+        retval = UA_MessageContext_encodeRaw(&mc, encodedMessage);
+    else
+        retval = UA_MessageContext_encode(&mc, &response->notificationMessage,
+                                          &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = encodeArrayWithMessageContext(&mc, response->results, response->resultsSize,
+                                           &UA_TYPES[UA_TYPES_STATUSCODE]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = encodeArrayWithMessageContext(&mc, response->diagnosticInfos,
+                                           response->diagnosticInfosSize,
+                                           &UA_TYPES[UA_TYPES_DIAGNOSTICINFO]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    return UA_MessageContext_finish(&mc);
 }
 
 /* According to OPC Unified Architecture, Part 4 5.13.1.1 i) The value 0 is
@@ -347,14 +633,6 @@ UA_Subscription_nextSequenceNumber(UA_UInt32 sequenceNumber) {
     return nextSequenceNumber;
 }
 
-static void
-publishCallback(UA_Server *server, UA_Subscription *sub) {
-    sub->readyNotifications = sub->notificationQueueSize;
-    UA_LOCK(server->serviceMutex);
-    UA_Subscription_publish(server, sub);
-    UA_UNLOCK(server->serviceMutex);
-}
-
 void
 UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
@@ -382,8 +660,8 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
     }
 
     /* If there are several late publish responses... */
-    if(sub->readyNotifications > sub->notificationQueueSize)
-        sub->readyNotifications = sub->notificationQueueSize;
+    if(sub->readyNotifications > sub->notificationOrder.size)
+        sub->readyNotifications = sub->notificationOrder.size;
 
     /* Count the available notifications */
     UA_UInt32 notifications = sub->readyNotifications;
@@ -424,6 +702,8 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
     /* Prepare the response */
     UA_PublishResponse *response = &pre->response;
     UA_NotificationMessage *message = &response->notificationMessage;
+    UA_DateTime publishTime = UA_DateTime_now();
+    UA_ByteString encodedMessage = UA_BYTESTRING_NULL;
     UA_NotificationMessageEntry *retransmission = NULL;
     if(notifications > 0) {
         if(server->config.enableRetransmissionQueue) {
@@ -439,8 +719,11 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
             }
         }
 
-        /* Prepare the response */
-        UA_StatusCode retval = prepareNotificationMessage(server, sub, message, notifications);
+        /* Encode the notification message. This moves the notifications out
+         * of the queue. */
+        UA_StatusCode retval =
+            encodeNotificationMessage(server, sub, sub->nextSequenceNumber,
+                                      publishTime, notifications, &encodedMessage);
         if(retval != UA_STATUSCODE_GOOD) {
             UA_LOG_WARNING_SESSION(&server->config.logger, sub->session,
                                    "Subscription %" PRIu32 " | Could not prepare the notification message. "
@@ -461,10 +744,10 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
     sub->readyNotifications -= notifications;
 
     /* Set up the response */
-    response->responseHeader.timestamp = UA_DateTime_now();
+    response->responseHeader.timestamp = publishTime;
     response->subscriptionId = sub->subscriptionId;
     response->moreNotifications = moreNotifications;
-    message->publishTime = response->responseHeader.timestamp;
+    message->publishTime = publishTime;
 
     /* Set sequence number to message. Started at 1 which is given
      * during creating a new subscription. The 1 is required for
@@ -474,10 +757,13 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
     if(notifications > 0) {
         /* If the retransmission queue is enabled a retransmission message is allocated */
         if(retransmission) {
-            /* Put the notification message into the retransmission queue. This
-             * needs to be done here, so that the message itself is included in the
-             * available sequence numbers for acknowledgement. */
-            retransmission->message = response->notificationMessage;
+            /* Put the encoded notification message into the retransmission
+             * queue. This needs to be done here, so that the message itself is
+             * included in the available sequence numbers for
+             * acknowledgement. */
+            retransmission->sequenceNumber = message->sequenceNumber;
+            retransmission->publishTime = publishTime;
+            retransmission->message = encodedMessage;
             UA_Subscription_addRetransmissionMessage(server, sub, retransmission);
         }
         /* Only if a notification was created, the sequence number must be increased.
@@ -494,7 +780,7 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
         size_t i = 0;
         UA_NotificationMessageEntry *nme;
         TAILQ_FOREACH(nme, &sub->retransmissionQueue, listEntry) {
-            response->availableSequenceNumbers[i] = nme->message.sequenceNumber;
+            response->availableSequenceNumbers[i] = nme->sequenceNumber;
             ++i;
         }
     }
@@ -504,22 +790,35 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
                          "Subscription %" PRIu32 " | Sending out a publish response "
                          "with %" PRIu32 " notifications", sub->subscriptionId,
                          notifications);
-    sendResponse(server, sub->session, sub->session->header.channel, pre->requestId,
-                 (UA_Response*)response, &UA_TYPES[UA_TYPES_PUBLISHRESPONSE]);
+    sendPublishResponse(channel, pre->requestId, response,
+                        (notifications > 0) ? &encodedMessage : NULL);
 
     /* Reset subscription state to normal */
     sub->state = UA_SUBSCRIPTIONSTATE_NORMAL;
     sub->currentKeepAliveCount = 0;
 
-    /* Free the response */
+    /* Free the response. The encoded NotificationMessage was moved into the
+     * retransmission queue. Now that it was sent, it can be spilled. */
     if(retransmission)
-        /* NotificationMessage was moved into retransmission queue */
-        UA_NotificationMessage_init(&response->notificationMessage);
+        enforceRetransmissionBudget(server);
+    else
+        UA_ByteString_clear(&encodedMessage);
     response->availableSequenceNumbers = NULL;
     response->availableSequenceNumbersSize = 0;
     UA_PublishResponse_clear(&pre->response);
     UA_free(pre);
 
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    /* The sent notifications freed space in the queues. Continue streaming the
+     * retained conditions of a ConditionRefresh. */
+    if(sub->conditionRefreshes > 0 && notifications > 0) {
+        UA_UInt32 refreshed = UA_Subscription_continueConditionRefresh(server, sub);
+        sub->readyNotifications += refreshed;
+        if(refreshed > 0)
+            moreNotifications = true;
+    }
+#endif
+
     /* Repeat sending responses if there are more notifications to send */
     if(moreNotifications)
         UA_Subscription_publish(server, sub);
@@ -566,6 +865,55 @@ UA_Subscription_reachedPublishReqLimit(UA_Server *server,  UA_Session *session)
     return true;
 }
 
+static void
+publishSlotCallback(UA_Server *server, UA_PublishSlot *slot) {
+    UA_LOCK(server->serviceMutex);
+
+    /* Coalesce the publish responses per SecureChannel. Only the channels of
+     * the subscriptions in the slot are batched. The channels are remembered
+     * as the subscriptions can be deleted during the publish callback (end of
+     * lifetime). Removed channels are freed with a delayed callback. If the
+     * array cannot be allocated, the responses are sent without batching. */
+    UA_Subscription *sub, *sub_tmp;
+    size_t channelsSize = 0;
+    UA_SecureChannel **channels = NULL;
+    if(slot->subscriptionsSize > 0)
+        channels = (UA_SecureChannel**)
+            UA_malloc(slot->subscriptionsSize * sizeof(UA_SecureChannel*));
+    if(channels) {
+        TAILQ_FOREACH(sub, &slot->subscriptions, publishSlotEntry) {
+            UA_SecureChannel *channel = sub->session ? sub->session->header.channel : NULL;
+            if(!channel || channel->sendBatch)
+                continue; /* No channel or already batched */
+            UA_SecureChannel_beginSendBatch(channel);
+            if(channel->sendBatch)
+                channels[channelsSize++] = channel;
+        }
+    }
+
+    /* An empty slot is freed only after the callback (delayed) */
+    TAILQ_FOREACH_SAFE(sub, &slot->subscriptions, publishSlotEntry, sub_tmp) {
+        sub->readyNotifications = sub->notificationOrder.size;
+        UA_Subscription_publish(server, sub);
+    }
+
+    for(size_t i = 0; i < channelsSize; i++)
+        UA_SecureChannel_flushSendBatch(channels[i]);
+    UA_free(channels);
+
+    UA_UNLOCK(server->serviceMutex);
+}
+
+/* The timer works with milliseconds. Round to the closest interval. */
+static UA_UInt32
+publishSlotInterval(UA_Double publishingInterval) {
+    if(!(publishingInterval >= 1.0))
+        return 1;
+    if(publishingInterval >= (UA_Double)UA_UINT32_MAX)
+        return UA_UINT32_MAX;
+    return (UA_UInt32)(publishingInterval + 0.5);
+}
+
 UA_StatusCode
 Subscription_registerPublishCallback(UA_Server *server, UA_Subscription *sub) {
     UA_LOG_DEBUG_SESSION(&server->config.logger, sub->session,
@@ -573,16 +921,37 @@ Subscription_registerPublishCallback(UA_Server *server, UA_Subscription *sub) {
                          "publishing callback", sub->subscriptionId);
     UA_LOCK_ASSERT(server->serviceMutex, 1);
 
-    if(sub->publishCallbackIsRegistered)
+    if(sub->publishSlot)
         return UA_STATUSCODE_GOOD;
 
-    UA_StatusCode retval =
-        addRepeatedCallback(server, (UA_ServerCallback)publishCallback,
-                            sub, (UA_UInt32)sub->publishingInterval, &sub->publishCallbackId);
-    if(retval != UA_STATUSCODE_GOOD)
-        return retval;
+    /* Find the slot for the publishing interval */
+    UA_UInt32 interval = publishSlotInterval(sub->publishingInterval);
+    UA_PublishSlot *slot;
+    LIST_FOREACH(slot, &server->publishSlots, listEntry) {
+        if(slot->interval == interval)
+            break;
+    }
 
-    sub->publishCallbackIsRegistered = true;
+    /* Create a new slot */
+    if(!slot) {
+        slot = (UA_PublishSlot*)UA_calloc(1, sizeof(UA_PublishSlot));
+        if(!slot)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        slot->interval = interval;
+        TAILQ_INIT(&slot->subscriptions);
+        UA_StatusCode retval =
+            addRepeatedCallback(server, (UA_ServerCallback)publishSlotCallback,
+                                slot, (UA_Double)interval, &slot->callbackId);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_free(slot);
+            return retval;
+        }
+        LIST_INSERT_HEAD(&server->publishSlots, slot, listEntry);
+    }
+
+    TAILQ_INSERT_TAIL(&slot->subscriptions, sub, publishSlotEntry);
+    slot->subscriptionsSize++;
+    sub->publishSlot = slot;
     return UA_STATUSCODE_GOOD;
 }
 
@@ -591,11 +960,23 @@ Subscription_unregisterPublishCallback(UA_Server *server, UA_Subscription *sub)
     UA_LOG_DEBUG_SESSION(&server->config.logger, sub->session, "Subscription %" PRIu32 " | "
                          "Unregister subscription publishing callback", sub->subscriptionId);
 
-    if(!sub->publishCallbackIsRegistered)
+    UA_PublishSlot *slot = sub->publishSlot;
+    if(!slot)
+        return;
+
+    TAILQ_REMOVE(&slot->subscriptions, sub, publishSlotEntry);
+    slot->subscriptionsSize--;
+    sub->publishSlot = NULL;
+    if(!TAILQ_EMPTY(&slot->subscriptions))
         return;
 
-    removeCallback(server, sub->publishCallbackId);
-    sub->publishCallbackIsRegistered = false;
+    /* Remove the empty slot. The callback might be running or already
+     * dispatched to a worker thread. So free the slot only when the currently
+     * scheduled jobs have completed. */
+    LIST_REMOVE(slot, listEntry);
+    removeCallback(server, slot->callbackId);
+    slot->delayedFreePointers.callback = NULL;
+    UA_WorkQueue_enqueueDelayed(&server->workQueue, &slot->delayedFreePointers);
 }
 
 /* When the session has publish requests stored but the last subscription is
@@ -33,22 +33,37 @@ _UA_BEGIN_DECLS
         else DST = SRC;                                \
     }
 
-/* Set to the TAILQ_NEXT pointer of a notification, the sentinel that the
- * notification was not added to the global queue */
-#define UA_SUBSCRIPTION_QUEUE_SENTINEL ((UA_Notification*)0x01)
-
 /**
  * MonitoredItems create Notifications. Subscriptions collect Notifications from
  * (several) MonitoredItems and publish them to the client.
  *
- * Notifications are put into two queues at the same time. One for the
- * MonitoredItem that generated the notification. Here we can remove it if the
- * space reserved for the MonitoredItem runs full. The second queue is the
- * "global" queue for all Notifications generated in a Subscription. For
- * publication, the notifications are taken out of the "global" queue in the
- * order of their creation.
+ * The Notifications are kept in a ring buffer of the MonitoredItem that
+ * generated them. Here we can remove them if the space reserved for the
+ * MonitoredItem runs full. The Subscription keeps the order of the
+ * Notifications of its MonitoredItems in REPORTING mode in a second ring
+ * buffer. Each entry points to a MonitoredItem. As the queue of a
+ * MonitoredItem is FIFO, the n-th entry for a MonitoredItem stands for its n-th
+ * Notification. For publication, the notifications are taken out in this
+ * order.
  */
 
+/* Ring buffer of pointers. The capacity is zero or a power of two. The buffer
+ * only grows, so the steady state does not allocate. */
+typedef struct {
+    void **entries;
+    UA_UInt32 capacity;
+    UA_UInt32 start; /* Position of the first entry */
+    UA_UInt32 size;
+} UA_PointerRing;
+
+/* Get the i-th entry (0 is the first) */
+static UA_INLINE void *
+UA_PointerRing_get(const UA_PointerRing *ring, UA_UInt32 i) {
+    return ring->entries[(ring->start + i) & (ring->capacity - 1)];
+}
+
+void UA_PointerRing_clear(UA_PointerRing *ring);
+
 /*****************/
 /* MonitoredItem */
 /*****************/
@@ -84,6 +99,9 @@ typedef struct {
     UA_TwoStateVariableChangeCallback activeStateCallback;
 } UA_ConditionCallbacks;
 
+struct UA_Condition;
+struct UA_ConditionSource;
+
 /*
  * In Alarms and Conditions first implementation, conditionBranchId
  * is always equal to NULL NodeId (UA_NODEID_NULL). That ConditionBranch
@@ -92,9 +110,11 @@ typedef struct {
  */
 typedef struct UA_ConditionBranch {
     LIST_ENTRY(UA_ConditionBranch) listEntry;
+    struct UA_Condition *condition;
     UA_NodeId conditionBranchId;
     UA_ByteString lastEventId;
     UA_Boolean isCallerAC;
+    UA_NodeId retainId; /* Cached NodeId of the Retain field (resolved lazily) */
 } UA_ConditionBranch;
 
 /*
@@ -104,6 +124,7 @@ typedef struct UA_ConditionBranch {
 typedef struct UA_Condition {
     LIST_ENTRY(UA_Condition) listEntry;
     LIST_HEAD(, UA_ConditionBranch) conditionBranchHead;
+    struct UA_ConditionSource *source;
     UA_NodeId conditionId;
     UA_UInt16 lastSeverity;
     UA_DateTime lastSeveritySourceTimeStamp;
@@ -122,14 +143,24 @@ typedef struct UA_ConditionSource {
     UA_NodeId conditionSourceId;
 } UA_ConditionSource;
 
+/*
+ * A ConditionRefresh in progress for a MonitoredItem. The retained conditions
+ * are collected when the refresh starts. Their events are enqueued as the
+ * notification queue of the MonitoredItem drains with the publish responses.
+ * The RefreshEndEvent follows the last condition.
+ */
+typedef struct {
+    UA_NodeId *conditions; /* ConditionIds or BranchIds */
+    size_t conditionsSize;
+    size_t conditionsSent;
+} UA_ConditionRefresh;
+
 #endif /* UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS */
 
 #endif /* UA_ENABLE_SUBSCRIPTIONS_EVENTS */
 
 typedef struct UA_Notification {
-    TAILQ_ENTRY(UA_Notification) listEntry; /* Notification list for the MonitoredItem */
-    TAILQ_ENTRY(UA_Notification) globalEntry; /* Notification list for the Subscription */
-
+    struct UA_Notification *next; /* In the free list of the pool */
     UA_MonitoredItem *mon;
 
     /* See the monitoredItemType of the MonitoredItem */
@@ -141,19 +172,59 @@ typedef struct UA_Notification {
     } data;
 } UA_Notification;
 
-/* Ensure enough space is available; Add notification to the linked lists;
- * Increase the counters */
-void UA_Notification_enqueue(UA_Server *server, UA_Subscription *sub,
-                             UA_MonitoredItem *mon, UA_Notification *n);
-
-/* Remove the notification from the MonitoredItem's queue and the Subscriptions
- * global queue. Reduce the respective counters. */
+/* Unused notifications are kept in a server-wide pool for reuse. The pool
+ * retains (in use or free) at most as many notifications as the MonitoredItems
+ * of all subscriptions can enqueue. So the steady state does not allocate. */
+typedef struct {
+    UA_Notification *freeList; /* Linked via the next pointer */
+    size_t freeSize;
+    size_t allocated; /* Taken from the heap (in use and free) */
+    size_t reserve;   /* Sum of the (max) queue sizes of all MonitoredItems */
+} UA_NotificationPool;
+
+void UA_NotificationPool_clear(UA_NotificationPool *pool);
+
+/* Take a notification from the pool or allocate a new one. The content is not
+ * initialized. */
+UA_Notification * UA_Notification_new(UA_Server *server);
+
+/* Add the notification to the queues; Increase the counters; Ensure enough
+ * space is available. If the notification cannot be added (out of memory),
+ * the queues are unchanged and the notification has to be deleted by the
+ * caller. */
+UA_StatusCode UA_Notification_enqueue(UA_Server *server, UA_Subscription *sub,
+                                      UA_MonitoredItem *mon, UA_Notification *n);
+
+/* Remove the notification from the MonitoredItem's queue and the order of the
+ * Subscription. Reduce the respective counters. Constant time for the oldest
+ * notification of the MonitoredItem if the MonitoredItem is first in the order
+ * (as for publishing) or not reporting. Otherwise the order is searched. */
 void UA_Notification_dequeue(UA_Server *server, UA_Notification *n);
 
-/* Delete the notification. Must be dequeued first. */
-void UA_Notification_delete(UA_Notification *n);
+/* Delete the notification content and return it to the pool. Must be dequeued
+ * first. */
+void UA_Notification_delete(UA_Server *server, UA_Notification *n);
 
-typedef TAILQ_HEAD(NotificationQueue, UA_Notification) NotificationQueue;
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+
+/* The EventFilter is compiled when it is set for the MonitoredItem. The where
+ * clause is validated once and reduced to the type check. The select clauses
+ * are flagged whether they require the event to be of a valid type. The
+ * compiled filter points into the EventFilter it was created from. */
+typedef struct {
+    UA_StatusCode whereClauseResult; /* Returned for every event if not good */
+    const UA_NodeId *ofType; /* NULL -> all event types match */
+    size_t selectClausesSize;
+    UA_Boolean *checkEventType;
+    UA_UInt32 filterHash; /* Of the binary encoding. Zero if not encodable. */
+} UA_CompiledEventFilter;
+
+UA_StatusCode
+UA_CompiledEventFilter_init(UA_CompiledEventFilter *cf, const UA_EventFilter *filter);
+
+void UA_CompiledEventFilter_clear(UA_CompiledEventFilter *cf);
+
+#endif
 
 struct UA_MonitoredItem {
     UA_DelayedCallback delayedFreePointers;
@@ -191,23 +262,44 @@ struct UA_MonitoredItem {
          * changed at runtime of the MonitoredItem */
         UA_DataChangeFilter dataChangeFilter;
     } filter;
-    UA_Variant lastValue; // TODO: dataEncoding is hardcoded to UA binary
-
-    /* Sample Callback */
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    UA_CompiledEventFilter compiledEventFilter;
+#endif
+    UA_DataValue lastValue; /* The last sample (after applying the filter) for
+                             * the change detection */
+    UA_Boolean lastValueSet;
+
+    /* Sample Callback. Variables with an internal value are not polled. The
+     * MonitoredItem is put in the sample trigger index instead (sampleOnWrite).
+     * A write to the node schedules a single sample (samplePending) that is
+     * delayed until one samplingInterval after the last sample. */
     UA_UInt64 sampleCallbackId;
-    UA_ByteString lastSampledValue;
     UA_Boolean sampleCallbackIsRegistered;
-
-    /* Notification Queue */
-    NotificationQueue queue;
+    UA_Boolean sampleOnWrite;
+    UA_Boolean samplePending;
+    UA_DateTime lastSampleTime; /* Monotonic */
+    struct UA_MonitoredItem *triggerNext; /* Next for the same node in the
+                                           * sample trigger index */
+
+    /* Notification Queue. The ring buffer is sized when maxQueueSize is set.
+     * It has space for maxQueueSize notifications plus the one that is added
+     * before the oldest is discarded (and an overflow event). */
+    UA_PointerRing queue; /* UA_Notification pointers, oldest first */
     UA_UInt32 maxQueueSize; /* The max number of enqueued notifications (not
                              * counting overflow events) */
-    UA_UInt32 queueSize;
     UA_UInt32 eventOverflows; /* Separate counter for the queue. Can at most
                                * double the queue size */
+    UA_UInt32 publishCursor; /* Next notification while encoding a
+                              * NotificationMessage */
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-    UA_MonitoredItem *next;
+    /* Routing of events from the notifier node */
+    struct UA_EventRouteGroup *routeGroup;
+    LIST_ENTRY(UA_MonitoredItem) routeEntry;
+#endif
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    UA_ConditionRefresh *conditionRefresh; /* NULL if no refresh in progress */
 #endif
 
 #ifdef UA_ENABLE_DA
@@ -215,6 +307,15 @@ struct UA_MonitoredItem {
 #endif
 };
 
+/* Schedule a sample for the MonitoredItems in the sample trigger index that
+ * monitor the node. Called after the node was written or deleted. */
+void UA_MonitoredItem_sampleOnWrite(UA_Server *server, const UA_NodeId *nodeId);
+
+/* Re-register the sample callbacks of the MonitoredItems in the sample trigger
+ * index that monitor the node. Called when the node gets a DataSource or a
+ * value callback and has to be polled from now on. */
+void UA_MonitoredItem_updateSampleCallbacks(UA_Server *server, const UA_NodeId *nodeId);
+
 void UA_MonitoredItem_init(UA_MonitoredItem *mon, UA_Subscription *sub);
 void UA_MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem);
 void UA_MonitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem);
@@ -228,18 +329,103 @@ UA_StatusCode UA_Event_generateEventId(UA_ByteString *generatedId);
  * data if required. */
 UA_StatusCode UA_MonitoredItem_ensureQueueSpace(UA_Server *server, UA_MonitoredItem *mon);
 
-UA_StatusCode UA_MonitoredItem_removeNodeEventCallback(UA_Server *server, UA_Session *session,
-                                                       UA_Node *node, void *data);
+/* Grow the queue for maxQueueSize notifications (plus the one that is added
+ * before the oldest is discarded) */
+UA_StatusCode UA_MonitoredItem_reserveQueue(UA_MonitoredItem *mon, UA_UInt32 maxQueueSize);
+
+/* Add the queued notifications to the order of the Subscription (when reporting
+ * is enabled) or remove them (when reporting is disabled) */
+UA_StatusCode UA_MonitoredItem_addToSubscriptionOrder(UA_MonitoredItem *mon);
+void UA_MonitoredItem_removeFromSubscriptionOrder(UA_MonitoredItem *mon);
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+/* Enqueue the next events of the ConditionRefreshes in progress. Returns the
+ * number of notifications added to the subscription. */
+UA_UInt32 UA_Subscription_continueConditionRefresh(UA_Server *server, UA_Subscription *sub);
+void UA_MonitoredItem_removeConditionRefresh(UA_MonitoredItem *mon);
+#endif
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+
+/* The event MonitoredItems are indexed by their notifier node. For each
+ * notifier, the MonitoredItems are grouped by the event type of the where
+ * clause (OfType). An event is routed only to the groups of the notifier nodes
+ * it propagates to and whose type matches. */
+typedef struct UA_EventRouteGroup {
+    LIST_ENTRY(UA_EventRouteGroup) listEntry;
+    struct UA_EventRoute *route;
+    UA_NodeId ofType; /* Null -> all event types */
+    LIST_HEAD(, UA_MonitoredItem) monitoredItems; /* Linked via routeEntry */
+} UA_EventRouteGroup;
+
+typedef struct UA_EventRoute {
+    UA_NodeId notifier; /* Key in server->eventRoutes */
+    LIST_HEAD(, UA_EventRouteGroup) groups;
+} UA_EventRoute;
+
+UA_StatusCode
+UA_EventRoute_addMonitoredItem(UA_Server *server, UA_MonitoredItem *mon);
+
+void UA_EventRoute_removeMonitoredItem(UA_Server *server, UA_MonitoredItem *mon);
+
+#endif
 
 /****************/
 /* Subscription */
 /****************/
 
 typedef struct UA_NotificationMessageEntry {
-    TAILQ_ENTRY(UA_NotificationMessageEntry) listEntry;
-    UA_NotificationMessage message;
+    TAILQ_ENTRY(UA_NotificationMessageEntry) listEntry;   /* In the Subscription */
+    TAILQ_ENTRY(UA_NotificationMessageEntry) serverEntry; /* In the store */
+    UA_Subscription *sub;
+    UA_UInt32 sequenceNumber;
+    UA_DateTime publishTime;
+    UA_ByteString message; /* Binary encoded NotificationMessage. The data is
+                            * NULL if the message was moved to the spill file.
+                            * The length is retained. */
+    UA_Boolean spilled;
+    size_t spillOffset;
 } UA_NotificationMessageEntry;
 
+typedef TAILQ_HEAD(ListOfNotificationMessages, UA_NotificationMessageEntry) ListOfNotificationMessages;
+
+/* The retransmission messages of all Subscriptions in the order of their
+ * creation. If the messages kept in memory exceed
+ * config.maxRetransmissionQueueBytes, the oldest are moved to the spill file.
+ * The spill file is used as a ring buffer. Without a spill file (or if the
+ * message does not fit), the oldest messages are dropped. */
+typedef struct {
+    ListOfNotificationMessages inMemory; /* Linked via serverEntry */
+    size_t inMemoryBytes;
+
+    ListOfNotificationMessages spilled;  /* Ordered by the position in the ring */
+    UA_Boolean spillFailed; /* Don't retry to open the spill file */
+    int spillFd;
+    UA_Byte *spillMap; /* NULL if the spill file is not open */
+    size_t spillMapSize;
+    size_t spillTail;  /* Next write position */
+} UA_RetransmissionStore;
+
+void UA_RetransmissionStore_init(UA_RetransmissionStore *store);
+void UA_RetransmissionStore_clear(UA_RetransmissionStore *store);
+
+/* Returns a view on the encoded message (also if it was spilled) */
+void UA_RetransmissionStore_getMessage(UA_Server *server,
+                                       const UA_NotificationMessageEntry *entry,
+                                       UA_ByteString *message);
+
+/* Subscriptions with the same publishing interval share one repeated callback
+ * in the server timer. In each tick, the publish responses of all
+ * subscriptions in the slot are coalesced per SecureChannel. */
+typedef struct UA_PublishSlot {
+    UA_DelayedCallback delayedFreePointers;
+    LIST_ENTRY(UA_PublishSlot) listEntry;
+    UA_UInt32 interval; /* in ms */
+    UA_UInt64 callbackId;
+    TAILQ_HEAD(, UA_Subscription) subscriptions;
+    size_t subscriptionsSize;
+} UA_PublishSlot;
+
 /* We use only a subset of the states defined in the standard */
 typedef enum {
     /* UA_SUBSCRIPTIONSTATE_CLOSED */
@@ -249,8 +435,6 @@ typedef enum {
     UA_SUBSCRIPTIONSTATE_KEEPALIVE
 } UA_SubscriptionState;
 
-typedef TAILQ_HEAD(ListOfNotificationMessages, UA_NotificationMessageEntry) ListOfNotificationMessages;
-
 struct UA_Subscription {
     UA_DelayedCallback delayedFreePointers;
     LIST_ENTRY(UA_Subscription) listEntry;
@@ -272,20 +456,19 @@ struct UA_Subscription {
     UA_UInt32 currentLifetimeCount;
 
     /* Publish Callback */
-    UA_UInt64 publishCallbackId;
-    UA_Boolean publishCallbackIsRegistered;
+    UA_PublishSlot *publishSlot; /* NULL if not registered */
+    TAILQ_ENTRY(UA_Subscription) publishSlotEntry;
 
     /* MonitoredItems */
     UA_UInt32 lastMonitoredItemId; /* increase the identifiers */
     LIST_HEAD(, UA_MonitoredItem) monitoredItems;
     UA_UInt32 monitoredItemsSize;
 
-    /* Global list of notifications from the MonitoredItems */
-    NotificationQueue notificationQueue;
-    UA_UInt32 notificationQueueSize; /* Total queue size */
+    /* Order of the notifications from the MonitoredItems in REPORTING mode.
+     * The n-th entry for a MonitoredItem stands for its n-th notification. */
+    UA_PointerRing notificationOrder; /* UA_MonitoredItem pointers */
     UA_UInt32 dataChangeNotifications;
     UA_UInt32 eventNotifications;
-    UA_UInt32 statusChangeNotifications;
 
     /* Notifications to be sent out now (already late). In a regular publish
      * callback, all queued notifications are sent out. In a late publish
@@ -293,6 +476,10 @@ struct UA_Subscription {
      * callback are sent. */
     UA_UInt32 readyNotifications;
 
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    UA_UInt32 conditionRefreshes; /* MonitoredItems with a ConditionRefresh */
+#endif
+
     /* Retransmission Queue */
     ListOfNotificationMessages retransmissionQueue;
     size_t retransmissionQueueSize;
@@ -310,7 +497,8 @@ UA_Subscription_deleteMonitoredItem(UA_Server *server, UA_Subscription *sub,
                                     UA_UInt32 monitoredItemId);
 
 void UA_Subscription_publish(UA_Server *server, UA_Subscription *sub);
-UA_StatusCode UA_Subscription_removeRetransmissionMessage(UA_Subscription *sub,
+UA_StatusCode UA_Subscription_removeRetransmissionMessage(UA_Server *server,
+                                                          UA_Subscription *sub,
                                                           UA_UInt32 sequenceNumber);
 void UA_Subscription_answerPublishRequestsNoSubscription(UA_Server *server, UA_Session *session);
 UA_Boolean UA_Subscription_reachedPublishReqLimit(UA_Server *server,  UA_Session *session);
@@ -132,6 +132,84 @@ static UA_NodeId refreshEvents[2] =
     {{0, UA_NODEIDTYPE_NUMERIC, {0}},
      {0, UA_NODEIDTYPE_NUMERIC, {0}}};
 
+/*****************************************************************************/
+/* Condition Index                                                           */
+/*****************************************************************************/
+
+/* Remove the entry only if it points to the structure. Another structure
+ * might have been indexed with the same key afterwards. */
+static void
+conditionIndexRemove(UA_NodeIdMap *index, const UA_NodeId *key, void *data) {
+    void **value = UA_NodeIdMap_find(index, key);
+    if(value && *value == data)
+        UA_NodeIdMap_remove(index, key);
+}
+
+/* The EventIds are indexed as ByteString NodeIds */
+static UA_NodeId
+eventIdKey(const UA_ByteString *eventId) {
+    UA_NodeId key;
+    key.namespaceIndex = 0;
+    key.identifierType = UA_NODEIDTYPE_BYTESTRING;
+    key.identifier.byteString = *eventId;
+    return key;
+}
+
+static UA_ConditionSource *
+findConditionSource(UA_Server *server, const UA_NodeId *conditionSource) {
+    void **value = UA_NodeIdMap_find(&server->conditionSourceIndex, conditionSource);
+    return (value) ? (UA_ConditionSource*)*value : NULL;
+}
+
+/* Returns the condition if it belongs to the ConditionSource. The source is
+ * not checked if conditionSource is NULL. */
+static UA_Condition *
+findCondition(UA_Server *server, const UA_NodeId *conditionSource,
+              const UA_NodeId *conditionId) {
+    void **value = UA_NodeIdMap_find(&server->conditionIndex, conditionId);
+    if(!value)
+        return NULL;
+    UA_Condition *cond = (UA_Condition*)*value;
+    if(conditionSource &&
+       !UA_NodeId_equal(&cond->source->conditionSourceId, conditionSource))
+        return NULL;
+    return cond;
+}
+
+/* Same as findCondition for branches with a BranchId other than NULL */
+static UA_ConditionBranch *
+findConditionBranch(UA_Server *server, const UA_NodeId *conditionSource,
+                    const UA_NodeId *branchId) {
+    void **value = UA_NodeIdMap_find(&server->conditionBranchIndex, branchId);
+    if(!value)
+        return NULL;
+    UA_ConditionBranch *branch = (UA_ConditionBranch*)*value;
+    if(conditionSource &&
+       !UA_NodeId_equal(&branch->condition->source->conditionSourceId, conditionSource))
+        return NULL;
+    return branch;
+}
+
+static UA_ConditionBranch *
+findConditionBranchByEventId(UA_Server *server, const UA_ByteString *eventId) {
+    UA_NodeId key = eventIdKey(eventId);
+    void **value = UA_NodeIdMap_find(&server->conditionEventIndex, &key);
+    return (value) ? (UA_ConditionBranch*)*value : NULL;
+}
+
+static UA_StatusCode
+setBranchLastEventId(UA_Server *server, UA_ConditionBranch *branch,
+                     const UA_ByteString *lastEventId) {
+    UA_NodeId key = eventIdKey(&branch->lastEventId);
+    conditionIndexRemove(&server->conditionEventIndex, &key, branch);
+    UA_ByteString_clear(&branch->lastEventId);
+    UA_StatusCode retval = UA_ByteString_copy(lastEventId, &branch->lastEventId);
+    if(retval != UA_STATUSCODE_GOOD || branch->lastEventId.length == 0)
+        return retval;
+    key = eventIdKey(&branch->lastEventId);
+    return UA_NodeIdMap_insert(&server->conditionEventIndex, &key, branch);
+}
+
 /*****************************************************************************/
 /* Functions                                                                */
 /*****************************************************************************/
@@ -145,43 +223,33 @@ UA_Server_setConditionTwoStateVariableCallback(UA_Server *server, const UA_NodeI
                                                const UA_NodeId conditionSource, UA_Boolean removeBranch,
                                                UA_TwoStateVariableChangeCallback callback,
                                                UA_TwoStateVariableCallbackType callbackType) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *cs;
-    LIST_FOREACH(cs, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&cs->conditionSourceId, &conditionSource))
-            continue;
+    /* Get Condition Entry */
+    UA_Condition *c = findCondition(server, &conditionSource, &condition);
+    if(!c)
+        return UA_STATUSCODE_BADNOTFOUND;
 
-        /* Get Condition Entry */
-        UA_Condition *c;
-        LIST_FOREACH(c, &cs->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&c->conditionId, &condition))
-                continue;
-
-            switch(callbackType) {
-                case UA_ENTERING_ENABLEDSTATE:
-                    c->callbacks.enableStateCallback = callback;
-                    return UA_STATUSCODE_GOOD;
-
-                case UA_ENTERING_ACKEDSTATE:
-                    c->callbacks.ackStateCallback = callback;
-                    c->callbacks.ackedRemoveBranch = removeBranch;
-                    return UA_STATUSCODE_GOOD;
-
-                case UA_ENTERING_CONFIRMEDSTATE:
-                    c->callbacks.confirmStateCallback = callback;
-                    c->callbacks.confirmedRemoveBranch = removeBranch;
-                    return UA_STATUSCODE_GOOD;
-
-                case UA_ENTERING_ACTIVESTATE:
-                    c->callbacks.activeStateCallback = callback;
-                    return UA_STATUSCODE_GOOD;
-
-                default:
-                    return UA_STATUSCODE_BADNOTFOUND;
-            }
-        }
+    switch(callbackType) {
+        case UA_ENTERING_ENABLEDSTATE:
+            c->callbacks.enableStateCallback = callback;
+            return UA_STATUSCODE_GOOD;
+
+        case UA_ENTERING_ACKEDSTATE:
+            c->callbacks.ackStateCallback = callback;
+            c->callbacks.ackedRemoveBranch = removeBranch;
+            return UA_STATUSCODE_GOOD;
+
+        case UA_ENTERING_CONFIRMEDSTATE:
+            c->callbacks.confirmStateCallback = callback;
+            c->callbacks.confirmedRemoveBranch = removeBranch;
+            return UA_STATUSCODE_GOOD;
+
+        case UA_ENTERING_ACTIVESTATE:
+            c->callbacks.activeStateCallback = callback;
+            return UA_STATUSCODE_GOOD;
+
+        default:
+            return UA_STATUSCODE_BADNOTFOUND;
     }
-    return UA_STATUSCODE_BADNOTFOUND;
 }
 
 static UA_StatusCode
@@ -222,25 +290,15 @@ static UA_StatusCode
 callConditionTwoStateVariableCallback(UA_Server *server, const UA_NodeId *condition,
                                       const UA_NodeId *conditionSource, UA_Boolean *removeBranch,
                                       UA_TwoStateVariableCallbackType callbackType) {
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(UA_NodeId_equal(&cond->conditionId, condition)) {
-                return getConditionTwoStateVariableCallback(server, condition, cond,
-                                                            removeBranch, callbackType);
-            }
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                if(!UA_NodeId_equal(&branch->conditionBranchId, condition))
-                    continue;
-                return getConditionTwoStateVariableCallback(server, &branch->conditionBranchId,
-                                                            cond, removeBranch, callbackType);
-            }
-        }
-    }
+    UA_Condition *cond = findCondition(server, conditionSource, condition);
+    if(cond)
+        return getConditionTwoStateVariableCallback(server, condition, cond,
+                                                    removeBranch, callbackType);
+    UA_ConditionBranch *branch = findConditionBranch(server, conditionSource, condition);
+    if(branch)
+        return getConditionTwoStateVariableCallback(server, &branch->conditionBranchId,
+                                                    branch->condition, removeBranch,
+                                                    callbackType);
     return UA_STATUSCODE_BADNOTFOUND;
 }
 
@@ -345,73 +403,40 @@ getConditionBranchNodeId(UA_Server *server, const UA_ByteString *eventId,
     *outConditionBranchNodeId = UA_NODEID_NULL;
     /* The function checks the BranchId based on the event Id, if BranchId ==
        NULL -> outConditionId = ConditionId */
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            /* Get Branch Entry*/
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                if(!UA_ByteString_equal(&branch->lastEventId, eventId))
-                    continue;
-                if(UA_NodeId_isNull(&branch->conditionBranchId))
-                    return UA_NodeId_copy(&cond->conditionId, outConditionBranchNodeId);
-                return UA_NodeId_copy(&branch->conditionBranchId, outConditionBranchNodeId);
-            }
-        }
-    }
-
-    return UA_STATUSCODE_BADEVENTIDUNKNOWN;
+    UA_ConditionBranch *branch = findConditionBranchByEventId(server, eventId);
+    if(!branch)
+        return UA_STATUSCODE_BADEVENTIDUNKNOWN;
+    if(UA_NodeId_isNull(&branch->conditionBranchId))
+        return UA_NodeId_copy(&branch->condition->conditionId, outConditionBranchNodeId);
+    return UA_NodeId_copy(&branch->conditionBranchId, outConditionBranchNodeId);
 }
 
 static UA_StatusCode
 getConditionLastSeverity(UA_Server *server, const UA_NodeId *conditionSource,
                          const UA_NodeId *conditionId, UA_UInt16 *outLastSeverity,
                          UA_DateTime *outLastSeveritySourceTimeStamp) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, conditionId))
-                continue;
-            *outLastSeverity = cond->lastSeverity;
-            *outLastSeveritySourceTimeStamp = cond->lastSeveritySourceTimeStamp;
-            return UA_STATUSCODE_GOOD;
-        }
+    UA_Condition *cond = findCondition(server, conditionSource, conditionId);
+    if(!cond) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
+        return UA_STATUSCODE_BADNOTFOUND;
     }
-
-    UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
-    return UA_STATUSCODE_BADNOTFOUND;
+    *outLastSeverity = cond->lastSeverity;
+    *outLastSeveritySourceTimeStamp = cond->lastSeveritySourceTimeStamp;
+    return UA_STATUSCODE_GOOD;
 }
 
 static UA_StatusCode
 updateConditionLastSeverity(UA_Server *server, const UA_NodeId *conditionSource,
                             const UA_NodeId *conditionId, UA_UInt16 lastSeverity,
                             UA_DateTime lastSeveritySourceTimeStamp) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, conditionId))
-                continue;
-            cond->lastSeverity = lastSeverity;
-            cond->lastSeveritySourceTimeStamp =  lastSeveritySourceTimeStamp;
-            return UA_STATUSCODE_GOOD;
-        }
+    UA_Condition *cond = findCondition(server, conditionSource, conditionId);
+    if(!cond) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
+        return UA_STATUSCODE_BADNOTFOUND;
     }
-
-    UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
-    return UA_STATUSCODE_BADNOTFOUND;
+    cond->lastSeverity = lastSeverity;
+    cond->lastSeveritySourceTimeStamp =  lastSeveritySourceTimeStamp;
+    return UA_STATUSCODE_GOOD;
 }
 
 
@@ -419,171 +444,126 @@ static UA_StatusCode
 getConditionActiveState(UA_Server *server, const UA_NodeId *conditionSource,
                          const UA_NodeId *conditionId, UA_ActiveState *outLastActiveState,
                          UA_ActiveState *outCurrentActiveState, UA_Boolean *outIsLimitAlarm) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, conditionId))
-                continue;
-            *outLastActiveState = cond->lastActiveState;
-            *outCurrentActiveState = cond->currentActiveState;
-            *outIsLimitAlarm = cond->isLimitAlarm;
-            return UA_STATUSCODE_GOOD;
-        }
+    UA_Condition *cond = findCondition(server, conditionSource, conditionId);
+    if(!cond) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
+        return UA_STATUSCODE_BADNOTFOUND;
     }
-
-    UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
-    return UA_STATUSCODE_BADNOTFOUND;
+    *outLastActiveState = cond->lastActiveState;
+    *outCurrentActiveState = cond->currentActiveState;
+    *outIsLimitAlarm = cond->isLimitAlarm;
+    return UA_STATUSCODE_GOOD;
 }
 
 static UA_StatusCode
 updateConditionActiveState(UA_Server *server, const UA_NodeId *conditionSource,
                             const UA_NodeId *conditionId, const UA_ActiveState lastActiveState,
                             const UA_ActiveState currentActiveState, UA_Boolean isLimitAlarm) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, conditionId))
-                continue;
-            cond->lastActiveState = lastActiveState;
-            cond->currentActiveState = currentActiveState;
-            cond->isLimitAlarm = isLimitAlarm;
-            return UA_STATUSCODE_GOOD;
-        }
+    UA_Condition *cond = findCondition(server, conditionSource, conditionId);
+    if(!cond) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
+        return UA_STATUSCODE_BADNOTFOUND;
     }
+    cond->lastActiveState = lastActiveState;
+    cond->currentActiveState = currentActiveState;
+    cond->isLimitAlarm = isLimitAlarm;
+    return UA_STATUSCODE_GOOD;
+}
 
-    UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
-    return UA_STATUSCODE_BADNOTFOUND;
+/* Returns the main branch (BranchId == NULL) of the condition */
+static UA_ConditionBranch *
+getMainBranch(UA_Server *server, const UA_NodeId *condition,
+              const UA_NodeId *conditionSource) {
+    UA_Condition *cond = findCondition(server, conditionSource, condition);
+    if(!cond) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
+        return NULL;
+    }
+    UA_ConditionBranch *branch = LIST_FIRST(&cond->conditionBranchHead);
+    if(!branch || !UA_NodeId_isNull(&branch->conditionBranchId)) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND,
+                     "Condition Branch not implemented");
+        return NULL;
+    }
+    return branch;
 }
 
 static UA_StatusCode
 updateConditionLastEventId(UA_Server *server, const UA_NodeId *triggeredEvent,
                            const UA_NodeId *ConditionSource, const UA_ByteString *lastEventId) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, ConditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, triggeredEvent))
-                continue;
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                if(UA_NodeId_isNull(&branch->conditionBranchId)) {
-                    /* update main condition branch */
-                    UA_ByteString_deleteMembers(&branch->lastEventId);
-                    return UA_ByteString_copy(lastEventId, &branch->lastEventId);
-                }
-                UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND,
-                             "Condition Branch not implemented");
-                return UA_STATUSCODE_BADNOTFOUND;
-            }
-        }
-    }
-
-    UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
-    return UA_STATUSCODE_BADNOTFOUND;
+    /* update main condition branch */
+    UA_ConditionBranch *branch = getMainBranch(server, triggeredEvent, ConditionSource);
+    if(!branch)
+        return UA_STATUSCODE_BADNOTFOUND;
+    return setBranchLastEventId(server, branch, lastEventId);
 }
 
 static void
 setIsCallerAC(UA_Server *server, const UA_NodeId *condition,
               const UA_NodeId *conditionSource, UA_Boolean isCallerAC) {
-    /* Get conditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, condition))
-                continue;
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                if(UA_NodeId_isNull(&branch->conditionBranchId)) {
-                    branch->isCallerAC = isCallerAC;
-                    return;
-                }
-                UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND,
-                             "Condition Branch not implemented");
-                return;
-            }
-        }
-    }
-
-    UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Entry not found in list!");
+    UA_ConditionBranch *branch = getMainBranch(server, condition, conditionSource);
+    if(branch)
+        branch->isCallerAC = isCallerAC;
 }
 
 UA_Boolean
 isConditionOrBranch(UA_Server *server, const UA_NodeId *condition,
                     const UA_NodeId *conditionSource, UA_Boolean *isCallerAC) {
-    /* Get conditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, condition))
-                continue;
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                if(UA_NodeId_isNull(&branch->conditionBranchId)) {
-                    *isCallerAC = branch->isCallerAC;
-                    return true;
-                }
-                UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND,
-                             "Condition Branch not implemented");
-                return false;
-            }
-        }
+    UA_Condition *cond = findCondition(server, conditionSource, condition);
+    if(!cond)
+        return false;
+    UA_ConditionBranch *branch = LIST_FIRST(&cond->conditionBranchHead);
+    if(!branch)
+        return false;
+    if(!UA_NodeId_isNull(&branch->conditionBranchId)) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_USERLAND,
+                     "Condition Branch not implemented");
+        return false;
     }
-    return false;
+    *isCallerAC = branch->isCallerAC;
+    return true;
+}
+
+/* Returns the ConditionBranch entry of a Condition (main branch) or of a
+ * branch node */
+static UA_ConditionBranch *
+getBranchEntry(UA_Server *server, const UA_NodeId *conditionOrBranch) {
+    UA_Condition *cond = findCondition(server, NULL, conditionOrBranch);
+    if(cond)
+        return LIST_FIRST(&cond->conditionBranchHead);
+    return findConditionBranch(server, NULL, conditionOrBranch);
 }
 
 static UA_Boolean
 isRetained(UA_Server *server, const UA_NodeId *condition) {
-    /* Get EnabledStateId NodeId */
+    /* Get Retain NodeId. The NodeId is cached in the list entry. */
     UA_NodeId retainNodeId;
-    UA_StatusCode retval = getConditionFieldNodeId(server, condition, &fieldRetainQN, &retainNodeId);
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_USERLAND,
-                       "Retain not found. StatusCode %s", UA_StatusCode_name(retval));
-        return false; //TODO maybe a better error handling?
+    UA_ConditionBranch *branch = getBranchEntry(server, condition);
+    if(branch && !UA_NodeId_isNull(&branch->retainId)) {
+        retainNodeId = branch->retainId;
+    } else {
+        UA_StatusCode retval =
+            getConditionFieldNodeId(server, condition, &fieldRetainQN, &retainNodeId);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_USERLAND,
+                           "Retain not found. StatusCode %s", UA_StatusCode_name(retval));
+            return false; //TODO maybe a better error handling?
+        }
+        if(branch)
+            branch->retainId = retainNodeId; /* Move to the cache */
     }
 
     /* Read Retain value */
     UA_Variant tOutVariant;
     UA_Variant_init(&tOutVariant);
-
-    retval = UA_Server_readValue(server, retainNodeId, &tOutVariant);
-    if(retval != UA_STATUSCODE_GOOD ||
-       !UA_Variant_hasScalarType(&tOutVariant, &UA_TYPES[UA_TYPES_BOOLEAN])) {
-          UA_NodeId_deleteMembers(&retainNodeId);
-          return false;
-    }
-
-    if(*(UA_Boolean *)tOutVariant.data == true) {
-        UA_NodeId_deleteMembers(&retainNodeId);
-        UA_Variant_deleteMembers(&tOutVariant);
-        return true;
-    }
-
-    UA_NodeId_deleteMembers(&retainNodeId);
+    UA_StatusCode retval = UA_Server_readValue(server, retainNodeId, &tOutVariant);
+    UA_Boolean retained = (retval == UA_STATUSCODE_GOOD &&
+                           UA_Variant_hasScalarType(&tOutVariant, &UA_TYPES[UA_TYPES_BOOLEAN]) &&
+                           *(UA_Boolean *)tOutVariant.data == true);
     UA_Variant_deleteMembers(&tOutVariant);
-    return false;
+    if(!branch)
+        UA_NodeId_deleteMembers(&retainNodeId);
+    return retained;
 }
 
 static UA_Boolean
@@ -625,67 +605,56 @@ isTwoStateVariableInTrueState(UA_Server *server, const UA_NodeId *condition,
 static UA_StatusCode
 enteringDisabledState(UA_Server *server, const UA_NodeId *conditionId,
                       const UA_NodeId *conditionSource) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
+    /* Get Condition Entry */
+    UA_Condition *cond = findCondition(server, conditionSource, conditionId);
+    if(!cond)
+        return UA_STATUSCODE_BADNOTFOUND;
 
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, conditionId))
-                continue;
+    /* Get Branch Entry*/
+    UA_ConditionBranch *branch;
+    LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
+        UA_NodeId triggeredNode;
+        if(UA_NodeId_isNull(&branch->conditionBranchId))
+            //disable main Condition Branch (BranchId == NULL)
+            triggeredNode = cond->conditionId;
+        else //disable all branches
+            triggeredNode = branch->conditionBranchId;
+
+        UA_LocalizedText message = UA_LOCALIZEDTEXT(LOCALE, DISABLED_MESSAGE);
+        UA_LocalizedText enableText = UA_LOCALIZEDTEXT(LOCALE, DISABLED_TEXT);
+        UA_Variant value;
+        UA_Variant_setScalar(&value, &message, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        UA_StatusCode retval = UA_Server_setConditionField(server, triggeredNode,
+                                                           &value, fieldMessageQN);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "Set Condition Message failed",);
 
-            /* Get Branch Entry*/
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                UA_NodeId triggeredNode;
-                if(UA_NodeId_isNull(&branch->conditionBranchId))
-                    //disable main Condition Branch (BranchId == NULL)
-                    triggeredNode = cond->conditionId;
-                else //disable all branches
-                    triggeredNode = branch->conditionBranchId;
-
-                UA_LocalizedText message = UA_LOCALIZEDTEXT(LOCALE, DISABLED_MESSAGE);
-                UA_LocalizedText enableText = UA_LOCALIZEDTEXT(LOCALE, DISABLED_TEXT);
-                UA_Variant value;
-                UA_Variant_setScalar(&value, &message, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
-                UA_StatusCode retval = UA_Server_setConditionField(server, triggeredNode,
-                                                                   &value, fieldMessageQN);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "Set Condition Message failed",);
-
-                UA_Variant_setScalar(&value, &enableText, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
-                retval = UA_Server_setConditionField(server, triggeredNode, &value, fieldEnabledStateQN);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "Set Condition EnabledState text failed",);
-
-                UA_Boolean retain = false;
-                UA_Variant_setScalar(&value, &retain, &UA_TYPES[UA_TYPES_BOOLEAN]);
-                retval = UA_Server_setConditionField(server, triggeredNode, &value, fieldRetainQN);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "Set Condition Retain failed",);
-
-                /* Trigger event */
-                UA_ByteString lastEventId = UA_BYTESTRING_NULL;
-                /* Trigger the event for Condition or its Branch */
-                setIsCallerAC(server, &triggeredNode, conditionSource, true);
-                //Condition Nodes should not be deleted after triggering the event
-                retval = UA_Server_triggerEvent(server, triggeredNode, source->conditionSourceId,
-                                                &lastEventId, false);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "Triggering condition event failed",);
-                setIsCallerAC(server, &triggeredNode, conditionSource, false);
-
-                /* Update list */
-                retval = updateConditionLastEventId(server, &triggeredNode,
-                                                    &source->conditionSourceId, &lastEventId);
-                UA_ByteString_deleteMembers(&lastEventId);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "updating condition event failed",);
-            }
+        UA_Variant_setScalar(&value, &enableText, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        retval = UA_Server_setConditionField(server, triggeredNode, &value, fieldEnabledStateQN);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "Set Condition EnabledState text failed",);
 
-            return UA_STATUSCODE_GOOD;
-        }
+        UA_Boolean retain = false;
+        UA_Variant_setScalar(&value, &retain, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        retval = UA_Server_setConditionField(server, triggeredNode, &value, fieldRetainQN);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "Set Condition Retain failed",);
+
+        /* Trigger event */
+        UA_ByteString lastEventId = UA_BYTESTRING_NULL;
+        /* Trigger the event for Condition or its Branch */
+        setIsCallerAC(server, &triggeredNode, conditionSource, true);
+        //Condition Nodes should not be deleted after triggering the event
+        retval = UA_Server_triggerEvent(server, triggeredNode, *conditionSource,
+                                        &lastEventId, false);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "Triggering condition event failed",);
+        setIsCallerAC(server, &triggeredNode, conditionSource, false);
+
+        /* Update list */
+        retval = updateConditionLastEventId(server, &triggeredNode,
+                                            conditionSource, &lastEventId);
+        UA_ByteString_deleteMembers(&lastEventId);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "updating condition event failed",);
     }
 
-    return UA_STATUSCODE_BADNOTFOUND;
+    return UA_STATUSCODE_GOOD;
 }
 
 static UA_StatusCode
@@ -697,54 +666,45 @@ enteringEnabledState(UA_Server *server,
     UA_NodeId triggeredNode;
     UA_Variant value;
 
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(!UA_NodeId_equal(&cond->conditionId, conditionId))
-                continue;
-            /* Get Branch Entry*/
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                UA_NodeId_init(&triggeredNode);
-                if(UA_NodeId_isNull(&branch->conditionBranchId)) //enable main Condition
-                    triggeredNode = cond->conditionId;
-                else //enable branches
-                    triggeredNode = branch->conditionBranchId;
-
-                message = UA_LOCALIZEDTEXT(LOCALE, ENABLED_MESSAGE);
-                enableText = UA_LOCALIZEDTEXT(LOCALE, ENABLED_TEXT);
-                UA_Variant_setScalar(&value, &message, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
-                UA_StatusCode retval = UA_Server_setConditionField(server, triggeredNode,
-                                                                   &value, fieldMessageQN);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "set Condition Message failed",);
-
-                UA_Variant_setScalar(&value, &enableText, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
-                retval = UA_Server_setConditionField(server, triggeredNode, &value, fieldEnabledStateQN);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "set Condition EnabledState text failed",);
-
-                /* User callback TODO how should branches be evaluated? see p.19 (5.5.2) */
-                UA_Boolean removeBranch = false;//not used
-                retval = callConditionTwoStateVariableCallback(server, &triggeredNode,
-                                                               conditionSource, &removeBranch,
-                                                               UA_ENTERING_ENABLEDSTATE);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "calling condition callback failed",);
-
-                /* Trigger event */
-                //Condition Nodes should not be deleted after triggering the event
-                retval = UA_Server_triggerConditionEvent(server, triggeredNode, *conditionSource, NULL);
-                CONDITION_ASSERT_RETURN_RETVAL(retval, "triggering condition event failed",);
-            }
+    /* Get Condition Entry */
+    UA_Condition *cond = findCondition(server, conditionSource, conditionId);
+    if(!cond)
+        return UA_STATUSCODE_BADNOTFOUND;
 
-            return UA_STATUSCODE_GOOD;
-        }
+    /* Get Branch Entry*/
+    UA_ConditionBranch *branch;
+    LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
+        UA_NodeId_init(&triggeredNode);
+        if(UA_NodeId_isNull(&branch->conditionBranchId)) //enable main Condition
+            triggeredNode = cond->conditionId;
+        else //enable branches
+            triggeredNode = branch->conditionBranchId;
+
+        message = UA_LOCALIZEDTEXT(LOCALE, ENABLED_MESSAGE);
+        enableText = UA_LOCALIZEDTEXT(LOCALE, ENABLED_TEXT);
+        UA_Variant_setScalar(&value, &message, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        UA_StatusCode retval = UA_Server_setConditionField(server, triggeredNode,
+                                                           &value, fieldMessageQN);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "set Condition Message failed",);
+
+        UA_Variant_setScalar(&value, &enableText, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        retval = UA_Server_setConditionField(server, triggeredNode, &value, fieldEnabledStateQN);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "set Condition EnabledState text failed",);
+
+        /* User callback TODO how should branches be evaluated? see p.19 (5.5.2) */
+        UA_Boolean removeBranch = false;//not used
+        retval = callConditionTwoStateVariableCallback(server, &triggeredNode,
+                                                       conditionSource, &removeBranch,
+                                                       UA_ENTERING_ENABLEDSTATE);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "calling condition callback failed",);
+
+        /* Trigger event */
+        //Condition Nodes should not be deleted after triggering the event
+        retval = UA_Server_triggerConditionEvent(server, triggeredNode, *conditionSource, NULL);
+        CONDITION_ASSERT_RETURN_RETVAL(retval, "triggering condition event failed",);
     }
 
-    return UA_STATUSCODE_BADNOTFOUND;
+    return UA_STATUSCODE_GOOD;
 }
 
 static void
@@ -1593,67 +1553,171 @@ isConditionSourceInMonitoredItem(UA_Server *server, const UA_MonitoredItem *moni
                         parentReferences_conditions, 4);
 }
 
+/* Collect the retained conditions and branches of the sources monitored by the
+ * MonitoredItem (see 5.5.7). If the Server Object is being monitored, then the
+ * retained conditions of all sources are refreshed. */
 static UA_StatusCode
-refreshLogic(UA_Server *server, const UA_NodeId *refreshStartNodId,
-             const UA_NodeId *refreshEndNodId, UA_MonitoredItem *monitoredItem) {
-    if(monitoredItem == NULL)
-        return UA_STATUSCODE_BADINVALIDARGUMENT;
+collectRetainedConditions(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                          UA_ConditionRefresh *refresh) {
+    size_t capacity = 0;
+    UA_NodeId serverObjectNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    UA_Boolean allSources = UA_NodeId_equal(&monitoredItem->monitoredNodeId,
+                                            &serverObjectNodeId);
+    UA_ConditionSource *source;
+    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
+        /* Check if the conditionSource is being monitored */
+        if(!allSources &&
+           !UA_NodeId_equal(&monitoredItem->monitoredNodeId, &source->conditionSourceId) &&
+           !isConditionSourceInMonitoredItem(server, monitoredItem, &source->conditionSourceId))
+            continue;
 
-    /* 1. Trigger RefreshStartEvent */
-    UA_DateTime fieldTimeValue = UA_DateTime_now();
-    UA_StatusCode retval =
-        UA_Server_writeObjectProperty_scalar(server, *refreshStartNodId, fieldTimeQN,
-                                             &fieldTimeValue, &UA_TYPES[UA_TYPES_DATETIME]);
-    CONDITION_ASSERT_RETURN_RETVAL(retval, "Write Object Property scalar failed",);
+        UA_Condition *cond;
+        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
+            UA_ConditionBranch *branch;
+            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
+                /* If no event was triggered for that branch, then check next
+                 * without refreshing */
+                if(branch->lastEventId.length == 0)
+                    continue;
 
-    retval = UA_Event_addEventToMonitoredItem(server, refreshStartNodId, monitoredItem);
-    CONDITION_ASSERT_RETURN_RETVAL(retval, "Events: Could not add the event to a listening node",);
+                const UA_NodeId *triggeredNode = &branch->conditionBranchId;
+                if(UA_NodeId_isNull(triggeredNode))
+                    triggeredNode = &cond->conditionId;
+                if(!isRetained(server, triggeredNode))
+                    continue;
 
-    /* 2. refresh (see 5.5.7)*/
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        UA_NodeId conditionSource = source->conditionSourceId;
-        UA_NodeId serverObjectNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
-        /* Check if the conditionSource is being monitored. If the Server Object
-         * is being monitored, then all Events of all monitoredItems should be
-         * refreshed*/
-        if(UA_NodeId_equal(&monitoredItem->monitoredNodeId, &conditionSource) ||
-           UA_NodeId_equal(&monitoredItem->monitoredNodeId, &serverObjectNodeId) ||
-           isConditionSourceInMonitoredItem(server, monitoredItem, &conditionSource)) {
-            /* Get Condition Entry */
-            UA_Condition *cond;
-            LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-                /* Get Branch Entry*/
-                UA_ConditionBranch *branch;
-                LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                    /*if no event was triggered for that branch, then check next without refreshing*/
-                    if(UA_ByteString_equal(&branch->lastEventId, &UA_BYTESTRING_NULL))
-                        continue;
-
-                    UA_NodeId triggeredNode;
-                    if(UA_NodeId_isNull(&branch->conditionBranchId))
-                        triggeredNode = cond->conditionId;
-                    else
-                        triggeredNode = branch->conditionBranchId;
-
-                    /* Check if Retain is set to true*/
-                    if(isRetained(server, &triggeredNode)) {
-                        retval = UA_Event_addEventToMonitoredItem(server, &triggeredNode,
-                                                                  monitoredItem);
-                        CONDITION_ASSERT_RETURN_RETVAL(retval, "Events: Could not add the event to a listening node",);
-                    }
+                /* Grow the array */
+                if(refresh->conditionsSize == capacity) {
+                    capacity = (capacity > 0) ? capacity * 2 : 16;
+                    UA_NodeId *conditions = (UA_NodeId*)
+                        UA_realloc(refresh->conditions, capacity * sizeof(UA_NodeId));
+                    if(!conditions)
+                        return UA_STATUSCODE_BADOUTOFMEMORY;
+                    refresh->conditions = conditions;
                 }
+                UA_StatusCode retval =
+                    UA_NodeId_copy(triggeredNode, &refresh->conditions[refresh->conditionsSize]);
+                if(retval != UA_STATUSCODE_GOOD)
+                    return retval;
+                refresh->conditionsSize++;
             }
         }
     }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+deleteConditionRefresh(UA_ConditionRefresh *refresh) {
+    UA_Array_delete(refresh->conditions, refresh->conditionsSize,
+                    &UA_TYPES[UA_TYPES_NODEID]);
+    UA_free(refresh);
+}
+
+void
+UA_MonitoredItem_removeConditionRefresh(UA_MonitoredItem *mon) {
+    if(!mon->conditionRefresh)
+        return;
+    deleteConditionRefresh(mon->conditionRefresh);
+    mon->conditionRefresh = NULL;
+    if(mon->subscription)
+        mon->subscription->conditionRefreshes--;
+}
+
+/* Enqueue the events of the retained conditions while the notification queue
+ * has space. Dropping events of the refresh for the queue size would leave the
+ * client with an incomplete view of the conditions. After the last condition,
+ * the RefreshEndEvent is enqueued and the ConditionRefresh is removed. */
+static void
+continueConditionRefresh(UA_Server *server, UA_MonitoredItem *monitoredItem) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
+    UA_ConditionRefresh *refresh = monitoredItem->conditionRefresh;
+    while(monitoredItem->queue.size - monitoredItem->eventOverflows <
+          monitoredItem->maxQueueSize) {
+        if(refresh->conditionsSent < refresh->conditionsSize) {
+            /* The condition might have been deleted in the meantime */
+            UA_StatusCode retval =
+                UA_Event_addEventToMonitoredItem(server,
+                                                 &refresh->conditions[refresh->conditionsSent],
+                                                 monitoredItem);
+            if(retval != UA_STATUSCODE_GOOD)
+                UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                               "Events: Could not add the condition event of the "
+                               "refresh with StatusCode %s", UA_StatusCode_name(retval));
+            refresh->conditionsSent++;
+            continue;
+        }
+
+        /* Trigger RefreshEndEvent */
+        UA_DateTime fieldTimeValue = UA_DateTime_now();
+        UA_Variant value;
+        UA_Variant_setScalar(&value, &fieldTimeValue, &UA_TYPES[UA_TYPES_DATETIME]);
+        UA_StatusCode retval =
+            writeObjectProperty(server, refreshEvents[REFRESHEVENT_END_IDX],
+                                fieldTimeQN, value);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = UA_Event_addEventToMonitoredItem(server,
+                                                      &refreshEvents[REFRESHEVENT_END_IDX],
+                                                      monitoredItem);
+        if(retval != UA_STATUSCODE_GOOD)
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                           "Events: Could not add the RefreshEndEvent "
+                           "with StatusCode %s", UA_StatusCode_name(retval));
+        UA_MonitoredItem_removeConditionRefresh(monitoredItem);
+        return;
+    }
+}
+
+UA_UInt32
+UA_Subscription_continueConditionRefresh(UA_Server *server, UA_Subscription *sub) {
+    UA_UInt32 oldQueueSize = sub->notificationOrder.size;
+    UA_MonitoredItem *monitoredItem;
+    LIST_FOREACH(monitoredItem, &sub->monitoredItems, listEntry) {
+        if(monitoredItem->conditionRefresh)
+            continueConditionRefresh(server, monitoredItem);
+    }
+    return sub->notificationOrder.size - oldQueueSize;
+}
+
+/* Start the ConditionRefresh for the MonitoredItem. The events of the retained
+ * conditions that do not fit into the notification queue are enqueued with
+ * the following publish responses. */
+static UA_StatusCode
+refreshLogic(UA_Server *server, const UA_NodeId *refreshStartNodId,
+             UA_MonitoredItem *monitoredItem) {
+    if(monitoredItem == NULL)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    if(monitoredItem->conditionRefresh)
+        return UA_STATUSCODE_BADREFRESHINPROGRESS;
+
+    UA_ConditionRefresh *refresh = (UA_ConditionRefresh*)
+        UA_calloc(1, sizeof(UA_ConditionRefresh));
+    if(!refresh)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retval = collectRetainedConditions(server, monitoredItem, refresh);
+    CONDITION_ASSERT_RETURN_RETVAL(retval, "Collecting the retained conditions failed",
+                                   deleteConditionRefresh(refresh););
 
-    /* 3. Trigger RefreshEndEvent*/
-    fieldTimeValue = UA_DateTime_now();
-    retval = UA_Server_writeObjectProperty_scalar(server, *refreshEndNodId, fieldTimeQN,
+    /* 1. Trigger RefreshStartEvent */
+    UA_DateTime fieldTimeValue = UA_DateTime_now();
+    retval = UA_Server_writeObjectProperty_scalar(server, *refreshStartNodId, fieldTimeQN,
                                                   &fieldTimeValue, &UA_TYPES[UA_TYPES_DATETIME]);
-    CONDITION_ASSERT_RETURN_RETVAL(retval, "Write Object Property scalar failed",);
-    return UA_Event_addEventToMonitoredItem(server, refreshEndNodId, monitoredItem);
+    CONDITION_ASSERT_RETURN_RETVAL(retval, "Write Object Property scalar failed",
+                                   deleteConditionRefresh(refresh););
+
+    /* The refresh continues in the publish callback with the service mutex */
+    UA_LOCK(server->serviceMutex);
+    retval = UA_Event_addEventToMonitoredItem(server, refreshStartNodId, monitoredItem);
+    CONDITION_ASSERT_RETURN_RETVAL(retval, "Events: Could not add the event to a listening node",
+                                   UA_UNLOCK(server->serviceMutex);
+                                   deleteConditionRefresh(refresh););
+
+    /* 2. Stream the retained conditions and 3. trigger RefreshEndEvent */
+    monitoredItem->conditionRefresh = refresh;
+    if(monitoredItem->subscription)
+        monitoredItem->subscription->conditionRefreshes++;
+    continueConditionRefresh(server, monitoredItem);
+    UA_UNLOCK(server->serviceMutex);
+    return UA_STATUSCODE_GOOD;
 }
 
 static UA_StatusCode
@@ -1664,29 +1728,33 @@ refresh2MethodCallback(UA_Server *server, const UA_NodeId *sessionId,
                       const UA_Variant *input, size_t outputSize,
                       UA_Variant *output) {
     //TODO implement logic for subscription array
-    /* Check if valid subscriptionId */
+    /* Check if valid subscriptionId. The method callback is called without
+     * the service mutex. */
+    UA_LOCK(server->serviceMutex);
     UA_Session *session = UA_Server_getSessionById(server, sessionId);
     UA_Subscription *subscription =
         UA_Session_getSubscriptionById(session, *((UA_UInt32 *)input[0].data));
+    UA_MonitoredItem *monitoredItem = NULL;
+    if(subscription)
+        monitoredItem =
+            UA_Subscription_getMonitoredItem(subscription, *((UA_UInt32 *)input[1].data));
+    UA_Boolean inProgress = (monitoredItem && monitoredItem->conditionRefresh);
+    UA_UNLOCK(server->serviceMutex);
     if(!subscription)
         return UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
+    if(!monitoredItem)
+        return UA_STATUSCODE_BADMONITOREDITEMIDINVALID;
+    if(inProgress)
+        return UA_STATUSCODE_BADREFRESHINPROGRESS;
 
     /* set RefreshStartEvent and RefreshEndEvent */
     UA_StatusCode retval = setRefreshMethodEvents(server,
                                                   &refreshEvents[REFRESHEVENT_START_IDX],
                                                   &refreshEvents[REFRESHEVENT_END_IDX]);
     CONDITION_ASSERT_RETURN_RETVAL(retval, "Create Event RefreshStart or RefreshEnd failed",);
-    
-    /* Trigger RefreshStartEvent and RefreshEndEvent for the each monitoredItem
-     * in the subscription */
-    UA_MonitoredItem *monitoredItem =
-        UA_Subscription_getMonitoredItem(subscription, *((UA_UInt32 *)input[1].data));
-    if(!monitoredItem)
-        return UA_STATUSCODE_BADMONITOREDITEMIDINVALID;
 
-    //TODO when there are a lot of monitoreditems (not only events)?
-    retval = refreshLogic(server, &refreshEvents[REFRESHEVENT_START_IDX],
-                          &refreshEvents[REFRESHEVENT_END_IDX], monitoredItem);
+    /* Trigger RefreshStartEvent and RefreshEndEvent for the monitoredItem */
+    retval = refreshLogic(server, &refreshEvents[REFRESHEVENT_START_IDX], monitoredItem);
     CONDITION_ASSERT_RETURN_RETVAL(retval, "Could not refresh Condition",);
     return UA_STATUSCODE_GOOD;
 }
@@ -1699,26 +1767,34 @@ refreshMethodCallback(UA_Server *server, const UA_NodeId *sessionId,
                       const UA_Variant *input, size_t outputSize,
                       UA_Variant *output) {
     //TODO implement logic for subscription array
-    /* Check if valid subscriptionId */
+    /* Check if valid subscriptionId. The method callback is called without
+     * the service mutex. */
+    UA_LOCK(server->serviceMutex);
     UA_Session *session = UA_Server_getSessionById(server, sessionId);
     UA_Subscription *subscription =
         UA_Session_getSubscriptionById(session, *((UA_UInt32 *)input[0].data));
+    UA_Boolean inProgress = (subscription && subscription->conditionRefreshes > 0);
+    UA_UNLOCK(server->serviceMutex);
     if(!subscription)
         return UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
 
+    /* A refresh of the subscription is still streamed */
+    if(inProgress)
+        return UA_STATUSCODE_BADREFRESHINPROGRESS;
+
     /* set RefreshStartEvent and RefreshEndEvent */
     UA_StatusCode retval =
         setRefreshMethodEvents(server, &refreshEvents[REFRESHEVENT_START_IDX],
                                &refreshEvents[REFRESHEVENT_END_IDX]);
     CONDITION_ASSERT_RETURN_RETVAL(retval, "Create Event RefreshStart or RefreshEnd failed",);
-    
-    /* Trigger RefreshStartEvent and RefreshEndEvent for the each monitoredItem
-     * in the subscription */
-    //TODO when there are a lot of monitoreditems (not only events)?
+
+    /* Trigger RefreshStartEvent and RefreshEndEvent for the each event
+     * MonitoredItem in the subscription */
     UA_MonitoredItem *monitoredItem = NULL;
     LIST_FOREACH(monitoredItem, &subscription->monitoredItems, listEntry) {
-        retval = refreshLogic(server, &refreshEvents[REFRESHEVENT_START_IDX],
-                              &refreshEvents[REFRESHEVENT_END_IDX], monitoredItem);
+        if(monitoredItem->attributeId != UA_ATTRIBUTEID_EVENTNOTIFIER)
+            continue;
+        retval = refreshLogic(server, &refreshEvents[REFRESHEVENT_START_IDX], monitoredItem);
         CONDITION_ASSERT_RETURN_RETVAL(retval, "Could not refresh Condition",);
     }
     return UA_STATUSCODE_GOOD;
@@ -1746,25 +1822,45 @@ setConditionInConditionList(UA_Server *server, const UA_NodeId *conditionNodeId,
     UA_ConditionBranch *conditionBranchListEntry;
     conditionBranchListEntry = (UA_ConditionBranch*)UA_malloc(sizeof(UA_ConditionBranch));
     if(!conditionBranchListEntry) {
+        UA_NodeId_clear(&conditionListEntry->conditionId);
         UA_free(conditionListEntry);
         return UA_STATUSCODE_BADOUTOFMEMORY;
     }
-
     memset(conditionBranchListEntry, 0, sizeof(UA_ConditionBranch));
+
+    /* Add to the index */
+    retval = UA_NodeIdMap_insert(&server->conditionIndex, conditionNodeId,
+                                 conditionListEntry);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NodeId_clear(&conditionListEntry->conditionId);
+        UA_free(conditionListEntry);
+        UA_free(conditionBranchListEntry);
+        return retval;
+    }
+
+    conditionListEntry->source = conditionSourceEntry;
+    conditionBranchListEntry->condition = conditionListEntry;
     LIST_INSERT_HEAD(&conditionSourceEntry->conditionHead, conditionListEntry, listEntry);
     LIST_INSERT_HEAD(&conditionListEntry->conditionBranchHead, conditionBranchListEntry, listEntry);
     return UA_STATUSCODE_GOOD;
 }
 
+static void
+deleteConditionSource(UA_Server *server, UA_ConditionSource *source) {
+    conditionIndexRemove(&server->conditionSourceIndex,
+                         &source->conditionSourceId, source);
+    UA_NodeId_clear(&source->conditionSourceId);
+    LIST_REMOVE(source, listEntry);
+    UA_free(source);
+}
+
 static UA_StatusCode
 appendConditionEntry(UA_Server *server, const UA_NodeId *conditionNodeId,
                      const UA_NodeId *conditionSourceNodeId) {
     /* Get ConditionSource Entry to see if the ConditionSource Entry already exists*/
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        if(UA_NodeId_equal(&source->conditionSourceId, conditionSourceNodeId))
-            return setConditionInConditionList(server, conditionNodeId, source);
-    }
+    UA_ConditionSource *source = findConditionSource(server, conditionSourceNodeId);
+    if(source)
+        return setConditionInConditionList(server, conditionNodeId, source);
 
     /* ConditionSource not found in list, so we create a new ConditionSource Entry */
     UA_ConditionSource *conditionSourceListEntry;
@@ -1782,23 +1878,36 @@ appendConditionEntry(UA_Server *server, const UA_NodeId *conditionNodeId,
     }
 
     LIST_INSERT_HEAD(&server->headConditionSource, conditionSourceListEntry, listEntry);
-    return setConditionInConditionList(server, conditionNodeId, conditionSourceListEntry);
+    retval = UA_NodeIdMap_insert(&server->conditionSourceIndex,
+                                 conditionSourceNodeId, conditionSourceListEntry);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = setConditionInConditionList(server, conditionNodeId,
+                                             conditionSourceListEntry);
+    if(retval != UA_STATUSCODE_GOOD)
+        deleteConditionSource(server, conditionSourceListEntry);
+    return retval;
 }
 
-static void deleteAllBranchesFromCondition(UA_Condition *cond)
-{
+static void
+deleteAllBranchesFromCondition(UA_Server *server, UA_Condition *cond) {
     UA_ConditionBranch *branch, *tmp_branch;
     LIST_FOREACH_SAFE(branch, &cond->conditionBranchHead, listEntry, tmp_branch) {
+        UA_NodeId eventKey = eventIdKey(&branch->lastEventId);
+        conditionIndexRemove(&server->conditionBranchIndex,
+                             &branch->conditionBranchId, branch);
+        conditionIndexRemove(&server->conditionEventIndex, &eventKey, branch);
         UA_NodeId_clear(&branch->conditionBranchId);
+        UA_NodeId_clear(&branch->retainId);
         UA_ByteString_clear(&branch->lastEventId);
         LIST_REMOVE(branch, listEntry);
         UA_free(branch);
     }
 }
 
-static void deleteCondition(UA_Condition *cond)
-{
-    deleteAllBranchesFromCondition(cond);
+static void
+deleteCondition(UA_Server *server, UA_Condition *cond) {
+    deleteAllBranchesFromCondition(server, cond);
+    conditionIndexRemove(&server->conditionIndex, &cond->conditionId, cond);
     UA_NodeId_clear(&cond->conditionId);
     LIST_REMOVE(cond, listEntry);
     UA_free(cond);
@@ -1810,12 +1919,15 @@ UA_ConditionList_delete(UA_Server *server) {
     LIST_FOREACH_SAFE(source, &server->headConditionSource, listEntry, tmp_source) {
         UA_Condition *cond, *tmp_cond;
         LIST_FOREACH_SAFE(cond, &source->conditionHead, listEntry, tmp_cond) {
-            deleteCondition(cond);
+            deleteCondition(server, cond);
         }
-        UA_NodeId_clear(&source->conditionSourceId);
-        LIST_REMOVE(source, listEntry);
-        UA_free(source);
+        deleteConditionSource(server, source);
     }
+    UA_NodeIdMap_clear(&server->conditionSourceIndex);
+    UA_NodeIdMap_clear(&server->conditionIndex);
+    UA_NodeIdMap_clear(&server->conditionBranchIndex);
+    UA_NodeIdMap_clear(&server->conditionEventIndex);
+
     /* Free memory allocated for RefreshEvents NodeIds */
     UA_NodeId_clear(&refreshEvents[REFRESHEVENT_START_IDX]);
     UA_NodeId_clear(&refreshEvents[REFRESHEVENT_END_IDX]);
@@ -1826,27 +1938,15 @@ UA_ConditionList_delete(UA_Server *server) {
 UA_StatusCode
 UA_getConditionId(UA_Server *server, const UA_NodeId *conditionNodeId,
                   UA_NodeId *outConditionId) {
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source;
-    LIST_FOREACH(source, &server->headConditionSource, listEntry) {
-        /* Get Condition Entry */
-        UA_Condition *cond;
-        LIST_FOREACH(cond, &source->conditionHead, listEntry) {
-            if(UA_NodeId_equal(&cond->conditionId, conditionNodeId)) {
-                *outConditionId = cond->conditionId;
-                return UA_STATUSCODE_GOOD;
-            }
-            /* Get Branch Entry*/
-            UA_ConditionBranch *branch;
-            LIST_FOREACH(branch, &cond->conditionBranchHead, listEntry) {
-                if(UA_NodeId_equal(&branch->conditionBranchId, conditionNodeId)) {
-                    *outConditionId = cond->conditionId;
-                    return UA_STATUSCODE_GOOD;
-                }
-            }
-        }
-    }
-    return UA_STATUSCODE_BADNOTFOUND;
+    UA_Condition *cond = findCondition(server, NULL, conditionNodeId);
+    if(!cond) {
+        UA_ConditionBranch *branch = findConditionBranch(server, NULL, conditionNodeId);
+        if(!branch)
+            return UA_STATUSCODE_BADNOTFOUND;
+        cond = branch->condition;
+    }
+    *outConditionId = cond->conditionId;
+    return UA_STATUSCODE_GOOD;
 }
 
 /* Check whether the Condition Source Node has "EventSource" or one of its
@@ -2535,33 +2635,14 @@ UA_Server_triggerConditionEvent(UA_Server *server, const UA_NodeId condition,
 UA_StatusCode UA_Server_deleteCondition(UA_Server *server, const UA_NodeId condition, const UA_NodeId conditionSource)
 {
     // Delete from internal list
-    UA_Boolean found = UA_FALSE;
-    /* Get ConditionSource Entry */
-    UA_ConditionSource *source, *tmp_source;
-    LIST_FOREACH_SAFE(source, &server->headConditionSource, listEntry, tmp_source) {
-        if(!UA_NodeId_equal(&source->conditionSourceId, &conditionSource))
-            continue;
-        /* Get Condition Entry */
-        UA_Condition *cond, *tmp_cond;
-        LIST_FOREACH_SAFE(cond, &source->conditionHead, listEntry, tmp_cond) {
-            if(!UA_NodeId_equal(&cond->conditionId, &condition))
-                continue;
-            deleteCondition(cond);
-            found = UA_TRUE;
-            break;
-        }
-
-        if(LIST_EMPTY(&source->conditionHead)){
-            UA_NodeId_clear(&source->conditionSourceId);
-            LIST_REMOVE(source, listEntry);
-            UA_free(source);
-        }
-        break;
-    }
-    if(!found)
-    {
+    UA_Condition *cond = findCondition(server, &conditionSource, &condition);
+    if(!cond)
         return UA_STATUSCODE_BADNOTFOUND;
-    }
+    UA_ConditionSource *source = cond->source;
+    deleteCondition(server, cond);
+    if(LIST_EMPTY(&source->conditionHead))
+        deleteConditionSource(server, source);
+
     // Delete from address space
     return UA_Server_deleteNode(server, condition, true);
 }
@@ -11,12 +11,9 @@
 
 #include "ua_server_internal.h"
 #include "ua_subscription.h"
-#include "ua_types_encoding_binary.h"
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS /* conditional compilation */
 
-#define UA_VALUENCODING_MAXSTACK 512
-
 /* Convert to double first. We might loose differences for large Int64 that
  * cannot be precisely expressed as double. */
 static UA_Boolean
@@ -75,97 +72,28 @@ updateNeededForFilteredValue(const UA_Variant *value, const UA_Variant *oldValue
     return false;
 }
 
-/* When a change is detected, encoding contains the heap-allocated binary
- * encoded value. The default for changed is false. */
-static UA_StatusCode
-detectValueChangeWithFilter(UA_Server *server, UA_Session *session, UA_MonitoredItem *mon,
-                            UA_DataValue *value, UA_ByteString *encoding, UA_Boolean *changed) {
+/* Has this sample changed from the last one? The filtered sample is compared
+ * in place with the last sample. No memory is allocated. */
+static UA_Boolean
+detectValueChange(UA_Server *server, UA_MonitoredItem *mon,
+                  const UA_DataValue *value) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
+
     /* Check for absolute deadband */
-    if(UA_DataType_isNumeric(value->value.type) &&
+    if(mon->lastValueSet && UA_DataType_isNumeric(value->value.type) &&
        mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_ABSOLUTE) {
         UA_assert(value->value.type);
         if(mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUE ||
            mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP) {
-            if(!updateNeededForFilteredValue(&value->value, &mon->lastValue,
+            if(!updateNeededForFilteredValue(&value->value, &mon->lastValue.value,
                                              mon->filter.dataChangeFilter.deadbandValue))
-                return UA_STATUSCODE_GOOD;
-        }
-    }
-
-    /* Stack-allocate some memory for the value encoding. We might heap-allocate
-     * more memory if needed. This is just enough for scalars and small
-     * structures. */
-    UA_STACKARRAY(UA_Byte, stackValueEncoding, UA_VALUENCODING_MAXSTACK);
-    UA_ByteString valueEncoding;
-    valueEncoding.data = stackValueEncoding;
-    valueEncoding.length = UA_VALUENCODING_MAXSTACK;
-
-    /* Encode the value */
-    UA_Byte *bufPos = valueEncoding.data;
-    const UA_Byte *bufEnd = &valueEncoding.data[valueEncoding.length];
-    UA_StatusCode retval = UA_encodeBinary(value, &UA_TYPES[UA_TYPES_DATAVALUE],
-                                           &bufPos, &bufEnd, NULL, NULL);
-    if(retval == UA_STATUSCODE_BADENCODINGERROR) {
-        size_t binsize = UA_calcSizeBinary(value, &UA_TYPES[UA_TYPES_DATAVALUE]);
-        if(binsize == 0)
-            return UA_STATUSCODE_BADENCODINGERROR;
-
-        if(binsize > UA_VALUENCODING_MAXSTACK) {
-            retval = UA_ByteString_allocBuffer(&valueEncoding, binsize);
-            if(retval == UA_STATUSCODE_GOOD) {
-                bufPos = valueEncoding.data;
-                bufEnd = &valueEncoding.data[valueEncoding.length];
-                retval = UA_encodeBinary(value, &UA_TYPES[UA_TYPES_DATAVALUE],
-                                         &bufPos, &bufEnd, NULL, NULL);
-            }
+                return false;
         }
     }
-    if(retval != UA_STATUSCODE_GOOD) {
-        if(valueEncoding.data != stackValueEncoding)
-            UA_ByteString_clear(&valueEncoding);
-        return retval;
-    }
-
-    /* Has the value changed? */
-    valueEncoding.length = (uintptr_t)bufPos - (uintptr_t)valueEncoding.data;
-    *changed = (!mon->lastSampledValue.data ||
-                !UA_String_equal(&valueEncoding, &mon->lastSampledValue));
-
-    /* No change */
-    if(!(*changed)) {
-        if(valueEncoding.data != stackValueEncoding)
-            UA_ByteString_clear(&valueEncoding);
-        return UA_STATUSCODE_GOOD;
-    }
-
-    /* Change detected. Copy encoding on the heap if necessary. */
-    if(valueEncoding.data == stackValueEncoding)
-        return UA_ByteString_copy(&valueEncoding, encoding);
-
-    *encoding = valueEncoding;
-    return UA_STATUSCODE_GOOD;
-}
-
-/* Has this sample changed from the last one? The method may allocate additional
- * space for the encoding buffer. Detect the change in encoding->data. */
-static UA_StatusCode
-    detectValueChange(UA_Server *server, UA_Session *session, UA_MonitoredItem *mon,
-                  UA_DataValue value, UA_ByteString *encoding, UA_Boolean *changed) {
-    UA_LOCK_ASSERT(server->serviceMutex, 1);
-
-    /* Apply Filter */
-    if(mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUS)
-        value.hasValue = false;
-
-    value.hasServerTimestamp = false;
-    value.hasServerPicoseconds = false;
-    if(mon->filter.dataChangeFilter.trigger < UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP) {
-        value.hasSourceTimestamp = false;
-        value.hasSourcePicoseconds = false;
-    }
 
-    /* Detect the value change */
-    return detectValueChangeWithFilter(server, session, mon, &value, encoding, changed);
+    /* Compare with the last sample */
+    return (!mon->lastValueSet ||
+            !UA_equal(value, &mon->lastValue, &UA_TYPES[UA_TYPES_DATAVALUE]));
 }
 
 /* movedValue returns whether the sample was moved to the notification. The
@@ -176,34 +104,45 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
                         UA_DataValue *value, UA_Boolean *movedValue) {
     UA_assert(mon->attributeId != UA_ATTRIBUTEID_EVENTNOTIFIER);
 
-    /* Contains heap-allocated binary encoding of the value if a change was detected */
-    UA_ByteString binValueEncoding = UA_BYTESTRING_NULL;
-
-    /* Has the value changed? Allocates memory in binValueEncoding if necessary.
-     * value is edited internally so we make a shallow copy. */
-    UA_Boolean changed = false;
-    UA_StatusCode retval = detectValueChange(server, session, mon, *value, &binValueEncoding, &changed);
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_LOG_WARNING_SESSION(&server->config.logger, session, "Subscription %" PRIu32 " | "
-                               "MonitoredItem %" PRIi32 " | Value change detection failed with StatusCode %s",
-                               sub ? sub->subscriptionId : 0, mon->monitoredItemId,
-                               UA_StatusCode_name(retval));
-        return retval;
+    /* Apply the filter to a shallow copy of the sample. Only the content that
+     * is relevant for the trigger is compared and retained. */
+    UA_DataValue filtered = *value;
+    if(mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUS) {
+        filtered.hasValue = false;
+        UA_Variant_init(&filtered.value);
+    }
+    filtered.hasServerTimestamp = false;
+    filtered.hasServerPicoseconds = false;
+    if(mon->filter.dataChangeFilter.trigger < UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP) {
+        filtered.hasSourceTimestamp = false;
+        filtered.hasSourcePicoseconds = false;
     }
-    if(!changed) {
+
+    /* Has the value changed? */
+    if(!detectValueChange(server, mon, &filtered)) {
         UA_LOG_DEBUG_SESSION(&server->config.logger, session, "Subscription %" PRIu32 " | "
                              "MonitoredItem %" PRIi32 " | The value has not changed",
                              sub ? sub->subscriptionId : 0, mon->monitoredItemId);
         return UA_STATUSCODE_GOOD;
     }
 
+    /* Store the filtered sample for the comparison with the next sample. Copy
+     * before the sample is moved into the notification. If this fails, a
+     * notification will be forced for the next sample. */
+    UA_DataValue_clear(&mon->lastValue);
+    UA_StatusCode retval = UA_DataValue_copy(&filtered, &mon->lastValue);
+    mon->lastValueSet = (retval == UA_STATUSCODE_GOOD);
+#ifdef UA_ENABLE_DA
+    mon->lastStatus = value->status;
+#endif
+
     /* The MonitoredItem is attached to a subscription (not server-local).
      * Prepare a notification and enqueue it. */
     if(sub) {
         /* Allocate a new notification */
-        UA_Notification *newNotification = (UA_Notification *)UA_malloc(sizeof(UA_Notification));
+        UA_Notification *newNotification = UA_Notification_new(server);
         if(!newNotification) {
-            UA_ByteString_clear(&binValueEncoding);
+            mon->lastValueSet = false;
             return UA_STATUSCODE_BADOUTOFMEMORY;
         }
 
@@ -213,8 +152,9 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
         } else { /* => (value->value.storageType == UA_VARIANT_DATA_NODELETE) */
             retval = UA_DataValue_copy(value, &newNotification->data.value);
             if(retval != UA_STATUSCODE_GOOD) {
-                UA_ByteString_clear(&binValueEncoding);
-                UA_free(newNotification);
+                mon->lastValueSet = false;
+                newNotification->mon = mon;
+                UA_Notification_delete(server, newNotification);
                 return retval;
             }
         }
@@ -226,28 +166,12 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
                              sub ? sub->subscriptionId : 0, mon->monitoredItemId);
 
         newNotification->mon = mon;
-        UA_Notification_enqueue(server, sub, mon, newNotification);
-    }
-
-    /* Store the encoding for comparison */
-    UA_ByteString_clear(&mon->lastSampledValue);
-    mon->lastSampledValue = binValueEncoding;
-
-    /* Store the value for filter comparison (we don't want to decode
-     * lastSampledValue in every iteration). Don't test the return code here. If
-     * this fails, lastValue is empty and a notification will be forced for the
-     * next deadband comparison. */
-    if((mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_NONE ||
-        mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_ABSOLUTE ||
-        mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_PERCENT) &&
-       (mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUS ||
-        mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUE ||
-        mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP)) {
-        UA_Variant_clear(&mon->lastValue);
-        UA_Variant_copy(&value->value, &mon->lastValue);
-#ifdef UA_ENABLE_DA
-        mon->lastStatus = value->status;
-#endif
+        retval = UA_Notification_enqueue(server, sub, mon, newNotification);
+        if(retval != UA_STATUSCODE_GOOD) {
+            mon->lastValueSet = false;
+            UA_Notification_delete(server, newNotification);
+            return retval;
+        }
     }
 
     /* Call the local callback if the MonitoredItem is not attached to a
@@ -291,6 +215,7 @@ monitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem)
                          sub ? sub->subscriptionId : 0, monitoredItem->monitoredItemId);
 
     UA_assert(monitoredItem->attributeId != UA_ATTRIBUTEID_EVENTNOTIFIER);
+    monitoredItem->lastSampleTime = UA_DateTime_nowMonotonic();
 
     /* Get the node */
     const UA_Node *node = UA_NODESTORE_GET(server, &monitoredItem->monitoredNodeId);
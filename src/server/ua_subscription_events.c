@@ -8,36 +8,100 @@
 
 #include "ua_server_internal.h"
 #include "ua_subscription.h"
+#include "ua_types_encoding_binary.h"
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
 
-UA_StatusCode
-UA_MonitoredItem_removeNodeEventCallback(UA_Server *server, UA_Session *session,
-                                         UA_Node *node, void *data) {
-    if(node->head.nodeClass != UA_NODECLASS_OBJECT)
-        return UA_STATUSCODE_BADINVALIDARGUMENT;
-    UA_ObjectNode *on = (UA_ObjectNode*)node;
-    UA_MonitoredItem *remove = (UA_MonitoredItem*)data;
+static UA_EventRoute *
+findEventRoute(UA_Server *server, const UA_NodeId *notifier) {
+    void **route = UA_NodeIdMap_find(&server->eventRoutes, notifier);
+    return (route) ? (UA_EventRoute*)*route : NULL;
+}
 
-    if(!on->monitoredItemQueue)
-        return UA_STATUSCODE_GOOD;
+static void
+deleteEventRoute(UA_Server *server, UA_EventRoute *route) {
+    UA_NodeIdMap_remove(&server->eventRoutes, &route->notifier);
+    UA_NodeId_clear(&route->notifier);
+    UA_free(route);
+}
 
-    /* Edge case that it's the first element */
-    if(on->monitoredItemQueue == remove) {
-        on->monitoredItemQueue = remove->next;
-        return UA_STATUSCODE_GOOD;
+/* Remove the group and the route if they are empty */
+static void
+cleanupEventRoute(UA_Server *server, UA_EventRouteGroup *group) {
+    UA_EventRoute *route = group->route;
+    if(LIST_EMPTY(&group->monitoredItems)) {
+        LIST_REMOVE(group, listEntry);
+        UA_NodeId_clear(&group->ofType);
+        UA_free(group);
     }
+    if(LIST_EMPTY(&route->groups))
+        deleteEventRoute(server, route);
+}
 
-    UA_MonitoredItem *prev = on->monitoredItemQueue;
-    UA_MonitoredItem *entry = prev->next;
-    for(; entry != NULL; prev = entry, entry = entry->next) {
-        if(entry == remove) {
-            prev->next = entry->next;
-            return UA_STATUSCODE_GOOD;
+UA_StatusCode
+UA_EventRoute_addMonitoredItem(UA_Server *server, UA_MonitoredItem *mon) {
+    UA_assert(!mon->routeGroup);
+
+    /* Find or create the route of the notifier node */
+    UA_EventRoute *route = findEventRoute(server, &mon->monitoredNodeId);
+    if(!route) {
+        route = (UA_EventRoute*)UA_calloc(1, sizeof(UA_EventRoute));
+        if(!route)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        UA_StatusCode retval = UA_NodeId_copy(&mon->monitoredNodeId, &route->notifier);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_free(route);
+            return retval;
+        }
+        LIST_INIT(&route->groups);
+        retval = UA_NodeIdMap_insert(&server->eventRoutes, &route->notifier, route);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_NodeId_clear(&route->notifier);
+            UA_free(route);
+            return retval;
         }
     }
 
-    return UA_STATUSCODE_BADNOTFOUND;
+    /* Find or create the group for the event type. MonitoredItems without a
+     * type check (also with an invalid where clause) receive all events. */
+    UA_NodeId ofType = UA_NODEID_NULL;
+    if(mon->compiledEventFilter.ofType)
+        ofType = *mon->compiledEventFilter.ofType;
+    UA_EventRouteGroup *group;
+    LIST_FOREACH(group, &route->groups, listEntry) {
+        if(UA_NodeId_equal(&group->ofType, &ofType))
+            break;
+    }
+    if(!group) {
+        group = (UA_EventRouteGroup*)UA_calloc(1, sizeof(UA_EventRouteGroup));
+        if(!group) {
+            if(LIST_EMPTY(&route->groups))
+                deleteEventRoute(server, route);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        group->route = route;
+        LIST_INIT(&group->monitoredItems);
+        LIST_INSERT_HEAD(&route->groups, group, listEntry);
+        UA_StatusCode retval = UA_NodeId_copy(&ofType, &group->ofType);
+        if(retval != UA_STATUSCODE_GOOD) {
+            cleanupEventRoute(server, group);
+            return retval;
+        }
+    }
+
+    LIST_INSERT_HEAD(&group->monitoredItems, mon, routeEntry);
+    mon->routeGroup = group;
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_EventRoute_removeMonitoredItem(UA_Server *server, UA_MonitoredItem *mon) {
+    UA_EventRouteGroup *group = mon->routeGroup;
+    if(!group)
+        return;
+    LIST_REMOVE(mon, routeEntry);
+    mon->routeGroup = NULL;
+    cleanupEventRoute(server, group);
 }
 
 /* We use a 16-Byte ByteString as an identifier */
@@ -130,62 +194,218 @@ UA_Server_createEvent(UA_Server *server, const UA_NodeId eventType,
     return UA_STATUSCODE_GOOD;
 }
 
-static UA_Boolean
-isValidEvent(UA_Server *server, const UA_NodeId *validEventParent,
-             const UA_NodeId *eventId) {
-    /* find the eventType variableNode */
-    UA_QualifiedName findName = UA_QUALIFIEDNAME(0, "EventType");
-    UA_BrowsePathResult bpr = browseSimplifiedBrowsePath(server, *eventId, 1, &findName);
-    if(bpr.statusCode != UA_STATUSCODE_GOOD || bpr.targetsSize < 1) {
-        UA_BrowsePathResult_clear(&bpr);
-        return false;
+/* Information about the triggered event that is shared between all
+ * MonitoredItems receiving the event. The EventType property is read once. And
+ * every distinct browse path of the select clauses is resolved only once. */
+typedef struct {
+    UA_QualifiedName *browsePath;
+    size_t browsePathSize;
+    UA_StatusCode status;
+    UA_NodeId target;
+} ResolvedBrowsePath;
+
+/* Result of the OfType check for the event */
+typedef struct {
+    UA_NodeId ofType;
+    UA_Boolean match;
+} CheckedEventType;
+
+/* The select clauses of identical EventFilters (of the same Session) are
+ * evaluated once. The other MonitoredItems get a copy of the event fields. */
+typedef struct {
+    UA_Session *session;
+    const UA_EventFilter *filter; /* Points into a MonitoredItem */
+    UA_EventFieldList fields;
+    size_t next; /* Index + 1 of the next entry with the same key. 0 -> end */
+} SharedEventFields;
+
+typedef struct {
+    const UA_NodeId *eventNode;
+    UA_StatusCode eventTypeStatus;
+    UA_NodeId eventType;
+    UA_Boolean isBaseEventChecked;
+    UA_Boolean isBaseEvent;
+    UA_Boolean isConditionChecked;
+    UA_Boolean isCondition;
+    size_t resolvedSize;
+    ResolvedBrowsePath *resolved;
+    size_t checkedTypesSize;
+    CheckedEventType *checkedTypes;
+    size_t sharedFieldsSize;
+    SharedEventFields *sharedFields;
+    UA_NodeIdMap sharedFieldsIndex; /* Key from sharedFieldsKey. The value is
+                                     * the index + 1 of the first entry. */
+} EventContext;
+
+static void
+EventContext_init(UA_Server *server, EventContext *ctx, const UA_NodeId *eventNode) {
+    memset(ctx, 0, sizeof(EventContext));
+    ctx->eventNode = eventNode;
+
+    /* Read the EventType property (the value should be a NodeId) */
+    UA_Variant v;
+    UA_Variant_init(&v);
+    ctx->eventTypeStatus =
+        readObjectProperty(server, *eventNode, UA_QUALIFIEDNAME(0, "EventType"), &v);
+    if(ctx->eventTypeStatus != UA_STATUSCODE_GOOD)
+        return;
+    if(!UA_Variant_hasScalarType(&v, &UA_TYPES[UA_TYPES_NODEID]) || !v.data) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                     "EventType has an invalid type.");
+        ctx->eventTypeStatus = UA_STATUSCODE_BADINTERNALERROR;
+        UA_Variant_clear(&v);
+        return;
     }
+    ctx->eventType = *(UA_NodeId*)v.data;
+    UA_free(v.data); /* The NodeId was moved out */
+}
 
-    /* Get the EventType Property Node */
-    UA_Variant tOutVariant;
-    UA_Variant_init(&tOutVariant);
+static void
+EventContext_clear(EventContext *ctx) {
+    UA_NodeId_clear(&ctx->eventType);
+    for(size_t i = 0; i < ctx->resolvedSize; i++) {
+        UA_Array_delete(ctx->resolved[i].browsePath, ctx->resolved[i].browsePathSize,
+                        &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+        UA_NodeId_clear(&ctx->resolved[i].target);
+    }
+    UA_free(ctx->resolved);
+    for(size_t i = 0; i < ctx->checkedTypesSize; i++)
+        UA_NodeId_clear(&ctx->checkedTypes[i].ofType);
+    UA_free(ctx->checkedTypes);
+    for(size_t i = 0; i < ctx->sharedFieldsSize; i++)
+        UA_EventFieldList_clear(&ctx->sharedFields[i].fields);
+    UA_free(ctx->sharedFields);
+    UA_NodeIdMap_clear(&ctx->sharedFieldsIndex);
+}
 
-    /* Read the Value of EventType Property Node (the Value should be a NodeId) */
-    UA_StatusCode retval = readWithReadValue(server, &bpr.targets[0].targetId.nodeId,
-                                             UA_ATTRIBUTEID_VALUE, &tOutVariant);
-    if(retval != UA_STATUSCODE_GOOD ||
-       !UA_Variant_hasScalarType(&tOutVariant, &UA_TYPES[UA_TYPES_NODEID])) {
-        UA_BrowsePathResult_clear(&bpr);
-        return false;
+/* The shared event fields are indexed by the Session and the hash of the
+ * EventFilter. Entries with the same key are chained and compared in full. */
+static UA_NodeId
+sharedFieldsKey(const UA_Session *session, const UA_CompiledEventFilter *cf) {
+    UA_UInt32 h = UA_ByteString_hash(cf->filterHash, (const UA_Byte*)&session,
+                                     sizeof(const UA_Session*));
+    return UA_NODEID_NUMERIC(0, h);
+}
+
+/* Is the event type a subtype of ofType? The result is cached. */
+static UA_Boolean
+eventIsOfType(UA_Server *server, EventContext *ctx, const UA_NodeId *ofType) {
+    for(size_t i = 0; i < ctx->checkedTypesSize; i++) {
+        if(UA_NodeId_equal(&ctx->checkedTypes[i].ofType, ofType))
+            return ctx->checkedTypes[i].match;
     }
 
-    const UA_NodeId *tEventType = (UA_NodeId*)tOutVariant.data;
+    UA_NodeId hasSubtypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    UA_Boolean match = isNodeInTree(server, &ctx->eventType, ofType, &hasSubtypeId, 1);
+
+    /* Cache the result. Not caching (out of memory) is not an error. */
+    CheckedEventType *checked = (CheckedEventType*)
+        UA_realloc(ctx->checkedTypes, sizeof(CheckedEventType) * (ctx->checkedTypesSize + 1));
+    if(!checked)
+        return match;
+    ctx->checkedTypes = checked;
+    if(UA_NodeId_copy(ofType, &checked[ctx->checkedTypesSize].ofType) != UA_STATUSCODE_GOOD)
+        return match;
+    checked[ctx->checkedTypesSize].match = match;
+    ctx->checkedTypesSize++;
+    return match;
+}
+
+/* Check whether the event is valid for a select clause of the given
+ * TypeDefinition */
+static UA_Boolean
+isValidEvent(UA_Server *server, EventContext *ctx, const UA_NodeId *validEventParent) {
+    if(ctx->eventTypeStatus != UA_STATUSCODE_GOOD)
+        return false;
 
     /* check whether the EventType is a Subtype of CondtionType
      * (Part 9 first implementation) */
-    UA_NodeId conditionTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_CONDITIONTYPE);
     UA_NodeId hasSubtypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
-
-    if(UA_NodeId_equal(validEventParent, &conditionTypeId) &&
-       isNodeInTree(server, tEventType,
-					&conditionTypeId, &hasSubtypeId, 1)){
-        UA_BrowsePathResult_deleteMembers(&bpr);
-        UA_Variant_clear(&tOutVariant);
-        return true;
+    UA_NodeId conditionTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_CONDITIONTYPE);
+    if(UA_NodeId_equal(validEventParent, &conditionTypeId)) {
+        if(!ctx->isConditionChecked) {
+            ctx->isCondition = isNodeInTree(server, &ctx->eventType, &conditionTypeId,
+                                            &hasSubtypeId, 1);
+            ctx->isConditionChecked = true;
+        }
+        if(ctx->isCondition)
+            return true;
     }
 
     /*EventType is not a Subtype of CondtionType
      *(ConditionId Clause won't be present in Events, which are not Conditions)*/
     /* check whether Valid Event other than Conditions */
-    UA_NodeId baseEventTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
-    UA_Boolean isSubtypeOfBaseEvent = isNodeInTree(server, tEventType,
-                                                   &baseEventTypeId, &hasSubtypeId, 1);
+    if(!ctx->isBaseEventChecked) {
+        UA_NodeId baseEventTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
+        ctx->isBaseEvent = isNodeInTree(server, &ctx->eventType, &baseEventTypeId,
+                                        &hasSubtypeId, 1);
+        ctx->isBaseEventChecked = true;
+    }
+    return ctx->isBaseEvent;
+}
+
+/* Resolve the browse path relative to the event node. The result is cached for
+ * the other MonitoredItems. */
+static UA_StatusCode
+resolveBrowsePath(UA_Server *server, EventContext *ctx, size_t browsePathSize,
+                  const UA_QualifiedName *browsePath, const UA_NodeId **target) {
+    /* Already resolved? */
+    for(size_t i = 0; i < ctx->resolvedSize; i++) {
+        ResolvedBrowsePath *rbp = &ctx->resolved[i];
+        if(rbp->browsePathSize != browsePathSize)
+            continue;
+        size_t j = 0;
+        for(; j < browsePathSize; j++) {
+            if(!UA_QualifiedName_equal(&rbp->browsePath[j], &browsePath[j]))
+                break;
+        }
+        if(j < browsePathSize)
+            continue;
+        *target = &rbp->target;
+        return rbp->status;
+    }
 
+    /* Resolve the browse path */
+    UA_BrowsePathResult bpr =
+        browseSimplifiedBrowsePath(server, *ctx->eventNode, browsePathSize, browsePath);
+    if(bpr.targetsSize == 0 && bpr.statusCode == UA_STATUSCODE_GOOD)
+        bpr.statusCode = UA_STATUSCODE_BADNOTFOUND;
+
+    /* Store the result */
+    UA_QualifiedName *pathCopy = NULL;
+    UA_StatusCode retval = UA_Array_copy(browsePath, browsePathSize, (void**)&pathCopy,
+                                         &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+    ResolvedBrowsePath *resolved = NULL;
+    if(retval == UA_STATUSCODE_GOOD)
+        resolved = (ResolvedBrowsePath*)
+            UA_realloc(ctx->resolved, sizeof(ResolvedBrowsePath) * (ctx->resolvedSize + 1));
+    if(!resolved) {
+        UA_Array_delete(pathCopy, browsePathSize, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+        UA_BrowsePathResult_clear(&bpr);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    ctx->resolved = resolved;
+    ResolvedBrowsePath *rbp = &ctx->resolved[ctx->resolvedSize];
+    ctx->resolvedSize++;
+    rbp->browsePath = pathCopy;
+    rbp->browsePathSize = browsePathSize;
+    rbp->status = bpr.statusCode;
+    UA_NodeId_init(&rbp->target);
+    if(bpr.statusCode == UA_STATUSCODE_GOOD) {
+        /* Move the first matching element */
+        rbp->target = bpr.targets[0].targetId.nodeId;
+        UA_NodeId_init(&bpr.targets[0].targetId.nodeId);
+    }
     UA_BrowsePathResult_clear(&bpr);
-    UA_Variant_clear(&tOutVariant);
-    return isSubtypeOfBaseEvent;
+    *target = &rbp->target;
+    return rbp->status;
 }
 
 /* Part 4: 7.4.4.5 SimpleAttributeOperand
  * The clause can point to any attribute of nodes. Either a child of the event
  * node and also the event type. */
 static UA_StatusCode
-resolveSimpleAttributeOperand(UA_Server *server, UA_Session *session, const UA_NodeId *origin,
+resolveSimpleAttributeOperand(UA_Server *server, UA_Session *session, EventContext *ctx,
                               const UA_SimpleAttributeOperand *sao, UA_Variant *value) {
     /* Prepare the ReadValueId */
     UA_ReadValueId rvi;
@@ -203,7 +423,7 @@ resolveSimpleAttributeOperand(UA_Server *server, UA_Session *session, const UA_N
       // Set ConditionId
       if(UA_NodeId_equal(&sao->typeDefinitionId, &conditionTypeId)){
         UA_NodeId conditionId;
-        UA_StatusCode retval = UA_getConditionId(server, origin, &conditionId);
+        UA_StatusCode retval = UA_getConditionId(server, ctx->eventNode, &conditionId);
         if(retval != UA_STATUSCODE_GOOD)
           return retval;
 
@@ -225,154 +445,174 @@ resolveSimpleAttributeOperand(UA_Server *server, UA_Session *session, const UA_N
     }
 
     /* Resolve the browse path */
-    UA_BrowsePathResult bpr =
-        browseSimplifiedBrowsePath(server, *origin, sao->browsePathSize, sao->browsePath);
-    if(bpr.targetsSize == 0 && bpr.statusCode == UA_STATUSCODE_GOOD)
-        bpr.statusCode = UA_STATUSCODE_BADNOTFOUND;
-    if(bpr.statusCode != UA_STATUSCODE_GOOD) {
-        UA_StatusCode retval = bpr.statusCode;
-        UA_BrowsePathResult_clear(&bpr);
+    const UA_NodeId *target = NULL;
+    UA_StatusCode retval =
+        resolveBrowsePath(server, ctx, sao->browsePathSize, sao->browsePath, &target);
+    if(retval != UA_STATUSCODE_GOOD)
         return retval;
-    }
 
     /* Read the first matching element. Move the value to the output. */
-    rvi.nodeId = bpr.targets[0].targetId.nodeId;
+    rvi.nodeId = *target;
     UA_DataValue v = UA_Server_readWithSession(server, session, &rvi,
                                                UA_TIMESTAMPSTORETURN_NEITHER);
     if(v.status == UA_STATUSCODE_GOOD && v.hasValue)
         *value = v.value;
-
-    UA_BrowsePathResult_clear(&bpr);
     return v.status;
 }
 
-UA_StatusCode
-UA_Server_evaluateWhereClauseContentFilter(
-    UA_Server *server,
-    const UA_NodeId *eventNode,
-    const UA_ContentFilter *contentFilter) {
-    if(contentFilter->elements == NULL || contentFilter->elementsSize == 0)
-    {
+/* The first element of the where clause is evaluated. Only the OfType
+ * operator is supported so far. See 7.4.1 in Part 4, v1.04-Nov 22, 2017. */
+static void
+compileWhereClause(const UA_ContentFilter *contentFilter, UA_CompiledEventFilter *cf) {
+    cf->whereClauseResult = UA_STATUSCODE_GOOD;
+    cf->ofType = NULL;
+    if(contentFilter->elements == NULL || contentFilter->elementsSize == 0) {
         /* Nothing to do.*/
         /** @todo Whats the default result?*/
-        return UA_STATUSCODE_GOOD;
+        return;
     }
 
-    /* The first element needs to be evaluated, this might be linked to */
-    /* other elements, which are evaluated in these cases.*/
-    /* See 7.4.1 in Part 4, v1.04-Nov 22, 2017 */
-    UA_ContentFilterElement *pElement = &contentFilter->elements[0];
+    const UA_ContentFilterElement *pElement = &contentFilter->elements[0];
     /** @todo Verify retun types in specification or CTT */
-    switch (pElement->filterOperator)
-    {
-        case UA_FILTEROPERATOR_INVIEW:
-        case UA_FILTEROPERATOR_RELATEDTO:
-        {
-            /*Not allowed for event WhereClause according to 7.17.3 in */
-            /* Part 4, v1.04-Nov 22, 2017*/
-            return UA_STATUSCODE_BADEVENTFILTERINVALID;
+    switch(pElement->filterOperator) {
+    case UA_FILTEROPERATOR_INVIEW:
+    case UA_FILTEROPERATOR_RELATEDTO:
+        /* Not allowed for event WhereClause according to 7.17.3 in
+         * Part 4, v1.04-Nov 22, 2017 */
+        cf->whereClauseResult = UA_STATUSCODE_BADEVENTFILTERINVALID;
+        return;
+    case UA_FILTEROPERATOR_EQUALS:
+    case UA_FILTEROPERATOR_ISNULL:
+    case UA_FILTEROPERATOR_GREATERTHAN:
+    case UA_FILTEROPERATOR_LESSTHAN:
+    case UA_FILTEROPERATOR_GREATERTHANOREQUAL:
+    case UA_FILTEROPERATOR_LESSTHANOREQUAL:
+    case UA_FILTEROPERATOR_LIKE:
+    case UA_FILTEROPERATOR_NOT:
+    case UA_FILTEROPERATOR_BETWEEN:
+    case UA_FILTEROPERATOR_INLIST:
+    case UA_FILTEROPERATOR_AND:
+    case UA_FILTEROPERATOR_OR:
+    case UA_FILTEROPERATOR_CAST:
+    case UA_FILTEROPERATOR_BITWISEAND:
+    case UA_FILTEROPERATOR_BITWISEOR:
+        cf->whereClauseResult = UA_STATUSCODE_BADFILTEROPERATORUNSUPPORTED;
+        return;
+    case UA_FILTEROPERATOR_OFTYPE: {
+        if(pElement->filterOperandsSize != 1) {
+            cf->whereClauseResult = UA_STATUSCODE_BADFILTEROPERANDCOUNTMISMATCH;
+            return;
         }
-        case UA_FILTEROPERATOR_EQUALS:
-        case UA_FILTEROPERATOR_ISNULL:
-        case UA_FILTEROPERATOR_GREATERTHAN:
-        case UA_FILTEROPERATOR_LESSTHAN:
-        case UA_FILTEROPERATOR_GREATERTHANOREQUAL:
-        case UA_FILTEROPERATOR_LESSTHANOREQUAL:
-        case UA_FILTEROPERATOR_LIKE:
-        case UA_FILTEROPERATOR_NOT:
-        case UA_FILTEROPERATOR_BETWEEN:
-        case UA_FILTEROPERATOR_INLIST:
-        case UA_FILTEROPERATOR_AND:
-        case UA_FILTEROPERATOR_OR:
-        case UA_FILTEROPERATOR_CAST:
-        case UA_FILTEROPERATOR_BITWISEAND:
-        case UA_FILTEROPERATOR_BITWISEOR:
-        {
-            return UA_STATUSCODE_BADFILTEROPERATORUNSUPPORTED;
+        if(pElement->filterOperands[0].content.decoded.type !=
+           &UA_TYPES[UA_TYPES_LITERALOPERAND]) {
+            cf->whereClauseResult = UA_STATUSCODE_BADFILTEROPERATORUNSUPPORTED;
+            return;
         }
-        case UA_FILTEROPERATOR_OFTYPE:
-        {
-            UA_Boolean result = UA_FALSE;
-            if(pElement->filterOperandsSize != 1)
-            {
-                return UA_STATUSCODE_BADFILTEROPERANDCOUNTMISMATCH;
-            }
-            if(pElement->filterOperands[0].content.decoded.type !=
-                &UA_TYPES[UA_TYPES_LITERALOPERAND])
-            {
-                return UA_STATUSCODE_BADFILTEROPERATORUNSUPPORTED;
-            }
-            UA_LiteralOperand *pOperand =
-                (UA_LiteralOperand *) pElement->filterOperands[0].content.decoded.data;
-            if(!UA_Variant_isScalar(&pOperand->value))
-            {
-                return UA_STATUSCODE_BADEVENTFILTERINVALID;
-            }
-
-            if(pOperand->value.type != &UA_TYPES[UA_TYPES_NODEID]
-                || pOperand->value.data == NULL)
-            {
-                result = UA_FALSE;
-            }
-            else {
-                UA_NodeId *pOperandNodeId = (UA_NodeId *) pOperand->value.data;
-                UA_NodeId hasSubtypeId =
-                    UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
-                UA_QualifiedName eventTypeQualifiedName =
-                    UA_QUALIFIEDNAME(0, "EventType");
-                UA_Variant typeNodeIdVariant;
-                UA_Variant_init(&typeNodeIdVariant);
-                UA_StatusCode readStatusCode =
-                    readObjectProperty(
-                        server, *eventNode,
-                        eventTypeQualifiedName, &typeNodeIdVariant);
-                if(readStatusCode != UA_STATUSCODE_GOOD)
-                {
-                    return readStatusCode;
-                }
-
-                if(!UA_Variant_isScalar(&typeNodeIdVariant)
-                    || typeNodeIdVariant.type != &UA_TYPES[UA_TYPES_NODEID]
-                    || typeNodeIdVariant.data == NULL)
-                {
-                    UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
-                     "EventType has an invalid type.");
-                    UA_Variant_clear(&typeNodeIdVariant);
-                    return UA_STATUSCODE_BADINTERNALERROR;
-                }
-                result = isNodeInTree(
-                    server, (UA_NodeId*) typeNodeIdVariant.data,
-                    pOperandNodeId, &hasSubtypeId, 1);
-                UA_Variant_clear(&typeNodeIdVariant);
-            }
-
-            if(result)
-            {
-                return UA_STATUSCODE_GOOD;
-            }
-            else
-            {
-                return UA_STATUSCODE_BADNOMATCH;
-            }
+        const UA_LiteralOperand *pOperand = (const UA_LiteralOperand *)
+            pElement->filterOperands[0].content.decoded.data;
+        if(!UA_Variant_isScalar(&pOperand->value)) {
+            cf->whereClauseResult = UA_STATUSCODE_BADEVENTFILTERINVALID;
+            return;
         }
-            break;
-        default:
-            return UA_STATUSCODE_BADFILTEROPERATORINVALID;
-            break;
+        if(pOperand->value.type != &UA_TYPES[UA_TYPES_NODEID] ||
+           pOperand->value.data == NULL) {
+            /* Never matches */
+            cf->whereClauseResult = UA_STATUSCODE_BADNOMATCH;
+            return;
         }
+        cf->ofType = (const UA_NodeId*)pOperand->value.data;
+        return;
+    }
+    default:
+        cf->whereClauseResult = UA_STATUSCODE_BADFILTEROPERATORINVALID;
+        return;
+    }
+}
+
+static UA_UInt32
+eventFilterHash(const UA_EventFilter *filter) {
+    size_t size = UA_calcSizeBinary(filter, &UA_TYPES[UA_TYPES_EVENTFILTER]);
+    UA_ByteString buf;
+    if(size == 0 || UA_ByteString_allocBuffer(&buf, size) != UA_STATUSCODE_GOOD)
+        return 0;
+    UA_Byte *pos = buf.data;
+    const UA_Byte *end = &buf.data[buf.length];
+    UA_UInt32 h = 0;
+    if(UA_encodeBinary(filter, &UA_TYPES[UA_TYPES_EVENTFILTER],
+                       &pos, &end, NULL, NULL) == UA_STATUSCODE_GOOD)
+        h = UA_ByteString_hash(0, buf.data, buf.length);
+    UA_ByteString_clear(&buf);
+    return h;
+}
+
+UA_StatusCode
+UA_CompiledEventFilter_init(UA_CompiledEventFilter *cf, const UA_EventFilter *filter) {
+    memset(cf, 0, sizeof(UA_CompiledEventFilter));
+    compileWhereClause(&filter->whereClause, cf);
+    cf->filterHash = eventFilterHash(filter);
+
+    /* Check if the browsePath is BaseEventType, in which case nothing more
+     * needs to be checked */
+    if(filter->selectClausesSize == 0)
+        return UA_STATUSCODE_GOOD;
+    cf->checkEventType = (UA_Boolean*)
+        UA_malloc(sizeof(UA_Boolean) * filter->selectClausesSize);
+    if(!cf->checkEventType)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    cf->selectClausesSize = filter->selectClausesSize;
+    UA_NodeId baseEventTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
+    for(size_t i = 0; i < filter->selectClausesSize; i++)
+        cf->checkEventType[i] =
+            !UA_NodeId_equal(&filter->selectClauses[i].typeDefinitionId, &baseEventTypeId);
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_CompiledEventFilter_clear(UA_CompiledEventFilter *cf) {
+    UA_free(cf->checkEventType);
+    memset(cf, 0, sizeof(UA_CompiledEventFilter));
+}
+
+static UA_StatusCode
+evaluateWhereClause(UA_Server *server, EventContext *ctx,
+                    const UA_CompiledEventFilter *cf) {
+    if(cf->whereClauseResult != UA_STATUSCODE_GOOD || !cf->ofType)
+        return cf->whereClauseResult;
+    if(ctx->eventTypeStatus != UA_STATUSCODE_GOOD)
+        return ctx->eventTypeStatus;
+    if(!eventIsOfType(server, ctx, cf->ofType))
+        return UA_STATUSCODE_BADNOMATCH;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_evaluateWhereClauseContentFilter(
+    UA_Server *server,
+    const UA_NodeId *eventNode,
+    const UA_ContentFilter *contentFilter) {
+    UA_CompiledEventFilter cf;
+    memset(&cf, 0, sizeof(UA_CompiledEventFilter));
+    compileWhereClause(contentFilter, &cf);
+    if(cf.whereClauseResult != UA_STATUSCODE_GOOD || !cf.ofType)
+        return cf.whereClauseResult;
+
+    EventContext ctx;
+    EventContext_init(server, &ctx, eventNode);
+    UA_StatusCode retval = evaluateWhereClause(server, &ctx, &cf);
+    EventContext_clear(&ctx);
+    return retval;
 }
 
 /* Filters the given event with the given filter and writes the results into a
  * notification */
 static UA_StatusCode
-UA_Server_filterEvent(UA_Server *server, UA_Session *session,
-                      const UA_NodeId *eventNode, UA_EventFilter *filter,
+UA_Server_filterEvent(UA_Server *server, UA_Session *session, EventContext *ctx,
+                      const UA_EventFilter *filter, const UA_CompiledEventFilter *cf,
                       UA_EventNotification *notification) {
     if (filter->selectClausesSize == 0)
         return UA_STATUSCODE_BADEVENTFILTERINVALID;
 
-    UA_StatusCode retVal = UA_Server_evaluateWhereClauseContentFilter(
-        server, eventNode, &filter->whereClause);
+    UA_StatusCode retVal = evaluateWhereClause(server, ctx, cf);
     if(retVal != UA_STATUSCODE_GOOD)
     {
         return retVal;
@@ -402,13 +642,9 @@ UA_Server_filterEvent(UA_Server *server, UA_Session *session,
     */
 
     /* Apply the filter */
-
-    /* Check if the browsePath is BaseEventType, in which case nothing more
-     * needs to be checked */
-    UA_NodeId baseEventTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
     for(size_t i = 0; i < filter->selectClausesSize; i++) {
-        if(!UA_NodeId_equal(&filter->selectClauses[i].typeDefinitionId, &baseEventTypeId) &&
-           !isValidEvent(server, &filter->selectClauses[i].typeDefinitionId, eventNode)) {
+        if(cf->checkEventType[i] &&
+           !isValidEvent(server, ctx, &filter->selectClauses[i].typeDefinitionId)) {
             UA_Variant_init(&notification->fields.eventFields[i]);
             /* EventFilterResult currently isn't being used
             notification->result.selectClauseResults[i] = UA_STATUSCODE_BADTYPEDEFINITIONINVALID; */
@@ -416,7 +652,7 @@ UA_Server_filterEvent(UA_Server *server, UA_Session *session,
         }
 
         /* TODO: Put the result into the selectClausResults */
-        resolveSimpleAttributeOperand(server, session, eventNode,
+        resolveSimpleAttributeOperand(server, session, ctx,
                                       &filter->selectClauses[i],
                                       &notification->fields.eventFields[i]);
     }
@@ -496,35 +732,113 @@ eventSetStandardFields(UA_Server *server, const UA_NodeId *event,
 
 /* Filters an event according to the filter specified by mon and then adds it to
  * mons notification queue */
-UA_StatusCode
-UA_Event_addEventToMonitoredItem(UA_Server *server, const UA_NodeId *event, UA_MonitoredItem *mon) {
-    UA_Notification *notification = (UA_Notification *) UA_malloc(sizeof(UA_Notification));
+static UA_StatusCode
+addEventToMonitoredItem(UA_Server *server, EventContext *ctx, UA_MonitoredItem *mon) {
+    UA_Notification *notification = UA_Notification_new(server);
     if(!notification)
         return UA_STATUSCODE_BADOUTOFMEMORY;
+    notification->mon = mon;
+    UA_EventFieldList_init(&notification->data.event.fields);
 
     /* Get the session */
     UA_Subscription *sub = mon->subscription;
     UA_Session *session = sub->session;
 
+    /* Reuse the event fields of an identical filter */
+    const UA_EventFilter *filter = &mon->filter.eventFilter;
+    UA_NodeId key = sharedFieldsKey(session, &mon->compiledEventFilter);
+    void **head = UA_NodeIdMap_find(&ctx->sharedFieldsIndex, &key);
+    size_t next = (head) ? (size_t)(uintptr_t)*head : 0;
+    while(next > 0) {
+        SharedEventFields *sf = &ctx->sharedFields[next - 1];
+        next = sf->next;
+        if(sf->session != session)
+            continue;
+        if(sf->filter != filter &&
+           !UA_equal(sf->filter, filter, &UA_TYPES[UA_TYPES_EVENTFILTER]))
+            continue;
+        UA_StatusCode retval =
+            UA_EventFieldList_copy(&sf->fields, &notification->data.event.fields);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_Notification_delete(server, notification);
+            return retval;
+        }
+        retval = UA_Notification_enqueue(server, mon->subscription, mon, notification);
+        if(retval != UA_STATUSCODE_GOOD)
+            UA_Notification_delete(server, notification);
+        return retval;
+    }
 
     /* Apply the filter */
     UA_StatusCode retval =
-        UA_Server_filterEvent(server, session, event, &mon->filter.eventFilter,
-                              &notification->data.event);
+        UA_Server_filterEvent(server, session, ctx, filter,
+                              &mon->compiledEventFilter, &notification->data.event);
     if(retval == UA_STATUSCODE_BADNOMATCH)
     {
-        UA_free(notification);
+        UA_Notification_delete(server, notification);
         return UA_STATUSCODE_GOOD;
     }
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_free(notification);
+        UA_Notification_delete(server, notification);
         return retval;
     }
 
+    /* Share the event fields with the following MonitoredItems. Not sharing
+     * (out of memory) is not an error. */
+    SharedEventFields *shared = (SharedEventFields*)
+        UA_realloc(ctx->sharedFields, sizeof(SharedEventFields) * (ctx->sharedFieldsSize + 1));
+    if(shared) {
+        ctx->sharedFields = shared;
+        SharedEventFields *sf = &shared[ctx->sharedFieldsSize];
+        sf->session = session;
+        sf->filter = filter;
+        sf->next = (head) ? (size_t)(uintptr_t)*head : 0;
+        if(UA_EventFieldList_copy(&notification->data.event.fields,
+                                  &sf->fields) == UA_STATUSCODE_GOOD) {
+            void *pos = (void*)(uintptr_t)(ctx->sharedFieldsSize + 1);
+            if(UA_NodeIdMap_insert(&ctx->sharedFieldsIndex, &key, pos) ==
+               UA_STATUSCODE_GOOD)
+                ctx->sharedFieldsSize++;
+            else
+                UA_EventFieldList_clear(&sf->fields);
+        }
+    }
+
     /* Enqueue the notification */
-    notification->mon = mon;
-    UA_Notification_enqueue(server, mon->subscription, mon, notification);
-    return UA_STATUSCODE_GOOD;
+    retval = UA_Notification_enqueue(server, mon->subscription, mon, notification);
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_Notification_delete(server, notification);
+    return retval;
+}
+
+UA_StatusCode
+UA_Event_addEventToMonitoredItem(UA_Server *server, const UA_NodeId *event, UA_MonitoredItem *mon) {
+    EventContext ctx;
+    EventContext_init(server, &ctx, event);
+    UA_StatusCode retval = addEventToMonitoredItem(server, &ctx, mon);
+    EventContext_clear(&ctx);
+    return retval;
+}
+
+/* Add the event to the MonitoredItems listening on the notifier node. Skip the
+ * groups of MonitoredItems whose type check does not match. */
+static void
+routeEvent(UA_Server *server, EventContext *ctx, UA_EventRoute *route) {
+    UA_EventRouteGroup *group;
+    LIST_FOREACH(group, &route->groups, listEntry) {
+        if(!UA_NodeId_isNull(&group->ofType) &&
+           ctx->eventTypeStatus == UA_STATUSCODE_GOOD &&
+           !eventIsOfType(server, ctx, &group->ofType))
+            continue;
+        UA_MonitoredItem *mon;
+        LIST_FOREACH(mon, &group->monitoredItems, routeEntry) {
+            UA_StatusCode retval = addEventToMonitoredItem(server, ctx, mon);
+            if(retval != UA_STATUSCODE_GOOD)
+                UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                               "Events: Could not add the event to a listening node with StatusCode %s",
+                               UA_StatusCode_name(retval));
+        }
+    }
 }
 
 static const UA_NodeId objectsFolderId = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_OBJECTSFOLDER}};
@@ -646,25 +960,12 @@ UA_Server_triggerEvent(UA_Server *server, const UA_NodeId eventNodeId,
     }
 
     /* Add the event to the listening MonitoredItems at each relevant node */
+    EventContext ctx;
+    EventContext_init(server, &ctx, &eventNodeId);
     for(size_t i = 0; i < emitNodesSize; i++) {
-        const UA_ObjectNode *node = (const UA_ObjectNode*)
-            UA_NODESTORE_GET(server, &emitNodes[i].nodeId);
-        if(!node)
-            continue;
-        if(node->head.nodeClass != UA_NODECLASS_OBJECT) {
-            UA_NODESTORE_RELEASE(server, (const UA_Node*)node);
-            continue;
-        }
-        for(UA_MonitoredItem *mi = node->monitoredItemQueue; mi != NULL; mi = mi->next) {
-            retval = UA_Event_addEventToMonitoredItem(server, &eventNodeId, mi);
-            if(retval != UA_STATUSCODE_GOOD) {
-                UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
-                               "Events: Could not add the event to a listening node with StatusCode %s",
-                               UA_StatusCode_name(retval));
-                retval = UA_STATUSCODE_GOOD; /* Only log problems with individual emit nodes */
-            }
-        }
-        UA_NODESTORE_RELEASE(server, (const UA_Node*)node);
+        UA_EventRoute *route = findEventRoute(server, &emitNodes[i].nodeId);
+        if(route)
+            routeEvent(server, &ctx, route);
 #ifdef UA_ENABLE_HISTORIZING
         if(!server->config.historyDatabase.setEvent)
             continue;
@@ -697,8 +998,12 @@ UA_Server_triggerEvent(UA_Server *server, const UA_NodeId eventNodeId,
         else {
             filter = (UA_EventFilter*)historicalEventFilterValue.data;
             UA_EventNotification eventNotification;
-            retval = UA_Server_filterEvent(server, &server->adminSession, &eventNodeId,
-                                           filter, &eventNotification);
+            UA_CompiledEventFilter cf;
+            retval = UA_CompiledEventFilter_init(&cf, filter);
+            if(retval == UA_STATUSCODE_GOOD)
+                retval = UA_Server_filterEvent(server, &server->adminSession, &ctx,
+                                               filter, &cf, &eventNotification);
+            UA_CompiledEventFilter_clear(&cf);
             if(retval == UA_STATUSCODE_GOOD) {
                 fieldList = UA_EventFieldList_new();
                 *fieldList = eventNotification.fields;
@@ -717,6 +1022,7 @@ UA_Server_triggerEvent(UA_Server *server, const UA_NodeId eventNodeId,
         retval = UA_STATUSCODE_GOOD;
 #endif
     }
+    EventContext_clear(&ctx);
 
     /* Delete the node representation of the event */
     if(deleteEventNode) {
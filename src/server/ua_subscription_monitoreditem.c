@@ -14,6 +14,91 @@
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS /* conditional compilation */
 
+/****************/
+/* Pointer Ring */
+/****************/
+
+/* Grow to at least the required capacity. The entries are moved to the start
+ * of the new buffer. */
+static UA_StatusCode
+UA_PointerRing_reserve(UA_PointerRing *ring, UA_UInt32 capacity) {
+    if(capacity <= ring->capacity)
+        return UA_STATUSCODE_GOOD;
+    UA_UInt32 newCapacity = (ring->capacity > 0) ? ring->capacity : 4;
+    while(newCapacity < capacity) {
+        if(newCapacity > UA_UINT32_MAX / 2)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        newCapacity *= 2;
+    }
+    void **entries = (void**)UA_malloc(newCapacity * sizeof(void*));
+    if(!entries)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(UA_UInt32 i = 0; i < ring->size; i++)
+        entries[i] = UA_PointerRing_get(ring, i);
+    UA_free(ring->entries);
+    ring->entries = entries;
+    ring->capacity = newCapacity;
+    ring->start = 0;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Insert before the i-th entry. The capacity must have been reserved. Moves
+ * the entries on the shorter side of the position. So adding to the front or
+ * the back takes constant time. */
+static void
+UA_PointerRing_insert(UA_PointerRing *ring, UA_UInt32 i, void *p) {
+    UA_assert(ring->size < ring->capacity && i <= ring->size);
+    UA_UInt32 mask = ring->capacity - 1;
+    if(i < ring->size / 2) {
+        ring->start = (ring->start - 1) & mask;
+        for(UA_UInt32 j = 0; j < i; j++)
+            ring->entries[(ring->start + j) & mask] =
+                ring->entries[(ring->start + j + 1) & mask];
+    } else {
+        for(UA_UInt32 j = ring->size; j > i; j--)
+            ring->entries[(ring->start + j) & mask] =
+                ring->entries[(ring->start + j - 1) & mask];
+    }
+    ring->entries[(ring->start + i) & mask] = p;
+    ring->size++;
+}
+
+/* Remove the i-th entry. Moves the entries on the shorter side. */
+static void
+UA_PointerRing_remove(UA_PointerRing *ring, UA_UInt32 i) {
+    UA_assert(i < ring->size);
+    UA_UInt32 mask = ring->capacity - 1;
+    if(i < ring->size / 2) {
+        for(UA_UInt32 j = i; j > 0; j--)
+            ring->entries[(ring->start + j) & mask] =
+                ring->entries[(ring->start + j - 1) & mask];
+        ring->start = (ring->start + 1) & mask;
+    } else {
+        for(UA_UInt32 j = i; j + 1 < ring->size; j++)
+            ring->entries[(ring->start + j) & mask] =
+                ring->entries[(ring->start + j + 1) & mask];
+    }
+    ring->size--;
+}
+
+void
+UA_PointerRing_clear(UA_PointerRing *ring) {
+    UA_free(ring->entries);
+    memset(ring, 0, sizeof(UA_PointerRing));
+}
+
+/* Position of the last entry for the MonitoredItem in the order of the
+ * Subscription. The MonitoredItem must be in REPORTING mode and have queued
+ * notifications. Constant time if the last entry of the order belongs to the
+ * MonitoredItem. That is the case after a notification was enqueued. */
+static UA_UInt32
+findLastInOrder(UA_Subscription *sub, UA_MonitoredItem *mon) {
+    UA_UInt32 i = sub->notificationOrder.size - 1;
+    while(UA_PointerRing_get(&sub->notificationOrder, i) != mon)
+        i--;
+    return i;
+}
+
 /****************/
 /* Notification */
 /****************/
@@ -47,20 +132,36 @@ UA_Notification_isOverflowEvent(UA_Server *server, UA_Notification *n) {
  * discarding any other event". So only generate one for all deleted events. */
 static UA_StatusCode
 createEventOverflowNotification(UA_Server *server, UA_Subscription *sub,
-                                UA_MonitoredItem *mon, UA_Notification *indicator) {
+                                UA_MonitoredItem *mon) {
+    /* The overflow event is inserted before the "indicator notification". This
+     * is either first in the queue (if the oldest notification was removed) or
+     * the new event that remains the last element of the queue. */
+    UA_UInt32 indicator = (mon->discardOldest) ? 0 : mon->queue.size - 1;
+
     /* Avoid two redundant overflow events in a row */
-    if((mon->discardOldest && UA_Notification_isOverflowEvent(server, indicator))
-       || (!mon->discardOldest && TAILQ_PREV(indicator, NotificationQueue, listEntry) != NULL &&
-           UA_Notification_isOverflowEvent(server, TAILQ_PREV(indicator, NotificationQueue, listEntry))))
+    if((mon->discardOldest &&
+        UA_Notification_isOverflowEvent(server, (UA_Notification*)
+                                        UA_PointerRing_get(&mon->queue, 0)))
+       || (!mon->discardOldest && indicator > 0 &&
+           UA_Notification_isOverflowEvent(server, (UA_Notification*)
+                                           UA_PointerRing_get(&mon->queue, indicator - 1))))
         return UA_STATUSCODE_GOOD;
 
+    /* Reserve the space in the queues */
+    UA_Boolean reporting = (mon->monitoringMode == UA_MONITORINGMODE_REPORTING);
+    UA_StatusCode retval = UA_PointerRing_reserve(&mon->queue, mon->queue.size + 1);
+    if(reporting)
+        retval |= UA_PointerRing_reserve(&sub->notificationOrder,
+                                         sub->notificationOrder.size + 1);
+    if(retval != UA_STATUSCODE_GOOD)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
     /* A notification is inserted into the queue which includes only the
      * NodeId of the overflowEventType. It is up to the client to check for
      * possible overflows. */
 
     /* Allocate the notification */
-    UA_Notification *overflowNotification = (UA_Notification *)
-        UA_malloc(sizeof(UA_Notification));
+    UA_Notification *overflowNotification = UA_Notification_new(server);
     if(!overflowNotification)
         return UA_STATUSCODE_BADOUTOFMEMORY;
 
@@ -69,30 +170,25 @@ createEventOverflowNotification(UA_Server *server, UA_Subscription *sub,
     UA_EventFieldList_init(&overflowNotification->data.event.fields);
     overflowNotification->data.event.fields.eventFields = UA_Variant_new();
     if(!overflowNotification->data.event.fields.eventFields) {
-        UA_free(overflowNotification);
+        UA_Notification_delete(server, overflowNotification);
         return UA_STATUSCODE_BADOUTOFMEMORY;
     }
     overflowNotification->data.event.fields.eventFieldsSize = 1;
-    UA_StatusCode retval =
-        UA_Variant_setScalarCopy(overflowNotification->data.event.fields.eventFields,
-                                 &simpleOverflowEventType, &UA_TYPES[UA_TYPES_NODEID]);
+    retval = UA_Variant_setScalarCopy(overflowNotification->data.event.fields.eventFields,
+                                      &simpleOverflowEventType, &UA_TYPES[UA_TYPES_NODEID]);
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_EventFieldList_clear(&overflowNotification->data.event.fields);
-        UA_free(overflowNotification);
+        UA_Notification_delete(server, overflowNotification);
         return retval;
     }
 
-    /* Insert before the "indicator notification". This is either first in the
-     * queue (if the oldest notification was removed) or before the new event
-     * that remains the last element of the queue. */
-    TAILQ_INSERT_BEFORE(indicator, overflowNotification, listEntry);
+    /* Insert before the indicator. The n-th entry for the MonitoredItem in the
+     * order of the Subscription stands for its n-th notification. So appending
+     * an entry to the order keeps the overflow event before the indicator. */
+    UA_PointerRing_insert(&mon->queue, indicator, overflowNotification);
     ++mon->eventOverflows;
-    ++mon->queueSize;
 
-    TAILQ_NEXT(overflowNotification, globalEntry) = UA_SUBSCRIPTION_QUEUE_SENTINEL;
-    if(mon->monitoringMode == UA_MONITORINGMODE_REPORTING) {
-        TAILQ_INSERT_BEFORE(indicator, overflowNotification, globalEntry);
-        ++sub->notificationQueueSize;
+    if(reporting) {
+        UA_PointerRing_insert(&sub->notificationOrder, sub->notificationOrder.size, mon);
         ++sub->eventNotifications;
     }
     return UA_STATUSCODE_GOOD;
@@ -103,12 +199,22 @@ createEventOverflowNotification(UA_Server *server, UA_Subscription *sub,
 /* !!! The enqueue and dequeue operations need to match the reporting
  * disable/enable logic in Operation_SetMonitoringMode !!! */
 
-void
+UA_StatusCode
 UA_Notification_enqueue(UA_Server *server, UA_Subscription *sub,
                         UA_MonitoredItem *mon, UA_Notification *n) {
+    /* Reserve the space. The queue of the MonitoredItem was already sized for
+     * maxQueueSize. So this allocates only for more overflow events or when
+     * the order of the Subscription grows. */
+    UA_Boolean reporting = (mon->monitoringMode == UA_MONITORINGMODE_REPORTING);
+    UA_StatusCode retval = UA_PointerRing_reserve(&mon->queue, mon->queue.size + 1);
+    if(reporting)
+        retval |= UA_PointerRing_reserve(&sub->notificationOrder,
+                                         sub->notificationOrder.size + 1);
+    if(retval != UA_STATUSCODE_GOOD)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
     /* Add to the MonitoredItem */
-    TAILQ_INSERT_TAIL(&mon->queue, n, listEntry);
-    ++mon->queueSize;
+    UA_PointerRing_insert(&mon->queue, mon->queue.size, n);
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
     if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER &&
@@ -116,11 +222,9 @@ UA_Notification_enqueue(UA_Server *server, UA_Subscription *sub,
         ++mon->eventOverflows;
 #endif
 
-    /* Add to the subscription if reporting is enabled */
-    TAILQ_NEXT(n, globalEntry) = UA_SUBSCRIPTION_QUEUE_SENTINEL;
-    if(mon->monitoringMode == UA_MONITORINGMODE_REPORTING) {
-        TAILQ_INSERT_TAIL(&sub->notificationQueue, n, globalEntry);
-        ++sub->notificationQueueSize;
+    /* Add to the order of the subscription if reporting is enabled */
+    if(reporting) {
+        UA_PointerRing_insert(&sub->notificationOrder, sub->notificationOrder.size, mon);
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
         if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
             ++sub->eventNotifications;
@@ -134,24 +238,39 @@ UA_Notification_enqueue(UA_Server *server, UA_Subscription *sub,
     /* Ensure enough space is available in the MonitoredItem. Do this only after
      * adding the new Notification. */
     UA_MonitoredItem_ensureQueueSpace(server, mon);
+    return UA_STATUSCODE_GOOD;
 }
 
-void
-UA_Notification_dequeue(UA_Server *server, UA_Notification *n) {
-    UA_MonitoredItem *mon = n->mon;
-    UA_Subscription *sub = mon->subscription;
-
-    /* Remove from the MonitoredItem queue */
+/* Remove the i-th notification of the MonitoredItem. If lastInOrder is set,
+ * the last entry for the MonitoredItem is removed from the order of the
+ * Subscription instead of the i-th. So the later notifications of the
+ * MonitoredItem move up in the order. */
+static void
+dequeueNotification(UA_Server *server, UA_MonitoredItem *mon, UA_UInt32 i,
+                    UA_Boolean lastInOrder) {
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    UA_Notification *n = (UA_Notification*)UA_PointerRing_get(&mon->queue, i);
     if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER &&
        UA_Notification_isOverflowEvent(server, n))
             --mon->eventOverflows;
 #endif
-    TAILQ_REMOVE(&mon->queue, n, listEntry);
-    --mon->queueSize;
 
-    /* Remove from the subscription's queue */
-    if(TAILQ_NEXT(n, globalEntry) != UA_SUBSCRIPTION_QUEUE_SENTINEL) {
+    /* Remove from the subscription's order. The n-th entry for the
+     * MonitoredItem stands for its n-th notification. */
+    UA_Subscription *sub = mon->subscription;
+    if(mon->monitoringMode == UA_MONITORINGMODE_REPORTING) {
+        UA_UInt32 pos;
+        if(lastInOrder) {
+            pos = findLastInOrder(sub, mon);
+        } else {
+            pos = 0;
+            for(UA_UInt32 j = 0; j <= i; pos++) {
+                if(UA_PointerRing_get(&sub->notificationOrder, pos) == mon)
+                    j++;
+            }
+            pos--;
+        }
+        UA_PointerRing_remove(&sub->notificationOrder, pos);
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
         if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
             --sub->eventNotifications;
@@ -160,23 +279,49 @@ UA_Notification_dequeue(UA_Server *server, UA_Notification *n) {
         {
             --sub->dataChangeNotifications;
         }
+    }
+
+    /* Remove from the MonitoredItem queue */
+    UA_PointerRing_remove(&mon->queue, i);
+}
 
-        /*
-          see open issue #2114:
-          in the function UA_MonitoredItem_ensureQueueSpace, a greater overflow event size
-          than event queue size will result in false assertion.
-          to fix this problem, we assume that only one overflow event is allowed, so by
-          dequeueing a notification, we remove the overflow event by setting its size to 0.
-        */
-        //mon->eventOverflows = 0; 
-
-        TAILQ_REMOVE(&sub->notificationQueue, n, globalEntry);
-        --sub->notificationQueueSize;
+void
+UA_Notification_dequeue(UA_Server *server, UA_Notification *n) {
+    UA_MonitoredItem *mon = n->mon;
+    UA_UInt32 i = 0;
+    while(UA_PointerRing_get(&mon->queue, i) != n)
+        i++;
+    dequeueNotification(server, mon, i, false);
+}
+
+void
+UA_NotificationPool_clear(UA_NotificationPool *pool) {
+    while(pool->freeList) {
+        UA_Notification *n = pool->freeList;
+        pool->freeList = n->next;
+        UA_free(n);
+    }
+    pool->freeSize = 0;
+    pool->allocated = 0;
+}
+
+UA_Notification *
+UA_Notification_new(UA_Server *server) {
+    UA_NotificationPool *pool = &server->notificationPool;
+    UA_Notification *n = pool->freeList;
+    if(n) {
+        pool->freeList = n->next;
+        pool->freeSize--;
+        return n;
     }
+    n = (UA_Notification*)UA_malloc(sizeof(UA_Notification));
+    if(n)
+        pool->allocated++;
+    return n;
 }
 
 void
-UA_Notification_delete(UA_Notification *n) {
+UA_Notification_delete(UA_Server *server, UA_Notification *n) {
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
     UA_MonitoredItem *mon = n->mon;
     if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
@@ -188,7 +333,19 @@ UA_Notification_delete(UA_Notification *n) {
     {
         UA_DataValue_clear(&n->data.value);
     }
-    UA_free(n);
+
+    /* Return to the pool if all MonitoredItem queues can still be filled from
+     * the allocated notifications. One more is retained for a new notification
+     * that is enqueued into a full queue before the oldest is discarded. */
+    UA_NotificationPool *pool = &server->notificationPool;
+    if(pool->allocated > pool->reserve + 1) {
+        pool->allocated--;
+        UA_free(n);
+        return;
+    }
+    n->next = pool->freeList;
+    pool->freeList = n;
+    pool->freeSize++;
 }
 
 /*****************/
@@ -199,7 +356,6 @@ void
 UA_MonitoredItem_init(UA_MonitoredItem *mon, UA_Subscription *sub) {
     memset(mon, 0, sizeof(UA_MonitoredItem));
     mon->subscription = sub;
-    TAILQ_INIT(&mon->queue);
 }
 
 void
@@ -212,20 +368,22 @@ UA_MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem) {
     /* Remove the queued notifications if attached to a subscription (not a
      * local MonitoredItem) */
     if(monitoredItem->subscription) {
-        UA_Notification *notification, *notification_tmp;
-        TAILQ_FOREACH_SAFE(notification, &monitoredItem->queue,
-                           listEntry, notification_tmp) {
-            /* Remove the item from the queues and free the memory */
-            UA_Notification_dequeue(server, notification);
-            UA_Notification_delete(notification);
-        }
+        UA_MonitoredItem_removeFromSubscriptionOrder(monitoredItem);
+        for(UA_UInt32 i = 0; i < monitoredItem->queue.size; i++)
+            UA_Notification_delete(server, (UA_Notification*)
+                                   UA_PointerRing_get(&monitoredItem->queue, i));
     }
+    UA_PointerRing_clear(&monitoredItem->queue);
+    monitoredItem->eventOverflows = 0;
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
     if(monitoredItem->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
-        /* Remove the monitored item from the node queue */
-        UA_Server_editNode(server, NULL, &monitoredItem->monitoredNodeId,
-                           UA_MonitoredItem_removeNodeEventCallback, monitoredItem);
+        /* Remove the monitored item from the event routing */
+        UA_EventRoute_removeMonitoredItem(server, monitoredItem);
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+        UA_MonitoredItem_removeConditionRefresh(monitoredItem);
+#endif
+        UA_CompiledEventFilter_clear(&monitoredItem->compiledEventFilter);
         UA_EventFilter_clear(&monitoredItem->filter.eventFilter);
     } else
 #endif
@@ -256,12 +414,16 @@ UA_MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem) {
         UA_LOCK(server->serviceMutex);
     }
 
+    /* Release the reserved space in the notification pool */
+    if(monitoredItem->subscription)
+        server->notificationPool.reserve -= monitoredItem->maxQueueSize;
+
     /* Remove the monitored item */
     if(monitoredItem->listEntry.le_prev != NULL)
         LIST_REMOVE(monitoredItem, listEntry);
     UA_String_clear(&monitoredItem->indexRange);
-    UA_ByteString_clear(&monitoredItem->lastSampledValue);
-    UA_Variant_clear(&monitoredItem->lastValue);
+    UA_DataValue_clear(&monitoredItem->lastValue);
+    monitoredItem->lastValueSet = false;
     UA_NodeId_clear(&monitoredItem->monitoredNodeId);
 
     /* No actual callback, just remove the structure */
@@ -273,11 +435,11 @@ UA_StatusCode
 UA_MonitoredItem_ensureQueueSpace(UA_Server *server, UA_MonitoredItem *mon) {
     /* Assert: The eventoverflow are counted in the queue size; There can be
      * only one eventoverflow more than normal entries */
-    UA_assert(mon->queueSize >= mon->eventOverflows);
-    UA_assert(mon->eventOverflows <= mon->queueSize - mon->eventOverflows + 1);
+    UA_assert(mon->queue.size >= mon->eventOverflows);
+    UA_assert(mon->eventOverflows <= mon->queue.size - mon->eventOverflows + 1);
 
     /* Nothing to do */
-    if(mon->queueSize - mon->eventOverflows <= mon->maxQueueSize)
+    if(mon->queue.size - mon->eventOverflows <= mon->maxQueueSize)
         return UA_STATUSCODE_GOOD;
 
 #ifdef __clang_analyzer__
@@ -285,70 +447,56 @@ UA_MonitoredItem_ensureQueueSpace(UA_Server *server, UA_MonitoredItem *mon) {
 #endif
     
     /* Remove notifications until the queue size is reached */
-    UA_Subscription *sub = mon->subscription;
-    while(mon->queueSize - mon->eventOverflows > mon->maxQueueSize) {
+    while(mon->queue.size - mon->eventOverflows > mon->maxQueueSize) {
         /* At least two notifications that are not eventOverflows in the queue */
-        UA_assert(mon->queueSize - mon->eventOverflows >= 2);
+        UA_assert(mon->queue.size - mon->eventOverflows >= 2);
 
         /* Select the next notification to delete. Skip over overflow events. */
-        UA_Notification *del = NULL;
+        UA_UInt32 del;
         if(mon->discardOldest) {
             /* Remove the oldest */
-            del = TAILQ_FIRST(&mon->queue);
+            del = 0;
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-            while(UA_Notification_isOverflowEvent(server, del))
-                del = TAILQ_NEXT(del, listEntry); /* skip overflow events */
+            while(UA_Notification_isOverflowEvent(server, (UA_Notification*)
+                                                  UA_PointerRing_get(&mon->queue, del)))
+                del++; /* skip overflow events */
 #endif
         } else {
             /* Remove the second newest (to keep the up-to-date notification).
              * The last entry is not an OverflowEvent -- we just added it. */
-            del = TAILQ_LAST(&mon->queue, NotificationQueue);
-            del = TAILQ_PREV(del, NotificationQueue, listEntry);
+            del = mon->queue.size - 2;
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
-            while(UA_Notification_isOverflowEvent(server, del))
-                del = TAILQ_PREV(del, NotificationQueue, listEntry); /* skip overflow events */
+            while(UA_Notification_isOverflowEvent(server, (UA_Notification*)
+                                                  UA_PointerRing_get(&mon->queue, del)))
+                del--; /* skip overflow events */
 #endif
         }
 
-        UA_assert(del); /* There must have been one entry that can be deleted */
-
-        /* If reporting is activated (entries are also in the subscriptions
-         * global queue): Move the entry after del in the per-MonitoredItem
-         * queue right after del in the global queue. (It is already right after
-         * del in the per-MonitoredItem queue.) This is required so we don't
-         * starve MonitoredItems with a high sampling interval by always
-         * removing their first appearance in the gloal queue for the
-         * Subscription. */
-        if(TAILQ_NEXT(del, globalEntry) != UA_SUBSCRIPTION_QUEUE_SENTINEL) {
-            UA_Notification *after_del = TAILQ_NEXT(del, listEntry);
-            UA_assert(after_del); /* There must be one remaining element after del */
-            TAILQ_REMOVE(&sub->notificationQueue, after_del, globalEntry);
-            TAILQ_INSERT_AFTER(&sub->notificationQueue, del, after_del, globalEntry);
-        }
-
-        /* Delete the notification */
-        UA_Notification_dequeue(server, del);
-        UA_Notification_delete(del);
+        /* If reporting is activated (entries are also in the order of the
+         * subscription): Remove the last entry for the MonitoredItem from the
+         * order. The notifications after del then take the place of their
+         * predecessor in the order. This is required so we don't starve
+         * MonitoredItems with a high sampling interval by always removing their
+         * first appearance in the order for the Subscription. The last entry is
+         * usually the one just added for the new notification. */
+        UA_Notification *n = (UA_Notification*)UA_PointerRing_get(&mon->queue, del);
+        dequeueNotification(server, mon, del, true);
+        UA_Notification_delete(server, n);
     }
 
-    /* Get the element where the overflow shall be announced (infobits or
-     * overflowevent) */
-    UA_Notification *indicator;
-    if(mon->discardOldest)
-        indicator = TAILQ_FIRST(&mon->queue);
-    else
-        indicator = TAILQ_LAST(&mon->queue, NotificationQueue);
-    UA_assert(indicator);
-
-    /* Create an overflow notification */
+    /* Announce the overflow in the first (oldest) or the last (newest)
+     * notification. Create an overflow notification for events. */
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
     if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
-        return createEventOverflowNotification(server, sub, mon, indicator);
+        return createEventOverflowNotification(server, mon->subscription, mon);
     } else
 #endif
     {
         /* Set the infobits of a datachange notification */
         if(mon->maxQueueSize > 1) {
+            UA_Notification *indicator = (UA_Notification*)
+                UA_PointerRing_get(&mon->queue, (mon->discardOldest) ?
+                                   0 : mon->queue.size - 1);
             /* Add the infobits either to the newest or the new last entry */
             indicator->data.value.hasStatus = true;
             indicator->data.value.status |=
@@ -358,6 +506,177 @@ UA_MonitoredItem_ensureQueueSpace(UA_Server *server, UA_MonitoredItem *mon) {
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+UA_MonitoredItem_reserveQueue(UA_MonitoredItem *mon, UA_UInt32 maxQueueSize) {
+    return UA_PointerRing_reserve(&mon->queue, maxQueueSize + 1);
+}
+
+UA_StatusCode
+UA_MonitoredItem_addToSubscriptionOrder(UA_MonitoredItem *mon) {
+    UA_Subscription *sub = mon->subscription;
+    UA_StatusCode retval =
+        UA_PointerRing_reserve(&sub->notificationOrder,
+                               sub->notificationOrder.size + mon->queue.size);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    for(UA_UInt32 i = 0; i < mon->queue.size; i++)
+        UA_PointerRing_insert(&sub->notificationOrder, sub->notificationOrder.size, mon);
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
+        sub->eventNotifications += mon->queue.size;
+    } else
+#endif
+    {
+        sub->dataChangeNotifications += mon->queue.size;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_MonitoredItem_removeFromSubscriptionOrder(UA_MonitoredItem *mon) {
+    /* The order is cleared up front when the Subscription is deleted */
+    UA_Subscription *sub = mon->subscription;
+    if(mon->monitoringMode != UA_MONITORINGMODE_REPORTING ||
+       mon->queue.size == 0 || sub->notificationOrder.size == 0)
+        return;
+
+    /* Compact the order without the entries for the MonitoredItem */
+    UA_PointerRing *order = &sub->notificationOrder;
+    UA_UInt32 mask = order->capacity - 1;
+    UA_UInt32 size = 0;
+    for(UA_UInt32 i = 0; i < order->size; i++) {
+        UA_MonitoredItem *entry = (UA_MonitoredItem*)UA_PointerRing_get(order, i);
+        if(entry != mon)
+            order->entries[(order->start + size++) & mask] = entry;
+    }
+    UA_assert(order->size - size == mon->queue.size);
+    order->size = size;
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
+        sub->eventNotifications -= mon->queue.size;
+    } else
+#endif
+    {
+        sub->dataChangeNotifications -= mon->queue.size;
+    }
+}
+
+/************************/
+/* Sample Trigger Index */
+/************************/
+
+static UA_StatusCode
+sampleTriggerIndexInsert(UA_NodeIdMap *index, UA_MonitoredItem *mon) {
+    void **head = UA_NodeIdMap_find(index, &mon->monitoredNodeId);
+    if(head) {
+        mon->triggerNext = (UA_MonitoredItem*)*head;
+        *head = mon;
+        return UA_STATUSCODE_GOOD;
+    }
+    mon->triggerNext = NULL;
+    return UA_NodeIdMap_insert(index, &mon->monitoredNodeId, mon);
+}
+
+static void
+sampleTriggerIndexRemove(UA_NodeIdMap *index, UA_MonitoredItem *mon) {
+    void **head = UA_NodeIdMap_find(index, &mon->monitoredNodeId);
+    if(!head)
+        return;
+    UA_MonitoredItem **m = (UA_MonitoredItem**)head;
+    for(; *m; m = &(*m)->triggerNext) {
+        if(*m != mon)
+            continue;
+        *m = mon->triggerNext;
+        break;
+    }
+    mon->triggerNext = NULL;
+    if(!*head)
+        UA_NodeIdMap_remove(index, &mon->monitoredNodeId);
+}
+
+/* The value of a variable changes only when it is written. Unless the value
+ * comes from a DataSource or is updated in the onRead callback. */
+static UA_Boolean
+canSampleOnWrite(UA_Server *server, UA_MonitoredItem *mon) {
+    if(mon->attributeId != UA_ATTRIBUTEID_VALUE)
+        return false;
+    const UA_Node *node = UA_NODESTORE_GET(server, &mon->monitoredNodeId);
+    if(!node)
+        return false;
+    UA_Boolean res = (node->head.nodeClass == UA_NODECLASS_VARIABLE &&
+                      node->variableNode.valueSource == UA_VALUESOURCE_DATA &&
+                      !node->variableNode.value.data.callback.onRead);
+    UA_NODESTORE_RELEASE(server, node);
+    return res;
+}
+
+static void
+triggeredSampleCallback(UA_Server *server, UA_MonitoredItem *mon) {
+    UA_LOCK(server->serviceMutex);
+    mon->samplePending = false;
+    monitoredItem_sampleCallback(server, mon);
+    UA_UNLOCK(server->serviceMutex);
+}
+
+void
+UA_MonitoredItem_sampleOnWrite(UA_Server *server, const UA_NodeId *nodeId) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
+    void **head = UA_NodeIdMap_find(&server->sampleTriggers, nodeId);
+    if(!head)
+        return;
+
+    UA_MonitoredItem *mon = (UA_MonitoredItem*)*head;
+    for(; mon; mon = mon->triggerNext) {
+        if(mon->samplePending)
+            continue;
+
+        /* Coalesce the writes until the sampling interval has passed */
+        UA_DateTime next = mon->lastSampleTime +
+            (UA_DateTime)(mon->samplingInterval * UA_DATETIME_MSEC);
+        UA_StatusCode retval =
+            UA_Timer_addTimedCallback(&server->timer,
+                                      (UA_ApplicationCallback)triggeredSampleCallback,
+                                      server, mon, next, &mon->sampleCallbackId);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                           "MonitoredItem %" PRIu32 " | Could not schedule the "
+                           "sample after a write with the status code %s",
+                           mon->monitoredItemId, UA_StatusCode_name(retval));
+            continue;
+        }
+        mon->samplePending = true;
+    }
+}
+
+void
+UA_MonitoredItem_updateSampleCallbacks(UA_Server *server, const UA_NodeId *nodeId) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
+    void **head = UA_NodeIdMap_find(&server->sampleTriggers, nodeId);
+    if(!head)
+        return;
+
+    /* Take out the MonitoredItems of the node first. Re-registering may add
+     * them to the index again. */
+    UA_MonitoredItem *mon, *next, *update = (UA_MonitoredItem*)*head;
+    UA_NodeIdMap_remove(&server->sampleTriggers, nodeId);
+
+    for(mon = update; mon; mon = next) {
+        next = mon->triggerNext;
+        mon->triggerNext = NULL;
+        if(mon->samplePending)
+            removeCallback(server, mon->sampleCallbackId);
+        mon->samplePending = false;
+        mon->sampleOnWrite = false;
+        mon->sampleCallbackIsRegistered = false;
+        UA_StatusCode retval = UA_MonitoredItem_registerSampleCallback(server, mon);
+        if(retval != UA_STATUSCODE_GOOD)
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                           "MonitoredItem %" PRIu32 " | Could not register the "
+                           "sample callback with the status code %s",
+                           mon->monitoredItemId, UA_StatusCode_name(retval));
+    }
+}
+
 UA_StatusCode
 UA_MonitoredItem_registerSampleCallback(UA_Server *server, UA_MonitoredItem *mon) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
@@ -368,6 +687,15 @@ UA_MonitoredItem_registerSampleCallback(UA_Server *server, UA_MonitoredItem *mon
     if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER)
         return UA_STATUSCODE_GOOD;
 
+    /* Sample when the node is written. Fall back to polling if the
+     * MonitoredItem cannot be added to the index. */
+    if(canSampleOnWrite(server, mon) &&
+       sampleTriggerIndexInsert(&server->sampleTriggers, mon) == UA_STATUSCODE_GOOD) {
+        mon->sampleOnWrite = true;
+        mon->sampleCallbackIsRegistered = true;
+        return UA_STATUSCODE_GOOD;
+    }
+
     UA_StatusCode retval =
         addRepeatedCallback(server, (UA_ServerCallback)UA_MonitoredItem_sampleCallback,
                             mon, mon->samplingInterval, &mon->sampleCallbackId);
@@ -381,7 +709,15 @@ UA_MonitoredItem_unregisterSampleCallback(UA_Server *server, UA_MonitoredItem *m
     UA_LOCK_ASSERT(server->serviceMutex, 1);
     if(!mon->sampleCallbackIsRegistered)
         return;
-    removeCallback(server, mon->sampleCallbackId);
+    if(mon->sampleOnWrite) {
+        sampleTriggerIndexRemove(&server->sampleTriggers, mon);
+        if(mon->samplePending)
+            removeCallback(server, mon->sampleCallbackId);
+        mon->samplePending = false;
+        mon->sampleOnWrite = false;
+    } else {
+        removeCallback(server, mon->sampleCallbackId);
+    }
     mon->sampleCallbackIsRegistered = false;
 }
 
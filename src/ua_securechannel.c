@@ -88,6 +88,17 @@ UA_Chunk_delete(UA_Chunk *chunk) {
     UA_free(chunk);
 }
 
+/* Skip the headers at the beginning of the chunk. Copied chunks keep the
+ * pointer to the allocated memory, so that it can be freed later on. */
+static void
+UA_Chunk_hideHeaders(UA_Chunk *chunk, size_t offset) {
+    chunk->bytes.length -= offset;
+    if(chunk->copied)
+        memmove(chunk->bytes.data, &chunk->bytes.data[offset], chunk->bytes.length);
+    else
+        chunk->bytes.data += offset;
+}
+
 static void
 deleteChunks(UA_ChunkQueue *queue) {
     UA_Chunk *chunk;
@@ -104,11 +115,89 @@ UA_SecureChannel_deleteBuffered(UA_SecureChannel *channel) {
     UA_ByteString_clear(&channel->incompleteChunk);
 }
 
+/* Pass the collected chunks to the network layer. The batch mode is not
+ * changed. */
+static UA_StatusCode
+sendBatchBuffer(UA_SecureChannel *channel) {
+    if(!channel->sendBatchBuffer.data)
+        return UA_STATUSCODE_GOOD;
+    UA_ByteString buf = channel->sendBatchBuffer;
+    buf.length = channel->sendBatchLength;
+    channel->sendBatchBuffer = UA_BYTESTRING_NULL;
+    channel->sendBatchLength = 0;
+    UA_Connection *connection = channel->connection;
+    if(!connection)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    if(buf.length == 0) {
+        connection->releaseSendBuffer(connection, &buf);
+        return UA_STATUSCODE_GOOD;
+    }
+    return connection->send(connection, &buf);
+}
+
+/* Hand a finished chunk to the network layer or append it to the batch. Takes
+ * ownership of the buffer. */
+static UA_StatusCode
+sendChunk(UA_SecureChannel *channel, UA_ByteString *chunk) {
+    UA_Connection *connection = channel->connection;
+    if(!channel->sendBatch)
+        return connection->send(connection, chunk);
+
+    /* Flush first if the chunk does not fit into the batch buffer. Large
+     * chunks are sent directly instead of being copied. */
+    size_t bufferSize = channel->config.sendBufferSize;
+    if(channel->sendBatchLength + chunk->length > bufferSize ||
+       chunk->length > bufferSize / 2) {
+        UA_StatusCode res = sendBatchBuffer(channel);
+        if(res != UA_STATUSCODE_GOOD) {
+            connection->releaseSendBuffer(connection, chunk);
+            return res;
+        }
+        if(chunk->length > bufferSize / 2)
+            return connection->send(connection, chunk);
+    }
+
+    /* Allocate the batch buffer. If that fails, the chunk is sent directly.
+     * The batch is empty in that case. */
+    if(!channel->sendBatchBuffer.data &&
+       connection->getSendBuffer(connection, bufferSize,
+                                 &channel->sendBatchBuffer) != UA_STATUSCODE_GOOD) {
+        channel->sendBatchBuffer = UA_BYTESTRING_NULL;
+        return connection->send(connection, chunk);
+    }
+
+    memcpy(&channel->sendBatchBuffer.data[channel->sendBatchLength],
+           chunk->data, chunk->length);
+    channel->sendBatchLength += chunk->length;
+    connection->releaseSendBuffer(connection, chunk);
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_SecureChannel_beginSendBatch(UA_SecureChannel *channel) {
+    if(channel->connection)
+        channel->sendBatch = true;
+}
+
+UA_StatusCode
+UA_SecureChannel_flushSendBatch(UA_SecureChannel *channel) {
+    channel->sendBatch = false;
+    return sendBatchBuffer(channel);
+}
+
 void
 UA_SecureChannel_close(UA_SecureChannel *channel) {
     /* Set the status to closed */
     channel->state = UA_SECURECHANNELSTATE_CLOSED;
 
+    /* Drop the unsent batch */
+    channel->sendBatch = false;
+    if(channel->sendBatchBuffer.data && channel->connection)
+        channel->connection->releaseSendBuffer(channel->connection,
+                                               &channel->sendBatchBuffer);
+    channel->sendBatchBuffer = UA_BYTESTRING_NULL;
+    channel->sendBatchLength = 0;
+
     /* Detach from the connection and close the connection */
     if(channel->connection) {
         if(channel->connection->state != UA_CONNECTIONSTATE_CLOSED)
@@ -171,6 +260,41 @@ UA_SecureChannel_processHELACK(UA_SecureChannel *channel,
     return UA_STATUSCODE_GOOD;
 }
 
+static void
+lockChannel(UA_SecureChannel *channel) {
+#if UA_MULTITHREADING >= 100
+    if(channel->lock)
+        channel->lock(channel->lockContext);
+#endif
+}
+
+static void
+unlockChannel(UA_SecureChannel *channel) {
+#if UA_MULTITHREADING >= 100
+    if(channel->unlock)
+        channel->unlock(channel->lockContext);
+#endif
+}
+
+#ifdef UA_ENABLE_ENCRYPTION
+static void
+beginAsymCrypto(UA_SecureChannel *channel) {
+#if UA_MULTITHREADING >= 200
+    if(channel->beginAsymCrypto)
+        channel->beginAsymCrypto(channel->lockContext, channel);
+#endif
+}
+
+static UA_StatusCode
+endAsymCrypto(UA_SecureChannel *channel) {
+#if UA_MULTITHREADING >= 200
+    if(channel->endAsymCrypto)
+        return channel->endAsymCrypto(channel->lockContext, channel);
+#endif
+    return UA_STATUSCODE_GOOD;
+}
+#endif
+
 /* Sends an OPN message using asymmetric encryption if defined */
 UA_StatusCode
 UA_SecureChannel_sendAsymmetricOPNMessage(UA_SecureChannel *channel,
@@ -234,7 +358,9 @@ UA_SecureChannel_sendAsymmetricOPNMessage(UA_SecureChannel *channel,
     }
 
 #ifdef UA_ENABLE_ENCRYPTION
+    beginAsymCrypto(channel);
     retval = signAndEncryptAsym(channel, pre_sig_length, &buf, securityHeaderLength, total_length);
+    retval |= endAsymCrypto(channel);
     if(retval != UA_STATUSCODE_GOOD) {
         connection->releaseSendBuffer(connection, &buf);
         return retval;
@@ -243,7 +369,7 @@ UA_SecureChannel_sendAsymmetricOPNMessage(UA_SecureChannel *channel,
 
     /* Send the message, the buffer is freed in the network layer */
     buf.length = finalLength;
-    retval = connection->send(connection, &buf);
+    retval = sendChunk(channel, &buf);
 #ifdef UA_ENABLE_UNIT_TEST_FAILURE_HOOKS
     retval |= sendAsym_sendFailure;
 #endif
@@ -307,6 +433,201 @@ encodeHeadersSym(UA_MessageContext *const messageContext, size_t totalLength) {
     return res;
 }
 
+#if UA_MULTITHREADING >= 200
+
+/* Chunk-wise cryptography in the worker threads. The headers (with the
+ * sequence numbers) are encoded in the calling thread in the order of the
+ * chunks. Only signing/encryption and decryption/verification are dispatched.
+ * At most UA_CHUNKCRYPTO_WINDOW chunks of a message are in flight at once. */
+#define UA_CHUNKCRYPTO_WINDOW 16
+
+/* The jobs of a batch are dispatched to the worker threads. But the calling
+ * thread does not rely on the workers alone. They might all be blocked, for
+ * example on the service mutex that the calling thread holds. So the caller
+ * executes the jobs itself that no worker has picked up yet. Then it waits
+ * only for the jobs that are currently executed in a worker. The sync is
+ * reference-counted, as the dispatched callbacks can run after the batch is
+ * done. They find no job left to do and drop their reference. */
+typedef void (*UA_ChunkCryptoJobCallback)(void *job);
+
+typedef struct {
+    size_t refCount;  /* Caller and dispatched callbacks that have not run */
+    size_t running;   /* Jobs that are currently executed in a worker */
+    size_t jobsStarted;
+    size_t jobsSize;
+    void *jobs[UA_CHUNKCRYPTO_WINDOW];
+    UA_ChunkCryptoJobCallback run;
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+} UA_ChunkCryptoSync;
+
+static UA_ChunkCryptoSync *
+UA_ChunkCryptoSync_new(UA_ChunkCryptoJobCallback run) {
+    UA_ChunkCryptoSync *sync = (UA_ChunkCryptoSync*)
+        UA_calloc(1, sizeof(UA_ChunkCryptoSync));
+    if(!sync)
+        return NULL;
+    sync->refCount = 1;
+    sync->run = run;
+    pthread_mutex_init(&sync->mutex, NULL);
+    pthread_cond_init(&sync->condition, NULL);
+    return sync;
+}
+
+/* Call only with the mutex held. Releases the mutex. */
+static void
+UA_ChunkCryptoSync_unlockRelease(UA_ChunkCryptoSync *sync) {
+    sync->refCount--;
+    UA_Boolean last = (sync->refCount == 0);
+    pthread_mutex_unlock(&sync->mutex);
+    if(!last)
+        return;
+    pthread_mutex_destroy(&sync->mutex);
+    pthread_cond_destroy(&sync->condition);
+    UA_free(sync);
+}
+
+/* Executed by the workers. Picks up the next job that was not started. */
+static void
+chunkCryptoWorkerCallback(void *application, void *data) {
+    UA_ChunkCryptoSync *sync = (UA_ChunkCryptoSync*)data;
+    pthread_mutex_lock(&sync->mutex);
+    if(sync->jobsStarted < sync->jobsSize) {
+        void *job = sync->jobs[sync->jobsStarted];
+        sync->jobsStarted++;
+        sync->running++;
+        pthread_mutex_unlock(&sync->mutex);
+        sync->run(job);
+        pthread_mutex_lock(&sync->mutex);
+        sync->running--;
+        if(sync->running == 0)
+            pthread_cond_signal(&sync->condition);
+    }
+    UA_ChunkCryptoSync_unlockRelease(sync);
+}
+
+static void
+UA_ChunkCryptoSync_dispatch(UA_ChunkCryptoSync *sync, UA_WorkQueue *wq, void *job) {
+    pthread_mutex_lock(&sync->mutex);
+    UA_assert(sync->jobsSize < UA_CHUNKCRYPTO_WINDOW);
+    sync->jobs[sync->jobsSize] = job;
+    sync->jobsSize++;
+    sync->refCount++;
+    pthread_mutex_unlock(&sync->mutex);
+    UA_WorkQueue_enqueue(wq, chunkCryptoWorkerCallback, NULL, sync);
+}
+
+/* Execute the remaining jobs in the calling thread and wait for the jobs that
+ * are executed in a worker. Afterwards the sync can be reused. */
+static void
+UA_ChunkCryptoSync_wait(UA_ChunkCryptoSync *sync) {
+    pthread_mutex_lock(&sync->mutex);
+    while(sync->jobsStarted < sync->jobsSize) {
+        void *job = sync->jobs[sync->jobsStarted];
+        sync->jobsStarted++;
+        pthread_mutex_unlock(&sync->mutex);
+        sync->run(job);
+        pthread_mutex_lock(&sync->mutex);
+    }
+    while(sync->running > 0)
+        pthread_cond_wait(&sync->condition, &sync->mutex);
+    sync->jobsStarted = 0;
+    sync->jobsSize = 0;
+    pthread_mutex_unlock(&sync->mutex);
+}
+
+/* Drop the reference of the caller. Call only after _wait. */
+static void
+UA_ChunkCryptoSync_release(UA_ChunkCryptoSync *sync) {
+    pthread_mutex_lock(&sync->mutex);
+    UA_ChunkCryptoSync_unlockRelease(sync);
+}
+
+static UA_Boolean
+useCryptoWorkers(const UA_SecureChannel *channel) {
+    return (channel->cryptoWorkQueue && channel->cryptoWorkQueue->workersSize > 0 &&
+            channel->securityPolicy && channel->securityPolicy->symmetricModule.reentrant &&
+            (channel->securityMode == UA_MESSAGESECURITYMODE_SIGN ||
+             channel->securityMode == UA_MESSAGESECURITYMODE_SIGNANDENCRYPT));
+}
+
+typedef struct {
+    UA_MessageContext mc; /* Copy of the context with the chunk buffer */
+    size_t preSigLength;
+    size_t totalLength;
+    UA_StatusCode res;
+} UA_ChunkCryptoJob;
+
+typedef struct UA_ChunkCryptoBatch {
+    UA_ChunkCryptoSync *sync;
+    size_t jobsSize;
+    UA_ChunkCryptoJob jobs[UA_CHUNKCRYPTO_WINDOW];
+} UA_ChunkCryptoBatch;
+
+static void
+signEncryptChunkJob(void *data) {
+#ifdef UA_ENABLE_ENCRYPTION
+    UA_ChunkCryptoJob *job = (UA_ChunkCryptoJob*)data;
+    job->res = signChunkSym(&job->mc, job->preSigLength);
+    if(job->res == UA_STATUSCODE_GOOD)
+        job->res = encryptChunkSym(&job->mc, job->totalLength);
+#endif
+}
+
+/* Wait for the workers and send out the finished chunks in order. If
+ * res is not good (or becomes bad), the remaining buffers are released. */
+static UA_StatusCode
+flushChunkCryptoBatch(UA_MessageContext *mc, UA_StatusCode res) {
+    UA_ChunkCryptoBatch *batch = mc->batch;
+    UA_ChunkCryptoSync_wait(batch->sync);
+    UA_Connection *connection = mc->channel->connection;
+    for(size_t i = 0; i < batch->jobsSize; i++) {
+        UA_ChunkCryptoJob *job = &batch->jobs[i];
+        if(res == UA_STATUSCODE_GOOD)
+            res = job->res;
+        if(res == UA_STATUSCODE_GOOD)
+            res = sendChunk(mc->channel, &job->mc.messageBuffer);
+        else
+            connection->releaseSendBuffer(connection, &job->mc.messageBuffer);
+    }
+    batch->jobsSize = 0;
+    return res;
+}
+
+static void
+deleteChunkCryptoBatch(UA_MessageContext *mc) {
+    UA_ChunkCryptoSync_release(mc->batch->sync);
+    UA_free(mc->batch);
+    mc->batch = NULL;
+}
+
+/* Takes ownership of the message buffer in the context */
+static UA_StatusCode
+dispatchChunkCrypto(UA_MessageContext *mc, size_t preSigLength, size_t totalLength) {
+    UA_ChunkCryptoBatch *batch = mc->batch;
+    if(batch->jobsSize == UA_CHUNKCRYPTO_WINDOW) {
+        UA_StatusCode res = flushChunkCryptoBatch(mc, UA_STATUSCODE_GOOD);
+        if(res != UA_STATUSCODE_GOOD) {
+            mc->channel->connection->
+                releaseSendBuffer(mc->channel->connection, &mc->messageBuffer);
+            return res;
+        }
+    }
+
+    UA_ChunkCryptoJob *job = &batch->jobs[batch->jobsSize];
+    batch->jobsSize++;
+    job->mc = *mc;
+    job->preSigLength = preSigLength;
+    job->totalLength = totalLength;
+    job->res = UA_STATUSCODE_GOOD;
+    mc->messageBuffer = UA_BYTESTRING_NULL;
+
+    UA_ChunkCryptoSync_dispatch(batch->sync, mc->channel->cryptoWorkQueue, job);
+    return UA_STATUSCODE_GOOD;
+}
+
+#endif /* UA_MULTITHREADING >= 200 */
+
 static UA_StatusCode
 sendSymmetricChunk(UA_MessageContext *messageContext) {
     UA_SecureChannel *const channel = messageContext->channel;
@@ -344,6 +665,12 @@ sendSymmetricChunk(UA_MessageContext *messageContext) {
     if(res != UA_STATUSCODE_GOOD)
         goto error;
 
+#if UA_MULTITHREADING >= 200
+    /* Sign/encrypt in a worker thread. The chunk is sent in order later on. */
+    if(messageContext->batch)
+        return dispatchChunkCrypto(messageContext, pre_sig_length, total_length);
+#endif
+
 #ifdef UA_ENABLE_ENCRYPTION
     res = signChunkSym(messageContext, pre_sig_length);
     if(res != UA_STATUSCODE_GOOD)
@@ -355,7 +682,7 @@ sendSymmetricChunk(UA_MessageContext *messageContext) {
 #endif
 
     /* Send the chunk, the buffer is freed in the network layer */
-    return connection->send(channel->connection, &messageContext->messageBuffer);
+    return sendChunk(channel, &messageContext->messageBuffer);
 
 error:
     connection->releaseSendBuffer(channel->connection, &messageContext->messageBuffer);
@@ -371,6 +698,23 @@ sendSymmetricEncodingCallback(void *data, UA_Byte **buf_pos, const UA_Byte **buf
     mc->buf_end = *buf_end;
 
     /* Send out */
+#if UA_MULTITHREADING >= 200
+    /* The message has more than one chunk. Use the workers for the crypto if
+     * configured. Otherwise (also if the allocation fails) the chunks are
+     * processed in this thread. */
+    if(!mc->batch && useCryptoWorkers(mc->channel)) {
+        mc->batch = (UA_ChunkCryptoBatch*)UA_malloc(sizeof(UA_ChunkCryptoBatch));
+        if(mc->batch) {
+            mc->batch->jobsSize = 0;
+            mc->batch->sync = UA_ChunkCryptoSync_new(signEncryptChunkJob);
+            if(!mc->batch->sync) {
+                UA_free(mc->batch);
+                mc->batch = NULL;
+            }
+        }
+    }
+#endif
+
     UA_StatusCode retval = sendSymmetricChunk(mc);
     if(retval != UA_STATUSCODE_GOOD)
         return retval;
@@ -410,6 +754,9 @@ UA_MessageContext_begin(UA_MessageContext *mc, UA_SecureChannel *channel,
     mc->final = false;
     mc->messageBuffer = UA_BYTESTRING_NULL;
     mc->messageType = messageType;
+#if UA_MULTITHREADING >= 200
+    mc->batch = NULL;
+#endif
 
     /* Allocate the message buffer */
     UA_StatusCode retval =
@@ -428,21 +775,75 @@ UA_MessageContext_encode(UA_MessageContext *mc, const void *content,
                          const UA_DataType *contentType) {
     UA_StatusCode retval = UA_encodeBinary(content, contentType, &mc->buf_pos, &mc->buf_end,
                                            sendSymmetricEncodingCallback, mc);
-    if(retval != UA_STATUSCODE_GOOD && mc->messageBuffer.length > 0)
-        UA_MessageContext_abort(mc);
+    if(retval != UA_STATUSCODE_GOOD) {
+        if(mc->messageBuffer.length > 0)
+            UA_MessageContext_abort(mc);
+#if UA_MULTITHREADING >= 200
+        else if(mc->batch)
+            UA_MessageContext_abort(mc);
+#endif
+    }
+    return retval;
+}
+
+UA_StatusCode
+UA_MessageContext_encodeRaw(UA_MessageContext *mc, const UA_ByteString *encoded) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    const UA_Byte *src = encoded->data;
+    size_t remaining = encoded->length;
+    while(remaining > 0) {
+        /* The chunk is full. Send it out and continue in a new buffer. */
+        size_t space = (uintptr_t)mc->buf_end - (uintptr_t)mc->buf_pos;
+        if(space == 0) {
+            UA_Byte *buf_pos = mc->buf_pos;
+            const UA_Byte *buf_end = mc->buf_end;
+            retval = sendSymmetricEncodingCallback(mc, &buf_pos, &buf_end);
+            if(retval != UA_STATUSCODE_GOOD)
+                break;
+            continue;
+        }
+
+        size_t len = (remaining < space) ? remaining : space;
+        memcpy(mc->buf_pos, src, len);
+        mc->buf_pos += len;
+        src += len;
+        remaining -= len;
+    }
+
+    if(retval != UA_STATUSCODE_GOOD) {
+        if(mc->messageBuffer.length > 0)
+            UA_MessageContext_abort(mc);
+#if UA_MULTITHREADING >= 200
+        else if(mc->batch)
+            UA_MessageContext_abort(mc);
+#endif
+    }
     return retval;
 }
 
 UA_StatusCode
 UA_MessageContext_finish(UA_MessageContext *mc) {
     mc->final = true;
-    return sendSymmetricChunk(mc);
+    UA_StatusCode res = sendSymmetricChunk(mc);
+#if UA_MULTITHREADING >= 200
+    if(mc->batch) {
+        res = flushChunkCryptoBatch(mc, res);
+        deleteChunkCryptoBatch(mc);
+    }
+#endif
+    return res;
 }
 
 void
 UA_MessageContext_abort(UA_MessageContext *mc) {
     UA_Connection *connection = mc->channel->connection;
     connection->releaseSendBuffer(connection, &mc->messageBuffer);
+#if UA_MULTITHREADING >= 200
+    if(mc->batch) {
+        flushChunkCryptoBatch(mc, UA_STATUSCODE_BADREQUESTCANCELLEDBYCLIENT);
+        deleteChunkCryptoBatch(mc);
+    }
+#endif
 }
 
 UA_StatusCode
@@ -530,6 +931,8 @@ decryptMessageChunk(UA_SecureChannel *channel, UA_Chunk *chunk, void *applicatio
     const UA_SecurityPolicyCryptoModule *cryptoModule;
     UA_SequenceHeader sequenceHeader;
 
+    /* The header checks run under the lock of the channel owner */
+    lockChannel(channel);
     if(chunk->messageType == UA_MESSAGETYPE_OPN) {
         processSequenceNumber = processSequenceNumberAsym;
         checkHeader = (UA_StatusCode (*)(const UA_SecureChannel *, void *)) checkAsymHeader;
@@ -539,6 +942,15 @@ decryptMessageChunk(UA_SecureChannel *channel, UA_Chunk *chunk, void *applicatio
         if(res != UA_STATUSCODE_GOOD)
             goto error;
 
+        /* Configure the channel before verifying the certificate. This lets
+         * the server reject handshakes (admission control) before performing
+         * expensive crypto operations. */
+        if(channel->processOPNHeader != NULL && channel->securityPolicy == NULL) {
+            res = channel->processOPNHeader(application, channel, &asymHeader);
+            if(res != UA_STATUSCODE_GOOD)
+                goto error;
+        }
+
         if(asymHeader.senderCertificate.length > 0) {
             if(channel->certificateVerification == NULL) {
                 res = UA_STATUSCODE_BADINTERNALERROR;
@@ -551,12 +963,6 @@ decryptMessageChunk(UA_SecureChannel *channel, UA_Chunk *chunk, void *applicatio
                 goto error;
         }
 
-        if(channel->processOPNHeader != NULL && channel->securityPolicy == NULL) {
-            res = channel->processOPNHeader(application, channel, &asymHeader);
-            if(res != UA_STATUSCODE_GOOD)
-                goto error;
-        }
-
         if(secureChannelId != 0 && channel->securityToken.channelId == 0)
             channel->securityToken.channelId = secureChannelId;
 
@@ -566,8 +972,10 @@ decryptMessageChunk(UA_SecureChannel *channel, UA_Chunk *chunk, void *applicatio
         }
         cryptoModule = &channel->securityPolicy->asymmetricModule.cryptoModule;
     } else {
-        if(channel->state == UA_SECURECHANNELSTATE_CLOSED)
+        if(channel->state == UA_SECURECHANNELSTATE_CLOSED) {
+            unlockChannel(channel);
             return UA_STATUSCODE_BADSECURECHANNELCLOSED;
+        }
 #ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
         processSequenceNumber = processSequenceNumberSym;
 #else
@@ -597,11 +1005,17 @@ decryptMessageChunk(UA_SecureChannel *channel, UA_Chunk *chunk, void *applicatio
 
     /* Check (and revolve) the SecurityToken */
     res = checkHeader(channel, securityHeader);
+    unlockChannel(channel);
     clearHeader(securityHeader);
     if(res != UA_STATUSCODE_GOOD)
         return res;
 
     /* Decrypt the chunk payload */
+#if UA_MULTITHREADING >= 200
+    if(chunk->decrypted)
+        res = chunk->decryptStatus;
+    else
+#endif
     res = decryptAndVerifyChunk(channel, cryptoModule, chunk->messageType,
                                 &chunk->bytes, offset);
     if(res != UA_STATUSCODE_GOOD)
@@ -617,11 +1031,11 @@ decryptMessageChunk(UA_SecureChannel *channel, UA_Chunk *chunk, void *applicatio
         return res;
 
     chunk->requestId = sequenceHeader.requestId;
-    chunk->bytes.data += offset;
-    chunk->bytes.length -= offset;
+    UA_Chunk_hideHeaders(chunk, offset);
     return res;
 
 error:
+    unlockChannel(channel);
     if(securityHeader != NULL)
         clearHeader(securityHeader);
     return res;
@@ -716,6 +1130,90 @@ persistIncompleteChunk(UA_SecureChannel *channel, const UA_ByteString *buffer,
     return UA_STATUSCODE_GOOD;
 }
 
+#if UA_MULTITHREADING >= 200
+
+typedef struct {
+    const UA_SecureChannel *channel;
+    UA_Chunk *chunk;
+    size_t offset;
+} UA_ChunkDecryptJob;
+
+static void
+decryptVerifyChunkJob(void *data) {
+    UA_ChunkDecryptJob *job = (UA_ChunkDecryptJob*)data;
+    const UA_SecureChannel *channel = job->channel;
+    job->chunk->decryptStatus =
+        decryptAndVerifyChunk(channel, &channel->securityPolicy->symmetricModule.cryptoModule,
+                              job->chunk->messageType, &job->chunk->bytes, job->offset);
+    job->chunk->decrypted = true;
+}
+
+/* Decrypt the run of symmetric chunks at the head of the queue in the worker
+ * threads. The run ends with the first chunk that uses a different
+ * SecurityToken, as revolving the token changes the keys. The checks of the
+ * headers and the sequence numbers remain in decryptMessageChunk and are
+ * processed in order.
+ *
+ * Usually the network layer delivers one chunk at a time. Returns true if
+ * processing the run shall be deferred until more chunks have arrived. That is
+ * the case if the last received chunk is intermediate and the window is not
+ * yet filled. */
+static UA_Boolean
+decryptChunksParallel(UA_SecureChannel *channel) {
+    if(!useCryptoWorkers(channel))
+        return false;
+    lockChannel(channel);
+    UA_Boolean open = (channel->state == UA_SECURECHANNELSTATE_OPEN);
+    unlockChannel(channel);
+    if(!open)
+        return false;
+
+    UA_ChunkDecryptJob jobs[UA_CHUNKCRYPTO_WINDOW];
+    size_t jobsSize = 0;
+    UA_Chunk *chunk;
+    SIMPLEQ_FOREACH(chunk, &channel->completeChunks, pointers) {
+        if(jobsSize == UA_CHUNKCRYPTO_WINDOW || chunk->decrypted)
+            break;
+        if(chunk->messageType != UA_MESSAGETYPE_MSG &&
+           chunk->messageType != UA_MESSAGETYPE_CLO)
+            break;
+
+        /* Skip the MessageHeader and the SecureChannelId. The remaining
+         * SymmetricAlgorithmSecurityHeader only contains the TokenId. */
+        size_t offset = UA_CONNECTION_PROTOCOL_MESSAGE_HEADER_SIZE + 4;
+        UA_UInt32 tokenId = 0;
+        if(UA_UInt32_decodeBinary(&chunk->bytes, &offset, &tokenId) != UA_STATUSCODE_GOOD ||
+           tokenId != channel->securityToken.tokenId)
+            break;
+
+        jobs[jobsSize].channel = channel;
+        jobs[jobsSize].chunk = chunk;
+        jobs[jobsSize].offset = offset;
+        jobsSize++;
+    }
+
+    /* Wait for the next chunks of the message */
+    if(!chunk && jobsSize > 0 && jobsSize < UA_CHUNKCRYPTO_WINDOW &&
+       jobs[jobsSize-1].chunk->chunkType == UA_CHUNKTYPE_INTERMEDIATE)
+        return true;
+
+    /* Not worth the synchronization overhead */
+    if(jobsSize < 2)
+        return false;
+
+    /* Decrypt in this thread if the sync cannot be allocated */
+    UA_ChunkCryptoSync *sync = UA_ChunkCryptoSync_new(decryptVerifyChunkJob);
+    if(!sync)
+        return false;
+    for(size_t i = 0; i < jobsSize; i++)
+        UA_ChunkCryptoSync_dispatch(sync, channel->cryptoWorkQueue, &jobs[i]);
+    UA_ChunkCryptoSync_wait(sync);
+    UA_ChunkCryptoSync_release(sync);
+    return false;
+}
+
+#endif /* UA_MULTITHREADING >= 200 */
+
 /* Processes chunks and puts them into the payloads queue. Once a final chunk is
  * put into the queue, the message is assembled and the callback is called. The
  * queue will be cleared for the next message. */
@@ -725,6 +1223,12 @@ processChunks(UA_SecureChannel *channel, void *application,
     UA_Chunk *chunk;
     UA_StatusCode retval;
     while((chunk = SIMPLEQ_FIRST(&channel->completeChunks))) {
+#if UA_MULTITHREADING >= 200
+        /* Decrypt the following chunks ahead of time in the worker threads */
+        if(!chunk->decrypted && decryptChunksParallel(channel))
+            break;
+#endif
+
         /* Decrypt and add to the decrypted queue */
         SIMPLEQ_REMOVE_HEAD(&channel->completeChunks, pointers);
         if(chunk->messageType == UA_MESSAGETYPE_OPN ||
@@ -736,8 +1240,7 @@ processChunks(UA_SecureChannel *channel, void *application,
                 return retval;
             }
         } else {
-            chunk->bytes.data += UA_CONNECTION_PROTOCOL_MESSAGE_HEADER_SIZE;
-            chunk->bytes.length -= UA_CONNECTION_PROTOCOL_MESSAGE_HEADER_SIZE;
+            UA_Chunk_hideHeaders(chunk, UA_CONNECTION_PROTOCOL_MESSAGE_HEADER_SIZE);
         }
         SIMPLEQ_INSERT_TAIL(&channel->decryptedChunks, chunk, pointers);
 
@@ -832,6 +1335,10 @@ extractCompleteChunk(UA_SecureChannel *channel, const UA_ByteString *buffer,
     chunk->chunkType = chunkType;
     chunk->requestId = 0;
     chunk->copied = false;
+#if UA_MULTITHREADING >= 200
+    chunk->decrypted = false;
+    chunk->decryptStatus = UA_STATUSCODE_GOOD;
+#endif
 
     SIMPLEQ_INSERT_TAIL(&channel->completeChunks, chunk, pointers);
     return UA_STATUSCODE_GOOD;
@@ -18,6 +18,7 @@
 
 #include "open62541_queue.h"
 #include "ua_connection_internal.h"
+#include "ua_workqueue.h"
 
 _UA_BEGIN_DECLS
 
@@ -51,6 +52,10 @@ typedef struct UA_Chunk {
     UA_UInt32 requestId;
     UA_Boolean copied; /* Do the bytes point to a buffer from the network or was
                         * memory allocated for the chunk separately */
+#if UA_MULTITHREADING >= 200
+    UA_Boolean decrypted; /* Decrypted and verified ahead of time by a worker */
+    UA_StatusCode decryptStatus;
+#endif
 } UA_Chunk;
 
 typedef SIMPLEQ_HEAD(UA_ChunkQueue, UA_Chunk) UA_ChunkQueue;
@@ -112,6 +117,39 @@ struct UA_SecureChannel {
     UA_CertificateVerification *certificateVerification;
     UA_StatusCode (*processOPNHeader)(void *application, UA_SecureChannel *channel,
                                       const UA_AsymmetricAlgorithmSecurityHeader *asymHeader);
+
+    /* While sendBatch is set, the finished chunks are collected in the batch
+     * buffer and handed to the network layer together. See
+     * UA_SecureChannel_beginSendBatch. */
+    UA_Boolean sendBatch;
+    UA_ByteString sendBatchBuffer; /* Allocated from the connection */
+    size_t sendBatchLength;
+
+#if UA_MULTITHREADING >= 100
+    /* Optional. The server processes received buffers without the service
+     * mutex. The header checks of a chunk change the channel state that other
+     * threads see (the configuration from the first OPN header, the renewal of
+     * the SecurityToken). These callbacks take and release the mutex around
+     * them. The decryption and verification run unlocked. */
+    void *lockContext;
+    void (*lock)(void *context);
+    void (*unlock)(void *context);
+#endif
+
+#if UA_MULTITHREADING >= 200
+    /* If set, the symmetric signing/encryption and decryption/verification of
+     * messages with several chunks is dispatched chunk-wise to the workers of
+     * the queue. The symmetric crypto functions of the SecurityPolicy must be
+     * reentrant for this. */
+    UA_WorkQueue *cryptoWorkQueue;
+
+    /* Optional. Enclose the asymmetric sign/encrypt of sent OPN messages. The
+     * server releases the service mutex in between during the handshake. The
+     * end callback returns an error if the channel was closed in the
+     * meantime. Uses the lockContext. */
+    void (*beginAsymCrypto)(void *context, UA_SecureChannel *channel);
+    UA_StatusCode (*endAsymCrypto)(void *context, UA_SecureChannel *channel);
+#endif
 };
 
 void UA_SecureChannel_init(UA_SecureChannel *channel,
@@ -130,6 +168,16 @@ UA_SecureChannel_setSecurityPolicy(UA_SecureChannel *channel,
                                    const UA_SecurityPolicy *securityPolicy,
                                    const UA_ByteString *remoteCertificate);
 
+/* Coalesce the outgoing messages into fewer calls to the network layer until
+ * UA_SecureChannel_flushSendBatch is called. Use this when many small messages
+ * (e.g. publish responses) are sent at once. */
+void
+UA_SecureChannel_beginSendBatch(UA_SecureChannel *channel);
+
+/* Send out the collected messages and end the batch mode */
+UA_StatusCode
+UA_SecureChannel_flushSendBatch(UA_SecureChannel *channel);
+
 /* Remove (partially) received unprocessed chunks */
 void
 UA_SecureChannel_deleteBuffered(UA_SecureChannel *channel);
@@ -176,6 +224,11 @@ typedef struct {
     const UA_Byte *buf_end;
 
     UA_Boolean final;
+
+#if UA_MULTITHREADING >= 200
+    /* Chunks that are signed/encrypted by the workers and wait to be sent */
+    struct UA_ChunkCryptoBatch *batch;
+#endif
 } UA_MessageContext;
 
 /* Start the context of a new symmetric message. */
@@ -190,6 +243,11 @@ UA_StatusCode
 UA_MessageContext_encode(UA_MessageContext *mc, const void *content,
                          const UA_DataType *contentType);
 
+/* Append content that is already binary encoded. Full chunks are sent out.
+ * The cleanup in case of errors is the same as for _encode. */
+UA_StatusCode
+UA_MessageContext_encodeRaw(UA_MessageContext *mc, const UA_ByteString *encoded);
+
 /* Sends a symmetric message already encoded in the context. The context is
  * cleaned up, also in case of errors. */
 UA_StatusCode
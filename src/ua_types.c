@@ -1243,6 +1243,275 @@ UA_delete(void *p, const UA_DataType *type) {
     UA_free(p);
 }
 
+/************/
+/* Equality */
+/************/
+
+/* Compares the values in place. No memory is allocated. The comparison follows
+ * the binary encoding: Two values are equal if they have the same encoding.
+ * (Except for ExtensionObjects that are compared in their decoded form when
+ * both are decoded.) */
+
+typedef UA_Boolean (*UA_equalSignature)(const void *p1, const void *p2,
+                                        const UA_DataType *type);
+
+static UA_Boolean
+arrayEqual(const void *p1, const void *p2, size_t size, const UA_DataType *type) {
+    if(type->overlayable)
+        return (memcmp(p1, p2, type->memSize * size) == 0);
+    uintptr_t ptr1 = (uintptr_t)p1;
+    uintptr_t ptr2 = (uintptr_t)p2;
+    for(size_t i = 0; i < size; i++) {
+        if(!UA_equal((const void*)ptr1, (const void*)ptr2, type))
+            return false;
+        ptr1 += type->memSize;
+        ptr2 += type->memSize;
+    }
+    return true;
+}
+
+static UA_Boolean
+equalMem(const void *p1, const void *p2, const UA_DataType *type) {
+    return (memcmp(p1, p2, type->memSize) == 0);
+}
+
+static UA_Boolean
+equalString(const UA_String *p1, const UA_String *p2, const UA_DataType *_) {
+    /* The null string is encoded differently than the empty string */
+    if(p1->length != p2->length || (p1->data == NULL) != (p2->data == NULL))
+        return false;
+    return (p1->length == 0 || memcmp(p1->data, p2->data, p1->length) == 0);
+}
+
+static UA_Boolean
+equalNodeId(const UA_NodeId *p1, const UA_NodeId *p2, const UA_DataType *_) {
+    return (UA_NodeId_order(p1, p2) == UA_ORDER_EQ);
+}
+
+static UA_Boolean
+equalExpandedNodeId(const UA_ExpandedNodeId *p1, const UA_ExpandedNodeId *p2,
+                    const UA_DataType *_) {
+    return (p1->serverIndex == p2->serverIndex &&
+            equalString(&p1->namespaceUri, &p2->namespaceUri, NULL) &&
+            equalNodeId(&p1->nodeId, &p2->nodeId, NULL));
+}
+
+static UA_Boolean
+equalQualifiedName(const UA_QualifiedName *p1, const UA_QualifiedName *p2,
+                   const UA_DataType *_) {
+    return (p1->namespaceIndex == p2->namespaceIndex &&
+            equalString(&p1->name, &p2->name, NULL));
+}
+
+static UA_Boolean
+equalLocalizedText(const UA_LocalizedText *p1, const UA_LocalizedText *p2,
+                   const UA_DataType *_) {
+    return (equalString(&p1->locale, &p2->locale, NULL) &&
+            equalString(&p1->text, &p2->text, NULL));
+}
+
+static UA_Boolean
+equalExtensionObject(const UA_ExtensionObject *p1, const UA_ExtensionObject *p2,
+                     const UA_DataType *_) {
+    UA_Boolean decoded1 = (p1->encoding >= UA_EXTENSIONOBJECT_DECODED);
+    UA_Boolean decoded2 = (p2->encoding >= UA_EXTENSIONOBJECT_DECODED);
+    if(decoded1 != decoded2)
+        return false;
+    if(!decoded1)
+        return (p1->encoding == p2->encoding &&
+                equalNodeId(&p1->content.encoded.typeId,
+                            &p2->content.encoded.typeId, NULL) &&
+                equalString(&p1->content.encoded.body,
+                            &p2->content.encoded.body, NULL));
+    const UA_DataType *type = p1->content.decoded.type;
+    if(type != p2->content.decoded.type)
+        return false;
+    if(!type)
+        return true;
+    return UA_equal(p1->content.decoded.data, p2->content.decoded.data, type);
+}
+
+static UA_Boolean
+equalVariant(const UA_Variant *p1, const UA_Variant *p2, const UA_DataType *_) {
+    if(p1->type != p2->type)
+        return false;
+    if(!p1->type)
+        return true; /* Both are empty */
+    UA_Boolean scalar1 = UA_Variant_isScalar(p1);
+    if(scalar1 != UA_Variant_isScalar(p2))
+        return false;
+    if(scalar1)
+        return UA_equal(p1->data, p2->data, p1->type);
+
+    /* The null array is encoded differently than the empty array */
+    if(p1->arrayLength != p2->arrayLength ||
+       (p1->data == NULL) != (p2->data == NULL))
+        return false;
+    if(p1->arrayDimensionsSize != p2->arrayDimensionsSize)
+        return false;
+    if(p1->arrayDimensionsSize > 0 &&
+       memcmp(p1->arrayDimensions, p2->arrayDimensions,
+              sizeof(UA_UInt32) * p1->arrayDimensionsSize) != 0)
+        return false;
+    return arrayEqual(p1->data, p2->data, p1->arrayLength, p1->type);
+}
+
+static UA_Boolean
+equalDataValue(const UA_DataValue *p1, const UA_DataValue *p2, const UA_DataType *_) {
+    if(p1->hasValue != p2->hasValue ||
+       p1->hasStatus != p2->hasStatus ||
+       p1->hasSourceTimestamp != p2->hasSourceTimestamp ||
+       p1->hasServerTimestamp != p2->hasServerTimestamp ||
+       p1->hasSourcePicoseconds != p2->hasSourcePicoseconds ||
+       p1->hasServerPicoseconds != p2->hasServerPicoseconds)
+        return false;
+    if(p1->hasStatus && p1->status != p2->status)
+        return false;
+    if(p1->hasSourceTimestamp && p1->sourceTimestamp != p2->sourceTimestamp)
+        return false;
+    if(p1->hasServerTimestamp && p1->serverTimestamp != p2->serverTimestamp)
+        return false;
+    if(p1->hasSourcePicoseconds && p1->sourcePicoseconds != p2->sourcePicoseconds)
+        return false;
+    if(p1->hasServerPicoseconds && p1->serverPicoseconds != p2->serverPicoseconds)
+        return false;
+    return (!p1->hasValue || equalVariant(&p1->value, &p2->value, NULL));
+}
+
+static UA_Boolean
+equalDiagnosticInfo(const UA_DiagnosticInfo *p1, const UA_DiagnosticInfo *p2,
+                    const UA_DataType *_) {
+    if(p1->hasSymbolicId != p2->hasSymbolicId ||
+       p1->hasNamespaceUri != p2->hasNamespaceUri ||
+       p1->hasLocalizedText != p2->hasLocalizedText ||
+       p1->hasLocale != p2->hasLocale ||
+       p1->hasAdditionalInfo != p2->hasAdditionalInfo ||
+       p1->hasInnerStatusCode != p2->hasInnerStatusCode ||
+       p1->hasInnerDiagnosticInfo != p2->hasInnerDiagnosticInfo)
+        return false;
+    if((p1->hasSymbolicId && p1->symbolicId != p2->symbolicId) ||
+       (p1->hasNamespaceUri && p1->namespaceUri != p2->namespaceUri) ||
+       (p1->hasLocalizedText && p1->localizedText != p2->localizedText) ||
+       (p1->hasLocale && p1->locale != p2->locale) ||
+       (p1->hasInnerStatusCode && p1->innerStatusCode != p2->innerStatusCode))
+        return false;
+    if(p1->hasAdditionalInfo &&
+       !equalString(&p1->additionalInfo, &p2->additionalInfo, NULL))
+        return false;
+    if(p1->hasInnerDiagnosticInfo) {
+        if((p1->innerDiagnosticInfo == NULL) != (p2->innerDiagnosticInfo == NULL))
+            return false;
+        if(p1->innerDiagnosticInfo &&
+           !equalDiagnosticInfo(p1->innerDiagnosticInfo, p2->innerDiagnosticInfo, NULL))
+            return false;
+    }
+    return true;
+}
+
+static UA_Boolean
+equalStructure(const void *p1, const void *p2, const UA_DataType *type) {
+    if(type->overlayable)
+        return (memcmp(p1, p2, type->memSize) == 0);
+    uintptr_t ptr1 = (uintptr_t)p1;
+    uintptr_t ptr2 = (uintptr_t)p2;
+    const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+    for(size_t i = 0; i < type->membersSize; ++i) {
+        const UA_DataTypeMember *m = &type->members[i];
+        const UA_DataType *mt = &typelists[!m->namespaceZero][m->memberTypeIndex];
+        ptr1 += m->padding;
+        ptr2 += m->padding;
+        if(!m->isOptional) {
+            if(!m->isArray) {
+                if(!UA_equal((const void*)ptr1, (const void*)ptr2, mt))
+                    return false;
+                ptr1 += mt->memSize;
+                ptr2 += mt->memSize;
+                continue;
+            }
+        } else if(!m->isArray) {
+            /* Optional scalar field */
+            const void *o1 = *(void * const *)ptr1;
+            const void *o2 = *(void * const *)ptr2;
+            if((o1 == NULL) != (o2 == NULL))
+                return false;
+            if(o1 && !UA_equal(o1, o2, mt))
+                return false;
+            ptr1 += sizeof(void*);
+            ptr2 += sizeof(void*);
+            continue;
+        }
+
+        /* (Optional) array field */
+        size_t size1 = *(const size_t*)ptr1;
+        size_t size2 = *(const size_t*)ptr2;
+        ptr1 += sizeof(size_t);
+        ptr2 += sizeof(size_t);
+        const void *a1 = *(void * const *)ptr1;
+        const void *a2 = *(void * const *)ptr2;
+        if(size1 != size2 || (a1 == NULL) != (a2 == NULL))
+            return false;
+        if(!arrayEqual(a1, a2, size1, mt))
+            return false;
+        ptr1 += sizeof(void*);
+        ptr2 += sizeof(void*);
+    }
+    return true;
+}
+
+static UA_Boolean
+equalUnion(const void *p1, const void *p2, const UA_DataType *type) {
+    UA_UInt32 selection = *(const UA_UInt32*)p1;
+    if(selection != *(const UA_UInt32*)p2)
+        return false;
+    if(selection == 0)
+        return true;
+    const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+    const UA_DataTypeMember *m = &type->members[selection-1];
+    const UA_DataType *mt = &typelists[!m->namespaceZero][m->memberTypeIndex];
+    uintptr_t offset = UA_TYPES[UA_TYPES_UINT32].memSize + m->padding;
+    return UA_equal((const void*)((uintptr_t)p1 + offset),
+                    (const void*)((uintptr_t)p2 + offset), mt);
+}
+
+static const UA_equalSignature equalJumpTable[UA_DATATYPEKINDS] = {
+    (UA_equalSignature)equalMem, /* Boolean */
+    (UA_equalSignature)equalMem, /* SByte */
+    (UA_equalSignature)equalMem, /* Byte */
+    (UA_equalSignature)equalMem, /* Int16 */
+    (UA_equalSignature)equalMem, /* UInt16 */
+    (UA_equalSignature)equalMem, /* Int32 */
+    (UA_equalSignature)equalMem, /* UInt32 */
+    (UA_equalSignature)equalMem, /* Int64 */
+    (UA_equalSignature)equalMem, /* UInt64 */
+    (UA_equalSignature)equalMem, /* Float */
+    (UA_equalSignature)equalMem, /* Double */
+    (UA_equalSignature)equalString,
+    (UA_equalSignature)equalMem, /* DateTime */
+    (UA_equalSignature)equalMem, /* Guid */
+    (UA_equalSignature)equalString, /* ByteString */
+    (UA_equalSignature)equalString, /* XmlElement */
+    (UA_equalSignature)equalNodeId,
+    (UA_equalSignature)equalExpandedNodeId,
+    (UA_equalSignature)equalMem, /* StatusCode */
+    (UA_equalSignature)equalQualifiedName,
+    (UA_equalSignature)equalLocalizedText,
+    (UA_equalSignature)equalExtensionObject,
+    (UA_equalSignature)equalDataValue,
+    (UA_equalSignature)equalVariant,
+    (UA_equalSignature)equalDiagnosticInfo,
+    (UA_equalSignature)equalMem, /* Decimal, has no heap members */
+    (UA_equalSignature)equalMem, /* Enumeration */
+    (UA_equalSignature)equalStructure,
+    (UA_equalSignature)equalStructure, /* Structure with Optional Fields */
+    (UA_equalSignature)equalUnion, /* Union */
+    (UA_equalSignature)equalMem /* BitfieldCluster, has no heap members */
+};
+
+UA_Boolean
+UA_equal(const void *p1, const void *p2, const UA_DataType *type) {
+    return equalJumpTable[type->typeKind](p1, p2, type);
+}
+
 /******************/
 /* Array Handling */
 /******************/
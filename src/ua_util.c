@@ -297,3 +297,117 @@ UA_NodeId_print(const UA_NodeId *id, UA_String *output) {
 
     return UA_STATUSCODE_GOOD;
 }
+
+/**************/
+/* NodeId Map */
+/**************/
+
+#define NODEIDMAP_MINSIZE 64
+
+static UA_UInt32
+nodeIdMapHash(const UA_NodeId *key) {
+    UA_UInt32 hash = UA_NodeId_hash(key);
+    return (hash != 0) ? hash : 1; /* Zero marks the empty slots */
+}
+
+/* The slot of the key or the empty slot where the key is inserted */
+static UA_NodeIdMapSlot *
+nodeIdMapSlot(const UA_NodeIdMap *map, const UA_NodeId *key, UA_UInt32 hash) {
+    size_t mask = map->slotsSize - 1;
+    size_t i = hash & mask;
+    while(map->slots[i].hash != 0 &&
+          (map->slots[i].hash != hash || !UA_NodeId_equal(&map->slots[i].key, key)))
+        i = (i + 1) & mask;
+    return &map->slots[i];
+}
+
+static UA_StatusCode
+nodeIdMapGrow(UA_NodeIdMap *map) {
+    size_t newSize = (map->slotsSize > 0) ? map->slotsSize * 2 : NODEIDMAP_MINSIZE;
+    UA_NodeIdMapSlot *slots = (UA_NodeIdMapSlot*)
+        UA_calloc(newSize, sizeof(UA_NodeIdMapSlot));
+    if(!slots)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_NodeIdMapSlot *old = map->slots;
+    size_t oldSize = map->slotsSize;
+    map->slots = slots;
+    map->slotsSize = newSize;
+    for(size_t i = 0; i < oldSize; i++) {
+        if(old[i].hash != 0)
+            *nodeIdMapSlot(map, &old[i].key, old[i].hash) = old[i]; /* Move */
+    }
+    UA_free(old);
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_NodeIdMap_clear(UA_NodeIdMap *map) {
+    for(size_t i = 0; i < map->slotsSize; i++) {
+        if(map->slots[i].hash != 0)
+            UA_NodeId_clear(&map->slots[i].key);
+    }
+    UA_free(map->slots);
+    memset(map, 0, sizeof(UA_NodeIdMap));
+}
+
+void **
+UA_NodeIdMap_find(const UA_NodeIdMap *map, const UA_NodeId *key) {
+    if(map->count == 0)
+        return NULL;
+    UA_NodeIdMapSlot *slot = nodeIdMapSlot(map, key, nodeIdMapHash(key));
+    return (slot->hash != 0) ? &slot->value : NULL;
+}
+
+UA_StatusCode
+UA_NodeIdMap_insert(UA_NodeIdMap *map, const UA_NodeId *key, void *value) {
+    UA_UInt32 hash = nodeIdMapHash(key);
+    if(map->count > 0) {
+        UA_NodeIdMapSlot *slot = nodeIdMapSlot(map, key, hash);
+        if(slot->hash != 0) {
+            slot->value = value;
+            return UA_STATUSCODE_GOOD;
+        }
+    }
+
+    /* Grow at half load. Without memory, continue with the old slots as long
+     * as one slot remains empty. The lookup gets slower but stays correct. */
+    if((map->count + 1) * 2 > map->slotsSize) {
+        UA_StatusCode res = nodeIdMapGrow(map);
+        if(res != UA_STATUSCODE_GOOD && map->count + 1 >= map->slotsSize)
+            return res;
+    }
+
+    UA_NodeIdMapSlot *slot = nodeIdMapSlot(map, key, hash);
+    UA_StatusCode res = UA_NodeId_copy(key, &slot->key);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    slot->value = value;
+    slot->hash = hash;
+    map->count++;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_Boolean
+UA_NodeIdMap_remove(UA_NodeIdMap *map, const UA_NodeId *key) {
+    if(map->count == 0)
+        return false;
+    UA_NodeIdMapSlot *slot = nodeIdMapSlot(map, key, nodeIdMapHash(key));
+    if(slot->hash == 0)
+        return false;
+    UA_NodeId_clear(&slot->key);
+
+    /* Move the following entries of the probe sequence into the gap. An entry
+     * stays if its home slot lies cyclically in (gap, j]. */
+    size_t mask = map->slotsSize - 1;
+    size_t gap = (size_t)(slot - map->slots);
+    for(size_t j = (gap + 1) & mask; map->slots[j].hash != 0; j = (j + 1) & mask) {
+        size_t home = map->slots[j].hash & mask;
+        if((gap < j) ? (home > gap && home <= j) : (home > gap || home <= j))
+            continue;
+        map->slots[gap] = map->slots[j];
+        gap = j;
+    }
+    memset(&map->slots[gap], 0, sizeof(UA_NodeIdMapSlot));
+    map->count--;
+    return true;
+}
@@ -157,6 +157,42 @@ typedef union {
 UA_Boolean UA_EXPORT
 UA_String_equal_ignorecase(const UA_String *s1, const UA_String *s2);
 
+/**
+ * NodeId Map
+ * ----------
+ * Hash map from NodeIds to pointers for the internal indexes. Open addressing
+ * with linear probing. The number of slots is a power of two and doubles at
+ * half load. Removed entries are shifted back, so there are no tombstones. The
+ * keys are copied into the map. A zeroed map is empty. Iterate over the slots
+ * with a non-zero hash. */
+
+typedef struct {
+    UA_NodeId key;
+    void *value;
+    UA_UInt32 hash; /* Zero for empty slots */
+} UA_NodeIdMapSlot;
+
+typedef struct {
+    UA_NodeIdMapSlot *slots;
+    size_t slotsSize;
+    size_t count;
+} UA_NodeIdMap;
+
+void
+UA_NodeIdMap_clear(UA_NodeIdMap *map);
+
+/* Returns the address of the value. NULL if the key is not contained. */
+void **
+UA_NodeIdMap_find(const UA_NodeIdMap *map, const UA_NodeId *key);
+
+/* Insert the key or replace the value of a contained key */
+UA_StatusCode
+UA_NodeIdMap_insert(UA_NodeIdMap *map, const UA_NodeId *key, void *value);
+
+/* Returns whether the key was contained */
+UA_Boolean
+UA_NodeIdMap_remove(UA_NodeIdMap *map, const UA_NodeId *key);
+
 _UA_END_DECLS
 
 #endif /* UA_UTIL_H_ */
@@ -37,7 +37,7 @@ void UA_WorkQueue_init(UA_WorkQueue *wq) {
 static void UA_WorkQueue_manuallyProcessDelayed(UA_WorkQueue *wq);
 #endif
 
-void UA_WorkQueue_cleanup(UA_WorkQueue *wq) {
+void UA_WorkQueue_processRemaining(UA_WorkQueue *wq) {
 #if UA_MULTITHREADING >= 200
     /* Shut down workers */
     UA_WorkQueue_stop(wq);
@@ -59,6 +59,10 @@ void UA_WorkQueue_cleanup(UA_WorkQueue *wq) {
 
     /* All workers are shut down. Execute remaining delayed work here. */
     UA_WorkQueue_manuallyProcessDelayed(wq);
+}
+
+void UA_WorkQueue_cleanup(UA_WorkQueue *wq) {
+    UA_WorkQueue_processRemaining(wq);
 
 #if UA_MULTITHREADING >= 200
     wq->delayedCallbacks_checkpoint = NULL;
@@ -95,12 +99,20 @@ workerLoop(UA_Worker *worker) {
             SIMPLEQ_REMOVE_HEAD(&wq->dispatchQueue, next);
         UA_UNLOCK(wq->dispatchQueue_accessMutex);
 
-        /* Nothing to do. Sleep until a callback is dispatched */
+        /* Nothing to do. Sleep until a callback is dispatched. The mutex is
+         * released during the wait and can be held by several workers. So the
+         * counting UA_LOCK macros cannot be used here. */
         if(!dc) {
-            UA_LOCK(wq->dispatchQueue_conditionMutex);
-            pthread_cond_wait(&wq->dispatchQueue_condition,
-                              &wq->dispatchQueue_conditionMutex);
-            UA_UNLOCK(wq->dispatchQueue_conditionMutex);
+            pthread_mutex_lock(&wq->dispatchQueue_conditionMutex);
+            /* Check again under the condition mutex. Work might have been
+             * enqueued (and the wakeup signal sent) in the meantime. */
+            UA_LOCK(wq->dispatchQueue_accessMutex);
+            UA_Boolean empty = SIMPLEQ_EMPTY(&wq->dispatchQueue);
+            UA_UNLOCK(wq->dispatchQueue_accessMutex);
+            if(empty && *running)
+                pthread_cond_wait(&wq->dispatchQueue_condition,
+                                  &wq->dispatchQueue_conditionMutex);
+            pthread_mutex_unlock(&wq->dispatchQueue_conditionMutex);
             continue;
         }
 
@@ -145,7 +157,9 @@ void UA_WorkQueue_stop(UA_WorkQueue *wq) {
         wq->workers[i].running = false;
 
     /* Wake up all workers */
+    pthread_mutex_lock(&wq->dispatchQueue_conditionMutex);
     pthread_cond_broadcast(&wq->dispatchQueue_condition);
+    pthread_mutex_unlock(&wq->dispatchQueue_conditionMutex);
 
     /* Wait for the workers to finish, then clean up */
     for(size_t i = 0; i < wq->workersSize; ++i)
@@ -174,7 +188,9 @@ void UA_WorkQueue_enqueue(UA_WorkQueue *wq, UA_ApplicationCallback cb,
     UA_UNLOCK(wq->dispatchQueue_accessMutex);
 
     /* Wake up sleeping workers */
+    pthread_mutex_lock(&wq->dispatchQueue_conditionMutex);
     pthread_cond_broadcast(&wq->dispatchQueue_condition);
+    pthread_mutex_unlock(&wq->dispatchQueue_conditionMutex);
 }
 
 #endif
@@ -100,6 +100,10 @@ void UA_WorkQueue_init(UA_WorkQueue *wq);
  * delayed queue to the worker dispatch queue. */
 void UA_WorkQueue_enqueueDelayed(UA_WorkQueue *wq, UA_DelayedCallback *cb);
 
+/* Stops the workers and executes the remaining (delayed) callbacks in the
+ * calling thread. The workers can be started again afterwards. */
+void UA_WorkQueue_processRemaining(UA_WorkQueue *wq);
+
 /* Stop the workers, process all enqueued work in the calling thread, clean up
  * mutexes etc. */
 void UA_WorkQueue_cleanup(UA_WorkQueue *wq);
@@ -0,0 +1,114 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <open62541/plugin/log_async.h>
+
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "check.h"
+
+/* Returns the number of lines and the number of lines that report dropped
+ * messages */
+static size_t
+countLines(FILE *f, size_t *dropLines) {
+    char line[1024];
+    size_t lines = 0;
+    *dropLines = 0;
+    rewind(f);
+    while(fgets(line, sizeof(line), f)) {
+        lines++;
+        if(strstr(line, "log messages dropped"))
+            (*dropLines)++;
+    }
+    return lines;
+}
+
+START_TEST(AsyncLog_writeAll) {
+    FILE *f = tmpfile();
+    ck_assert(f != NULL);
+    UA_Logger logger = UA_Log_Async_withLevel(f, UA_LOGLEVEL_INFO, 1024);
+    ck_assert(logger.log != NULL);
+
+    for(size_t i = 0; i < 100; i++)
+        UA_LOG_INFO(&logger, UA_LOGCATEGORY_USERLAND, "message %lu", (unsigned long)i);
+    UA_LOG_DEBUG(&logger, UA_LOGCATEGORY_USERLAND, "filtered");
+    ck_assert_uint_eq(UA_Log_Async_getDropCount(&logger), 0);
+    logger.clear(logger.context); /* Writes all pending messages */
+
+    size_t dropLines;
+    ck_assert_uint_eq(countLines(f, &dropLines), 100);
+    ck_assert_uint_eq(dropLines, 0);
+
+    char line[1024];
+    rewind(f);
+    ck_assert(fgets(line, sizeof(line), f) != NULL);
+    ck_assert(strstr(line, "info/userland\tmessage 0\n") != NULL);
+    fclose(f);
+} END_TEST
+
+START_TEST(AsyncLog_dropWhenFull) {
+    FILE *f = tmpfile();
+    ck_assert(f != NULL);
+    UA_Logger logger = UA_Log_Async_withLevel(f, UA_LOGLEVEL_INFO, 2);
+    ck_assert(logger.log != NULL);
+
+    for(size_t i = 0; i < 10000; i++)
+        UA_LOG_INFO(&logger, UA_LOGCATEGORY_USERLAND, "message %lu", (unsigned long)i);
+    size_t dropped = UA_Log_Async_getDropCount(&logger);
+    logger.clear(logger.context);
+
+    size_t dropLines;
+    size_t lines = countLines(f, &dropLines);
+    ck_assert_uint_eq(lines - dropLines + dropped, 10000);
+    if(dropped > 0)
+        ck_assert_uint_gt(dropLines, 0);
+    fclose(f);
+} END_TEST
+
+START_TEST(AsyncLog_wakeUp) {
+    /* Read the output from a pipe while the logger is running */
+    int fds[2];
+    ck_assert_int_eq(pipe(fds), 0);
+    FILE *f = fdopen(fds[1], "w");
+    ck_assert(f != NULL);
+    UA_Logger logger = UA_Log_Async_withLevel(f, UA_LOGLEVEL_INFO, 16);
+    ck_assert(logger.log != NULL);
+
+    /* Every message wakes up the idle background thread */
+    for(size_t i = 0; i < 3; i++) {
+        usleep(20 * 1000);
+        UA_LOG_INFO(&logger, UA_LOGCATEGORY_USERLAND, "message %lu", (unsigned long)i);
+        struct pollfd pfd = {fds[0], POLLIN, 0};
+        ck_assert_int_eq(poll(&pfd, 1, 5000), 1);
+        char buf[1024];
+        ssize_t len = read(fds[0], buf, sizeof(buf) - 1);
+        ck_assert_int_gt(len, 0);
+        buf[len] = 0;
+        ck_assert(strstr(buf, "info/userland\tmessage") != NULL);
+    }
+
+    logger.clear(logger.context);
+    fclose(f);
+    close(fds[0]);
+} END_TEST
+
+int main(void) {
+    Suite *s  = suite_create("Test Async Logger");
+    TCase *tc = tcase_create("test cases");
+    tcase_add_test(tc, AsyncLog_writeAll);
+    tcase_add_test(tc, AsyncLog_dropWhenFull);
+    tcase_add_test(tc, AsyncLog_wakeUp);
+    suite_add_tcase(s, tc);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all (sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -290,6 +290,95 @@ START_TEST(decodeComplexTypeFromRandomBufferShallSurvive) {
 }
 END_TEST
 
+START_TEST(decodedCopyShallBeEqual) {
+    // given
+    UA_ByteString msg1;
+    UA_StatusCode retval = UA_ByteString_allocBuffer(&msg1, 256);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+#ifdef _WIN32
+    srand(42);
+#else
+    srandom(42);
+#endif
+    for(int n = 0; n < RANDOM_TESTS; n++) {
+        for(size_t i = 0; i < msg1.length; i++) {
+#ifdef _WIN32
+            msg1.data[i] = (UA_Byte)rand();
+#else
+            msg1.data[i] = (UA_Byte)random();
+#endif
+        }
+        size_t pos = 0;
+        void *obj1 = UA_new(&UA_TYPES[_i]);
+        retval = UA_decodeBinary(&msg1, &pos, obj1, &UA_TYPES[_i], NULL);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_delete(obj1, &UA_TYPES[_i]);
+            continue;
+        }
+        // when
+        void *obj2 = UA_new(&UA_TYPES[_i]);
+        retval = UA_copy(obj1, obj2, &UA_TYPES[_i]);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        // then
+        ck_assert_msg(UA_equal(obj1, obj2, &UA_TYPES[_i]),
+                      "Copy of type %s is not equal", UA_TYPES[_i].typeName);
+        // finally
+        UA_delete(obj1, &UA_TYPES[_i]);
+        UA_delete(obj2, &UA_TYPES[_i]);
+    }
+    UA_ByteString_deleteMembers(&msg1);
+}
+END_TEST
+
+START_TEST(equalShallDetectChanges) {
+    UA_String strings[2] = {UA_STRING_STATIC("open"), UA_STRING_STATIC("62541")};
+    UA_DataValue dv1;
+    UA_DataValue_init(&dv1);
+    UA_Variant_setArray(&dv1.value, strings, 2, &UA_TYPES[UA_TYPES_STRING]);
+    dv1.hasValue = true;
+
+    UA_DataValue dv2;
+    UA_StatusCode retval = UA_DataValue_copy(&dv1, &dv2);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_equal(&dv1, &dv2, &UA_TYPES[UA_TYPES_DATAVALUE]));
+
+    /* Change the content */
+    ((UA_String*)dv2.value.data)[1].data[0] = 'x';
+    ck_assert(!UA_equal(&dv1, &dv2, &UA_TYPES[UA_TYPES_DATAVALUE]));
+    ((UA_String*)dv2.value.data)[1].data[0] = '6';
+    ck_assert(UA_equal(&dv1, &dv2, &UA_TYPES[UA_TYPES_DATAVALUE]));
+
+    /* Change the flags */
+    dv2.hasStatus = true;
+    ck_assert(!UA_equal(&dv1, &dv2, &UA_TYPES[UA_TYPES_DATAVALUE]));
+    dv2.hasStatus = false;
+
+    /* The null string is different from the empty string */
+    UA_String s1 = UA_STRING_NULL;
+    UA_String s2 = {0, (UA_Byte*)UA_EMPTY_ARRAY_SENTINEL};
+    ck_assert(!UA_equal(&s1, &s2, &UA_TYPES[UA_TYPES_STRING]));
+
+    UA_DataValue_deleteMembers(&dv2);
+}
+END_TEST
+
+START_TEST(equalShallCompareFixedSizeKinds) {
+    /* Decimal and BitfieldCluster have no heap members and are compared
+     * bytewise */
+    UA_DataType type = UA_TYPES[UA_TYPES_UINT64];
+    UA_UInt64 v1 = 42;
+    UA_UInt64 v2 = 42;
+    type.typeKind = UA_DATATYPEKIND_DECIMAL;
+    ck_assert(UA_equal(&v1, &v2, &type));
+    type.typeKind = UA_DATATYPEKIND_BITFIELDCLUSTER;
+    ck_assert(UA_equal(&v1, &v2, &type));
+    v2 = 43;
+    ck_assert(!UA_equal(&v1, &v2, &type));
+    type.typeKind = UA_DATATYPEKIND_DECIMAL;
+    ck_assert(!UA_equal(&v1, &v2, &type));
+}
+END_TEST
+
 START_TEST(calcSizeBinaryShallBeCorrect) {
     /* Empty variants (with no type defined) cannot be encoded. This is
      * intentional. Discovery configuration is just a base class and void * */
@@ -365,6 +454,12 @@ int main(void) {
                         UA_TYPES_NODEID, UA_TYPES_COUNT - 1);
     suite_add_tcase(s, tc);
 
+    tc = tcase_create("Test equal");
+    tcase_add_loop_test(tc, decodedCopyShallBeEqual, UA_TYPES_BOOLEAN, UA_TYPES_COUNT - 1);
+    tcase_add_test(tc, equalShallDetectChanges);
+    tcase_add_test(tc, equalShallCompareFixedSizeKinds);
+    suite_add_tcase(s, tc);
+
     tc = tcase_create("Test calcSizeBinary");
     tcase_add_loop_test(tc, calcSizeBinaryShallBeCorrect, UA_TYPES_BOOLEAN, UA_TYPES_COUNT - 1);
     suite_add_tcase(s, tc);
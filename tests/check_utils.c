@@ -567,6 +567,50 @@ START_TEST(idOrderString) {
     ck_assert(UA_NodeId_order(&id_str_d, &id_str_c) == UA_ORDER_MORE);
 } END_TEST
 
+START_TEST(nodeIdMap) {
+    UA_NodeIdMap map;
+    memset(&map, 0, sizeof(UA_NodeIdMap));
+    ck_assert_ptr_eq(UA_NodeIdMap_find(&map, &UA_NODEID_NULL), NULL);
+
+    /* Insert enough keys to grow the map several times */
+    for(UA_UInt32 i = 0; i < 1000; i++) {
+        UA_NodeId id = UA_NODEID_NUMERIC(1, i);
+        UA_StatusCode res = UA_NodeIdMap_insert(&map, &id, (void*)(uintptr_t)(i + 1));
+        ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    }
+    UA_NodeId sid = UA_NODEID_STRING(2, "key");
+    ck_assert_uint_eq(UA_NodeIdMap_insert(&map, &sid, &map), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(map.count, 1001);
+
+    /* Replace an existing key */
+    UA_NodeId id5 = UA_NODEID_NUMERIC(1, 5);
+    ck_assert_uint_eq(UA_NodeIdMap_insert(&map, &id5, (void*)(uintptr_t)42), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(map.count, 1001);
+    ck_assert_ptr_eq(*UA_NodeIdMap_find(&map, &id5), (void*)(uintptr_t)42);
+
+    /* Remove every other key. The backward shift keeps the others reachable. */
+    for(UA_UInt32 i = 0; i < 1000; i += 2) {
+        UA_NodeId id = UA_NODEID_NUMERIC(1, i);
+        ck_assert(UA_NodeIdMap_remove(&map, &id));
+        ck_assert(!UA_NodeIdMap_remove(&map, &id));
+    }
+    ck_assert_uint_eq(map.count, 501);
+    for(UA_UInt32 i = 0; i < 1000; i++) {
+        UA_NodeId id = UA_NODEID_NUMERIC(1, i);
+        void **v = UA_NodeIdMap_find(&map, &id);
+        if(i % 2 == 0) {
+            ck_assert_ptr_eq(v, NULL);
+        } else if(i != 5) {
+            ck_assert_ptr_ne(v, NULL);
+            ck_assert_ptr_eq(*v, (void*)(uintptr_t)(i + 1));
+        }
+    }
+    ck_assert_ptr_eq(*UA_NodeIdMap_find(&map, &sid), &map);
+
+    UA_NodeIdMap_clear(&map);
+    ck_assert_uint_eq(map.count, 0);
+    ck_assert_ptr_eq(UA_NodeIdMap_find(&map, &sid), NULL);
+} END_TEST
 
 static Suite* testSuite_Utils(void) {
     Suite *s = suite_create("Utils");
@@ -581,6 +625,7 @@ static Suite* testSuite_Utils(void) {
     tcase_add_test(tc_utils, readNumberWithBase);
     tcase_add_test(tc_utils, StatusCode_msg);
     tcase_add_test(tc_utils, stringCompare);
+    tcase_add_test(tc_utils, nodeIdMap);
     suite_add_tcase(s,tc_utils);
 
 
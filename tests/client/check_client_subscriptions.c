@@ -61,6 +61,18 @@ dataChangeHandler(UA_Client *client, UA_UInt32 subId, void *subContext,
     countNotificationReceived++;
 }
 
+/* With multithreading, the publish response is sent from a worker thread. The
+ * client can return earlier for other responses (e.g. BadTooManyPublishRequests
+ * from the network thread). */
+static UA_StatusCode
+iterateUntilNotification(UA_Client *client) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < 100 && !notificationReceived &&
+            retval == UA_STATUSCODE_GOOD; i++)
+        retval = UA_Client_run_iterate(client, 1);
+    return retval;
+}
+
 static void
 createSubscriptionCallback(UA_Client *client, void *userdata, UA_UInt32 requestId,
                            void *r) {
@@ -391,7 +403,7 @@ START_TEST(Client_subscription_createDataChanges) {
     notificationReceived = false;
     countNotificationReceived = 0;
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    retval = UA_Client_run_iterate(client, 1);
+    retval = iterateUntilNotification(client);
     ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
     ck_assert_uint_eq(notificationReceived, true);
     ck_assert_uint_eq(countNotificationReceived, 2);
@@ -400,7 +412,7 @@ START_TEST(Client_subscription_createDataChanges) {
     UA_Server_run_iterate(server, true);
 
     notificationReceived = false;
-    retval = UA_Client_run_iterate(client, 1);
+    retval = iterateUntilNotification(client);
     ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
     ck_assert_uint_eq(notificationReceived, true);
     ck_assert_uint_eq(countNotificationReceived, 3);
@@ -434,6 +446,102 @@ START_TEST(Client_subscription_createDataChanges) {
 }
 END_TEST
 
+#define STREAMITEMS 40
+static UA_UInt32 streamCounts[STREAMITEMS];
+
+static void
+streamDataChangeHandler(UA_Client *client, UA_UInt32 subId, void *subContext,
+                        UA_UInt32 monId, void *monContext, UA_DataValue *value) {
+    ck_assert(value->hasValue);
+    streamCounts[(uintptr_t)monContext]++;
+}
+
+/* Decode the notifications while processing them. With enough MonitoredItems
+ * to grow the clientHandle index. */
+START_TEST(Client_subscription_streamNotifications) {
+    UA_Client *client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    UA_Client_getConfig(client)->streamNotifications = true;
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_CreateSubscriptionRequest request = UA_CreateSubscriptionRequest_default();
+    UA_CreateSubscriptionResponse response = UA_Client_Subscriptions_create(client, request,
+                                                                            NULL, NULL, NULL);
+    ck_assert_uint_eq(response.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_UInt32 subId = response.subscriptionId;
+
+    UA_MonitoredItemCreateRequest items[STREAMITEMS];
+    UA_UInt32 monIds[STREAMITEMS];
+    UA_Client_DataChangeNotificationCallback callbacks[STREAMITEMS];
+    UA_Client_DeleteMonitoredItemCallback deleteCallbacks[STREAMITEMS];
+    void *contexts[STREAMITEMS];
+    for(size_t i = 0; i < STREAMITEMS; i++) {
+        items[i] = UA_MonitoredItemCreateRequest_default(
+            UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_CURRENTTIME));
+        callbacks[i] = streamDataChangeHandler;
+        deleteCallbacks[i] = NULL;
+        contexts[i] = (void*)(uintptr_t)i;
+        streamCounts[i] = 0;
+    }
+
+    UA_CreateMonitoredItemsRequest createRequest;
+    UA_CreateMonitoredItemsRequest_init(&createRequest);
+    createRequest.subscriptionId = subId;
+    createRequest.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    createRequest.itemsToCreate = items;
+    createRequest.itemsToCreateSize = STREAMITEMS;
+    UA_CreateMonitoredItemsResponse createResponse =
+       UA_Client_MonitoredItems_createDataChanges(client, createRequest, contexts,
+                                                   callbacks, deleteCallbacks);
+    ck_assert_uint_eq(createResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(createResponse.resultsSize, STREAMITEMS);
+    for(size_t i = 0; i < STREAMITEMS; i++) {
+        ck_assert_uint_eq(createResponse.results[i].statusCode, UA_STATUSCODE_GOOD);
+        monIds[i] = createResponse.results[i].monitoredItemId;
+    }
+    UA_CreateMonitoredItemsResponse_deleteMembers(&createResponse);
+
+    /* Delete the first half of the MonitoredItems */
+    UA_DeleteMonitoredItemsRequest deleteRequest;
+    UA_DeleteMonitoredItemsRequest_init(&deleteRequest);
+    deleteRequest.subscriptionId = subId;
+    deleteRequest.monitoredItemIds = monIds;
+    deleteRequest.monitoredItemIdsSize = STREAMITEMS / 2;
+    UA_DeleteMonitoredItemsResponse deleteResponse =
+        UA_Client_MonitoredItems_delete(client, deleteRequest);
+    ck_assert_uint_eq(deleteResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_DeleteMonitoredItemsResponse_deleteMembers(&deleteResponse);
+
+    /* manually control the server thread */
+    running = false;
+    THREAD_JOIN(server_thread);
+
+    retval = UA_Client_run_iterate(client, 1);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_fakeSleep((UA_UInt32)publishingInterval + 1);
+    UA_Server_run_iterate(server, true);
+    UA_fakeSleep((UA_UInt32)publishingInterval + 1);
+    retval = UA_Client_run_iterate(client, 1);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    for(size_t i = 0; i < STREAMITEMS / 2; i++)
+        ck_assert_uint_eq(streamCounts[i], 0);
+    for(size_t i = STREAMITEMS / 2; i < STREAMITEMS; i++)
+        ck_assert_uint_eq(streamCounts[i], 1);
+
+    /* run the server in an independent thread again */
+    running = true;
+    THREAD_CREATE(server_thread, serverloop);
+
+    retval = UA_Client_Subscriptions_deleteSingle(client, subId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+END_TEST
+
 START_TEST(Client_subscription_createDataChanges_async) {
     UA_UInt32 reqId = 0;
     UA_Client *client = UA_Client_new();
@@ -517,7 +625,7 @@ START_TEST(Client_subscription_createDataChanges_async) {
 
     notificationReceived = false;
     countNotificationReceived = 0;
-    retval = UA_Client_run_iterate(client, 1);
+    retval = iterateUntilNotification(client);
     ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
     ck_assert_uint_eq(notificationReceived, true);
     ck_assert_uint_eq(countNotificationReceived, 2);
@@ -526,7 +634,7 @@ START_TEST(Client_subscription_createDataChanges_async) {
     UA_Server_run_iterate(server, true);
 
     notificationReceived = false;
-    retval = UA_Client_run_iterate(client, 1);
+    retval = iterateUntilNotification(client);
     ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
     ck_assert_uint_eq(notificationReceived, true);
     ck_assert_uint_eq(countNotificationReceived, 3);
@@ -862,6 +970,122 @@ subscriptionInactivityCallback (UA_Client *client, UA_UInt32 subId, void *subCon
     inactivityCallbackCalled = true;
 }
 
+static void
+publishCallback(UA_Client *client, void *userdata, UA_UInt32 requestId, void *r) {
+    UA_PublishResponse_copy((const UA_PublishResponse *)r, (UA_PublishResponse *)userdata);
+}
+
+static void
+republishCallback(UA_Client *client, void *userdata, UA_UInt32 requestId, void *r) {
+    UA_RepublishResponse_copy((const UA_RepublishResponse *)r,
+                              (UA_RepublishResponse *)userdata);
+}
+
+/* The subscription is created with the raw services. So the client does not
+ * send publish requests (and acknowledgements) in the background. */
+static void
+publishAndRepublish(UA_StatusCode expectedRepublishResult) {
+    UA_Client *client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_CreateSubscriptionRequest request = UA_CreateSubscriptionRequest_default();
+    UA_CreateSubscriptionResponse response;
+    __UA_Client_Service(client, &request, &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONREQUEST],
+                        &response, &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONRESPONSE]);
+    ck_assert_uint_eq(response.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_UInt32 subId = response.subscriptionId;
+    UA_Double revisedInterval = response.revisedPublishingInterval;
+    UA_CreateSubscriptionResponse_deleteMembers(&response);
+
+    UA_MonitoredItemCreateRequest item =
+        UA_MonitoredItemCreateRequest_default(UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE));
+    UA_CreateMonitoredItemsRequest monRequest;
+    UA_CreateMonitoredItemsRequest_init(&monRequest);
+    monRequest.subscriptionId = subId;
+    monRequest.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    monRequest.itemsToCreate = &item;
+    monRequest.itemsToCreateSize = 1;
+    UA_CreateMonitoredItemsResponse monResponse;
+    __UA_Client_Service(client, &monRequest, &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSREQUEST],
+                        &monResponse, &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSRESPONSE]);
+    ck_assert_uint_eq(monResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(monResponse.resultsSize, 1);
+    ck_assert_uint_eq(monResponse.results[0].statusCode, UA_STATUSCODE_GOOD);
+    UA_CreateMonitoredItemsResponse_deleteMembers(&monResponse);
+
+    /* manually control the server thread */
+    running = false;
+    THREAD_JOIN(server_thread);
+
+    /* Publish the first notification */
+    UA_PublishRequest pubRequest;
+    UA_PublishRequest_init(&pubRequest);
+    UA_PublishResponse pubResponse;
+    UA_PublishResponse_init(&pubResponse);
+    UA_UInt32 reqId = 0;
+    retval = __UA_Client_AsyncService(client, &pubRequest, &UA_TYPES[UA_TYPES_PUBLISHREQUEST],
+                                      publishCallback, &UA_TYPES[UA_TYPES_PUBLISHRESPONSE],
+                                      &pubResponse, &reqId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_fakeSleep((UA_UInt32)revisedInterval + 1);
+    UA_Server_run_iterate(server, true);
+    retval = UA_Client_run_iterate(client, 1);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(pubResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(pubResponse.notificationMessage.notificationDataSize, 1);
+    ck_assert_uint_eq(pubResponse.availableSequenceNumbersSize, 1);
+
+    /* Republish from the retransmission queue */
+    UA_RepublishRequest repRequest;
+    UA_RepublishRequest_init(&repRequest);
+    repRequest.subscriptionId = subId;
+    repRequest.retransmitSequenceNumber = pubResponse.notificationMessage.sequenceNumber;
+    UA_RepublishResponse repResponse;
+    UA_RepublishResponse_init(&repResponse);
+    retval = __UA_Client_AsyncService(client, &repRequest, &UA_TYPES[UA_TYPES_REPUBLISHREQUEST],
+                                      republishCallback, &UA_TYPES[UA_TYPES_REPUBLISHRESPONSE],
+                                      &repResponse, &reqId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Server_run_iterate(server, true);
+    retval = UA_Client_run_iterate(client, 1);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(repResponse.responseHeader.serviceResult, expectedRepublishResult);
+    if(expectedRepublishResult == UA_STATUSCODE_GOOD)
+        ck_assert(UA_equal(&pubResponse.notificationMessage, &repResponse.notificationMessage,
+                           &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE]));
+
+    UA_PublishResponse_deleteMembers(&pubResponse);
+    UA_RepublishResponse_deleteMembers(&repResponse);
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+
+START_TEST(Client_subscription_republish) {
+    publishAndRepublish(UA_STATUSCODE_GOOD);
+}
+END_TEST
+
+/* Every message exceeds the budget and is dropped */
+START_TEST(Client_subscription_republish_budget) {
+    UA_Server_getConfig(server)->maxRetransmissionQueueBytes = 1;
+    publishAndRepublish(UA_STATUSCODE_BADMESSAGENOTAVAILABLE);
+}
+END_TEST
+
+#ifdef UA_ARCHITECTURE_POSIX
+/* Every message exceeds the budget and is moved to the spill file */
+START_TEST(Client_subscription_republish_spill) {
+    UA_ServerConfig *config = UA_Server_getConfig(server);
+    config->maxRetransmissionQueueBytes = 1;
+    config->retransmissionSpillFile = UA_STRING_ALLOC("/tmp/open62541_retransmission_spill");
+    config->retransmissionSpillFileSize = 1 << 16;
+    publishAndRepublish(UA_STATUSCODE_GOOD);
+}
+END_TEST
+#endif
+
 START_TEST(Client_subscription_async_sub) {
     UA_Client *client = UA_Client_new();
     UA_ClientConfig_setDefault(UA_Client_getConfig(client));
@@ -1100,8 +1324,14 @@ static Suite* testSuite_Client(void) {
     tcase_add_test(tc_client, Client_subscription_connectionClose);
     tcase_add_test(tc_client, Client_subscription_createDataChanges);
     tcase_add_test(tc_client, Client_subscription_createDataChanges_async);
+    tcase_add_test(tc_client, Client_subscription_streamNotifications);
     tcase_add_test(tc_client, Client_subscription_keepAlive);
     tcase_add_test(tc_client, Client_subscription_without_notification);
+    tcase_add_test(tc_client, Client_subscription_republish);
+    tcase_add_test(tc_client, Client_subscription_republish_budget);
+#ifdef UA_ARCHITECTURE_POSIX
+    tcase_add_test(tc_client, Client_subscription_republish_spill);
+#endif
     tcase_add_test(tc_client, Client_subscription_async_sub);
     tcase_add_test(tc_client, Client_subscription_reconnect);
     suite_add_tcase(s,tc_client);
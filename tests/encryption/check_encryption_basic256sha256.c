@@ -27,6 +27,8 @@
 
 UA_Server *server;
 UA_Boolean running;
+UA_Boolean parallelChunkCrypto;
+UA_Boolean asyncHandshakes;
 UA_ServerNetworkLayer nl;
 THREAD_HANDLE server_thread;
 
@@ -83,6 +85,12 @@ static void setup(void) {
     for(size_t i = 0; i < trustListSize; i++)
         UA_ByteString_deleteMembers(&trustList[i]);
 
+#if UA_MULTITHREADING >= 200
+    config->nThreads = 4;
+    config->parallelChunkCrypto = parallelChunkCrypto;
+    config->asyncHandshakes = asyncHandshakes;
+#endif
+
     UA_Server_run_startup(server);
     THREAD_CREATE(server_thread, serverloop);
 }
@@ -175,14 +183,307 @@ START_TEST(encryption_connect) {
 }
 END_TEST
 
+static UA_Client *
+newSecureClient(void) {
+    UA_ByteString certificate;
+    certificate.length = CERT_DER_LENGTH;
+    certificate.data = CERT_DER_DATA;
+
+    UA_ByteString privateKey;
+    privateKey.length = KEY_DER_LENGTH;
+    privateKey.data = KEY_DER_DATA;
+
+    UA_Client *client = UA_Client_new();
+    UA_ClientConfig *cc = UA_Client_getConfig(client);
+    UA_ClientConfig_setDefaultEncryption(cc, certificate, privateKey,
+                                         NULL, 0, NULL, 0);
+    cc->securityPolicyUri =
+        UA_STRING_ALLOC("http://opcfoundation.org/UA/SecurityPolicy#Basic256Sha256");
+    return client;
+}
+
+/* A SecureChannel without an activated Session holds the only handshake slot.
+ * Further secured OPN requests are rejected until the slot is released by the
+ * handshake timeout. */
+START_TEST(encryption_handshakeAdmission) {
+    UA_ServerConfig *config = UA_Server_getConfig(server);
+    config->maxConcurrentHandshakes = 1;
+    ck_assert_uint_gt(config->handshakeTimeout, 0);
+
+    /* Connect once to select the secured endpoint. Then reconnect without
+     * activating a Session. */
+    UA_Client *client = newSecureClient();
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Client_disconnect(client);
+    retval = UA_Client_connectSecureChannel(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_ne(client->channel.securityMode, UA_MESSAGESECURITYMODE_NONE);
+
+    UA_Client *client2 = newSecureClient();
+    retval = UA_Client_connect(client2, "opc.tcp://localhost:4840");
+    ck_assert_uint_ne(retval, UA_STATUSCODE_GOOD);
+    UA_Client_delete(client2);
+    ck_assert_uint_eq(server->serverStats.scs.rejectedChannelCount, 1);
+
+    /* The slot is kept before the handshake timeout */
+    UA_LOCK(server->serviceMutex);
+    UA_Server_cleanupTimedOutSecureChannels(server, UA_DateTime_nowMonotonic());
+    size_t handshakes = server->handshakesInProgress;
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(handshakes, 1);
+
+    /* The handshake times out. The channel stays open but releases the slot. */
+    UA_fakeSleep(config->handshakeTimeout + 1);
+    UA_LOCK(server->serviceMutex);
+    UA_Server_cleanupTimedOutSecureChannels(server, UA_DateTime_nowMonotonic());
+    handshakes = server->handshakesInProgress;
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(handshakes, 0);
+
+    client2 = newSecureClient();
+    retval = UA_Client_connect(client2, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* The activated Session released the slot */
+    UA_Client *client3 = newSecureClient();
+    retval = UA_Client_connect(client3, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Client_disconnect(client3);
+    UA_Client_delete(client3);
+    UA_Client_disconnect(client2);
+    UA_Client_delete(client2);
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+END_TEST
+
+#if UA_MULTITHREADING >= 200
+
+/* SecurityPolicies that are not reentrant (e.g. the mbedTLS policies that keep
+ * the hash contexts in the channel) cannot be used for parallel chunk crypto */
+START_TEST(encryption_parallelChunkCryptoRejected) {
+    UA_ByteString certificate;
+    certificate.length = CERT_DER_LENGTH;
+    certificate.data = CERT_DER_DATA;
+
+    UA_ByteString privateKey;
+    privateKey.length = KEY_DER_LENGTH;
+    privateKey.data = KEY_DER_DATA;
+
+    UA_Server *server2 = UA_Server_new();
+    UA_ServerConfig *config = UA_Server_getConfig(server2);
+    UA_ServerConfig_setDefaultWithSecurityPolicies(config, 4841, &certificate, &privateKey,
+                                                   NULL, 0, NULL, 0, NULL, 0);
+    UA_String_clear(&config->applicationDescription.applicationUri);
+    config->applicationDescription.applicationUri =
+        UA_STRING_ALLOC("urn:unconfigured:application");
+    config->nThreads = 2;
+    config->parallelChunkCrypto = true;
+    ck_assert(config->securityPoliciesSize > 1);
+    config->securityPolicies[config->securityPoliciesSize-1].symmetricModule.reentrant = false;
+
+    UA_StatusCode retval = UA_Server_run_startup(server2);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADCONFIGURATIONERROR);
+
+    /* Without the parallel chunk crypto, the server starts up */
+    config->parallelChunkCrypto = false;
+    retval = UA_Server_run_startup(server2);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Server_run_shutdown(server2);
+    UA_Server_delete(server2);
+}
+END_TEST
+
+/* The OpenSSL policies are reentrant */
+#ifdef UA_ENABLE_ENCRYPTION_OPENSSL
+
+static void setup_parallelChunkCrypto(void) {
+    parallelChunkCrypto = true;
+    setup();
+}
+
+static void teardown_parallelChunkCrypto(void) {
+    teardown();
+    parallelChunkCrypto = false;
+}
+
+/* Write and read back a value that spans more chunks than are processed by the
+ * worker threads at once */
+START_TEST(encryption_parallelChunkCrypto) {
+    UA_ByteString certificate;
+    certificate.length = CERT_DER_LENGTH;
+    certificate.data = CERT_DER_DATA;
+
+    UA_ByteString privateKey;
+    privateKey.length = KEY_DER_LENGTH;
+    privateKey.data = KEY_DER_DATA;
+
+    UA_Client *client = UA_Client_new();
+    UA_ClientConfig *cc = UA_Client_getConfig(client);
+    UA_ClientConfig_setDefaultEncryption(cc, certificate, privateKey,
+                                         NULL, 0, NULL, 0);
+    cc->securityPolicyUri =
+        UA_STRING_ALLOC("http://opcfoundation.org/UA/SecurityPolicy#Basic256Sha256");
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* About 40 chunks of 64kB */
+    UA_ByteString large;
+    retval = UA_ByteString_allocBuffer(&large, 40 * 65535);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    for(size_t i = 0; i < large.length; i++)
+        large.data[i] = (UA_Byte)i;
+
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "large");
+    retval = UA_Server_addVariableNode(server, nodeId,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                       UA_QUALIFIEDNAME(1, "large"),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                       attr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Variant val;
+    UA_Variant_setScalar(&val, &large, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    retval = UA_Client_writeValueAttribute(client, nodeId, &val);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Variant_init(&val);
+    retval = UA_Client_readValueAttribute(client, nodeId, &val);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&val, &UA_TYPES[UA_TYPES_BYTESTRING]));
+    ck_assert(UA_ByteString_equal((UA_ByteString*)val.data, &large));
+    UA_Variant_deleteMembers(&val);
+    UA_ByteString_deleteMembers(&large);
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+END_TEST
+
+static void setup_asyncHandshakes(void) {
+    asyncHandshakes = true;
+    setup();
+}
+
+static void teardown_asyncHandshakes(void) {
+    teardown();
+    asyncHandshakes = false;
+}
+
+#define HANDSHAKE_CLIENTS 4
+#define HANDSHAKE_ITERATIONS 5
+
+static UA_StatusCode handshakeResults[HANDSHAKE_CLIENTS];
+
+THREAD_CALLBACK_PARAM(handshakeLoop, param) {
+    size_t index = *(size_t*)param;
+    for(size_t i = 0; i < HANDSHAKE_ITERATIONS; i++) {
+        UA_Client *client = newSecureClient();
+        UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+        if(retval == UA_STATUSCODE_GOOD) {
+            UA_Variant val;
+            UA_Variant_init(&val);
+            UA_NodeId nodeId =
+                UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE);
+            retval = UA_Client_readValueAttribute(client, nodeId, &val);
+            UA_Variant_deleteMembers(&val);
+        }
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+        handshakeResults[index] |= retval;
+    }
+    return 0;
+}
+
+/* The handshakes of several clients run in the worker threads at once */
+START_TEST(encryption_asyncHandshakes) {
+    THREAD_HANDLE threads[HANDSHAKE_CLIENTS];
+    size_t indices[HANDSHAKE_CLIENTS];
+    for(size_t i = 0; i < HANDSHAKE_CLIENTS; i++) {
+        indices[i] = i;
+        handshakeResults[i] = UA_STATUSCODE_GOOD;
+        THREAD_CREATE_PARAM(threads[i], handshakeLoop, indices[i]);
+    }
+    for(size_t i = 0; i < HANDSHAKE_CLIENTS; i++)
+        THREAD_JOIN(threads[i]);
+    for(size_t i = 0; i < HANDSHAKE_CLIENTS; i++)
+        ck_assert_uint_eq(handshakeResults[i], UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(server->serverStats.ss.rejectedSessionCount, 0);
+}
+END_TEST
+
+#endif /* UA_ENABLE_ENCRYPTION_OPENSSL */
+
+/* The asymmetric crypto of all SecurityPolicies has to be reentrant for the
+ * asynchronous handshakes */
+START_TEST(encryption_asyncHandshakesRejected) {
+    UA_ByteString certificate;
+    certificate.length = CERT_DER_LENGTH;
+    certificate.data = CERT_DER_DATA;
+
+    UA_ByteString privateKey;
+    privateKey.length = KEY_DER_LENGTH;
+    privateKey.data = KEY_DER_DATA;
+
+    UA_Server *server2 = UA_Server_new();
+    UA_ServerConfig *config = UA_Server_getConfig(server2);
+    UA_ServerConfig_setDefaultWithSecurityPolicies(config, 4841, &certificate, &privateKey,
+                                                   NULL, 0, NULL, 0, NULL, 0);
+    UA_String_clear(&config->applicationDescription.applicationUri);
+    config->applicationDescription.applicationUri =
+        UA_STRING_ALLOC("urn:unconfigured:application");
+    config->nThreads = 2;
+    config->asyncHandshakes = true;
+    ck_assert(config->securityPoliciesSize > 1);
+    config->securityPolicies[config->securityPoliciesSize-1].asymmetricModule.reentrant = false;
+
+    UA_StatusCode retval = UA_Server_run_startup(server2);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADCONFIGURATIONERROR);
+
+    config->asyncHandshakes = false;
+    retval = UA_Server_run_startup(server2);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Server_run_shutdown(server2);
+    UA_Server_delete(server2);
+}
+END_TEST
+
+#endif
+
 static Suite* testSuite_encryption(void) {
     Suite *s = suite_create("Encryption");
     TCase *tc_encryption = tcase_create("Encryption basic256sha256");
     tcase_add_checked_fixture(tc_encryption, setup, teardown);
 #ifdef UA_ENABLE_ENCRYPTION
     tcase_add_test(tc_encryption, encryption_connect);
+    tcase_add_test(tc_encryption, encryption_handshakeAdmission);
 #endif /* UA_ENABLE_ENCRYPTION */
     suite_add_tcase(s,tc_encryption);
+#if defined(UA_ENABLE_ENCRYPTION) && UA_MULTITHREADING >= 200
+#ifdef UA_ENABLE_ENCRYPTION_OPENSSL
+    TCase *tc_parallel = tcase_create("Encryption parallel chunk crypto");
+    tcase_add_checked_fixture(tc_parallel, setup_parallelChunkCrypto,
+                              teardown_parallelChunkCrypto);
+    tcase_add_test(tc_parallel, encryption_parallelChunkCrypto);
+    suite_add_tcase(s,tc_parallel);
+    TCase *tc_async = tcase_create("Encryption async handshakes");
+    tcase_add_checked_fixture(tc_async, setup_asyncHandshakes,
+                              teardown_asyncHandshakes);
+    tcase_add_test(tc_async, encryption_connect);
+    tcase_add_test(tc_async, encryption_handshakeAdmission);
+    tcase_add_test(tc_async, encryption_asyncHandshakes);
+    suite_add_tcase(s,tc_async);
+#endif
+    TCase *tc_rejected = tcase_create("Encryption parallel chunk crypto rejected");
+    tcase_add_test(tc_rejected, encryption_parallelChunkCryptoRejected);
+    tcase_add_test(tc_rejected, encryption_asyncHandshakesRejected);
+    suite_add_tcase(s,tc_rejected);
+#endif
     return s;
 }
 
@@ -0,0 +1,152 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <open62541/plugin/pki_default.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "certificates.h"
+#include "check.h"
+#include "testing_clock.h"
+
+#ifdef __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Defined in the PKI plugin and the testing clock */
+extern size_t UA_CertificateVerification_uncachedCount;
+extern UA_DateTime testingClock;
+
+static UA_CertificateVerification cv;
+static UA_ByteString certificate;
+
+static UA_StatusCode
+verify(const UA_ByteString *cert) {
+    return cv.verifyCertificate(cv.context, cert);
+}
+
+static void setup(void) {
+    certificate.length = CERT_DER_LENGTH;
+    certificate.data = CERT_DER_DATA;
+    UA_StatusCode res =
+        UA_CertificateVerification_Trustlist(&cv, &certificate, 1, NULL, 0, NULL, 0);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_CertificateVerification_uncachedCount = 0;
+}
+
+static void teardown(void) {
+    cv.clear(&cv);
+}
+
+START_TEST(Cache_hit) {
+    UA_StatusCode res = verify(&certificate);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 1);
+    ck_assert_uint_eq(verify(&certificate), res);
+    ck_assert_uint_eq(verify(&certificate), res);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 1);
+} END_TEST
+
+START_TEST(Cache_ttlExpiry) {
+    UA_StatusCode res = verify(&certificate);
+    UA_fakeSleep(59 * 1000);
+    ck_assert_uint_eq(verify(&certificate), res);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 1);
+    UA_fakeSleep(2 * 1000);
+    ck_assert_uint_eq(verify(&certificate), res);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 2);
+} END_TEST
+
+START_TEST(Cache_negative) {
+    /* The certificate is cut short and cannot be parsed */
+    UA_ByteString broken = {CERT_DER_LENGTH / 2, CERT_DER_DATA};
+    ck_assert_uint_eq(verify(&broken), UA_STATUSCODE_BADSECURITYCHECKSFAILED);
+    ck_assert_uint_eq(verify(&broken), UA_STATUSCODE_BADSECURITYCHECKSFAILED);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 1);
+} END_TEST
+
+START_TEST(Cache_notAfter) {
+    /* The certificate expires ten seconds from now */
+    UA_DateTime clock = testingClock;
+    UA_DateTimeStruct notAfter;
+    memset(&notAfter, 0, sizeof(UA_DateTimeStruct));
+    notAfter.year = 2028;
+    notAfter.month = 3;
+    notAfter.day = 25;
+    notAfter.hour = 8;
+    notAfter.min = 33;
+    notAfter.sec = 57;
+    testingClock = UA_DateTime_fromStruct(notAfter) - 10 * UA_DATETIME_SEC;
+
+    UA_StatusCode res = verify(&certificate);
+    UA_fakeSleep(9 * 1000);
+    ck_assert_uint_eq(verify(&certificate), res);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 1);
+    UA_fakeSleep(2 * 1000);
+    verify(&certificate);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 2);
+    testingClock = clock;
+} END_TEST
+
+#ifdef __linux__
+#define TRUSTFOLDER "check_pki_default_trust"
+#define ISSUERFOLDER "check_pki_default_issuer"
+#define REVOCATIONFOLDER "check_pki_default_revocation"
+#define TRUSTFILE TRUSTFOLDER "/cert.der"
+
+START_TEST(Cache_folderChange) {
+    mkdir(TRUSTFOLDER, 0700);
+    mkdir(ISSUERFOLDER, 0700);
+    mkdir(REVOCATIONFOLDER, 0700);
+    UA_CertificateVerification fcv;
+    memset(&fcv, 0, sizeof(UA_CertificateVerification));
+    UA_StatusCode res =
+        UA_CertificateVerification_CertFolders(&fcv, TRUSTFOLDER, ISSUERFOLDER,
+                                               REVOCATIONFOLDER);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    fcv.verifyCertificate(fcv.context, &certificate);
+    fcv.verifyCertificate(fcv.context, &certificate);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 1);
+
+    /* Adding a certificate to the folder invalidates the cache */
+    FILE *fp = fopen(TRUSTFILE, "wb");
+    ck_assert_ptr_ne(fp, NULL);
+    ck_assert_uint_eq(fwrite(certificate.data, 1, certificate.length, fp),
+                      certificate.length);
+    fclose(fp);
+    fcv.verifyCertificate(fcv.context, &certificate);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 2);
+    fcv.verifyCertificate(fcv.context, &certificate);
+    ck_assert_uint_eq(UA_CertificateVerification_uncachedCount, 2);
+
+    fcv.clear(&fcv);
+    remove(TRUSTFILE);
+    rmdir(TRUSTFOLDER);
+    rmdir(ISSUERFOLDER);
+    rmdir(REVOCATIONFOLDER);
+} END_TEST
+#endif
+
+int main(void) {
+    Suite *s = suite_create("PKI Default");
+    TCase *tc = tcase_create("Verification Cache");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, Cache_hit);
+    tcase_add_test(tc, Cache_ttlExpiry);
+    tcase_add_test(tc, Cache_negative);
+    tcase_add_test(tc, Cache_notAfter);
+#ifdef __linux__
+    tcase_add_test(tc, Cache_folderChange);
+#endif
+    suite_add_tcase(s, tc);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
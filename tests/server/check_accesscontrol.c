@@ -4,6 +4,7 @@
 
 #include <open62541/client.h>
 #include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
 #include <open62541/server.h>
 #include <open62541/server_config_default.h>
 #include <open62541/types.h>
@@ -31,6 +32,40 @@ static void setup(void) {
     THREAD_CREATE(server_thread, serverloop);
 }
 
+static size_t userAccessLevelCalls;
+static UA_Boolean invalidateInCallback;
+static UA_Byte (*defaultGetUserAccessLevel)(UA_Server *, UA_AccessControl *,
+                                            const UA_NodeId *, void *,
+                                            const UA_NodeId *, void *);
+
+static UA_Byte
+countingGetUserAccessLevel(UA_Server *s, UA_AccessControl *ac,
+                           const UA_NodeId *sessionId, void *sessionContext,
+                           const UA_NodeId *nodeId, void *nodeContext) {
+    userAccessLevelCalls++;
+    if(invalidateInCallback) {
+        /* The callback is called without the service mutex */
+        invalidateInCallback = false;
+        UA_Server_invalidateAccessControlCache(s, NULL);
+    }
+    return defaultGetUserAccessLevel(s, ac, sessionId, sessionContext,
+                                     nodeId, nodeContext);
+}
+
+static void setup_cache(void) {
+    running = true;
+    userAccessLevelCalls = 0;
+    invalidateInCallback = false;
+    server = UA_Server_new();
+    UA_ServerConfig *config = UA_Server_getConfig(server);
+    UA_ServerConfig_setDefault(config);
+    config->accessControlCacheSize = 64;
+    defaultGetUserAccessLevel = config->accessControl.getUserAccessLevel;
+    config->accessControl.getUserAccessLevel = countingGetUserAccessLevel;
+    UA_Server_run_startup(server);
+    THREAD_CREATE(server_thread, serverloop);
+}
+
 static void teardown(void) {
     running = false;
     THREAD_JOIN(server_thread);
@@ -85,6 +120,62 @@ START_TEST(Client_pass_fail) {
     UA_Client_delete(client);
 } END_TEST
 
+START_TEST(Client_accessControlCache) {
+    UA_Client *client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* The second read uses the cached decision */
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_CURRENTTIME);
+    UA_Byte accessLevel = 0;
+    retval = UA_Client_readUserAccessLevelAttribute(client, nodeId, &accessLevel);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(userAccessLevelCalls, 1);
+    retval = UA_Client_readUserAccessLevelAttribute(client, nodeId, &accessLevel);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(userAccessLevelCalls, 1);
+
+    UA_ServerStatistics stats = UA_Server_getStatistics(server);
+    ck_assert_uint_ge(stats.ss.accessCacheHitCount, 1);
+    ck_assert_uint_ge(stats.ss.accessCacheMissCount, 1);
+
+    /* Invalidate the cache */
+    UA_Server_invalidateAccessControlCache(server, NULL);
+    retval = UA_Client_readUserAccessLevelAttribute(client, nodeId, &accessLevel);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(userAccessLevelCalls, 2);
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+} END_TEST
+
+START_TEST(Client_accessControlCacheInvalidatedInCallback) {
+    UA_Client *client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    UA_StatusCode retval = UA_Client_connect(client, "opc.tcp://localhost:4840");
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* The cache is invalidated while the decision is computed. The decision
+     * must not be used for the following read. */
+    invalidateInCallback = true;
+    UA_NodeId nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_CURRENTTIME);
+    UA_Byte accessLevel = 0;
+    retval = UA_Client_readUserAccessLevelAttribute(client, nodeId, &accessLevel);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(userAccessLevelCalls, 1);
+    retval = UA_Client_readUserAccessLevelAttribute(client, nodeId, &accessLevel);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(userAccessLevelCalls, 2);
+
+    /* Now the decision is cached */
+    retval = UA_Client_readUserAccessLevelAttribute(client, nodeId, &accessLevel);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(userAccessLevelCalls, 2);
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+} END_TEST
 
 static Suite* testSuite_Client(void) {
     Suite *s = suite_create("Client");
@@ -95,6 +186,11 @@ static Suite* testSuite_Client(void) {
     tcase_add_test(tc_client_user, Client_user_fail);
     tcase_add_test(tc_client_user, Client_pass_fail);
     suite_add_tcase(s,tc_client_user);
+    TCase *tc_cache = tcase_create("Access Control Cache");
+    tcase_add_checked_fixture(tc_cache, setup_cache, teardown);
+    tcase_add_test(tc_cache, Client_accessControlCache);
+    tcase_add_test(tc_cache, Client_accessControlCacheInvalidatedInCallback);
+    suite_add_tcase(s,tc_cache);
     return s;
 }
 
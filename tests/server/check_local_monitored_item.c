@@ -117,12 +117,74 @@ START_TEST(Server_LocalMonitoredItem) {
 }
 END_TEST
 
+static UA_UInt32 dataSourceCount = 2000;
+
+static UA_StatusCode
+readCounter(UA_Server *thisServer, const UA_NodeId *sessionId, void *sessionContext,
+            const UA_NodeId *nodeId, void *nodeContext, UA_Boolean includeSourceTimeStamp,
+            const UA_NumericRange *range, UA_DataValue *value) {
+    dataSourceCount++;
+    UA_Variant_setScalarCopy(&value->value, &dataSourceCount, &UA_TYPES[UA_TYPES_UINT32]);
+    value->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+START_TEST(Server_LocalMonitoredItem_sampleOnWrite) {
+    callbackCount = 0;
+    UA_MonitoredItemCreateRequest monitorRequest =
+            UA_MonitoredItemCreateRequest_default(outNodeId);
+    monitorRequest.requestedParameters.samplingInterval = (double)100;
+    monitorRequest.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    UA_MonitoredItemCreateResult result =
+            UA_Server_createDataChangeMonitoredItem(server,
+                                                    UA_TIMESTAMPSTORETURN_BOTH,
+                                                    monitorRequest,
+                                                    NULL,
+                                                    &dataChangeNotificationCallback);
+    ASSERT_STATUSCODE(result.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(callbackCount, 1);
+
+    /* The writes within one sampling interval are sampled once */
+    UA_UInt32 count = 1000;
+    UA_Variant val;
+    UA_Variant_setScalar(&val, &count, &UA_TYPES[UA_TYPES_UINT32]);
+    for(size_t i = 0; i < 5; i++) {
+        count++;
+        UA_Server_writeValue(server, outNodeId, val);
+        UA_Server_run_iterate(server, true);
+    }
+    ck_assert_uint_eq(callbackCount, 1);
+    UA_fakeSleep(100);
+    UA_Server_run_iterate(server, true);
+    ck_assert_uint_eq(callbackCount, 2);
+
+    /* Without a write, nothing is sampled */
+    UA_fakeSleep(100);
+    UA_Server_run_iterate(server, true);
+    ck_assert_uint_eq(callbackCount, 2);
+
+    /* A DataSource is polled again */
+    UA_DataSource dataSource;
+    dataSource.read = readCounter;
+    dataSource.write = NULL;
+    UA_StatusCode retval =
+        UA_Server_setVariableNode_dataSource(server, outNodeId, dataSource);
+    ASSERT_STATUSCODE(retval, UA_STATUSCODE_GOOD);
+    for(size_t i = 0; i < 3; i++) {
+        UA_fakeSleep(100);
+        UA_Server_run_iterate(server, true);
+    }
+    ck_assert_uint_eq(callbackCount, 5);
+}
+END_TEST
+
 static Suite* testSuite_Client(void)
 {
     Suite *s = suite_create("Local Monitored Item");
     TCase *tc_server = tcase_create("Local Monitored Item Basic");
     tcase_add_checked_fixture(tc_server, setup, teardown);
     tcase_add_test(tc_server, Server_LocalMonitoredItem);
+    tcase_add_test(tc_server, Server_LocalMonitoredItem_sampleOnWrite);
     suite_add_tcase(s, tc_server);
 
     return s;
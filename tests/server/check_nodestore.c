@@ -75,6 +75,29 @@ START_TEST(replaceOldNode) {
 }
 END_TEST
 
+START_TEST(nodeExclusiveWhileSingleReference) {
+    UA_Node* n1 = createNode(0,2253);
+    ns.insertNode(ns.context, n1, NULL);
+    UA_NodeId in1 = UA_NODEID_NUMERIC(0,2253);
+    const UA_Node* nr1 = ns.getNode(ns.context, &in1);
+    ck_assert(ns.isNodeExclusive(ns.context, nr1));
+
+    /* A second consumer holds the node */
+    const UA_Node* nr2 = ns.getNode(ns.context, &in1);
+    ck_assert(!ns.isNodeExclusive(ns.context, nr1));
+    ns.releaseNode(ns.context, nr2);
+    ck_assert(ns.isNodeExclusive(ns.context, nr1));
+
+    /* The node was replaced while being held */
+    UA_Node* n2;
+    ns.getNodeCopy(ns.context, &in1, &n2);
+    UA_StatusCode retval = ns.replaceNode(ns.context, n2);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(!ns.isNodeExclusive(ns.context, nr1));
+    ns.releaseNode(ns.context, nr1);
+}
+END_TEST
+
 START_TEST(findNodeInUA_NodeStoreWithSingleEntry) {
     UA_Node* n1 = createNode(0,2253);
     ns.insertNode(ns.context, n1, NULL);
@@ -166,6 +189,74 @@ START_TEST(iterateOverExpandedNamespaceShallNotVisitEmptyNodes) {
 }
 END_TEST
 
+static size_t
+scanRange(const UA_NodeIdRange *range, UA_UInt32 *ids, size_t idsSize) {
+    size_t count = 0;
+    UA_NodeId cursor = UA_NODEID_NULL;
+    const UA_Node *node;
+    while((node = ns.getNextNode(ns.context, range, &cursor))) {
+        ck_assert_uint_eq(node->head.nodeId.namespaceIndex, range->namespaceIndex);
+        if(count < idsSize)
+            ids[count] = node->head.nodeId.identifier.numeric;
+        count++;
+        ns.releaseNode(ns.context, node);
+    }
+    UA_NodeId_clear(&cursor);
+    return count;
+}
+
+START_TEST(scanNamespaceInOrder) {
+    const UA_UInt32 ids[5] = {2253, 12, 500, 1, 2200};
+    for(size_t i = 0; i < 5; i++) {
+        ns.insertNode(ns.context, createNode(1, ids[i]), NULL);
+        ns.insertNode(ns.context, createNode(0, ids[i]), NULL);
+        ns.insertNode(ns.context, createNode(2, ids[i]), NULL);
+    }
+    UA_Node *sn = createNode(1, 0);
+    sn->head.nodeId = UA_NODEID_STRING_ALLOC(1, "Device");
+    ns.insertNode(ns.context, sn, NULL);
+
+    /* All nodes of the namespace. The numeric NodeIds come first. */
+    UA_NodeIdRange range;
+    memset(&range, 0, sizeof(UA_NodeIdRange));
+    range.namespaceIndex = 1;
+    UA_UInt32 found[6];
+    ck_assert_uint_eq(scanRange(&range, found, 6), 6);
+    ck_assert_uint_eq(found[0], 1);
+    ck_assert_uint_eq(found[1], 12);
+    ck_assert_uint_eq(found[2], 500);
+    ck_assert_uint_eq(found[3], 2200);
+    ck_assert_uint_eq(found[4], 2253);
+
+    /* Numeric range */
+    range.numericOnly = true;
+    range.numericMin = 12;
+    range.numericMax = 2200;
+    ck_assert_uint_eq(scanRange(&range, found, 6), 3);
+    ck_assert_uint_eq(found[0], 12);
+    ck_assert_uint_eq(found[2], 2200);
+
+    /* Remove the next node during the scan */
+    UA_NodeId cursor = UA_NODEID_NULL;
+    const UA_Node *node = ns.getNextNode(ns.context, &range, &cursor);
+    ck_assert_ptr_ne(node, NULL);
+    ns.releaseNode(ns.context, node);
+    UA_NodeId next = UA_NODEID_NUMERIC(1, 500);
+    ns.removeNode(ns.context, &next);
+    node = ns.getNextNode(ns.context, &range, &cursor);
+    ck_assert_ptr_ne(node, NULL);
+    ck_assert_uint_eq(node->head.nodeId.identifier.numeric, 2200);
+    ns.releaseNode(ns.context, node);
+    ck_assert_ptr_eq(ns.getNextNode(ns.context, &range, &cursor), NULL);
+    UA_NodeId_clear(&cursor);
+
+    /* Empty namespace */
+    range.numericOnly = false;
+    range.namespaceIndex = 3;
+    ck_assert_uint_eq(scanRange(&range, found, 6), 0);
+}
+END_TEST
+
 START_TEST(failToFindNonExistentNodeInUA_NodeStoreWithSeveralEntries) {
     UA_Node* n1 = createNode(0,2253);
     ns.insertNode(ns.context, n1, NULL);
@@ -248,6 +339,97 @@ START_TEST(profileGetDelete) {
 }
 END_TEST
 
+static void
+addTargets(UA_Node *node, UA_UInt32 first, UA_UInt32 last) {
+    UA_AddReferencesItem item;
+    UA_AddReferencesItem_init(&item);
+    item.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    item.isForward = true;
+    for(UA_UInt32 i = first; i <= last; i++) {
+        item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, i);
+        UA_StatusCode retval = UA_Node_addReference(node, &item, i % 7);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    }
+}
+
+static size_t
+countTargetsByName(const UA_NodeReferenceKind *rk, UA_UInt32 nameHash) {
+    size_t count = 0;
+    size_t iter = 0;
+    const UA_ReferenceTarget *rt;
+    while((rt = UA_NodeReferenceKind_findTargetByName(rk, nameHash, &iter))) {
+        ck_assert_uint_eq(rt->targetNameHash, nameHash);
+        count++;
+    }
+    return count;
+}
+
+START_TEST(referenceTargetIndex) {
+    UA_Node *node = createNode(0, 2253);
+    addTargets(node, 1, 200);
+    ck_assert_uint_eq(node->head.referencesSize, 1);
+    UA_NodeReferenceKind *rk = &node->head.references[0];
+    ck_assert_uint_eq(rk->refTargetsSize, 200);
+    ck_assert_ptr_ne(rk->refTargetsIndex, NULL);
+
+    /* Duplicates are detected with the index */
+    UA_AddReferencesItem item;
+    UA_AddReferencesItem_init(&item);
+    item.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    item.isForward = true;
+    item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, 100);
+    ck_assert_int_eq(UA_Node_addReference(node, &item, 100 % 7),
+                     UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED);
+
+    /* The targets of every name hash are found */
+    ck_assert_uint_eq(countTargetsByName(rk, 3), 29);
+    ck_assert_uint_eq(countTargetsByName(rk, 7), 0);
+
+    /* The copy has an identical index */
+    UA_Node *copy = UA_Node_copy_alloc(node);
+    ck_assert_ptr_ne(copy, NULL);
+    UA_ExpandedNodeId target = UA_EXPANDEDNODEID_NUMERIC(1, 150);
+    const UA_ReferenceTarget *rt =
+        UA_NodeReferenceKind_findTarget(&copy->head.references[0], &target);
+    ck_assert_ptr_ne(rt, NULL);
+    ck_assert_uint_eq(rt->targetNameHash, 150 % 7);
+    UA_Node_clear(copy);
+    UA_free(copy);
+
+    /* Delete the even targets. The remaining targets are moved around in the
+     * array and the index follows. */
+    UA_DeleteReferencesItem ditem;
+    UA_DeleteReferencesItem_init(&ditem);
+    ditem.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    ditem.isForward = true;
+    for(UA_UInt32 i = 2; i <= 200; i += 2) {
+        ditem.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, i);
+        ck_assert_int_eq(UA_Node_deleteReference(node, &ditem), UA_STATUSCODE_GOOD);
+    }
+    rk = &node->head.references[0];
+    ck_assert_uint_eq(rk->refTargetsSize, 100);
+    for(UA_UInt32 i = 1; i <= 200; i++) {
+        target = UA_EXPANDEDNODEID_NUMERIC(1, i);
+        rt = UA_NodeReferenceKind_findTarget(rk, &target);
+        ck_assert((rt != NULL) == (i % 2 == 1));
+    }
+    ck_assert_uint_eq(countTargetsByName(rk, 3), 15);
+
+    /* Few targets remain. The index is removed. */
+    for(UA_UInt32 i = 1; i <= 180; i += 2) {
+        ditem.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, i);
+        ck_assert_int_eq(UA_Node_deleteReference(node, &ditem), UA_STATUSCODE_GOOD);
+    }
+    ck_assert_uint_eq(rk->refTargetsSize, 10);
+    ck_assert_ptr_eq(rk->refTargetsIndex, NULL);
+    target = UA_EXPANDEDNODEID_NUMERIC(1, 199);
+    ck_assert_ptr_ne(UA_NodeReferenceKind_findTarget(rk, &target), NULL);
+    ck_assert_uint_eq(countTargetsByName(rk, 3), 2);
+
+    ns.deleteNode(ns.context, node);
+}
+END_TEST
+
 static Suite * namespace_suite (void) {
     Suite *s = suite_create ("UA_NodeStore");
 
@@ -264,6 +446,7 @@ static Suite * namespace_suite (void) {
     tcase_add_checked_fixture(tc_replace, setupZipTree, teardown);
     tcase_add_test (tc_replace, replaceExistingNode);
     tcase_add_test (tc_replace, replaceOldNode);
+    tcase_add_test (tc_replace, nodeExclusiveWhileSingleReference);
     suite_add_tcase (s, tc_replace);
 
     TCase* tc_iterate = tcase_create ("Iterate-ZipTree");
@@ -272,6 +455,11 @@ static Suite * namespace_suite (void) {
     tcase_add_test (tc_iterate, iterateOverExpandedNamespaceShallNotVisitEmptyNodes);
     suite_add_tcase (s, tc_iterate);
     
+    TCase* tc_scan = tcase_create ("Scan-ZipTree");
+    tcase_add_checked_fixture(tc_scan, setupZipTree, teardown);
+    tcase_add_test (tc_scan, scanNamespaceInOrder);
+    suite_add_tcase (s, tc_scan);
+
     TCase* tc_profile = tcase_create ("Profile-ZipTree");
     tcase_add_checked_fixture(tc_profile, setupZipTree, teardown);
     tcase_add_test (tc_profile, profileGetDelete);
@@ -290,6 +478,7 @@ static Suite * namespace_suite (void) {
     tcase_add_checked_fixture(tc_replace_hm, setupHashMap, teardown);
     tcase_add_test (tc_replace_hm, replaceExistingNode);
     tcase_add_test (tc_replace_hm, replaceOldNode);
+    tcase_add_test (tc_replace_hm, nodeExclusiveWhileSingleReference);
     suite_add_tcase (s, tc_replace_hm);
 
     TCase* tc_iterate_hm = tcase_create ("Iterate-HashMap");
@@ -303,6 +492,11 @@ static Suite * namespace_suite (void) {
     tcase_add_test (tc_profile_hm, profileGetDelete);
     suite_add_tcase (s, tc_profile_hm);
 
+    TCase* tc_references = tcase_create ("References");
+    tcase_add_checked_fixture(tc_references, setupZipTree, teardown);
+    tcase_add_test (tc_references, referenceTargetIndex);
+    suite_add_tcase (s, tc_references);
+
     return s;
 }
 
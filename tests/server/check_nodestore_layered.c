@@ -0,0 +1,167 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <open62541/plugin/log_stdout.h>
+#include <open62541/plugin/nodestore_default.h>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+
+#include <stdlib.h>
+
+#include "check.h"
+
+static const UA_NodeId typeId = {2, UA_NODEIDTYPE_NUMERIC, {2000}};
+static const UA_NodeId objectId = {2, UA_NODEIDTYPE_NUMERIC, {1000}};
+
+static UA_SharedNodes *shared;
+
+static UA_Server *
+newServer(void) {
+    UA_ServerConfig config;
+    memset(&config, 0, sizeof(UA_ServerConfig));
+    config.logger = UA_Log_Stdout_;
+    UA_StatusCode res = UA_Nodestore_Layered(&config.nodestore, shared);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Server *server = UA_Server_newWithConfig(&config);
+    ck_assert_ptr_ne(server, NULL);
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+    return server;
+}
+
+static UA_Boolean
+isOrganized(UA_Server *server, const UA_NodeId nodeId) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    UA_Boolean found = false;
+    for(size_t i = 0; i < br.referencesSize; i++) {
+        if(UA_NodeId_equal(&br.references[i].nodeId.nodeId, &nodeId))
+            found = true;
+    }
+    UA_BrowseResult_clear(&br);
+    return found;
+}
+
+static void setup(void) {
+    /* The template server adds a type that all servers have in common */
+    UA_Server *server = UA_Server_new();
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+    UA_Server_addNamespace(server, "urn:shared");
+    UA_ObjectTypeAttributes tAttr = UA_ObjectTypeAttributes_default;
+    UA_StatusCode res =
+        UA_Server_addObjectTypeNode(server, typeId,
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                    UA_QUALIFIEDNAME(2, "DeviceType"),
+                                    tAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    shared = UA_SharedNodes_new(&UA_Server_getConfig(server)->nodestore);
+    ck_assert_ptr_ne(shared, NULL);
+    UA_Server_delete(server);
+}
+
+static void teardown(void) {
+    UA_SharedNodes_release(shared);
+}
+
+START_TEST(Layered_isolatedChanges) {
+    UA_Server *server1 = newServer();
+    UA_Server *server2 = newServer();
+    ck_assert_uint_eq(UA_Server_addNamespace(server1, "urn:shared"), 2);
+    ck_assert_uint_eq(UA_Server_addNamespace(server2, "urn:shared"), 2);
+
+    /* Instantiate the shared type in the first server only */
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_StatusCode res =
+        UA_Server_addObjectNode(server1, objectId,
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(2, "Device"), typeId,
+                                oAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert(isOrganized(server1, objectId));
+    ck_assert(!isOrganized(server2, objectId));
+
+    /* Write a shared node in the first server */
+    UA_LocalizedText name = UA_LOCALIZEDTEXT("", "MyDeviceType");
+    res = UA_Server_writeDisplayName(server1, typeId, name);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_LocalizedText out;
+    res = UA_Server_readDisplayName(server1, typeId, &out);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert(UA_String_equal(&out.text, &name.text));
+    UA_LocalizedText_clear(&out);
+    res = UA_Server_readDisplayName(server2, typeId, &out);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert(!UA_String_equal(&out.text, &name.text));
+    UA_LocalizedText_clear(&out);
+
+    /* The DataSources of namespace zero are set up in both servers */
+    UA_Variant value;
+    res = UA_Server_readValue(server2, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE),
+                              &value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Variant_clear(&value);
+
+    UA_Server_delete(server1);
+    UA_Server_delete(server2);
+} END_TEST
+
+START_TEST(Layered_removeShared) {
+    UA_Server *server1 = newServer();
+    UA_Server *server2 = newServer();
+    UA_Server_addNamespace(server1, "urn:shared");
+    UA_Server_addNamespace(server2, "urn:shared");
+
+    UA_StatusCode res = UA_Server_deleteNode(server1, typeId, true);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_NodeClass nc;
+    res = UA_Server_readNodeClass(server1, typeId, &nc);
+    ck_assert_uint_eq(res, UA_STATUSCODE_BADNODEIDUNKNOWN);
+    res = UA_Server_readNodeClass(server2, typeId, &nc);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(nc, UA_NODECLASS_OBJECTTYPE);
+
+    /* Add the removed node again */
+    UA_ObjectTypeAttributes tAttr = UA_ObjectTypeAttributes_default;
+    res = UA_Server_addObjectTypeNode(server1, typeId,
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                      UA_QUALIFIEDNAME(2, "DeviceType"),
+                                      tAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    res = UA_Server_readNodeClass(server1, typeId, &nc);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* A shared node cannot be added twice */
+    res = UA_Server_addObjectTypeNode(server2, typeId,
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                      UA_QUALIFIEDNAME(2, "DeviceType"),
+                                      tAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_BADNODEIDEXISTS);
+
+    UA_Server_delete(server1);
+    UA_Server_delete(server2);
+} END_TEST
+
+int main(void) {
+    Suite *s = suite_create("Nodestore Layered");
+    TCase *tc = tcase_create("Layered");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, Layered_isolatedChanges);
+    tcase_add_test(tc, Layered_removeShared);
+    suite_add_tcase(s, tc);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
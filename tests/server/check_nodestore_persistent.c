@@ -0,0 +1,313 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <open62541/plugin/log_stdout.h>
+#include <open62541/plugin/nodestore_persistent.h>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "check.h"
+
+#define STOREPATH "check_nodestore_persistent"
+#define COPYPATH "check_nodestore_persistent_copy"
+
+static const UA_NodeId objectId = {1, UA_NODEIDTYPE_NUMERIC, {1000}};
+static const UA_NodeId variableId = {1, UA_NODEIDTYPE_NUMERIC, {1001}};
+
+static void
+removeFiles(void) {
+    remove(STOREPATH ".log");
+    remove(STOREPATH ".snapshot");
+    remove(COPYPATH ".log");
+    remove(COPYPATH ".snapshot");
+}
+
+static void
+copyFile(const char *from, const char *to) {
+    remove(to);
+    FILE *in = fopen(from, "rb");
+    if(!in)
+        return;
+    FILE *out = fopen(to, "wb");
+    ck_assert_ptr_ne(out, NULL);
+    char buf[4096];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), in)) > 0)
+        ck_assert_uint_eq(fwrite(buf, 1, n, out), n);
+    fclose(out);
+    fclose(in);
+}
+
+/* Restore a copy of the files while the server is running */
+static UA_Int32
+readPersistedInt32(const UA_NodeId nodeId) {
+    copyFile(STOREPATH ".snapshot", COPYPATH ".snapshot");
+    copyFile(STOREPATH ".log", COPYPATH ".log");
+    UA_Nodestore ns;
+    UA_StatusCode res = UA_Nodestore_Persistent(&ns, COPYPATH, NULL, 0.0, 0);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Int32 v = -1;
+    const UA_Node *node = ns.getNode(ns.context, &nodeId);
+    if(node) {
+        const UA_Variant *value = &node->variableNode.value.data.value.value;
+        if(UA_Variant_hasScalarType(value, &UA_TYPES[UA_TYPES_INT32]))
+            v = *(UA_Int32*)value->data;
+        ns.releaseNode(ns.context, node);
+    }
+    ns.clear(ns.context);
+    return v;
+}
+
+static UA_Server *
+newServer(UA_Double flushInterval, size_t maxLogSize) {
+    UA_ServerConfig config;
+    memset(&config, 0, sizeof(UA_ServerConfig));
+    config.logger = UA_Log_Stdout_;
+    UA_StatusCode res = UA_Nodestore_Persistent(&config.nodestore, STOREPATH, NULL,
+                                                flushInterval, maxLogSize);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Server *server = UA_Server_newWithConfig(&config);
+    ck_assert_ptr_ne(server, NULL);
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+    return server;
+}
+
+static void
+addNodes(UA_Server *server) {
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_StatusCode res =
+        UA_Server_addObjectNode(server, objectId,
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(1, "Device"),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                oAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+    vAttr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_Int32 value = 42;
+    UA_Variant_setScalar(&vAttr.value, &value, &UA_TYPES[UA_TYPES_INT32]);
+    res = UA_Server_addVariableNode(server, variableId, objectId,
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                    UA_QUALIFIEDNAME(1, "Value"),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                    vAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+}
+
+static UA_Boolean
+isOrganized(UA_Server *server, const UA_NodeId nodeId) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    UA_Boolean found = false;
+    for(size_t i = 0; i < br.referencesSize; i++) {
+        if(UA_NodeId_equal(&br.references[i].nodeId.nodeId, &nodeId))
+            found = true;
+    }
+    UA_BrowseResult_clear(&br);
+    return found;
+}
+
+static UA_Int32
+readInt32(UA_Server *server, const UA_NodeId nodeId) {
+    UA_Variant value;
+    UA_StatusCode res = UA_Server_readValue(server, nodeId, &value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_INT32]));
+    UA_Int32 v = *(UA_Int32*)value.data;
+    UA_Variant_clear(&value);
+    return v;
+}
+
+static void setup(void) {
+    removeFiles();
+}
+
+static void teardown(void) {
+    removeFiles();
+}
+
+START_TEST(Persistent_restoreNodes) {
+    UA_Server *server = newServer(1000.0, 0);
+    addNodes(server);
+    UA_Variant value;
+    UA_Int32 v = 43;
+    UA_Variant_setScalar(&value, &v, &UA_TYPES[UA_TYPES_INT32]);
+    UA_StatusCode res = UA_Server_writeValue(server, variableId, value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Server_delete(server); /* Writes the pending changes */
+
+    server = newServer(1000.0, 0);
+    ck_assert(isOrganized(server, objectId));
+    ck_assert_int_eq(readInt32(server, variableId), 43);
+
+    /* The DataSources of namespace zero are set up again */
+    res = UA_Server_readValue(server, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE),
+                              &value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Variant_clear(&value);
+
+    /* Persist the deletion */
+    res = UA_Server_deleteNode(server, objectId, true);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_Server_delete(server);
+
+    server = newServer(1000.0, 0);
+    ck_assert(!isOrganized(server, objectId));
+    UA_NodeClass nc;
+    res = UA_Server_readNodeClass(server, objectId, &nc);
+    ck_assert_uint_eq(res, UA_STATUSCODE_BADNODEIDUNKNOWN);
+    UA_Server_delete(server);
+} END_TEST
+
+START_TEST(Persistent_compactLog) {
+    /* Compact when the pending changes are written */
+    UA_Server *server = newServer(1000.0, 1);
+    addNodes(server);
+    UA_Server_delete(server);
+
+    FILE *fp = fopen(STOREPATH ".log", "rb");
+    ck_assert_ptr_ne(fp, NULL);
+    fseek(fp, 0, SEEK_END);
+    ck_assert_int_eq(ftell(fp), 8); /* Only the header */
+    fclose(fp);
+
+    server = newServer(1000.0, 1);
+    ck_assert(isOrganized(server, objectId));
+    ck_assert_int_eq(readInt32(server, variableId), 42);
+    UA_Server_delete(server);
+} END_TEST
+
+START_TEST(Persistent_partialBlock) {
+    UA_Server *server = newServer(1000.0, 0);
+    addNodes(server);
+    ck_assert_uint_eq(UA_Nodestore_Persistent_snapshot(&UA_Server_getConfig(server)->nodestore),
+                      UA_STATUSCODE_GOOD);
+    UA_Server_delete(server);
+
+    /* Append the beginning of a block that was not completely written */
+    FILE *fp = fopen(STOREPATH ".log", "ab");
+    ck_assert_ptr_ne(fp, NULL);
+    const unsigned char partial[6] = {100, 0, 0, 0, 0, 1};
+    ck_assert_uint_eq(fwrite(partial, 1, sizeof(partial), fp), sizeof(partial));
+    fclose(fp);
+
+    server = newServer(1000.0, 0);
+    ck_assert(isOrganized(server, objectId));
+    ck_assert_int_eq(readInt32(server, variableId), 42);
+    UA_Server_delete(server);
+} END_TEST
+
+/* The log was not truncated after the snapshot was written. Its changes are
+ * older than the snapshot and must not be replayed. */
+START_TEST(Persistent_outdatedLog) {
+    UA_Server *server = newServer(1000.0, 0);
+    addNodes(server);
+    UA_Nodestore *ns = &UA_Server_getConfig(server)->nodestore;
+    ck_assert_uint_eq(UA_Nodestore_Persistent_flush(ns), UA_STATUSCODE_GOOD);
+    copyFile(STOREPATH ".log", COPYPATH ".log");
+
+    UA_Variant value;
+    UA_Int32 v = 43;
+    UA_Variant_setScalar(&value, &v, &UA_TYPES[UA_TYPES_INT32]);
+    UA_StatusCode res = UA_Server_writeValue(server, variableId, value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(UA_Nodestore_Persistent_snapshot(ns), UA_STATUSCODE_GOOD);
+    UA_Server_delete(server);
+
+    /* Put back the log from before the snapshot */
+    copyFile(COPYPATH ".log", STOREPATH ".log");
+    server = newServer(1000.0, 0);
+    ck_assert(isOrganized(server, objectId));
+    ck_assert_int_eq(readInt32(server, variableId), 43);
+    UA_Server_delete(server);
+} END_TEST
+
+START_TEST(Persistent_flushInterval) {
+    UA_Server *server = newServer(10.0, 0);
+    addNodes(server);
+    UA_Variant value;
+    UA_Int32 v = 43;
+    UA_Variant_setScalar(&value, &v, &UA_TYPES[UA_TYPES_INT32]);
+    UA_StatusCode res = UA_Server_writeValue(server, variableId, value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* The change is written without a later change */
+    UA_Int32 persisted = -1;
+    for(size_t i = 0; i < 100 && persisted != 43; i++) {
+        usleep(10 * 1000);
+        persisted = readPersistedInt32(variableId);
+    }
+    ck_assert_int_eq(persisted, 43);
+    UA_Server_delete(server);
+} END_TEST
+
+static UA_Boolean flushRunning;
+static UA_StatusCode flushResult;
+
+static void *
+flushLoop(void *context) {
+    UA_Nodestore *ns = (UA_Nodestore*)context;
+    while(__atomic_load_n(&flushRunning, __ATOMIC_SEQ_CST) &&
+          flushResult == UA_STATUSCODE_GOOD)
+        flushResult = UA_Nodestore_Persistent_flush(ns);
+    return NULL;
+}
+
+START_TEST(Persistent_concurrentFlush) {
+    UA_Server *server = newServer(1.0, 4096);
+    addNodes(server);
+
+    /* Write while the log is flushed and compacted from two other threads */
+    pthread_t thread;
+    __atomic_store_n(&flushRunning, true, __ATOMIC_SEQ_CST);
+    flushResult = UA_STATUSCODE_GOOD;
+    ck_assert_int_eq(pthread_create(&thread, NULL, flushLoop,
+                                    &UA_Server_getConfig(server)->nodestore), 0);
+    UA_Variant value;
+    UA_StatusCode res = UA_STATUSCODE_GOOD;
+    for(UA_Int32 v = 0; v < 1000 && res == UA_STATUSCODE_GOOD; v++) {
+        UA_Variant_setScalar(&value, &v, &UA_TYPES[UA_TYPES_INT32]);
+        res = UA_Server_writeValue(server, variableId, value);
+    }
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    __atomic_store_n(&flushRunning, false, __ATOMIC_SEQ_CST);
+    pthread_join(thread, NULL);
+    ck_assert_uint_eq(flushResult, UA_STATUSCODE_GOOD);
+    UA_Server_delete(server);
+
+    server = newServer(1000.0, 0);
+    ck_assert_int_eq(readInt32(server, variableId), 999);
+    UA_Server_delete(server);
+} END_TEST
+
+int main(void) {
+    Suite *s = suite_create("Nodestore Persistent");
+    TCase *tc = tcase_create("Persistent");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, Persistent_restoreNodes);
+    tcase_add_test(tc, Persistent_compactLog);
+    tcase_add_test(tc, Persistent_partialBlock);
+    tcase_add_test(tc, Persistent_outdatedLog);
+    tcase_add_test(tc, Persistent_flushInterval);
+    tcase_add_test(tc, Persistent_concurrentFlush);
+    suite_add_tcase(s, tc);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
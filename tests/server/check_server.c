@@ -6,6 +6,8 @@
  */
 
 #include <open62541/server.h>
+#include <open62541/plugin/log_stdout.h>
+#include <open62541/plugin/nodestore_default.h>
 #include <open62541/server_config_default.h>
 #include <open62541/types.h>
 
@@ -25,6 +27,16 @@ static void setup(void) {
     UA_ServerConfig_setDefault(UA_Server_getConfig(server));
 }
 
+/* The ZipTree Nodestore scans the namespaces in order */
+static void setupZipTree(void) {
+    UA_ServerConfig config;
+    memset(&config, 0, sizeof(UA_ServerConfig));
+    config.logger = UA_Log_Stdout_;
+    UA_Nodestore_ZipTree(&config.nodestore);
+    server = UA_Server_newWithConfig(&config);
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+}
+
 static void teardown(void) {
     UA_Server_delete(server);
 }
@@ -60,6 +72,136 @@ START_TEST(checkServer_run) {
     ck_assert_int_eq(ret, UA_STATUSCODE_GOOD);
 } END_TEST
 
+static void
+countNodeVisitor(void *context, const UA_Node *node) {
+    if(node->head.nodeId.namespaceIndex == 0)
+        (*(size_t*)context)++;
+}
+
+static size_t
+countNs0Nodes(UA_Server *s) {
+    size_t count = 0;
+    UA_ServerConfig *config = UA_Server_getConfig(s);
+    config->nodestore.iterate(config->nodestore.context, countNodeVisitor, &count);
+    return count;
+}
+
+static size_t
+countChildren(UA_Server *s, const UA_NodeId nodeId) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = nodeId;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    bd.includeSubtypes = true;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(s, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    size_t count = br.referencesSize;
+    UA_BrowseResult_clear(&br);
+    return count;
+}
+
+START_TEST(checkNamespace0Snapshot) {
+    UA_UInt16 ns0 = 0;
+    UA_ByteString snapshot;
+    UA_StatusCode res = UA_Server_saveNodesetSnapshot(server, 1, &ns0, &snapshot);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    UA_ServerConfig config;
+    memset(&config, 0, sizeof(UA_ServerConfig));
+    config.logger = UA_Log_Stdout_;
+    UA_Nodestore_HashMap(&config.nodestore);
+    config.namespace0Snapshot = &snapshot;
+    UA_Server *server2 = UA_Server_newWithConfig(&config);
+    ck_assert_ptr_ne(server2, NULL);
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server2));
+
+    ck_assert_uint_eq(countNs0Nodes(server2), countNs0Nodes(server));
+    const UA_NodeId serverId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    ck_assert_uint_eq(countChildren(server2, serverId), countChildren(server, serverId));
+
+    /* The DataSources are set up after loading the snapshot */
+    UA_Variant value;
+    res = UA_Server_readValue(server2, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_STATE),
+                              &value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_SERVERSTATE]));
+    UA_Variant_clear(&value);
+
+    /* The type hierarchy is complete */
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    res = UA_Server_addObjectNode(server2, UA_NODEID_NULL,
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                  UA_QUALIFIEDNAME(1, "Folder"),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                  oAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    UA_Server_delete(server2);
+    UA_ByteString_clear(&snapshot);
+} END_TEST
+
+START_TEST(checkNodesetSnapshot) {
+    UA_UInt16 ns = UA_Server_addNamespace(server, "urn:snapshot");
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_StatusCode res =
+        UA_Server_addObjectNode(server, UA_NODEID_NUMERIC(ns, 1),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(ns, "Device"),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                oAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+    UA_Int32 answer = 42;
+    UA_Variant_setScalar(&vAttr.value, &answer, &UA_TYPES[UA_TYPES_INT32]);
+    res = UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(ns, 2),
+                                    UA_NODEID_NUMERIC(ns, 1),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                    UA_QUALIFIEDNAME(ns, "Answer"),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                    vAttr, NULL, NULL);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    UA_ByteString snapshot;
+    res = UA_Server_saveNodesetSnapshot(server, 1, &ns, &snapshot);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+
+    /* The namespace gets a different index in the second server */
+    UA_Server *server2 = UA_Server_new();
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server2));
+    UA_Server_addNamespace(server2, "urn:other");
+    const UA_NodeId objectsId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    size_t objects = countChildren(server2, objectsId);
+    res = UA_Server_loadNodesetSnapshot(server2, &snapshot);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    UA_ByteString_clear(&snapshot);
+
+    size_t ns2 = 0;
+    res = UA_Server_getNamespaceByName(server2, UA_STRING("urn:snapshot"), &ns2);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert_uint_ne(ns2, ns);
+
+    /* The reference from the ObjectsFolder was added */
+    ck_assert_uint_eq(countChildren(server2, objectsId), objects + 1);
+
+    UA_QualifiedName bn;
+    res = UA_Server_readBrowseName(server2, UA_NODEID_NUMERIC((UA_UInt16)ns2, 2), &bn);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(bn.namespaceIndex, ns2);
+    UA_QualifiedName_clear(&bn);
+
+    UA_Variant value;
+    res = UA_Server_readValue(server2, UA_NODEID_NUMERIC((UA_UInt16)ns2, 2), &value);
+    ck_assert_uint_eq(res, UA_STATUSCODE_GOOD);
+    ck_assert(UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_INT32]));
+    ck_assert_int_eq(*(UA_Int32*)value.data, 42);
+    UA_Variant_clear(&value);
+
+    UA_Server_delete(server2);
+} END_TEST
+
 int main(void) {
     Suite *s = suite_create("server");
 
@@ -68,8 +210,15 @@ int main(void) {
     tcase_add_test(tc_call, checkGetConfig);
     tcase_add_test(tc_call, checkGetNamespaceByName);
     tcase_add_test(tc_call, checkServer_run);
+    tcase_add_test(tc_call, checkNamespace0Snapshot);
+    tcase_add_test(tc_call, checkNodesetSnapshot);
     suite_add_tcase(s, tc_call);
 
+    TCase *tc_zip = tcase_create("server - ziptree");
+    tcase_add_checked_fixture(tc_zip, setupZipTree, teardown);
+    tcase_add_test(tc_zip, checkNodesetSnapshot);
+    suite_add_tcase(s, tc_zip);
+
     SRunner *sr = srunner_create(s);
     srunner_set_fork_status(sr, CK_NOFORK);
     srunner_run_all(sr, CK_NORMAL);
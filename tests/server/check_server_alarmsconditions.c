@@ -8,22 +8,89 @@
 #include <open62541/server.h>
 #include <open62541/server_config_default.h>
 
+#include "server/ua_server_internal.h"
+#include "server/ua_services.h"
+#include "server/ua_subscription.h"
+
 #include <check.h>
 
 UA_Server *server_ac;
-
+static UA_Session *session;
 
 static void setup(void) {
     server_ac = UA_Server_new();
     UA_ServerConfig_setDefault(UA_Server_getConfig(server_ac));
+    UA_Server_run_startup(server_ac);
+
+    UA_CreateSessionRequest request;
+    UA_CreateSessionRequest_init(&request);
+    request.requestedSessionTimeout = UA_UINT32_MAX;
+    UA_LOCK(server_ac->serviceMutex);
+    UA_StatusCode retval = UA_Server_createSession(server_ac, NULL, &request, &session);
+    UA_UNLOCK(server_ac->serviceMutex);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
 }
 
 static void teardown(void) {
+    UA_Server_run_shutdown(server_ac);
     UA_Server_delete(server_ac);
 }
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
 
+static UA_NodeId
+createRetainedCondition(const char *name) {
+    UA_NodeId conditionId;
+    UA_StatusCode retval =
+        UA_Server_createCondition(server_ac, UA_NODEID_NULL,
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_OFFNORMALALARMTYPE),
+                                  UA_QUALIFIEDNAME(0, (char*)(uintptr_t)name),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER),
+                                  UA_NODEID_NULL, &conditionId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_Boolean enabled = true;
+    UA_Variant value;
+    UA_Variant_setScalar(&value, &enabled, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    retval = UA_Server_setConditionVariableFieldProperty(server_ac, conditionId, &value,
+                                                         UA_QUALIFIEDNAME(0, "EnabledState"),
+                                                         UA_QUALIFIEDNAME(0, "Id"));
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_Boolean retain = true;
+    UA_Variant_setScalar(&value, &retain, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    retval = UA_Server_setConditionField(server_ac, conditionId, &value,
+                                         UA_QUALIFIEDNAME(0, "Retain"));
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    return conditionId;
+}
+
+static UA_StatusCode
+callMethod(const UA_NodeId objectId, const UA_NodeId methodId,
+           size_t inputSize, UA_Variant *input) {
+    UA_CallMethodRequest item;
+    UA_CallMethodRequest_init(&item);
+    item.objectId = objectId;
+    item.methodId = methodId;
+    item.inputArgumentsSize = inputSize;
+    item.inputArguments = input;
+
+    UA_CallRequest request;
+    UA_CallRequest_init(&request);
+    request.methodsToCallSize = 1;
+    request.methodsToCall = &item;
+
+    UA_CallResponse response;
+    UA_CallResponse_init(&response);
+    UA_LOCK(server_ac->serviceMutex);
+    Service_Call(server_ac, session, &request, &response);
+    UA_UNLOCK(server_ac->serviceMutex);
+    ck_assert_uint_eq(response.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(response.resultsSize, 1);
+    UA_StatusCode retval = response.results[0].statusCode;
+    UA_CallResponse_clear(&response);
+    return retval;
+}
+
 START_TEST(createDelete) {
     UA_StatusCode retval;
     // Loop to increase the chance of capturing dead pointers
@@ -50,6 +117,205 @@ START_TEST(createDelete) {
         ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
     }
 } END_TEST
+
+static UA_StatusCode
+twoStateCallback(UA_Server *server, const UA_NodeId *condition) {
+    return UA_STATUSCODE_GOOD;
+}
+
+START_TEST(findConditionById) {
+    /* Enough conditions to grow the index */
+    UA_NodeId conditions[100];
+    for(size_t i = 0; i < 100; i++) {
+        UA_StatusCode retval =
+            UA_Server_createCondition(server_ac, UA_NODEID_NULL,
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_OFFNORMALALARMTYPE),
+                                      UA_QUALIFIEDNAME(0, "Condition"),
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER),
+                                      UA_NODEID_NULL, &conditions[i]);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+
+    for(size_t i = 0; i < 100; i++) {
+        /* The condition is found for its own source only */
+        UA_StatusCode retval =
+            UA_Server_setConditionTwoStateVariableCallback(server_ac, conditions[i],
+                                                           UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER),
+                                                           false, twoStateCallback,
+                                                           UA_ENTERING_ACTIVESTATE);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        retval = UA_Server_setConditionTwoStateVariableCallback(server_ac, conditions[i],
+                                                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                                false, twoStateCallback,
+                                                                UA_ENTERING_ACTIVESTATE);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_BADNOTFOUND);
+
+        /* The main branch resolves to the condition */
+        UA_NodeId conditionId;
+        retval = UA_getConditionId(server_ac, &conditions[i], &conditionId);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert(UA_NodeId_equal(&conditionId, &conditions[i]));
+    }
+
+    /* Neither a condition nor a branch */
+    UA_NodeId serverId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    UA_NodeId conditionId;
+    UA_StatusCode retval = UA_getConditionId(server_ac, &serverId, &conditionId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADNOTFOUND);
+
+    /* Deleted conditions are removed from the index */
+    for(size_t i = 0; i < 100; i += 2) {
+        retval = UA_Server_deleteCondition(server_ac, conditions[i],
+                                           UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER));
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+    for(size_t i = 0; i < 100; i++) {
+        retval = UA_getConditionId(server_ac, &conditions[i], &conditionId);
+        ck_assert_uint_eq(retval, (i % 2 == 0) ?
+                          UA_STATUSCODE_BADNOTFOUND : UA_STATUSCODE_GOOD);
+    }
+} END_TEST
+
+START_TEST(findBranchByEventId) {
+    UA_NodeId conditionId = createRetainedCondition("Condition EventId");
+    UA_ByteString eventId = UA_BYTESTRING_NULL;
+    UA_StatusCode retval =
+        UA_Server_triggerConditionEvent(server_ac, conditionId,
+                                        UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER), &eventId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_gt(eventId.length, 0);
+
+    /* The condition branch is looked up with the EventId */
+    UA_LocalizedText comment = UA_LOCALIZEDTEXT("en", "Acknowledged");
+    UA_Variant input[2];
+    UA_Variant_setScalar(&input[0], &eventId, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    UA_Variant_setScalar(&input[1], &comment, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    UA_NodeId ackId = UA_NODEID_NUMERIC(0, UA_NS0ID_ACKNOWLEDGEABLECONDITIONTYPE_ACKNOWLEDGE);
+    retval = callMethod(conditionId, ackId, 2, input);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* The acknowledgement triggered a new event that replaces the EventId */
+    retval = callMethod(conditionId, ackId, 2, input);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADEVENTIDUNKNOWN);
+
+    /* Unknown EventId */
+    UA_ByteString unknownId = UA_BYTESTRING("unknown");
+    UA_Variant_setScalar(&input[0], &unknownId, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    retval = callMethod(conditionId, ackId, 2, input);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADEVENTIDUNKNOWN);
+    UA_ByteString_clear(&eventId);
+} END_TEST
+
+#define REFRESH_CONDITIONS 10
+#define REFRESH_QUEUESIZE 4
+
+START_TEST(conditionRefresh) {
+    for(size_t i = 0; i < REFRESH_CONDITIONS; i++) {
+        UA_NodeId conditionId = createRetainedCondition("Condition Refresh");
+        UA_StatusCode retval =
+            UA_Server_triggerConditionEvent(server_ac, conditionId,
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER), NULL);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+
+    /* Create a subscription with an event MonitoredItem on the Server object */
+    UA_CreateSubscriptionRequest subRequest;
+    UA_CreateSubscriptionRequest_init(&subRequest);
+    subRequest.publishingEnabled = true;
+    UA_CreateSubscriptionResponse subResponse;
+    UA_CreateSubscriptionResponse_init(&subResponse);
+    UA_LOCK(server_ac->serviceMutex);
+    Service_CreateSubscription(server_ac, session, &subRequest, &subResponse);
+    UA_UNLOCK(server_ac->serviceMutex);
+    ck_assert_uint_eq(subResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_UInt32 subscriptionId = subResponse.subscriptionId;
+    UA_CreateSubscriptionResponse_clear(&subResponse);
+
+    UA_SimpleAttributeOperand select;
+    UA_SimpleAttributeOperand_init(&select);
+    select.typeDefinitionId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
+    select.browsePathSize = 1;
+    select.browsePath = UA_QualifiedName_new();
+    *select.browsePath = UA_QUALIFIEDNAME_ALLOC(0, "EventId");
+    select.attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_EventFilter filter;
+    UA_EventFilter_init(&filter);
+    filter.selectClausesSize = 1;
+    filter.selectClauses = &select;
+
+    UA_MonitoredItemCreateRequest item;
+    UA_MonitoredItemCreateRequest_init(&item);
+    item.itemToMonitor.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    item.itemToMonitor.attributeId = UA_ATTRIBUTEID_EVENTNOTIFIER;
+    item.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    item.requestedParameters.queueSize = REFRESH_QUEUESIZE;
+    item.requestedParameters.filter.encoding = UA_EXTENSIONOBJECT_DECODED;
+    item.requestedParameters.filter.content.decoded.type = &UA_TYPES[UA_TYPES_EVENTFILTER];
+    item.requestedParameters.filter.content.decoded.data = &filter;
+
+    UA_CreateMonitoredItemsRequest monRequest;
+    UA_CreateMonitoredItemsRequest_init(&monRequest);
+    monRequest.subscriptionId = subscriptionId;
+    monRequest.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    monRequest.itemsToCreateSize = 1;
+    monRequest.itemsToCreate = &item;
+    UA_CreateMonitoredItemsResponse monResponse;
+    UA_CreateMonitoredItemsResponse_init(&monResponse);
+    UA_LOCK(server_ac->serviceMutex);
+    Service_CreateMonitoredItems(server_ac, session, &monRequest, &monResponse);
+    UA_UNLOCK(server_ac->serviceMutex);
+    UA_SimpleAttributeOperand_clear(&select);
+    ck_assert_uint_eq(monResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(monResponse.resultsSize, 1);
+    ck_assert_uint_eq(monResponse.results[0].statusCode, UA_STATUSCODE_GOOD);
+    UA_UInt32 monitoredItemId = monResponse.results[0].monitoredItemId;
+    UA_CreateMonitoredItemsResponse_clear(&monResponse);
+
+    UA_Subscription *sub = UA_Session_getSubscriptionById(session, subscriptionId);
+    ck_assert_ptr_ne(sub, NULL);
+    UA_MonitoredItem *mon = UA_Subscription_getMonitoredItem(sub, monitoredItemId);
+    ck_assert_ptr_ne(mon, NULL);
+    ck_assert_uint_eq(mon->maxQueueSize, REFRESH_QUEUESIZE);
+
+    /* Start the refresh. The events that do not fit into the queue are not
+     * dropped but remain pending. */
+    UA_Variant input;
+    UA_Variant_setScalar(&input, &subscriptionId, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_NodeId conditionTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_CONDITIONTYPE);
+    UA_NodeId refreshId = UA_NODEID_NUMERIC(0, UA_NS0ID_CONDITIONTYPE_CONDITIONREFRESH);
+    UA_StatusCode retval = callMethod(conditionTypeId, refreshId, 1, &input);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(mon->queue.size, REFRESH_QUEUESIZE);
+    ck_assert_uint_eq(mon->eventOverflows, 0);
+    ck_assert_ptr_ne(mon->conditionRefresh, NULL);
+    ck_assert_uint_eq(sub->conditionRefreshes, 1);
+
+    /* A second refresh is rejected while the first one is streamed */
+    retval = callMethod(conditionTypeId, refreshId, 1, &input);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_BADREFRESHINPROGRESS);
+
+    /* Drain the queue as the publish callback would and continue the refresh.
+     * RefreshStartEvent + conditions + RefreshEndEvent are received. */
+    size_t received = 0;
+    UA_LOCK(server_ac->serviceMutex);
+    while(mon->queue.size > 0) {
+        while(mon->queue.size > 0) {
+            UA_Notification *n = (UA_Notification*)UA_PointerRing_get(&mon->queue, 0);
+            UA_Notification_dequeue(server_ac, n);
+            UA_Notification_delete(server_ac, n);
+            received++;
+        }
+        UA_Subscription_continueConditionRefresh(server_ac, sub);
+    }
+    UA_UNLOCK(server_ac->serviceMutex);
+    ck_assert_uint_eq(received, REFRESH_CONDITIONS + 2);
+    ck_assert_ptr_eq(mon->conditionRefresh, NULL);
+    ck_assert_uint_eq(sub->conditionRefreshes, 0);
+
+    /* A new refresh can be started */
+    retval = callMethod(conditionTypeId, refreshId, 1, &input);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+} END_TEST
 #endif
 
 int main(void) {
@@ -58,6 +324,9 @@ int main(void) {
     TCase *tc_call = tcase_create("Alarms and Conditions");
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
     tcase_add_test(tc_call, createDelete);
+    tcase_add_test(tc_call, findConditionById);
+    tcase_add_test(tc_call, findBranchByEventId);
+    tcase_add_test(tc_call, conditionRefresh);
 #endif
     tcase_add_checked_fixture(tc_call, setup, teardown);
 
@@ -535,6 +535,226 @@ START_TEST(InstantiateObjectType) {
     ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
 } END_TEST
 
+static UA_Boolean
+createAllOptionalChildren(UA_Server *server_, const UA_NodeId *sessionId,
+                          void *sessionContext, const UA_NodeId *sourceNodeId,
+                          const UA_NodeId *targetParentNodeId,
+                          const UA_NodeId *referenceTypeId) {
+    return true;
+}
+
+static size_t
+countComponents(const UA_NodeId nodeId) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = nodeId;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    size_t count = br.referencesSize;
+    UA_BrowseResult_clear(&br);
+    return count;
+}
+
+static void
+addInstances(UA_NodeId typeId, size_t count, UA_NodeId *instances) {
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_AddNodesItem *items = (UA_AddNodesItem*)
+        UA_Array_new(count, &UA_TYPES[UA_TYPES_ADDNODESITEM]);
+    ck_assert_ptr_ne(items, NULL);
+    char name[32];
+    for(size_t i = 0; i < count; i++) {
+        snprintf(name, 32, "Device%u", (unsigned)i);
+        items[i].nodeClass = UA_NODECLASS_OBJECT;
+        items[i].parentNodeId.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+        items[i].referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+        items[i].browseName = UA_QUALIFIEDNAME_ALLOC(1, name);
+        items[i].typeDefinition.nodeId = typeId;
+        items[i].nodeAttributes.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+        items[i].nodeAttributes.content.decoded.type = &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES];
+        items[i].nodeAttributes.content.decoded.data = &oAttr;
+    }
+
+    UA_AddNodesResult *results = NULL;
+    UA_StatusCode retval = UA_Server_addNodes(server, count, items, &results);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    for(size_t i = 0; i < count; i++) {
+        ck_assert_uint_eq(results[i].statusCode, UA_STATUSCODE_GOOD);
+        instances[i] = results[i].addedNodeId;
+        UA_NodeId_init(&results[i].addedNodeId);
+    }
+    UA_Array_delete(results, count, &UA_TYPES[UA_TYPES_ADDNODESRESULT]);
+    UA_Array_delete(items, count, &UA_TYPES[UA_TYPES_ADDNODESITEM]);
+}
+
+/* The children of the type are cached for the instantiation. Changes of the
+ * type apply to the next instances. */
+START_TEST(InstantiateObjectTypeBulk) {
+    UA_Server_getConfig(server)->nodeLifecycle.createOptionalChild =
+        createAllOptionalChildren;
+
+    UA_NodeId baseTypeId;
+    UA_ObjectTypeAttributes otAttr = UA_ObjectTypeAttributes_default;
+    UA_StatusCode retval =
+        UA_Server_addObjectTypeNode(server, UA_NODEID_NULL,
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                    UA_QUALIFIEDNAME(1, "BaseDeviceType"), otAttr,
+                                    NULL, &baseTypeId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_NodeId typeId;
+    retval = UA_Server_addObjectTypeNode(server, UA_NODEID_NULL, baseTypeId,
+                                         UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                         UA_QUALIFIEDNAME(1, "DeviceType"), otAttr,
+                                         NULL, &typeId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* One variable in the type and one in the supertype */
+    UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+    retval = UA_Server_addVariableNode(server, UA_NODEID_NULL, typeId,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                       UA_QUALIFIEDNAME(1, "Temperature"),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                       vAttr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_NodeId serialId;
+    retval = UA_Server_addVariableNode(server, UA_NODEID_NULL, baseTypeId,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                       UA_QUALIFIEDNAME(1, "SerialNumber"),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                       vAttr, NULL, &serialId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_NodeId instances[50];
+    addInstances(typeId, 50, instances);
+    for(size_t i = 0; i < 50; i++) {
+        ck_assert_uint_eq(countComponents(instances[i]), 2);
+        UA_NodeId_clear(&instances[i]);
+    }
+
+    /* Add a variable to the supertype */
+    retval = UA_Server_addVariableNode(server, UA_NODEID_NULL, baseTypeId,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                       UA_QUALIFIEDNAME(1, "Firmware"),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                       vAttr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    addInstances(typeId, 10, instances);
+    for(size_t i = 0; i < 10; i++) {
+        ck_assert_uint_eq(countComponents(instances[i]), 3);
+        UA_NodeId_clear(&instances[i]);
+    }
+
+    /* Remove a variable from the supertype */
+    retval = UA_Server_deleteNode(server, serialId, true);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    addInstances(typeId, 10, instances);
+    for(size_t i = 0; i < 10; i++) {
+        ck_assert_uint_eq(countComponents(instances[i]), 2);
+        UA_NodeId_clear(&instances[i]);
+    }
+} END_TEST
+
+static size_t
+countReferences(const UA_NodeId nodeId, UA_UInt32 refTypeId,
+                UA_BrowseDirection direction) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = nodeId;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, refTypeId);
+    bd.includeSubtypes = true;
+    bd.browseDirection = direction;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    size_t count = br.referencesSize;
+    UA_BrowseResult_clear(&br);
+    return count;
+}
+
+START_TEST(AddDeleteNodesBulk) {
+    UA_NodeId folderId;
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_StatusCode retval =
+        UA_Server_addObjectNode(server, UA_NODEID_NULL,
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(1, "Bulk"),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                oAttr, NULL, &folderId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* The even nodes are organized by the folder. The odd nodes are components
+     * of the node that was added right before them in the same batch. */
+    const size_t count = 200;
+    UA_AddNodesItem *items = (UA_AddNodesItem*)
+        UA_Array_new(count, &UA_TYPES[UA_TYPES_ADDNODESITEM]);
+    ck_assert_ptr_ne(items, NULL);
+    char name[32];
+    for(size_t i = 0; i < count; i++) {
+        snprintf(name, 32, "Node%u", (unsigned)i);
+        items[i].nodeClass = UA_NODECLASS_OBJECT;
+        items[i].requestedNewNodeId.nodeId = UA_NODEID_NUMERIC(1, 70000 + (UA_UInt32)i);
+        if(i % 2 == 0) {
+            items[i].parentNodeId.nodeId = folderId;
+            items[i].referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+        } else {
+            items[i].parentNodeId.nodeId = UA_NODEID_NUMERIC(1, 70000 + (UA_UInt32)i - 1);
+            items[i].referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+        }
+        items[i].browseName = UA_QUALIFIEDNAME_ALLOC(1, name);
+        items[i].typeDefinition.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE);
+        items[i].nodeAttributes.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+        items[i].nodeAttributes.content.decoded.type = &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES];
+        items[i].nodeAttributes.content.decoded.data = &oAttr;
+    }
+
+    UA_AddNodesResult *addResults = NULL;
+    retval = UA_Server_addNodes(server, count, items, &addResults);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    for(size_t i = 0; i < count; i++)
+        ck_assert_uint_eq(addResults[i].statusCode, UA_STATUSCODE_GOOD);
+    UA_Array_delete(addResults, count, &UA_TYPES[UA_TYPES_ADDNODESRESULT]);
+
+    ck_assert_uint_eq(countReferences(folderId, UA_NS0ID_ORGANIZES,
+                                      UA_BROWSEDIRECTION_FORWARD), count / 2);
+    for(size_t i = 0; i < count; i++) {
+        UA_NodeId id = UA_NODEID_NUMERIC(1, 70000 + (UA_UInt32)i);
+        ck_assert_uint_eq(countReferences(id, UA_NS0ID_HIERARCHICALREFERENCES,
+                                          UA_BROWSEDIRECTION_INVERSE), 1);
+        ck_assert_uint_eq(countReferences(id, UA_NS0ID_HASCOMPONENT,
+                                          UA_BROWSEDIRECTION_FORWARD), (i + 1) % 2);
+    }
+
+    /* Delete the even nodes. The odd nodes are removed as their children. */
+    UA_DeleteNodesItem *deleteItems = (UA_DeleteNodesItem*)
+        UA_Array_new(count / 2, &UA_TYPES[UA_TYPES_DELETENODESITEM]);
+    ck_assert_ptr_ne(deleteItems, NULL);
+    for(size_t i = 0; i < count / 2; i++) {
+        deleteItems[i].nodeId = UA_NODEID_NUMERIC(1, 70000 + (UA_UInt32)(2 * i));
+        deleteItems[i].deleteTargetReferences = true;
+    }
+    UA_StatusCode *deleteResults = NULL;
+    retval = UA_Server_deleteNodes(server, count / 2, deleteItems, &deleteResults);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    for(size_t i = 0; i < count / 2; i++)
+        ck_assert_uint_eq(deleteResults[i], UA_STATUSCODE_GOOD);
+    UA_Array_delete(deleteResults, count / 2, &UA_TYPES[UA_TYPES_STATUSCODE]);
+
+    ck_assert_uint_eq(countReferences(folderId, UA_NS0ID_ORGANIZES,
+                                      UA_BROWSEDIRECTION_FORWARD), 0);
+    UA_NodeClass nc;
+    for(size_t i = 0; i < count; i++) {
+        retval = UA_Server_readNodeClass(server, UA_NODEID_NUMERIC(1, 70000 + (UA_UInt32)i),
+                                         &nc);
+        ck_assert_uint_eq(retval, UA_STATUSCODE_BADNODEIDUNKNOWN);
+    }
+
+    UA_Array_delete(deleteItems, count / 2, &UA_TYPES[UA_TYPES_DELETENODESITEM]);
+    UA_Array_delete(items, count, &UA_TYPES[UA_TYPES_ADDNODESITEM]);
+} END_TEST
+
 static UA_NodeId
 findReference(const UA_NodeId sourceId, const UA_NodeId refTypeId) {
 	UA_BrowseDescription * bDesc = UA_BrowseDescription_new();
@@ -640,6 +860,8 @@ int main(void) {
     tcase_add_test(tc_addnodes, AddNodeTwiceGivesError);
     tcase_add_test(tc_addnodes, AddObjectWithConstructor);
     tcase_add_test(tc_addnodes, InstantiateObjectType);
+    tcase_add_test(tc_addnodes, InstantiateObjectTypeBulk);
+    tcase_add_test(tc_addnodes, AddDeleteNodesBulk);
     suite_add_tcase(s, tc_addnodes);
 
     TCase *tc_deletenodes = tcase_create("deletenodes");
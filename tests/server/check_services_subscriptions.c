@@ -48,6 +48,17 @@ static void setup(void) {
     createSession();
 }
 
+/* With multithreading, the timed callbacks are dispatched to the workers. Wait
+ * for them to complete before the result is checked. */
+static void
+iterateServer(void) {
+    UA_Server_run_iterate(server, false);
+#if UA_MULTITHREADING >= 200
+    UA_WorkQueue_processRemaining(&server->workQueue);
+    UA_WorkQueue_start(&server->workQueue, server->config.nThreads);
+#endif
+}
+
 static void teardown(void) {
     UA_Server_run_shutdown(server);
     UA_Server_delete(server);
@@ -280,7 +291,7 @@ START_TEST(Server_publishCallback) {
 
     /* Sleep until the publishing interval times out */
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
     UA_realSleep(100);
 
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -310,6 +321,87 @@ START_TEST(Server_publishCallback) {
 }
 END_TEST
 
+static UA_UInt32
+createSubscriptionWithInterval(UA_Double publishingInterval) {
+    UA_CreateSubscriptionRequest request;
+    UA_CreateSubscriptionRequest_init(&request);
+    request.publishingEnabled = true;
+    request.requestedPublishingInterval = publishingInterval;
+    UA_CreateSubscriptionResponse response;
+    UA_CreateSubscriptionResponse_init(&response);
+    UA_LOCK(server->serviceMutex);
+    Service_CreateSubscription(server, session, &request, &response);
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(response.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_UInt32 id = response.subscriptionId;
+    UA_CreateSubscriptionResponse_deleteMembers(&response);
+    return id;
+}
+
+START_TEST(Server_publishSlots) {
+    /* Subscriptions with the same interval share the publish slot */
+    UA_UInt32 id1 = createSubscriptionWithInterval(500.0);
+    UA_UInt32 id2 = createSubscriptionWithInterval(500.0);
+    UA_UInt32 id3 = createSubscriptionWithInterval(1000.0);
+
+    UA_Subscription *sub1 = UA_Session_getSubscriptionById(session, id1);
+    UA_Subscription *sub2 = UA_Session_getSubscriptionById(session, id2);
+    UA_Subscription *sub3 = UA_Session_getSubscriptionById(session, id3);
+    ck_assert_ptr_ne(sub1->publishSlot, NULL);
+    ck_assert_ptr_eq(sub1->publishSlot, sub2->publishSlot);
+    ck_assert_ptr_ne(sub1->publishSlot, sub3->publishSlot);
+    ck_assert_uint_eq(sub1->publishSlot->interval, 500);
+    ck_assert_uint_eq(sub3->publishSlot->interval, 1000);
+
+    /* Intervals are rounded to full milliseconds, but at least one */
+    UA_Double savedPublishingIntervalLimitsMin = server->config.publishingIntervalLimits.min;
+    server->config.publishingIntervalLimits.min = 0.1;
+    UA_UInt32 id4 = createSubscriptionWithInterval(499.6);
+    UA_UInt32 id5 = createSubscriptionWithInterval(0.4);
+    server->config.publishingIntervalLimits.min = savedPublishingIntervalLimitsMin;
+    UA_Subscription *sub4 = UA_Session_getSubscriptionById(session, id4);
+    UA_Subscription *sub5 = UA_Session_getSubscriptionById(session, id5);
+    ck_assert_ptr_eq(sub4->publishSlot, sub1->publishSlot);
+    ck_assert_uint_eq(sub5->publishSlot->interval, 1);
+
+    /* Both subscriptions of the slot are served in one tick */
+    UA_fakeSleep(500 + 1);
+    iterateServer();
+    ck_assert_uint_eq(sub1->currentKeepAliveCount, sub1->maxKeepAliveCount + 1);
+    ck_assert_uint_eq(sub2->currentKeepAliveCount, sub2->maxKeepAliveCount + 1);
+    ck_assert_uint_eq(sub3->currentKeepAliveCount, sub3->maxKeepAliveCount);
+
+    /* Changing the interval moves the subscription to the other slot */
+    UA_ModifySubscriptionRequest modRequest;
+    UA_ModifySubscriptionRequest_init(&modRequest);
+    modRequest.subscriptionId = id2;
+    modRequest.requestedPublishingInterval = 1000.0;
+    UA_ModifySubscriptionResponse modResponse;
+    UA_ModifySubscriptionResponse_init(&modResponse);
+    UA_LOCK(server->serviceMutex);
+    Service_ModifySubscription(server, session, &modRequest, &modResponse);
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(modResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_ModifySubscriptionResponse_deleteMembers(&modResponse);
+    ck_assert_ptr_eq(sub2->publishSlot, sub3->publishSlot);
+
+    /* Empty slots are removed */
+    UA_DeleteSubscriptionsRequest del_request;
+    UA_DeleteSubscriptionsRequest_init(&del_request);
+    UA_UInt32 removeIds[5] = {id1, id2, id3, id4, id5};
+    del_request.subscriptionIdsSize = 5;
+    del_request.subscriptionIds = removeIds;
+    UA_DeleteSubscriptionsResponse del_response;
+    UA_DeleteSubscriptionsResponse_init(&del_response);
+    UA_LOCK(server->serviceMutex);
+    Service_DeleteSubscriptions(server, session, &del_request, &del_response);
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(del_response.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_DeleteSubscriptionsResponse_deleteMembers(&del_response);
+    ck_assert(LIST_EMPTY(&server->publishSlots));
+}
+END_TEST
+
 START_TEST(Server_createMonitoredItems) {
     createSubscription();
     createMonitoredItem();
@@ -416,35 +508,43 @@ START_TEST(Server_overflow) {
     }
     ck_assert_ptr_ne(mon, NULL);
     UA_assert(mon);
-    ck_assert_uint_eq(mon->queueSize, 1); 
+    ck_assert_uint_eq(mon->queue.size, 1); 
     ck_assert_uint_eq(mon->maxQueueSize, 3); 
     UA_Notification *notification;
-    notification = TAILQ_LAST(&mon->queue, NotificationQueue);
+    notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, mon->queue.size - 1);
     ck_assert_uint_eq(notification->data.value.hasStatus, false);
 
-    UA_ByteString_deleteMembers(&mon->lastSampledValue);
+    UA_DataValue_deleteMembers(&mon->lastValue);
+    mon->lastValueSet = false;
     UA_MonitoredItem_sampleCallback(server, mon);
-    ck_assert_uint_eq(mon->queueSize, 2); 
+    ck_assert_uint_eq(mon->queue.size, 2); 
     ck_assert_uint_eq(mon->maxQueueSize, 3); 
-    notification = TAILQ_LAST(&mon->queue, NotificationQueue);
+    notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, mon->queue.size - 1);
     ck_assert_uint_eq(notification->data.value.hasStatus, false);
 
-    UA_ByteString_deleteMembers(&mon->lastSampledValue);
+    UA_DataValue_deleteMembers(&mon->lastValue);
+    mon->lastValueSet = false;
     UA_MonitoredItem_sampleCallback(server, mon);
-    ck_assert_uint_eq(mon->queueSize, 3); 
+    ck_assert_uint_eq(mon->queue.size, 3); 
     ck_assert_uint_eq(mon->maxQueueSize, 3); 
-    notification = TAILQ_LAST(&mon->queue, NotificationQueue);
+    notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, mon->queue.size - 1);
     ck_assert_uint_eq(notification->data.value.hasStatus, false);
 
-    UA_ByteString_deleteMembers(&mon->lastSampledValue);
+    UA_DataValue_deleteMembers(&mon->lastValue);
+    mon->lastValueSet = false;
     UA_MonitoredItem_sampleCallback(server, mon);
-    ck_assert_uint_eq(mon->queueSize, 3); 
+    ck_assert_uint_eq(mon->queue.size, 3); 
     ck_assert_uint_eq(mon->maxQueueSize, 3); 
-    notification = TAILQ_FIRST(&mon->queue);
+    notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, 0);
     ck_assert_uint_eq(notification->data.value.hasStatus, true);
     ck_assert_uint_eq(notification->data.value.status,
                       UA_STATUSCODE_INFOTYPE_DATAVALUE | UA_STATUSCODE_INFOBITS_OVERFLOW);
 
+    /* The discarded notification was returned to the pool */
+    ck_assert_uint_eq(server->notificationPool.reserve, 3);
+    ck_assert_uint_eq(server->notificationPool.allocated, 4);
+    ck_assert_uint_eq(server->notificationPool.freeSize, 1);
+
     /* Remove status for next test */
     notification->data.value.hasStatus = false;
     notification->data.value.status = 0;
@@ -478,9 +578,9 @@ START_TEST(Server_overflow) {
     UA_MonitoredItemModifyRequest_deleteMembers(&itemToModify);
     UA_ModifyMonitoredItemsResponse_deleteMembers(&modifyMonitoredItemsResponse);
 
-    ck_assert_uint_eq(mon->queueSize, 2); 
+    ck_assert_uint_eq(mon->queue.size, 2); 
     ck_assert_uint_eq(mon->maxQueueSize, 2); 
-    notification = TAILQ_FIRST(&mon->queue);
+    notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, 0);
     ck_assert_uint_eq(notification->data.value.hasStatus, true);
     ck_assert_uint_eq(notification->data.value.status,
                       UA_STATUSCODE_INFOTYPE_DATAVALUE | UA_STATUSCODE_INFOBITS_OVERFLOW);
@@ -510,9 +610,9 @@ START_TEST(Server_overflow) {
     UA_MonitoredItemModifyRequest_deleteMembers(&itemToModify);
     UA_ModifyMonitoredItemsResponse_deleteMembers(&modifyMonitoredItemsResponse);
 
-    ck_assert_uint_eq(mon->queueSize, 1); 
+    ck_assert_uint_eq(mon->queue.size, 1); 
     ck_assert_uint_eq(mon->maxQueueSize, 1); 
-    notification = TAILQ_LAST(&mon->queue, NotificationQueue);
+    notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, mon->queue.size - 1);
     ck_assert_uint_eq(notification->data.value.hasStatus, false);
 
     /* Modify the MonitoredItem */
@@ -542,9 +642,9 @@ START_TEST(Server_overflow) {
     UA_ModifyMonitoredItemsResponse_deleteMembers(&modifyMonitoredItemsResponse);
 
     UA_MonitoredItem_sampleCallback(server, mon);
-    ck_assert_uint_eq(mon->queueSize, 1); 
+    ck_assert_uint_eq(mon->queue.size, 1); 
     ck_assert_uint_eq(mon->maxQueueSize, 1); 
-    notification = TAILQ_FIRST(&mon->queue);
+    notification = (UA_Notification*)UA_PointerRing_get(&mon->queue, 0);
     ck_assert_uint_eq(notification->data.value.hasStatus, false); /* the infobit is only set if the queue is larger than one */
 
     /* Remove the subscriptions */
@@ -570,6 +670,82 @@ START_TEST(Server_overflow) {
 }
 END_TEST
 
+START_TEST(Server_notificationOrder) {
+    createSubscription();
+    createMonitoredItem();
+    UA_UInt32 idA = monitoredItemId;
+    createMonitoredItem();
+    UA_UInt32 idB = monitoredItemId;
+
+    UA_Subscription *sub = UA_Session_getSubscriptionById(session, subscriptionId);
+    ck_assert_ptr_ne(sub, NULL);
+    UA_MonitoredItem *monA = UA_Subscription_getMonitoredItem(sub, idA);
+    UA_MonitoredItem *monB = UA_Subscription_getMonitoredItem(sub, idB);
+    ck_assert_ptr_ne(monA, NULL);
+    ck_assert_ptr_ne(monB, NULL);
+
+    /* The first sample of each MonitoredItem is queued (queue size 1) */
+    ck_assert_uint_eq(sub->notificationOrder.size, 2);
+    ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 0), monA);
+    ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 1), monB);
+
+    /* New samples replace the queued notification. The MonitoredItem keeps its
+     * position in the order. The ring wraps around. */
+    for(size_t i = 0; i < 10; i++) {
+        UA_Notification *old = (UA_Notification*)UA_PointerRing_get(&monA->queue, 0);
+        UA_DataValue_clear(&monA->lastValue);
+        monA->lastValueSet = false;
+        UA_MonitoredItem_sampleCallback(server, monA);
+        ck_assert_uint_eq(monA->queue.size, 1);
+        ck_assert_ptr_ne(UA_PointerRing_get(&monA->queue, 0), old);
+        ck_assert_uint_eq(sub->notificationOrder.size, 2);
+        ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 0), monA);
+        ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 1), monB);
+    }
+    ck_assert_uint_eq(sub->dataChangeNotifications, 2);
+
+    /* Sampling removes the notifications from the order. Reporting adds them to
+     * the end. */
+    UA_SetMonitoringModeRequest request;
+    UA_SetMonitoringModeRequest_init(&request);
+    request.subscriptionId = subscriptionId;
+    request.monitoringMode = UA_MONITORINGMODE_SAMPLING;
+    request.monitoredItemIdsSize = 1;
+    request.monitoredItemIds = &idA;
+    UA_SetMonitoringModeResponse response;
+    UA_SetMonitoringModeResponse_init(&response);
+    UA_LOCK(server->serviceMutex);
+    Service_SetMonitoringMode(server, session, &request, &response);
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(response.results[0], UA_STATUSCODE_GOOD);
+    UA_SetMonitoringModeResponse_clear(&response);
+    ck_assert_uint_eq(monA->queue.size, 1);
+    ck_assert_uint_eq(sub->notificationOrder.size, 1);
+    ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 0), monB);
+
+    request.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    UA_LOCK(server->serviceMutex);
+    Service_SetMonitoringMode(server, session, &request, &response);
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(response.results[0], UA_STATUSCODE_GOOD);
+    UA_SetMonitoringModeResponse_clear(&response);
+    ck_assert_uint_eq(sub->notificationOrder.size, 2);
+    ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 0), monB);
+    ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 1), monA);
+
+    /* Dequeue the oldest notification of A */
+    UA_LOCK(server->serviceMutex);
+    UA_Notification *n = (UA_Notification*)UA_PointerRing_get(&monA->queue, 0);
+    UA_Notification_dequeue(server, n);
+    UA_Notification_delete(server, n);
+    UA_UNLOCK(server->serviceMutex);
+    ck_assert_uint_eq(monA->queue.size, 0);
+    ck_assert_uint_eq(sub->notificationOrder.size, 1);
+    ck_assert_ptr_eq(UA_PointerRing_get(&sub->notificationOrder, 0), monB);
+    ck_assert_uint_eq(sub->dataChangeNotifications, 1);
+}
+END_TEST
+
 START_TEST(Server_setMonitoringMode) {
     createSubscription();
     createMonitoredItem();
@@ -689,7 +865,7 @@ START_TEST(Server_lifeTimeCount) {
     UA_MonitoredItemCreateRequest_deleteMembers(&item);
     UA_CreateMonitoredItemsResponse_deleteMembers(&mresponse);
 
-    UA_Server_run_iterate(server, false);
+    iterateServer();
     UA_UInt32 count = 0;
     UA_Subscription *sub;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -699,7 +875,7 @@ START_TEST(Server_lifeTimeCount) {
     ck_assert_uint_eq(count, 2);
 
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
 
     count = 0;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -710,7 +886,7 @@ START_TEST(Server_lifeTimeCount) {
 
     /* Sleep until the publishing interval times out */
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
 
     count = 0;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -721,7 +897,7 @@ START_TEST(Server_lifeTimeCount) {
 
     /* Sleep until the publishing interval times out */
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
 
     count = 0;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -732,7 +908,7 @@ START_TEST(Server_lifeTimeCount) {
 
     /* Sleep until the publishing interval times out */
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
 
     count = 0;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -743,7 +919,7 @@ START_TEST(Server_lifeTimeCount) {
 
     /* Sleep until the publishing interval times out */
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
 
     count = 0;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -754,7 +930,7 @@ START_TEST(Server_lifeTimeCount) {
 
     /* Sleep until the publishing interval times out */
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
 
     count = 0;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -766,7 +942,7 @@ START_TEST(Server_lifeTimeCount) {
     /* Sleep until the publishing interval times out. The next iteration removes
      * the subscription. */
     UA_fakeSleep((UA_UInt32)publishingInterval + 1);
-    UA_Server_run_iterate(server, false);
+    iterateServer();
 
     count = 0;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
@@ -857,12 +1033,14 @@ static Suite* testSuite_Client(void) {
     tcase_add_test(tc_server, Server_createMonitoredItems);
     tcase_add_test(tc_server, Server_modifyMonitoredItems);
     tcase_add_test(tc_server, Server_overflow);
+    tcase_add_test(tc_server, Server_notificationOrder);
     tcase_add_test(tc_server, Server_setMonitoringMode);
     tcase_add_test(tc_server, Server_deleteMonitoredItems);
     tcase_add_test(tc_server, Server_republish);
     tcase_add_test(tc_server, Server_republish_invalid);
     tcase_add_test(tc_server, Server_deleteSubscription);
     tcase_add_test(tc_server, Server_publishCallback);
+    tcase_add_test(tc_server, Server_publishSlots);
     tcase_add_test(tc_server, Server_lifeTimeCount);
     tcase_add_test(tc_server, Server_invalidPublishingInterval);
 #endif /* UA_ENABLE_SUBSCRIPTIONS */
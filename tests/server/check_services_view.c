@@ -161,6 +161,355 @@ START_TEST(Service_Browse_Recursive) {
 }
 END_TEST
 
+static UA_Boolean
+browseFindsTarget(UA_Server *server, const UA_NodeId *refType,
+                  const UA_NodeId *target) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    bd.referenceTypeId = *refType;
+    bd.includeSubtypes = true;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.resultMask = UA_BROWSERESULTMASK_NONE;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_int_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    UA_Boolean found = false;
+    for(size_t i = 0; i < br.referencesSize; i++) {
+        if(UA_NodeId_equal(&br.references[i].nodeId.nodeId, target))
+            found = true;
+    }
+    UA_BrowseResult_deleteMembers(&br);
+    return found;
+}
+
+START_TEST(Service_Browse_ReferenceTypeHierarchy) {
+    UA_Server *server = UA_Server_new();
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+
+    /* The namespace zero is fully represented in the index */
+    ck_assert(!server->typeHierarchy.fallback);
+
+    /* Browsing with subtypes caches the set of subtypes */
+    UA_NodeId serverObject = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    ck_assert(browseFindsTarget(server, &hierarchicalReferences, &serverObject));
+    ck_assert_uint_gt(server->typeHierarchy.subtypeSets.count, 0);
+
+    /* Add a subtype of Organizes and use it below the objects folder */
+    UA_NodeId myRef = UA_NODEID_NUMERIC(1, 5000);
+    UA_ReferenceTypeAttributes rattr = UA_ReferenceTypeAttributes_default;
+    rattr.displayName = UA_LOCALIZEDTEXT("", "MyOrganizes");
+    UA_StatusCode retval =
+        UA_Server_addReferenceTypeNode(server, myRef,
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                       UA_QUALIFIEDNAME(1, "MyOrganizes"), rattr,
+                                       NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_NodeId object = UA_NODEID_NUMERIC(1, 5001);
+    UA_ObjectAttributes oattr = UA_ObjectAttributes_default;
+    retval = UA_Server_addObjectNode(server, object,
+                                     UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                     myRef, UA_QUALIFIEDNAME(1, "MyObject"),
+                                     UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                     oattr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* The new reference type is found as a subtype. The cached sets were
+     * dropped when the HasSubtype reference was added. */
+    ck_assert(isNodeInTree(server, &myRef, &hierarchicalReferences, &subtypeId, 1));
+    ck_assert(browseFindsTarget(server, &hierarchicalReferences, &object));
+    UA_NodeId organizes = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    ck_assert(browseFindsTarget(server, &organizes, &object));
+
+    /* Unrelated reference types do not match */
+    UA_NodeId aggregates = UA_NODEID_NUMERIC(0, UA_NS0ID_AGGREGATES);
+    ck_assert(!isNodeInTree(server, &myRef, &aggregates, &subtypeId, 1));
+    ck_assert(!browseFindsTarget(server, &aggregates, &object));
+
+    /* Remove the reference type. It is no longer a subtype. */
+    retval = UA_Server_deleteNode(server, myRef, true);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(!isNodeInTree(server, &myRef, &hierarchicalReferences, &subtypeId, 1));
+    ck_assert(!browseFindsTarget(server, &hierarchicalReferences, &object));
+    ck_assert(!server->typeHierarchy.fallback);
+
+    UA_Server_delete(server);
+}
+END_TEST
+
+static size_t
+browseCount(UA_Server *server, UA_NodeId nodeId, UA_UInt32 resultMask,
+            UA_UInt32 nodeClassMask, UA_UInt32 maxResults) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = nodeId;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    bd.includeSubtypes = true;
+    bd.resultMask = resultMask;
+    bd.nodeClassMask = nodeClassMask;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(server, maxResults, &bd);
+    ck_assert_int_eq(br.statusCode, UA_STATUSCODE_GOOD);
+
+    size_t total = 0;
+    while(true) {
+        if(maxResults > 0)
+            ck_assert(br.referencesSize <= maxResults);
+        for(size_t i = 0; i < br.referencesSize; i++) {
+            if(nodeClassMask != 0 && (resultMask & UA_BROWSERESULTMASK_NODECLASS))
+                ck_assert(br.references[i].nodeClass & nodeClassMask);
+            if(resultMask & UA_BROWSERESULTMASK_BROWSENAME)
+                ck_assert(br.references[i].browseName.name.length > 0);
+        }
+        total += br.referencesSize;
+        UA_ByteString cp = br.continuationPoint;
+        br.continuationPoint = UA_BYTESTRING_NULL;
+        UA_BrowseResult_deleteMembers(&br);
+        if(cp.length == 0)
+            break;
+        br = UA_Server_browseNext(server, false, &cp);
+        UA_ByteString_deleteMembers(&cp);
+        ck_assert_int_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    }
+    return total;
+}
+
+/* More children than fit into one batch of nodestore lookups */
+START_TEST(Service_Browse_ManyTargets) {
+    UA_Server *server = UA_Server_new();
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+
+    UA_NodeId parent;
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_StatusCode retval =
+        UA_Server_addObjectNode(server, UA_NODEID_NULL,
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(1, "Parent"),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                oAttr, NULL, &parent);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    char name[32];
+    UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+    for(size_t i = 0; i < 200; i++) {
+        snprintf(name, 32, "Child%u", (unsigned)i);
+        if(i % 4 == 0) {
+            retval = UA_Server_addVariableNode(server, UA_NODEID_NULL, parent,
+                                               UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                               UA_QUALIFIEDNAME(1, name),
+                                               UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                               vAttr, NULL, NULL);
+        } else {
+            retval = UA_Server_addObjectNode(server, UA_NODEID_NULL, parent,
+                                             UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                             UA_QUALIFIEDNAME(1, name),
+                                             UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                             oAttr, NULL, NULL);
+        }
+        ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    }
+
+    /* Without node attributes, the targets are not looked up */
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_NONE, 0, 0), 200);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_ALL, 0, 0), 200);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_NONE, 0, 7), 200);
+
+    /* Filter by the NodeClass with and without node attributes in the result */
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_NONE,
+                                  UA_NODECLASS_VARIABLE, 0), 50);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_ALL,
+                                  UA_NODECLASS_VARIABLE, 0), 50);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_ALL,
+                                  UA_NODECLASS_OBJECT, 11), 150);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_ALL,
+                                  UA_NODECLASS_METHOD, 0), 0);
+
+    UA_Server_delete(server);
+}
+END_TEST
+
+static UA_BrowsePathResult
+translateChild(UA_Server *server, const char *name) {
+    UA_RelativePathElement rpe;
+    UA_RelativePathElement_init(&rpe);
+    rpe.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    rpe.targetName = UA_QUALIFIEDNAME(1, (char*)(uintptr_t)name);
+    UA_BrowsePath bp;
+    UA_BrowsePath_init(&bp);
+    bp.startingNode = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    bp.relativePath.elements = &rpe;
+    bp.relativePath.elementsSize = 1;
+    return UA_Server_translateBrowsePathToNodeIds(server, &bp);
+}
+
+static UA_StatusCode
+addTargetReference(UA_Server *server, UA_Session *session,
+                   UA_Node *node, void *data) {
+    return UA_Node_addReference(node, (const UA_AddReferencesItem*)data, 0);
+}
+
+/* Remote targets (ExpandedNodeId) and dangling local targets are returned
+ * without the attributes of the target node */
+START_TEST(Service_Browse_RemoteTarget) {
+    UA_Server *server = UA_Server_new();
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+
+    UA_NodeId parent;
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_StatusCode retval =
+        UA_Server_addObjectNode(server, UA_NODEID_NULL,
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(1, "Parent"),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                oAttr, NULL, &parent);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    retval = UA_Server_addObjectNode(server, UA_NODEID_NULL, parent,
+                                     UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                     UA_QUALIFIEDNAME(1, "Child"),
+                                     UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                     oAttr, NULL, NULL);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* The public API adds no remote references. Add them to the node. */
+    UA_AddReferencesItem item;
+    UA_AddReferencesItem_init(&item);
+    item.sourceNodeId = parent;
+    item.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    item.isForward = true;
+    item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, 4711);
+    item.targetNodeId.serverIndex = 1;
+    UA_LOCK(server->serviceMutex);
+    retval = UA_Server_editNode(server, &server->adminSession, &parent,
+                                addTargetReference, &item);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, 4712); /* Does not exist */
+    retval = UA_Server_editNode(server, &server->adminSession, &parent,
+                                addTargetReference, &item);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    UA_UNLOCK(server->serviceMutex);
+
+    /* With and without looking up the target nodes */
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_NONE, 0, 0), 3);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_NONE, 0, 1), 3);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_NODECLASS, 0, 0), 3);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_REFERENCETYPEID,
+                                  UA_NODECLASS_OBJECT, 0), 3);
+    ck_assert_uint_eq(browseCount(server, parent, UA_BROWSERESULTMASK_REFERENCETYPEID,
+                                  UA_NODECLASS_VARIABLE, 0), 2);
+
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = parent;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    bd.resultMask = UA_BROWSERESULTMASK_ALL;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_uint_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(br.referencesSize, 3);
+    size_t remote = 0, dangling = 0;
+    for(size_t i = 0; i < br.referencesSize; i++) {
+        UA_ReferenceDescription *rd = &br.references[i];
+        if(rd->nodeId.serverIndex == 1) {
+            ck_assert_uint_eq(rd->nodeId.nodeId.identifier.numeric, 4711);
+            ck_assert_uint_eq(rd->nodeClass, UA_NODECLASS_UNSPECIFIED);
+            ck_assert(rd->isForward);
+            remote++;
+        } else if(rd->nodeId.nodeId.identifierType == UA_NODEIDTYPE_NUMERIC &&
+                  rd->nodeId.nodeId.identifier.numeric == 4712) {
+            ck_assert_uint_eq(rd->nodeClass, UA_NODECLASS_UNSPECIFIED);
+            ck_assert_uint_eq(rd->browseName.name.length, 0);
+            dangling++;
+        } else {
+            ck_assert_uint_eq(rd->nodeClass, UA_NODECLASS_OBJECT);
+        }
+    }
+    ck_assert_uint_eq(remote, 1);
+    ck_assert_uint_eq(dangling, 1);
+    UA_BrowseResult_clear(&br);
+
+    UA_Server_delete(server);
+}
+END_TEST
+
+/* Returns the cache entry that is valid for the current model version */
+static UA_BrowsePathCacheEntry *
+validCacheEntry(UA_Server *server) {
+    UA_BrowsePathCacheEntry *found = NULL;
+    for(size_t i = 0; server->browsePathCache && i < UA_BROWSEPATHCACHE_SIZE; i++) {
+        UA_BrowsePathCacheEntry *entry = &server->browsePathCache[i];
+        if(entry->modelVersion != server->modelVersion)
+            continue;
+        ck_assert_ptr_eq(found, NULL);
+        found = entry;
+    }
+    return found;
+}
+
+/* The cached results are invalidated when the information model changes */
+START_TEST(TranslateBrowsePath_Cache) {
+    UA_Server *server = UA_Server_new();
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+
+    UA_BrowsePathResult bpr = translateChild(server, "Cached");
+    ck_assert_uint_eq(bpr.statusCode, UA_STATUSCODE_BADNOMATCH);
+    UA_BrowsePathResult_clear(&bpr);
+
+    UA_NodeId nodeId;
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_StatusCode retval =
+        UA_Server_addObjectNode(server, UA_NODEID_NULL,
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                UA_QUALIFIEDNAME(1, "Cached"),
+                                UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                oAttr, NULL, &nodeId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    /* Adding the node invalidated the cached BADNOMATCH result. The first
+     * translation is a cache miss and stores the result. */
+    ck_assert_ptr_eq(validCacheEntry(server), NULL);
+    bpr = translateChild(server, "Cached");
+    ck_assert_uint_eq(bpr.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(bpr.targetsSize, 1);
+    ck_assert(UA_NodeId_equal(&bpr.targets[0].targetId.nodeId, &nodeId));
+    UA_BrowsePathResult_clear(&bpr);
+    UA_BrowsePathCacheEntry *entry = validCacheEntry(server);
+    ck_assert_ptr_ne(entry, NULL);
+    ck_assert_uint_eq(entry->result.targetsSize, 1);
+
+    /* Mark the cached result. The second translation is a cache hit and
+     * returns the marked result. */
+    entry->result.targets[0].remainingPathIndex = 4711;
+    bpr = translateChild(server, "Cached");
+    ck_assert_uint_eq(bpr.statusCode, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(bpr.targetsSize, 1);
+    ck_assert_uint_eq(bpr.targets[0].remainingPathIndex, 4711);
+    UA_BrowsePathResult_clear(&bpr);
+
+    /* Removing the reference changes the model version and invalidates the
+     * cache */
+    UA_UInt64 modelVersion = server->modelVersion;
+    UA_ExpandedNodeId target;
+    UA_ExpandedNodeId_init(&target);
+    target.nodeId = nodeId;
+    retval = UA_Server_deleteReference(server, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                       UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES), true,
+                                       target, true);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert(server->modelVersion > modelVersion);
+    ck_assert_ptr_eq(validCacheEntry(server), NULL);
+    bpr = translateChild(server, "Cached");
+    ck_assert_uint_eq(bpr.statusCode, UA_STATUSCODE_BADNOMATCH);
+    UA_BrowsePathResult_clear(&bpr);
+
+    UA_NodeId_clear(&nodeId);
+    UA_Server_delete(server);
+}
+END_TEST
+
 START_TEST(Service_TranslateBrowsePathsToNodeIds) {
     UA_Client *client = UA_Client_new();
     UA_ClientConfig_setDefault(UA_Client_getConfig(client));
@@ -229,6 +578,10 @@ static Suite *testSuite_Service_TranslateBrowsePathsToNodeIds(void) {
     tcase_add_test(tc_browse, Service_Browse_WithBrowseName);
     tcase_add_test(tc_browse, Service_Browse_WithMaxResults);
     tcase_add_test(tc_browse, Service_Browse_Recursive);
+    tcase_add_test(tc_browse, Service_Browse_ReferenceTypeHierarchy);
+    tcase_add_test(tc_browse, Service_Browse_ManyTargets);
+    tcase_add_test(tc_browse, Service_Browse_RemoteTarget);
+    tcase_add_test(tc_browse, TranslateBrowsePath_Cache);
     suite_add_tcase(s, tc_browse);
 
     TCase *tc_translate = tcase_create("TranslateBrowsePathsToNodeIds");
@@ -124,6 +124,20 @@ handler_events_simple(UA_Client *lclient, UA_UInt32 subId, void *subContext,
     notificationReceived = true;
 }
 
+static size_t eventNotificationCount;
+
+static void
+handler_events_count(UA_Client *lclient, UA_UInt32 subId, void *subContext,
+                     UA_UInt32 monId, void *monContext,
+                     size_t nEventFields, UA_Variant *eventFields) {
+    ck_assert_uint_eq(nEventFields, nSelectClauses);
+    ck_assert(UA_Variant_hasScalarType(&eventFields[0], &UA_TYPES[UA_TYPES_UINT16]));
+    ck_assert_uint_eq(*(UA_UInt16*)eventFields[0].data, 1000);
+    ck_assert(UA_Variant_hasScalarType(&eventFields[2], &UA_TYPES[UA_TYPES_NODEID]));
+    ck_assert(UA_NodeId_equal((UA_NodeId*)eventFields[2].data, &eventType));
+    eventNotificationCount++;
+}
+
 // create a subscription and add a monitored item to it
 static void
 setupSubscription(void) {
@@ -627,6 +641,136 @@ START_TEST(multipleMonitoredItemsOneNode) {
     }
 } END_TEST
 
+/* The MonitoredItems share the resolved select clauses of the event */
+START_TEST(multipleMonitoredItemsSameFilter) {
+    UA_NodeId eventNodeId;
+    UA_StatusCode retval = eventSetup(&eventNodeId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_UInt32 monitoredItemIdAr[3];
+    for(size_t i = 0; i < 3; i++) {
+        UA_MonitoredItemCreateResult createResult =
+            addMonitoredItem(handler_events_count, true, true);
+        ck_assert_uint_eq(createResult.statusCode, UA_STATUSCODE_GOOD);
+        monitoredItemIdAr[i] = createResult.monitoredItemId;
+    }
+
+    retval = triggerEventLocked(eventNodeId, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER), NULL, UA_TRUE);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    eventNotificationCount = 0;
+    sleepUntilAnswer(publishingInterval + 100);
+    retval = UA_Client_run_iterate(client, 0);
+    sleepUntilAnswer(publishingInterval + 100);
+    retval = UA_Client_run_iterate(client, 0);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(eventNotificationCount, 3);
+
+    UA_DeleteMonitoredItemsRequest deleteRequest;
+    UA_DeleteMonitoredItemsRequest_init(&deleteRequest);
+    deleteRequest.subscriptionId = subscriptionId;
+    deleteRequest.monitoredItemIds = monitoredItemIdAr;
+    deleteRequest.monitoredItemIdsSize = 3;
+    UA_DeleteMonitoredItemsResponse deleteResponse =
+        UA_Client_MonitoredItems_delete(client, deleteRequest);
+    ck_assert_uint_eq(deleteResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(deleteResponse.resultsSize, 3);
+    UA_DeleteMonitoredItemsResponse_deleteMembers(&deleteResponse);
+} END_TEST
+
+static UA_MonitoredItemCreateResult
+addMonitoredItemOfType(UA_NodeId ofType) {
+    UA_MonitoredItemCreateRequest item;
+    UA_MonitoredItemCreateRequest_init(&item);
+    item.itemToMonitor.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    item.itemToMonitor.attributeId = UA_ATTRIBUTEID_EVENTNOTIFIER;
+    item.monitoringMode = UA_MONITORINGMODE_REPORTING;
+
+    UA_LiteralOperand literal;
+    UA_LiteralOperand_init(&literal);
+    UA_Variant_setScalar(&literal.value, &ofType, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_ContentFilterElement element;
+    UA_ContentFilterElement_init(&element);
+    element.filterOperator = UA_FILTEROPERATOR_OFTYPE;
+    element.filterOperandsSize = 1;
+    element.filterOperands = UA_ExtensionObject_new();
+    element.filterOperands[0].encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    element.filterOperands[0].content.decoded.type = &UA_TYPES[UA_TYPES_LITERALOPERAND];
+    element.filterOperands[0].content.decoded.data = &literal;
+
+    UA_EventFilter filter;
+    UA_EventFilter_init(&filter);
+    filter.selectClauses = selectClauses;
+    filter.selectClausesSize = nSelectClauses;
+    filter.whereClause.elements = &element;
+    filter.whereClause.elementsSize = 1;
+
+    item.requestedParameters.filter.encoding = UA_EXTENSIONOBJECT_DECODED;
+    item.requestedParameters.filter.content.decoded.data = &filter;
+    item.requestedParameters.filter.content.decoded.type = &UA_TYPES[UA_TYPES_EVENTFILTER];
+    item.requestedParameters.queueSize = 1;
+    item.requestedParameters.discardOldest = true;
+
+    UA_MonitoredItemCreateResult result =
+        UA_Client_MonitoredItems_createEvent(client, subscriptionId,
+                                             UA_TIMESTAMPSTORETURN_BOTH, item,
+                                             NULL, handler_events_count, NULL);
+    UA_ExtensionObject_delete(element.filterOperands);
+    return result;
+}
+
+/* Events are routed only to the MonitoredItems with a matching OfType */
+START_TEST(routeByEventType) {
+    UA_NodeId eventNodeId;
+    UA_StatusCode retval = eventSetup(&eventNodeId);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_UInt32 monitoredItemIdAr[2];
+    UA_MonitoredItemCreateResult createResult = addMonitoredItemOfType(eventType);
+    ck_assert_uint_eq(createResult.statusCode, UA_STATUSCODE_GOOD);
+    monitoredItemIdAr[0] = createResult.monitoredItemId;
+    createResult = addMonitoredItemOfType(UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER));
+    ck_assert_uint_eq(createResult.statusCode, UA_STATUSCODE_GOOD);
+    monitoredItemIdAr[1] = createResult.monitoredItemId;
+
+    /* One route for the server object with a group per event type */
+    serverMutexLock();
+    UA_EventRoute *route = LIST_FIRST(&server->eventRoutes);
+    ck_assert_ptr_ne(route, NULL);
+    ck_assert_ptr_eq(LIST_NEXT(route, listEntry), NULL);
+    size_t groups = 0;
+    UA_EventRouteGroup *group;
+    LIST_FOREACH(group, &route->groups, listEntry)
+        groups++;
+    ck_assert_uint_eq(groups, 2);
+    serverMutexUnlock();
+
+    retval = triggerEventLocked(eventNodeId, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER), NULL, UA_TRUE);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+
+    eventNotificationCount = 0;
+    sleepUntilAnswer(publishingInterval + 100);
+    retval = UA_Client_run_iterate(client, 0);
+    sleepUntilAnswer(publishingInterval + 100);
+    retval = UA_Client_run_iterate(client, 0);
+    ck_assert_uint_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(eventNotificationCount, 1);
+
+    UA_DeleteMonitoredItemsRequest deleteRequest;
+    UA_DeleteMonitoredItemsRequest_init(&deleteRequest);
+    deleteRequest.subscriptionId = subscriptionId;
+    deleteRequest.monitoredItemIds = monitoredItemIdAr;
+    deleteRequest.monitoredItemIdsSize = 2;
+    UA_DeleteMonitoredItemsResponse deleteResponse =
+        UA_Client_MonitoredItems_delete(client, deleteRequest);
+    ck_assert_uint_eq(deleteResponse.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    UA_DeleteMonitoredItemsResponse_deleteMembers(&deleteResponse);
+
+    serverMutexLock();
+    ck_assert(LIST_EMPTY(&server->eventRoutes));
+    serverMutexUnlock();
+} END_TEST
+
 START_TEST(discardNewestOverflow) {
     // add a monitored item
     UA_MonitoredItemCreateResult createResult = addMonitoredItem(handler_events_overflow, true, false);
@@ -769,6 +913,8 @@ static Suite *testSuite_Client(void) {
     tcase_add_test(tc_server, uppropagation);
     tcase_add_test(tc_server, eventOverflow);
     tcase_add_test(tc_server, multipleMonitoredItemsOneNode);
+    tcase_add_test(tc_server, multipleMonitoredItemsSameFilter);
+    tcase_add_test(tc_server, routeByEventType);
     tcase_add_test(tc_server, discardNewestOverflow);
     tcase_add_test(tc_server, eventStressing);
     tcase_add_test(tc_server, evaluateWhereClause);
@@ -122,7 +122,100 @@ def sortNodes(nodeset):
 # Generate C Code #
 ###################
 
-def generateOpen62541Code(nodeset, outfilename, internal_headers=False, typesArray=[]):
+def generateSnapshotCode(nodeset, outfilename):
+    outfilebase = basename(outfilename)
+    # The namespaces with nodes that are created by the generated code
+    uris = sorted(set(nodeset.namespaces[node.id.ns] for node in nodeset.nodes.values()
+                      if not node.hidden))
+    ns0Only = uris == [nodeset.namespaces[0]]
+
+    code = """/* WARNING: This is a generated file.
+ * Any manual changes will be overwritten. */
+
+/* Usage: %s_snapshot <output file> [<dependency snapshot>...]
+ * The snapshots of the dependencies are loaded before the nodes are created.
+ * Build with the same options as the server that loads the snapshot. */
+
+#include "%s.h"
+
+#ifndef UA_ENABLE_AMALGAMATION
+# include <open62541/server_config_default.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static UA_StatusCode
+loadSnapshotFile(UA_Server *server, const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if(!fp)
+        return UA_STATUSCODE_BADNOTFOUND;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    UA_ByteString snapshot = UA_BYTESTRING_NULL;
+    UA_StatusCode retVal = UA_ByteString_allocBuffer(&snapshot, (size_t)size);
+    if(retVal == UA_STATUSCODE_GOOD &&
+       fread(snapshot.data, 1, snapshot.length, fp) != snapshot.length)
+        retVal = UA_STATUSCODE_BADINTERNALERROR;
+    fclose(fp);
+    if(retVal == UA_STATUSCODE_GOOD)
+        retVal = UA_Server_loadNodesetSnapshot(server, &snapshot);
+    UA_ByteString_clear(&snapshot);
+    return retVal;
+}
+
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %%s <output file> [<dependency snapshot>...]\\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    UA_Server *server = UA_Server_new();
+    UA_StatusCode retVal = UA_STATUSCODE_GOOD;
+    for(int i = 2; i < argc && retVal == UA_STATUSCODE_GOOD; i++)
+        retVal = loadSnapshotFile(server, argv[i]);
+""" % (outfilebase, outfilebase)
+
+    # Namespace zero is created during the server initialization
+    if not ns0Only:
+        code += """    if(retVal == UA_STATUSCODE_GOOD)
+        retVal = %s(server);
+""" % outfilebase
+
+    code += "\n    UA_UInt16 ns[%d];\n" % len(uris)
+    for i, uri in enumerate(uris):
+        uri = uri.replace("\"", "\\\"")
+        code += "    ns[%d] = UA_Server_addNamespace(server, \"%s\");\n" % (i, uri)
+
+    code += """
+    UA_ByteString snapshot = UA_BYTESTRING_NULL;
+    if(retVal == UA_STATUSCODE_GOOD)
+        retVal = UA_Server_saveNodesetSnapshot(server, %d, ns, &snapshot);
+    if(retVal == UA_STATUSCODE_GOOD) {
+        FILE *fp = fopen(argv[1], "wb");
+        if(!fp || fwrite(snapshot.data, 1, snapshot.length, fp) != snapshot.length)
+            retVal = UA_STATUSCODE_BADINTERNALERROR;
+        if(fp)
+            fclose(fp);
+    }
+
+    if(retVal != UA_STATUSCODE_GOOD)
+        fprintf(stderr, "Could not create the snapshot: %%s\\n", UA_StatusCode_name(retVal));
+    UA_ByteString_clear(&snapshot);
+    UA_Server_delete(server);
+    return (retVal == UA_STATUSCODE_GOOD) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+""" % len(uris)
+
+    outfile = codecs.open(outfilename + "_snapshot.c", r"w+", encoding='utf-8')
+    outfile.write(code)
+    outfile.flush()
+    os.fsync(outfile)
+    outfile.close()
+
+def generateOpen62541Code(nodeset, outfilename, internal_headers=False, typesArray=[],
+                          snapshot=False):
     outfilebase = basename(outfilename)
     # Printing functions
     outfileh = codecs.open(outfilename + ".h", r"w+", encoding='utf-8')
@@ -317,3 +410,6 @@ UA_StatusCode retVal = UA_STATUSCODE_GOOD;""" % (outfilebase))
     os.fsync(outfilec)
     outfilec.close()
 
+    if snapshot:
+        generateSnapshotCode(nodeset, outfilename)
+
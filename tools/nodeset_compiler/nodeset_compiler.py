@@ -66,6 +66,11 @@ parser.add_argument('-t', '--types-array',
                     default=[],
                     help='Types array for the given namespace. Can be used mutliple times to define (in the same order as the .xml files, first for --existing, then --xml) the type arrays')
 
+parser.add_argument('--snapshot',
+                    action='store_true',
+                    dest="snapshot",
+                    help='Also generate <output file>_snapshot.c. This is a program that creates the nodes and saves them to a binary snapshot file. The snapshot is loaded at runtime with UA_Server_loadNodesetSnapshot (much faster than running the generated code)')
+
 parser.add_argument('-v', '--verbose', action='count',
                     default=1,
                     help='Make the script more verbose. Can be applied up to 4 times')
@@ -186,7 +191,8 @@ logger.info("Generating Code for Backend: {}".format(args.backend))
 if args.backend == "open62541":
     # Create the C code with the open62541 backend of the compiler
     from backend_open62541 import generateOpen62541Code
-    generateOpen62541Code(ns, args.outputFile, args.internal_headers, args.typesArray)
+    generateOpen62541Code(ns, args.outputFile, args.internal_headers, args.typesArray,
+                          args.snapshot)
 elif args.backend == "graphviz":
     from backend_graphviz import generateGraphvizCode
     generateGraphvizCode(ns, filename=args.outputFile)